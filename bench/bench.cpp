@@ -0,0 +1,298 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+#include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <QTemporaryDir>
+#include "generator.h"
+#include "predReader.h"
+#include "predWriter.h"
+#include "pogReader.h"
+#include "pogWriter.h"
+#include "readerCache.h"
+#include "binReader.h"
+#include "subCalculus.h"
+#include "fingerprint.h"
+
+static const unsigned int seed = 42;
+
+// Replaces the state variable v0 by a fresh expression
+static std::map<VarName,Expr> substitution(){
+    Generator gen(seed + 1);
+    std::map<VarName,Expr> map;
+    map[VarName::makeVarWithoutSuffix("v0")] = gen.expression(3);
+    return map;
+}
+
+/*
+ * Core operations
+ */
+
+static void BM_ExprSubst(benchmark::State &state){
+    Generator gen(seed);
+    Expr e = gen.expression(state.range(0));
+    std::map<VarName,Expr> map = substitution();
+    for(auto _ : state){
+        Expr c = e.copy();
+        c.subst(map);
+        benchmark::DoNotOptimize(c);
+    }
+}
+BENCHMARK(BM_ExprSubst)->DenseRange(4,12,4);
+
+static void BM_PredSubst_Nested(benchmark::State &state){
+    Generator gen(seed);
+    Pred p = gen.nestedQuantifiers(state.range(0));
+    std::map<VarName,Expr> map = substitution();
+    for(auto _ : state){
+        Pred c = p.copy();
+        c.subst(map);
+        benchmark::DoNotOptimize(c);
+    }
+}
+BENCHMARK(BM_PredSubst_Nested)->RangeMultiplier(4)->Range(4,256);
+
+static void BM_PredSubst_PO(benchmark::State &state){
+    Generator gen(seed);
+    Pred p = gen.proofObligation(state.range(0),4);
+    std::map<VarName,Expr> map = substitution();
+    for(auto _ : state){
+        Pred c = p.copy();
+        c.subst(map);
+        benchmark::DoNotOptimize(c);
+    }
+}
+BENCHMARK(BM_PredSubst_PO)->RangeMultiplier(4)->Range(4,256);
+
+static void BM_ExprCompare_Record(benchmark::State &state){
+    Generator gen1(seed);
+    Generator gen2(seed);
+    BType ty = gen1.recordType(state.range(0),2);
+    Expr e1 = gen1.record(ty);
+    Expr e2 = gen2.record(gen2.recordType(state.range(0),2));
+    for(auto _ : state)
+        benchmark::DoNotOptimize(Expr::compare(e1,e2));
+}
+BENCHMARK(BM_ExprCompare_Record)->RangeMultiplier(4)->Range(4,256);
+
+static void BM_PredCompare_Conjunction(benchmark::State &state){
+    Generator gen1(seed);
+    Generator gen2(seed);
+    Pred p1 = gen1.wideConjunction(state.range(0));
+    Pred p2 = gen2.wideConjunction(state.range(0));
+    for(auto _ : state)
+        benchmark::DoNotOptimize(Pred::compare(p1,p2));
+}
+BENCHMARK(BM_PredCompare_Conjunction)->RangeMultiplier(8)->Range(8,4096);
+
+static void BM_AlphaEquals(benchmark::State &state){
+    // same trees, with different suffixes for the bound variables
+    Generator gen1(seed,1);
+    Generator gen2(seed,1000000);
+    Pred p1 = gen1.proofObligation(state.range(0),5);
+    Pred p2 = gen2.proofObligation(state.range(0),5);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(Pred::alpha_equals(p1,p2));
+}
+BENCHMARK(BM_AlphaEquals)->RangeMultiplier(4)->Range(4,256);
+
+static void BM_AlphaEquals_Nested(benchmark::State &state){
+    Generator gen1(seed,1);
+    Generator gen2(seed,1000000);
+    Pred p1 = gen1.nestedQuantifiers(state.range(0));
+    Pred p2 = gen2.nestedQuantifiers(state.range(0));
+    for(auto _ : state)
+        benchmark::DoNotOptimize(Pred::alpha_equals(p1,p2));
+}
+BENCHMARK(BM_AlphaEquals_Nested)->RangeMultiplier(4)->Range(4,256);
+
+static void BM_AlphaHash(benchmark::State &state){
+    Generator gen(seed);
+    Pred p = gen.proofObligation(state.range(0),5);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(p.alpha_hash_combine(0));
+}
+BENCHMARK(BM_AlphaHash)->RangeMultiplier(4)->Range(4,256);
+
+static void BM_HashCombine(benchmark::State &state){
+    Generator gen(seed);
+    Pred p = gen.proofObligation(state.range(0),5);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(p.hash_combine(0));
+}
+BENCHMARK(BM_HashCombine)->RangeMultiplier(4)->Range(4,256);
+
+static void BM_Fingerprint(benchmark::State &state){
+    Generator gen(seed);
+    Pred p = gen.proofObligation(state.range(0),5);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(Fingerprint::of(p));
+}
+BENCHMARK(BM_Fingerprint)->RangeMultiplier(4)->Range(4,256);
+
+static void BM_FreeVars(benchmark::State &state){
+    Generator gen(seed);
+    Pred p = gen.proofObligation(state.range(0),5);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(p.getFreeVars());
+}
+BENCHMARK(BM_FreeVars)->RangeMultiplier(4)->Range(4,256);
+
+static void BM_SubCalculus_OpCalls(benchmark::State &state){
+    Generator gen(seed);
+    Subst s = gen.opCallChain(state.range(0));
+    Pred post = gen.predicate(3);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(SubCalculus::apply(s,post.copy()));
+}
+BENCHMARK(BM_SubCalculus_OpCalls)->RangeMultiplier(4)->Range(4,256);
+
+/*
+ * Readers and writers
+ */
+
+static std::vector<Pred> proofObligations(int n){
+    Generator gen(seed);
+    std::vector<Pred> res;
+    for(int i=0;i<n;i++)
+        res.push_back(gen.proofObligation(8,4));
+    return res;
+}
+
+static void BM_WriteXml(benchmark::State &state){
+    std::vector<Pred> pos = proofObligations(state.range(0));
+    std::vector<BType> typeInfos;
+    for(auto _ : state)
+        benchmark::DoNotOptimize(Generator::toXml(pos,typeInfos));
+}
+BENCHMARK(BM_WriteXml)->RangeMultiplier(8)->Range(8,512);
+
+static void BM_ReadXml_Dom(benchmark::State &state){
+    std::vector<BType> typeInfos;
+    QByteArray xml = Generator::toXml(proofObligations(state.range(0)),typeInfos);
+    for(auto _ : state){
+        QDomDocument doc;
+        doc.setContent(xml);
+        for(QDomElement goal = doc.documentElement().firstChildElement("Goal");
+                !goal.isNull(); goal = goal.nextSiblingElement("Goal"))
+            benchmark::DoNotOptimize(Xml::readPredicate(goal.firstChildElement(),typeInfos));
+    }
+    state.SetBytesProcessed(state.iterations() * xml.size());
+}
+BENCHMARK(BM_ReadXml_Dom)->RangeMultiplier(8)->Range(8,512);
+
+static void BM_ReadXml_Stream(benchmark::State &state){
+    std::vector<BType> typeInfos;
+    QByteArray xml = Generator::toXml(proofObligations(state.range(0)),typeInfos);
+    for(auto _ : state){
+        QXmlStreamReader stream(xml);
+        stream.readNextStartElement(); // Proof_Obligations
+        while(stream.readNextStartElement()){ // Goal
+            stream.readNextStartElement();
+            benchmark::DoNotOptimize(Xml::readPredicate(stream,typeInfos));
+            stream.skipCurrentElement();
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * xml.size());
+}
+BENCHMARK(BM_ReadXml_Stream)->RangeMultiplier(8)->Range(8,512);
+
+// 512 proof obligations read by 1, 2, 4 ... threads
+static void BM_ReadPog(benchmark::State &state){
+    std::vector<BType> typeInfos;
+    QByteArray xml = Generator::toPog(proofObligations(512),typeInfos);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(Xml::readProofObligations(xml,typeInfos,state.range(0)));
+    state.SetBytesProcessed(state.iterations() * xml.size());
+}
+BENCHMARK(BM_ReadPog)->RangeMultiplier(2)->Range(1,16)->UseRealTime();
+
+// Same, with every proof obligation found in the cache
+static void BM_ReadPog_Cached(benchmark::State &state){
+    std::vector<BType> typeInfos;
+    QByteArray xml = Generator::toPog(proofObligations(512),typeInfos);
+    QTemporaryDir dir;
+    Xml::ReaderCache cache(dir.path());
+    Xml::readProofObligations(xml,typeInfos,state.range(0),&cache); // fills the cache
+    for(auto _ : state)
+        benchmark::DoNotOptimize(Xml::readProofObligations(xml,typeInfos,state.range(0),&cache));
+    state.SetBytesProcessed(state.iterations() * xml.size());
+}
+BENCHMARK(BM_ReadPog_Cached)->RangeMultiplier(2)->Range(1,16)->UseRealTime();
+
+static void BM_WritePog(benchmark::State &state){
+    std::vector<BType> typeInfos;
+    QByteArray xml = Generator::toPog(proofObligations(state.range(0)),typeInfos);
+    std::vector<Xml::ProofObligation> pos = Xml::readProofObligations(xml,typeInfos);
+    int64_t bytes = 0;
+    for(auto _ : state){
+        QByteArray res;
+        Xml::POGWriter writer(&res);
+        for(auto &po : pos)
+            writer.writeProofObligation(po);
+        writer.finish();
+        bytes += res.size();
+    }
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_WritePog)->RangeMultiplier(8)->Range(8,512);
+
+static void BM_ReadBinary(benchmark::State &state){
+    Bin::Writer writer;
+    for(auto &p : proofObligations(state.range(0)))
+        writer.writePredicate(p);
+    std::string data = writer.data();
+    for(auto _ : state){
+        Bin::Reader reader(data.data(),data.size());
+        while(!reader.atEnd())
+            benchmark::DoNotOptimize(reader.readPredicate());
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ReadBinary)->RangeMultiplier(8)->Range(8,512);
+
+// End to end: read the goals, substitute in each of them, write them back
+static void BM_Pipeline(benchmark::State &state){
+    std::vector<BType> typeInfos;
+    QByteArray xml = Generator::toXml(proofObligations(state.range(0)),typeInfos);
+    std::map<VarName,Expr> map = substitution();
+    for(auto _ : state){
+        QXmlStreamReader in(xml);
+        QByteArray res;
+        QXmlStreamWriter out(&res);
+        std::map<BType,unsigned int> types;
+        out.writeStartDocument();
+        out.writeStartElement("Proof_Obligations");
+        in.readNextStartElement();
+        while(in.readNextStartElement()){
+            in.readNextStartElement();
+            Pred p = Xml::readPredicate(in,typeInfos);
+            in.skipCurrentElement();
+            p.subst(map);
+            out.writeStartElement("Goal");
+            Xml::writePredicate(out,types,p);
+            out.writeEndElement(); // Goal
+        }
+        out.writeEndElement(); // Proof_Obligations
+        out.writeEndDocument();
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetBytesProcessed(state.iterations() * xml.size());
+}
+BENCHMARK(BM_Pipeline)->RangeMultiplier(8)->Range(8,512);
+
+BENCHMARK_MAIN();
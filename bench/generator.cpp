@@ -0,0 +1,236 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "generator.h"
+#include <QXmlStreamWriter>
+#include "predWriter.h"
+#include "predDesc.h"
+
+Generator::Generator(unsigned int seed, int firstSuffix, int stateVars):
+    rng{seed},
+    nextSuffix{firstSuffix}
+{
+    for(int i=0;i<stateVars;i++)
+        state.push_back(TypedVar(VarName::makeVarWithoutSuffix("v" + std::to_string(i)),BType::INT));
+}
+
+Expr Generator::variable(){
+    // bound variables are preferred, as in the hypotheses of real proof obligations
+    if(!bound.empty() && pick(3) != 0){
+        auto &v = bound[pick(bound.size())];
+        return Expr::makeIdent(v.name,v.type);
+    }
+    auto &v = state[pick(state.size())];
+    return Expr::makeIdent(v.name,v.type);
+}
+
+TypedVar Generator::boundVariable(){
+    return TypedVar(VarName::makeVar("x",nextSuffix++),BType::INT);
+}
+
+Expr Generator::expression(int depth){
+    if(depth <= 0){
+        if(pick(4) == 0)
+            return Expr::makeInteger(std::to_string(pick(100)));
+        return variable();
+    }
+    static const Expr::BinaryOp ops[] = {
+        Expr::BinaryOp::IAddition, Expr::BinaryOp::ISubtraction,
+        Expr::BinaryOp::IMultiplication, Expr::BinaryOp::IDivision };
+    if(pick(5) == 0)
+        return Expr::makeUnaryExpr(Expr::UnaryOp::IMinus,expression(depth-1),BType::INT);
+    Expr lhs = expression(depth-1);
+    Expr rhs = expression(pick(depth));
+    return Expr::makeBinaryExpr(ops[pick(4)],std::move(lhs),std::move(rhs),BType::INT);
+}
+
+Pred Generator::comparison(int depth){
+    static const Pred::ComparisonOp ops[] = {
+        Pred::ComparisonOp::Equality, Pred::ComparisonOp::Ilt,
+        Pred::ComparisonOp::Ile, Pred::ComparisonOp::Igt };
+    Expr lhs = expression(depth);
+    Expr rhs = expression(pick(depth+1));
+    return Pred::makeExprComparison(ops[pick(4)],std::move(lhs),std::move(rhs));
+}
+
+Pred Generator::predicate(int depth){
+    if(depth <= 0)
+        return comparison(2);
+    switch(pick(6)){
+        case 0:
+            {
+                Pred lhs = predicate(depth-1);
+                Pred rhs = predicate(depth-1);
+                return Pred::makeImplication(std::move(lhs),std::move(rhs));
+            }
+        case 1:
+            return Pred::makeNegation(predicate(depth-1));
+        case 2:
+        case 3:
+            {
+                std::vector<Pred> vec;
+                int n = 2 + pick(3);
+                for(int i=0;i<n;i++)
+                    vec.push_back(predicate(depth-1));
+                if(pick(3) == 0)
+                    return Pred::makeDisjunction(std::move(vec));
+                return Pred::makeConjunction(std::move(vec));
+            }
+        default:
+            {
+                std::vector<TypedVar> vars;
+                int n = 1 + pick(2);
+                for(int i=0;i<n;i++)
+                    vars.push_back(boundVariable());
+                bound.insert(bound.end(),vars.begin(),vars.end());
+                Pred body = predicate(depth-1);
+                bound.erase(bound.end() - vars.size(),bound.end());
+                if(pick(2) == 0)
+                    return Pred::makeExists(vars,std::move(body));
+                return Pred::makeForall(vars,std::move(body));
+            }
+    }
+}
+
+Pred Generator::nestedQuantifiers(int depth){
+    std::vector<TypedVar> vars;
+    for(int i=0;i<depth;i++)
+        vars.push_back(boundVariable());
+    std::vector<Pred> vec;
+    for(size_t i=0;i<vars.size();i++){
+        Expr lhs = Expr::makeIdent(vars[i].name,BType::INT);
+        Expr rhs = (i+1 < vars.size()) ? Expr::makeIdent(vars[i+1].name,BType::INT) : variable();
+        vec.push_back(Pred::makeExprComparison(Pred::ComparisonOp::Ile,std::move(lhs),std::move(rhs)));
+    }
+    Pred res = Pred::makeConjunction(std::move(vec));
+    for(auto it = vars.rbegin(); it != vars.rend(); ++it)
+        res = Pred::makeForall({*it},std::move(res));
+    return res;
+}
+
+Pred Generator::wideConjunction(int width){
+    std::vector<Pred> vec;
+    for(int i=0;i<width;i++)
+        vec.push_back(comparison(1));
+    return Pred::makeConjunction(std::move(vec));
+}
+
+BType Generator::recordType(int fields, int depth){
+    std::vector<std::pair<std::string,BType>> vec;
+    for(int i=0;i<fields;i++){
+        std::string label = "f" + std::to_string(1000 + i); // sorted as strings
+        if(depth > 0 && i % 4 == 0)
+            vec.push_back({label,recordType(fields/2 + 1,depth-1)});
+        else if(i % 3 == 0)
+            vec.push_back({label,BType::BOOL});
+        else
+            vec.push_back({label,BType::INT});
+    }
+    return BType::STRUCT(vec);
+}
+
+Expr Generator::record(const BType &ty){
+    std::vector<std::pair<std::string,Expr>> fds;
+    for(auto &f : ty.toRecordType().fields){
+        switch(f.second.getKind()){
+            case BType::Kind::Struct:
+                fds.push_back({f.first,record(f.second)});
+                break;
+            case BType::Kind::BOOLEAN:
+                fds.push_back({f.first,pick(2) ? Expr::makeTRUE() : Expr::makeFALSE()});
+                break;
+            default:
+                fds.push_back({f.first,expression(1)});
+                break;
+        }
+    }
+    return Expr::makeRecord(std::move(fds),ty);
+}
+
+Subst Generator::opCallChain(int length){
+    TypedVar in(VarName::makeVarWithoutSuffix("in"),BType::INT);
+    TypedVar out(VarName::makeVarWithoutSuffix("out"),BType::INT);
+    std::vector<Subst> vec;
+    for(int i=0;i<length;i++){
+        // v(i+1) <-- op_i(v(i)) with PRE 0 <= in THEN out := in + i END
+        const TypedVar &arg = state[i % state.size()];
+        const TypedVar &res = state[(i+1) % state.size()];
+        std::vector<Expr> input;
+        input.push_back(Expr::makeIdent(arg.name,arg.type));
+        Pred pre = Pred::makeExprComparison(Pred::ComparisonOp::Ile,
+                Expr::makeInteger("0"),Expr::makeIdent(in.name,in.type));
+        std::vector<Expr> values;
+        values.push_back(Expr::makeBinaryExpr(Expr::BinaryOp::IAddition,
+                    Expr::makeIdent(in.name,in.type),Expr::makeInteger(std::to_string(i)),BType::INT));
+        Subst body = Subst::makeSimpleAssignment({out},std::move(values));
+        vec.push_back(Subst::makeOpCall("op" + std::to_string(i),std::move(input),{res},
+                    {in},{out},std::move(pre),std::move(body)));
+    }
+    return Subst::makeSequence(std::move(vec));
+}
+
+Pred Generator::proofObligation(int hyps, int depth){
+    std::vector<Pred> vec;
+    for(int i=0;i<hyps;i++)
+        vec.push_back(predicate(pick(depth+1)));
+    Pred goal = predicate(depth);
+    return Pred::makeImplication(Pred::makeConjunction(std::move(vec)),std::move(goal));
+}
+
+QByteArray Generator::toXml(const std::vector<Pred> &pos, std::vector<BType> &typeInfos){
+    QByteArray res;
+    QXmlStreamWriter stream(&res);
+    std::map<BType,unsigned int> types;
+    stream.writeStartDocument();
+    stream.writeStartElement("Proof_Obligations");
+    for(auto &p : pos){
+        stream.writeStartElement("Goal");
+        Xml::writePredicate(stream,types,p);
+        stream.writeEndElement(); // Goal
+    }
+    stream.writeEndElement(); // Proof_Obligations
+    stream.writeEndDocument();
+    typeInfos.resize(types.size());
+    for(auto &t : types)
+        typeInfos[t.second] = t.first;
+    return res;
+}
+
+QByteArray Generator::toPog(const std::vector<Pred> &pos, std::vector<BType> &typeInfos){
+    QByteArray res;
+    QXmlStreamWriter stream(&res);
+    std::map<BType,unsigned int> types;
+    stream.writeStartDocument();
+    stream.writeStartElement("Proof_Obligations");
+    for(auto &p : pos){
+        const Pred::Implication &imp = p.toImplication();
+        stream.writeStartElement("Proof_Obligation");
+        stream.writeStartElement("Hypothesis");
+        Xml::writePredicate(stream,types,imp.lhs);
+        stream.writeEndElement(); // Hypothesis
+        stream.writeStartElement("Simple_Goal");
+        stream.writeStartElement("Goal");
+        Xml::writePredicate(stream,types,imp.rhs);
+        stream.writeEndElement(); // Goal
+        stream.writeEndElement(); // Simple_Goal
+        stream.writeEndElement(); // Proof_Obligation
+    }
+    stream.writeEndElement(); // Proof_Obligations
+    stream.writeEndDocument();
+    typeInfos.resize(types.size());
+    for(auto &t : types)
+        typeInfos[t.second] = t.first;
+    return res;
+}
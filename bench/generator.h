@@ -0,0 +1,71 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <random>
+#include <QByteArray>
+#include "pred.h"
+#include "subst.h"
+
+/** \brief Seeded generator of synthetic proof obligations.
+ *
+ * Two generators built with the same seed produce the same trees. The
+ * bound variables are x$n, with n counted from firstSuffix, so that
+ * generators differing only by firstSuffix produce alpha-equivalent trees.
+ * The free variables are the integer state variables v0 ... v(n-1).
+ */
+class Generator {
+    public:
+        explicit Generator(unsigned int seed, int firstSuffix = 1, int stateVars = 16);
+
+        // Integer expression of the given depth
+        Expr expression(int depth);
+        // Predicate of the given depth mixing connectives and quantifiers
+        Pred predicate(int depth);
+        // !x1.(... !xn.(P) ...) where P mentions every xi
+        Pred nestedQuantifiers(int depth);
+        // Conjunction of width comparisons
+        Pred wideConjunction(int width);
+        // Struct type with the given number of fields, nested depth times
+        BType recordType(int fields, int depth);
+        // Record value of type ty
+        Expr record(const BType &ty);
+        // Sequence of length operation calls, each one feeding the next
+        Subst opCallChain(int length);
+        // hyp1 & ... & hypn => goal
+        Pred proofObligation(int hyps, int depth);
+
+        /* Proof obligations in the bxml format, each one in a Goal element.
+         * typeInfos receives the types referenced by the typref attributes. */
+        static QByteArray toXml(const std::vector<Pred> &pos, std::vector<BType> &typeInfos);
+        /* Same, as a POG document: each proof obligation hyp => goal is a
+         * Proof_Obligation element with one Hypothesis and one Simple_Goal. */
+        static QByteArray toPog(const std::vector<Pred> &pos, std::vector<BType> &typeInfos);
+
+    private:
+        std::mt19937 rng;
+        std::vector<TypedVar> state;
+        std::vector<TypedVar> bound; // variables in scope
+        int nextSuffix;
+
+        int pick(int n){ return std::uniform_int_distribution<int>(0,n-1)(rng); };
+        Expr variable();
+        TypedVar boundVariable();
+        Pred comparison(int depth);
+};
+
+#endif // GENERATOR_H
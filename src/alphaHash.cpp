@@ -0,0 +1,256 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "exprDesc.h"
+#include "predDesc.h"
+
+/* Alpha-invariant hashing.
+ *
+ * The nodes are hashed in prefix order, each one contributing its kind and its
+ * own data (operator, labels, literal, arity): this sequence determines the
+ * tree. A bound identifier contributes the de Bruijn level of its binder
+ * instead of its name, and a binder contributes the prefixes and types of its
+ * variables, which alpha_equals requires to be equal. */
+
+namespace {
+    // Entry of the explicit stack: a node to hash, or (both null) the end of
+    // the scope of the innermost binder
+    struct Item {
+        const Expr *expr;
+        const Pred *pred;
+    };
+
+    class AlphaHasher {
+        public:
+            explicit AlphaHasher(size_t seed):seed{seed}{};
+            size_t run(Item root);
+        private:
+            size_t seed;
+            Binders binders;
+            std::vector<Item> todo;
+
+            void push(const Expr &e){ todo.push_back({&e,nullptr}); };
+            void push(const Pred &p){ todo.push_back({nullptr,&p}); };
+            void add(int i){ seed = hashUtil::hash_combine_int(i,seed); };
+            void add(const std::string &s){ seed = hashUtil::hash_combine_string(s,seed); };
+            void add(const VarName &v);
+            void bind(const std::vector<TypedVar> &vars);
+            void hash(const Expr &e);
+            void hash(const Pred &p);
+    };
+
+    size_t AlphaHasher::run(Item root){
+        todo.push_back(root);
+        while(!todo.empty()){
+            Item it = todo.back();
+            todo.pop_back();
+            if(it.expr != nullptr)
+                hash(*it.expr);
+            else if(it.pred != nullptr)
+                hash(*it.pred);
+            else
+                binders.pop();
+        }
+        return seed;
+    }
+
+    void AlphaHasher::add(const VarName &v){
+        int level = binders.level(v);
+        if(level < 0){
+            seed = v.hash_combine(seed);
+        } else {
+            add(-1); // not confused with a free variable
+            add(level);
+        }
+    }
+
+    // The variables are in scope for the items pushed after this call
+    void AlphaHasher::bind(const std::vector<TypedVar> &vars){
+        add(vars.size());
+        for(auto &v : vars){
+            add(v.name.prefix());
+            seed = v.type.hash_combine(seed);
+        }
+        binders.push(vars);
+        todo.push_back({nullptr,nullptr});
+    }
+
+    void AlphaHasher::hash(const Expr &e){
+        add(static_cast<int>(e.getTag()));
+        switch(e.getTag()){
+            case Expr::EKind::IntegerLiteral:
+                add(e.getIntegerLiteral());
+                return;
+            case Expr::EKind::StringLiteral:
+                add(e.getStringLiteral());
+                return;
+            case Expr::EKind::RealLiteral:
+                add(e.getRealLiteral().integerPart);
+                add(e.getRealLiteral().fractionalPart);
+                return;
+            case Expr::EKind::Id:
+                add(e.getId());
+                return;
+            case Expr::EKind::UnaryExpr:
+                {
+                    auto &u = e.toUnaryExpr();
+                    add(static_cast<int>(u.op));
+                    push(u.content);
+                    return;
+                }
+            case Expr::EKind::BinaryExpr:
+                {
+                    auto &b = e.toBinaryExpr();
+                    add(static_cast<int>(b.op));
+                    push(b.rhs);
+                    push(b.lhs);
+                    return;
+                }
+            case Expr::EKind::TernaryExpr:
+                {
+                    auto &t = e.toTernaryExpr();
+                    add(static_cast<int>(t.op));
+                    push(t.thd);
+                    push(t.snd);
+                    push(t.fst);
+                    return;
+                }
+            case Expr::EKind::NaryExpr:
+                {
+                    auto &n = e.toNaryExpr();
+                    add(static_cast<int>(n.op));
+                    add(n.vec.size());
+                    for(size_t i=n.vec.size();i>0;i--)
+                        push(n.vec[i-1]);
+                    return;
+                }
+            case Expr::EKind::BooleanExpr:
+                push(e.toBooleanExpr());
+                return;
+            case Expr::EKind::Struct:
+            case Expr::EKind::Record:
+                {
+                    auto &fields = (e.getTag() == Expr::EKind::Struct) ?
+                        e.toStructExpr().fields : e.toRecordExpr().fields;
+                    add(fields.size());
+                    for(auto &f : fields)
+                        add(f.first);
+                    for(size_t i=fields.size();i>0;i--)
+                        push(fields[i-1].second);
+                    return;
+                }
+            case Expr::EKind::QuantifiedSet:
+                {
+                    auto &q = e.toQuantifiedSet();
+                    bind(q.vars);
+                    push(q.cond);
+                    return;
+                }
+            case Expr::EKind::QuantifiedExpr:
+                {
+                    auto &q = e.toQuantiedExpr();
+                    add(static_cast<int>(q.op));
+                    bind(q.vars);
+                    push(q.body);
+                    push(q.cond);
+                    return;
+                }
+            case Expr::EKind::Record_Field_Update:
+                {
+                    auto &r = e.toRecordUpdate();
+                    add(r.label);
+                    push(r.fvalue);
+                    push(r.rec);
+                    return;
+                }
+            case Expr::EKind::Record_Field_Access:
+                {
+                    auto &r = e.toRecordAccess();
+                    add(r.label);
+                    push(r.rec);
+                    return;
+                }
+            default: // constants
+                return;
+        }
+    }
+
+    void AlphaHasher::hash(const Pred &p){
+        add(static_cast<int>(p.getTag()));
+        switch(p.getTag()){
+            case Pred::PKind::True:
+            case Pred::PKind::False:
+                return;
+            case Pred::PKind::Negation:
+                push(p.toNegation().operand);
+                return;
+            case Pred::PKind::Implication:
+                {
+                    auto &b = p.toImplication();
+                    push(b.rhs);
+                    push(b.lhs);
+                    return;
+                }
+            case Pred::PKind::Equivalence:
+                {
+                    auto &b = p.toEquivalence();
+                    push(b.rhs);
+                    push(b.lhs);
+                    return;
+                }
+            case Pred::PKind::ExprComparison:
+                {
+                    auto &c = p.toExprComparison();
+                    add(static_cast<int>(c.op));
+                    push(c.rhs);
+                    push(c.lhs);
+                    return;
+                }
+            case Pred::PKind::Conjunction:
+            case Pred::PKind::Disjunction:
+                {
+                    auto &vec = (p.getTag() == Pred::PKind::Conjunction) ?
+                        p.toConjunction().operands : p.toDisjunction().operands;
+                    add(vec.size());
+                    for(size_t i=vec.size();i>0;i--)
+                        push(vec[i-1]);
+                    return;
+                }
+            case Pred::PKind::Forall:
+                {
+                    auto &q = p.toForall();
+                    bind(q.vars);
+                    push(q.body);
+                    return;
+                }
+            case Pred::PKind::Exists:
+                {
+                    auto &q = p.toExists();
+                    bind(q.vars);
+                    push(q.body);
+                    return;
+                }
+        }
+        assert(false); // unreachable
+    }
+}
+
+size_t Expr::alpha_hash_combine(size_t seed) const {
+    return AlphaHasher(seed).run({this,nullptr});
+}
+
+size_t Pred::alpha_hash_combine(size_t seed) const {
+    return AlphaHasher(seed).run({nullptr,this});
+}
@@ -0,0 +1,110 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "arena.h"
+#include <new>
+
+static thread_local Arena *current_arena = nullptr;
+
+static const size_t alignment = alignof(std::max_align_t);
+
+static size_t align_up(size_t n){
+    return (n + alignment - 1) & ~(alignment - 1);
+}
+
+Arena::Arena(size_t chunkSize):
+    next{nullptr},
+    left{0},
+    chunkSize{chunkSize},
+    reserved{0}
+{}
+
+Arena::~Arena(){
+    for(auto c : chunks)
+        ::operator delete(c);
+}
+
+void* Arena::allocate(size_t size){
+    size = align_up(size);
+    if(size > left){
+        if(size > chunkSize / 4){
+            // large blocks get a chunk of their own, the current chunk is kept
+            char *c = static_cast<char*>(::operator new(size));
+            chunks.push_back(c);
+            reserved += size;
+            return c;
+        }
+        next = static_cast<char*>(::operator new(chunkSize));
+        chunks.push_back(next);
+        left = chunkSize;
+        reserved += chunkSize;
+    }
+    void *res = next;
+    next += size;
+    left -= size;
+    return res;
+}
+
+Arena* Arena::current(){
+    return current_arena;
+}
+
+Arena::Scope::Scope(Arena &arena):
+    previous{current_arena}
+{
+    current_arena = &arena;
+}
+
+Arena::Scope::~Scope(){
+    current_arena = previous;
+}
+
+Arena::Suspend::Suspend():
+    previous{current_arena}
+{
+    current_arena = nullptr;
+}
+
+Arena::Suspend::~Suspend(){
+    current_arena = previous;
+}
+
+namespace {
+    // Each node is preceded by the arena it comes from (nullptr for the heap)
+    struct alignas(alignof(std::max_align_t)) Header {
+        Arena *arena;
+    };
+}
+
+void* Arena::Allocated::operator new(size_t size){
+    Header *h;
+    if(current_arena == nullptr){
+        h = static_cast<Header*>(::operator new(sizeof(Header) + size));
+        h->arena = nullptr;
+    } else {
+        h = static_cast<Header*>(current_arena->allocate(sizeof(Header) + size));
+        h->arena = current_arena;
+    }
+    return h + 1;
+}
+
+void Arena::Allocated::operator delete(void *p){
+    if(p == nullptr)
+        return;
+    Header *h = static_cast<Header*>(p) - 1;
+    if(h->arena == nullptr)
+        ::operator delete(h);
+    // otherwise the memory is released with the arena
+}
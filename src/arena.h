@@ -0,0 +1,117 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/** \brief Region allocator for the nodes of a document.
+ *
+ * While an Arena::Scope is active on a thread, every AST descriptor created
+ * on that thread is bump-allocated from the arena instead of the heap.
+ * Deleting such a node only runs its destructor: the memory is given back
+ * in one operation when the arena is destroyed.
+ *
+ * The arena must outlive every node allocated from it.
+ */
+class Arena {
+    public:
+        explicit Arena(size_t chunkSize = 64 * 1024);
+        ~Arena();
+        Arena(const Arena &) = delete;
+        Arena& operator=(const Arena &) = delete;
+
+        // Returns a block of at least size bytes, aligned for any scalar type
+        void* allocate(size_t size);
+        // Number of bytes reserved from the system
+        size_t capacity() const { return reserved; };
+
+        // Arena installed on the current thread (nullptr if none)
+        static Arena* current();
+
+        class Scope;
+        class Suspend;
+        class Allocated;
+        template <class T> class Allocator;
+
+        // Wraps a freshly allocated node. The control block is taken from
+        // the current arena, if any.
+        template <class T> static std::shared_ptr<T> share(T *p);
+
+    private:
+        std::vector<char*> chunks;
+        char *next;
+        size_t left;
+        const size_t chunkSize;
+        size_t reserved;
+};
+
+// Installs an arena on the current thread for the lifetime of the scope
+class Arena::Scope {
+    public:
+        explicit Scope(Arena &arena);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope& operator=(const Scope &) = delete;
+    private:
+        Arena *previous;
+};
+
+// Uninstalls the arena of the current thread, if any, for the lifetime of the scope
+class Arena::Suspend {
+    public:
+        Suspend();
+        ~Suspend();
+        Suspend(const Suspend &) = delete;
+        Suspend& operator=(const Suspend &) = delete;
+    private:
+        Arena *previous;
+};
+
+// Base class of the nodes that may be allocated in an arena
+class Arena::Allocated {
+    public:
+        static void* operator new(size_t size);
+        static void operator delete(void *p);
+};
+
+// Standard allocator drawing from an arena. Deallocation is a no-op.
+template <class T>
+class Arena::Allocator {
+    public:
+        typedef T value_type;
+        explicit Allocator(Arena *arena):arena{arena}{};
+        template <class U> Allocator(const Allocator<U> &other):arena{other.arena}{};
+        T* allocate(size_t n){ return static_cast<T*>(arena->allocate(n * sizeof(T))); };
+        void deallocate(T *, size_t){};
+        template <class U> bool operator==(const Allocator<U> &other) const { return arena == other.arena; };
+        template <class U> bool operator!=(const Allocator<U> &other) const { return arena != other.arena; };
+        Arena *arena;
+};
+
+template <class T>
+std::shared_ptr<T> Arena::share(T *p){
+    if(p == nullptr)
+        return nullptr;
+    Arena *arena = current();
+    if(arena == nullptr)
+        return std::shared_ptr<T>(p);
+    return std::shared_ptr<T>(p,std::default_delete<T>(),Allocator<T>(arena));
+}
+
+#endif // ARENA_H
@@ -0,0 +1,745 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "binReader.h"
+#include <cstring>
+
+namespace Bin {
+    // Checks that v is a value of the enumeration whose last value is last
+    template <typename E>
+    static E toEnum(uint64_t v, E last){
+        if(v > static_cast<uint64_t>(last))
+            throw ReaderException("Invalid node kind " + std::to_string(v) + ".");
+        return static_cast<E>(v);
+    }
+
+    uint64_t Reader::varint(){
+        uint64_t res = 0;
+        for(unsigned int shift = 0; shift < 64; shift += 7){
+            if(cur == end)
+                throw ReaderException("Unexpected end of data.");
+            unsigned char b = *cur++;
+            res |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if((b & 0x80) == 0)
+                return res;
+        }
+        throw ReaderException("Invalid varint.");
+    }
+
+    size_t Reader::count(){
+        uint64_t n = varint();
+        // every element takes at least one byte
+        if(n > static_cast<uint64_t>(end - cur))
+            throw ReaderException("Invalid element count " + std::to_string(n) + ".");
+        return n;
+    }
+
+    const std::string& Reader::str(){
+        uint64_t i = varint();
+        if(i >= strings.size())
+            throw ReaderException("Invalid string reference " + std::to_string(i) + ".");
+        return strings[i];
+    }
+
+    const BType& Reader::type(){
+        uint64_t i = varint();
+        if(i >= types.size())
+            throw ReaderException("Invalid type reference " + std::to_string(i) + ".");
+        return types[i];
+    }
+
+    const VarName& Reader::name(){
+        uint64_t i = varint();
+        if(i >= names.size())
+            throw ReaderException("Invalid identifier reference " + std::to_string(i) + ".");
+        return names[i];
+    }
+
+    const TagSet::List& Reader::tags(){
+        uint64_t i = varint();
+        if(i >= tagLists.size())
+            throw ReaderException("Invalid tag reference " + std::to_string(i) + ".");
+        return tagLists[i];
+    }
+
+    std::vector<TypedVar> Reader::vars(){
+        size_t n = count();
+        std::vector<TypedVar> res;
+        res.reserve(n);
+        for(size_t i=0;i<n;i++){
+            const VarName &v = name();
+            res.push_back(TypedVar(v,type()));
+        }
+        return res;
+    }
+
+    Reader::Reader(const char *data, size_t size):
+        cur{reinterpret_cast<const unsigned char*>(data)},
+        end{reinterpret_cast<const unsigned char*>(data) + size}
+    {
+        if(size < sizeof(magic) || memcmp(data,magic,sizeof(magic)) != 0)
+            throw ReaderException("Not a BAST binary file.");
+        cur += sizeof(magic);
+        uint64_t v = varint();
+        if(v != version)
+            throw ReaderException("Unsupported version " + std::to_string(v) + ".");
+
+        size_t n = count();
+        strings.reserve(n);
+        for(size_t i=0;i<n;i++){
+            size_t len = count();
+            strings.emplace_back(reinterpret_cast<const char*>(cur),len);
+            cur += len;
+        }
+
+        n = count();
+        types.reserve(n);
+        for(size_t i=0;i<n;i++){
+            switch(toEnum(varint(),BType::Kind::Struct)){
+                case BType::Kind::INTEGER:
+                    types.push_back(BType::INT);
+                    break;
+                case BType::Kind::BOOLEAN:
+                    types.push_back(BType::BOOL);
+                    break;
+                case BType::Kind::FLOAT:
+                    types.push_back(BType::FLOAT);
+                    break;
+                case BType::Kind::REAL:
+                    types.push_back(BType::REAL);
+                    break;
+                case BType::Kind::STRING:
+                    types.push_back(BType::STRING);
+                    break;
+                case BType::Kind::ProductType:
+                    {
+                        const BType &lhs = type();
+                        const BType &rhs = type();
+                        types.push_back(BType::PROD(lhs,rhs));
+                        break;
+                    }
+                case BType::Kind::PowerType:
+                    types.push_back(BType::POW(type()));
+                    break;
+                case BType::Kind::Struct:
+                    {
+                        size_t m = count();
+                        std::vector<std::pair<std::string,BType>> fields;
+                        for(size_t j=0;j<m;j++){
+                            const std::string &label = str();
+                            fields.push_back({label,type()});
+                        }
+                        types.push_back(BType::STRUCT(fields));
+                        break;
+                    }
+            }
+        }
+
+        n = count();
+        names.reserve(n);
+        for(size_t i=0;i<n;i++){
+            VarName::Kind kind = toEnum(varint(),VarName::Kind::Tmp);
+            const std::string &prefix = str();
+            switch(kind){
+                case VarName::Kind::NoSuffix:
+                    names.push_back(VarName::makeVarWithoutSuffix(prefix));
+                    break;
+                case VarName::Kind::WithSuffix:
+                    {
+                        uint64_t suffix = varint();
+                        if(suffix == 0 || suffix > INT32_MAX)
+                            throw ReaderException("Invalid suffix " + std::to_string(suffix) + ".");
+                        names.push_back(VarName::makeVar(prefix,suffix));
+                        break;
+                    }
+                case VarName::Kind::FreshId:
+                    names.push_back(VarName::makeFreshId(prefix));
+                    break;
+                case VarName::Kind::Tmp:
+                    // temporary identifiers only need to be distinct from each other
+                    names.push_back(VarName::makeTmp(prefix));
+                    break;
+            }
+        }
+
+        n = count();
+        tagLists.reserve(n);
+        for(size_t i=0;i<n;i++){
+            size_t m = count();
+            TagSet::List list;
+            for(size_t j=0;j<m;j++)
+                list.push_back(str());
+            tagLists.push_back(list);
+        }
+    }
+
+    void Reader::root(Root r){
+        if(cur == end)
+            throw ReaderException("Unexpected end of data.");
+        if(*cur++ != static_cast<unsigned char>(r))
+            throw ReaderException("Unexpected kind of tree.");
+    }
+
+    /* The operands of the non-binding operators are read with an explicit
+     * stack, so that chains such as ((a+b)+c)+... do not use the call stack.
+     * next(f,res) reads the header of a node: for an operator, it fills the
+     * frame f and returns true, otherwise it reads the whole node into res.
+     * f.make() builds the operator once its operands are read. */
+    template <typename T, typename Frame, typename Next>
+    static T readOperators(Next next){
+        std::vector<Frame> stack;
+        for(;;){
+            Frame f;
+            T res;
+            if(next(f,res)){
+                if(f.arity > 0){
+                    f.operands.reserve(f.arity);
+                    stack.push_back(std::move(f));
+                    continue;
+                }
+                res = f.make();
+            }
+            while(!stack.empty()){
+                Frame &top = stack.back();
+                top.operands.push_back(std::move(res));
+                if(top.operands.size() < top.arity)
+                    break;
+                res = top.make();
+                stack.pop_back();
+            }
+            if(stack.empty())
+                return res;
+        }
+    }
+
+    struct Reader::ExprFrame {
+        Expr::EKind tag;
+        const BType *type;
+        const TagSet::List *bxmlTag;
+        uint64_t op; // checked by toEnum
+        const std::string *label; // of the record operators
+        size_t arity;
+        std::vector<Expr> operands;
+        Expr make();
+    };
+
+    Expr Reader::expr(){
+        return readOperators<Expr,ExprFrame>(
+                [this](ExprFrame &f, Expr &res){ return exprOperator(f,res); });
+    }
+
+    bool Reader::exprOperator(ExprFrame &f, Expr &res){
+        f.tag = toEnum(varint(),Expr::EKind::Predecessor);
+        f.type = &type();
+        f.bxmlTag = &tags();
+        switch(f.tag){
+            case Expr::EKind::UnaryExpr:
+                f.op = static_cast<uint64_t>(toEnum(varint(),Expr::UnaryOp::Bin));
+                f.arity = 1;
+                return true;
+            case Expr::EKind::BinaryExpr:
+                f.op = static_cast<uint64_t>(toEnum(varint(),Expr::BinaryOp::Arity));
+                f.arity = 2;
+                return true;
+            case Expr::EKind::TernaryExpr:
+                f.op = static_cast<uint64_t>(toEnum(varint(),Expr::TernaryOp::Bin));
+                f.arity = 3;
+                return true;
+            case Expr::EKind::NaryExpr:
+                f.op = static_cast<uint64_t>(toEnum(varint(),Expr::NaryOp::Set));
+                f.arity = count();
+                return true;
+            case Expr::EKind::Record_Field_Access:
+                f.label = &str();
+                f.arity = 1;
+                return true;
+            case Expr::EKind::Record_Field_Update:
+                f.label = &str();
+                f.arity = 2;
+                return true;
+            default:
+                res = exprNode(f.tag,*f.type,*f.bxmlTag);
+                return false;
+        }
+    }
+
+    Expr Reader::ExprFrame::make(){
+        std::vector<Expr> &ops = operands;
+        switch(tag){
+            case Expr::EKind::UnaryExpr:
+                return Expr::makeUnaryExpr(static_cast<Expr::UnaryOp>(op),std::move(ops[0]),*type,*bxmlTag);
+            case Expr::EKind::BinaryExpr:
+                return Expr::makeBinaryExpr(static_cast<Expr::BinaryOp>(op),std::move(ops[0]),std::move(ops[1]),*type,*bxmlTag);
+            case Expr::EKind::TernaryExpr:
+                return Expr::makeTernaryExpr(static_cast<Expr::TernaryOp>(op),std::move(ops[0]),std::move(ops[1]),std::move(ops[2]),*type,*bxmlTag);
+            case Expr::EKind::NaryExpr:
+                return Expr::makeNaryExpr(static_cast<Expr::NaryOp>(op),std::move(ops),*type,*bxmlTag);
+            case Expr::EKind::Record_Field_Access:
+                return Expr::makeRecordFieldAccess(std::move(ops[0]),*label,*type,*bxmlTag);
+            case Expr::EKind::Record_Field_Update:
+                return Expr::makeRecordFieldUpdate(std::move(ops[0]),*label,std::move(ops[1]),*type,*bxmlTag);
+            default:
+                throw ReaderException("Invalid tag."); // unreachable: see exprOperator
+        }
+    }
+
+    // The nodes that are not read by exprOperator
+    Expr Reader::exprNode(Expr::EKind tag, const BType &ty, const TagSet::List &bxmlTag){
+        switch(tag){
+            case Expr::EKind::MaxInt:
+                return Expr::makeMaxInt(bxmlTag);
+            case Expr::EKind::MinInt:
+                return Expr::makeMinInt(bxmlTag);
+            case Expr::EKind::INTEGER:
+                return Expr::makeINTEGER(bxmlTag);
+            case Expr::EKind::NATURAL:
+                return Expr::makeNATURAL(bxmlTag);
+            case Expr::EKind::NATURAL1:
+                return Expr::makeNATURAL1(bxmlTag);
+            case Expr::EKind::INT:
+                return Expr::makeINT(bxmlTag);
+            case Expr::EKind::NAT:
+                return Expr::makeNAT(bxmlTag);
+            case Expr::EKind::NAT1:
+                return Expr::makeNAT1(bxmlTag);
+            case Expr::EKind::STRING:
+                return Expr::makeSTRING(bxmlTag);
+            case Expr::EKind::BOOL:
+                return Expr::makeBOOL(bxmlTag);
+            case Expr::EKind::REAL:
+                return Expr::makeREAL(bxmlTag);
+            case Expr::EKind::FLOAT:
+                return Expr::makeFLOAT(bxmlTag);
+            case Expr::EKind::TRUE:
+                return Expr::makeTRUE(bxmlTag);
+            case Expr::EKind::FALSE:
+                return Expr::makeFALSE(bxmlTag);
+            case Expr::EKind::EmptySet:
+                return Expr::makeEmptySet(ty,bxmlTag);
+            case Expr::EKind::Successor:
+                return Expr::makeSuccessor(ty,bxmlTag);
+            case Expr::EKind::Predecessor:
+                return Expr::makePredecessor(ty,bxmlTag);
+            case Expr::EKind::IntegerLiteral:
+                return Expr::makeInteger(str(),bxmlTag);
+            case Expr::EKind::StringLiteral:
+                return Expr::makeString(str(),bxmlTag);
+            case Expr::EKind::RealLiteral:
+                {
+                    const std::string &integerPart = str();
+                    const std::string &fractionalPart = str();
+                    return Expr::makeReal(Expr::Decimal(integerPart,fractionalPart),bxmlTag);
+                }
+            case Expr::EKind::Id:
+                return Expr::makeIdent(name(),ty,bxmlTag);
+            case Expr::EKind::BooleanExpr:
+                return Expr::makeBooleanExpr(pred(),bxmlTag);
+            case Expr::EKind::QuantifiedExpr:
+                {
+                    Expr::QuantifiedOp op = toEnum(varint(),Expr::QuantifiedOp::RProduct);
+                    std::vector<TypedVar> vars = this->vars();
+                    Pred cond = pred();
+                    Expr body = expr();
+                    return Expr::makeQuantifiedExpr(op,vars,std::move(cond),std::move(body),ty,bxmlTag);
+                }
+            case Expr::EKind::QuantifiedSet:
+                {
+                    std::vector<TypedVar> vars = this->vars();
+                    return Expr::makeQuantifiedSet(vars,pred(),ty,bxmlTag);
+                }
+            case Expr::EKind::UnaryExpr:
+            case Expr::EKind::BinaryExpr:
+            case Expr::EKind::TernaryExpr:
+            case Expr::EKind::NaryExpr:
+            case Expr::EKind::Record_Field_Access:
+            case Expr::EKind::Record_Field_Update:
+                break; // read by exprOperator
+            case Expr::EKind::Struct:
+            case Expr::EKind::Record:
+                {
+                    size_t n = count();
+                    std::vector<std::pair<std::string,Expr>> fds;
+                    fds.reserve(n);
+                    for(size_t i=0;i<n;i++){
+                        const std::string &label = str();
+                        fds.push_back({label,expr()});
+                    }
+                    if(tag == Expr::EKind::Struct)
+                        return Expr::makeStruct(std::move(fds),ty,bxmlTag);
+                    else
+                        return Expr::makeRecord(std::move(fds),ty,bxmlTag);
+                }
+        }
+        throw ReaderException("Invalid tag."); // unreachable: the tags are checked by toEnum
+    }
+
+    struct Reader::PredFrame {
+        Pred::PKind tag;
+        const std::string *goalTag;
+        size_t arity;
+        std::vector<Pred> operands;
+        Pred make();
+    };
+
+    Pred Reader::pred(){
+        return readOperators<Pred,PredFrame>(
+                [this](PredFrame &f, Pred &res){ return predOperator(f,res); });
+    }
+
+    bool Reader::predOperator(PredFrame &f, Pred &res){
+        f.tag = toEnum(varint(),Pred::PKind::False);
+        f.goalTag = &str();
+        switch(f.tag){
+            case Pred::PKind::Implication:
+            case Pred::PKind::Equivalence:
+                f.arity = 2;
+                return true;
+            case Pred::PKind::Negation:
+                f.arity = 1;
+                return true;
+            case Pred::PKind::Conjunction:
+            case Pred::PKind::Disjunction:
+                f.arity = count();
+                return true;
+            default:
+                res = predNode(f.tag,*f.goalTag);
+                return false;
+        }
+    }
+
+    Pred Reader::PredFrame::make(){
+        std::vector<Pred> &ops = operands;
+        switch(tag){
+            case Pred::PKind::Implication:
+                return Pred::makeImplication(std::move(ops[0]),std::move(ops[1]),*goalTag);
+            case Pred::PKind::Equivalence:
+                return Pred::makeEquivalence(std::move(ops[0]),std::move(ops[1]),*goalTag);
+            case Pred::PKind::Negation:
+                return Pred::makeNegation(std::move(ops[0]),*goalTag);
+            case Pred::PKind::Conjunction:
+                return Pred::makeConjunction(std::move(ops),*goalTag);
+            case Pred::PKind::Disjunction:
+                return Pred::makeDisjunction(std::move(ops),*goalTag);
+            default:
+                throw ReaderException("Invalid tag."); // unreachable: see predOperator
+        }
+    }
+
+    // The nodes that are not read by predOperator
+    Pred Reader::predNode(Pred::PKind tag, const std::string &goalTag){
+        switch(tag){
+            case Pred::PKind::Implication:
+            case Pred::PKind::Equivalence:
+            case Pred::PKind::Negation:
+            case Pred::PKind::Conjunction:
+            case Pred::PKind::Disjunction:
+                break; // read by predOperator
+            case Pred::PKind::Forall:
+                {
+                    std::vector<TypedVar> vars = this->vars();
+                    Pred body = pred();
+                    return Pred::makeForall(vars,std::move(body),goalTag);
+                }
+            case Pred::PKind::Exists:
+                {
+                    const bool witness = varint() != 0;
+                    std::vector<TypedVar> vars = this->vars();
+                    Pred body = pred();
+                    if(witness)
+                        return Pred::makeExistsForWitness(vars,std::move(body),goalTag);
+                    return Pred::makeExists(vars,std::move(body),goalTag);
+                }
+            case Pred::PKind::ExprComparison:
+                {
+                    Pred::ComparisonOp op = toEnum(varint(),Pred::ComparisonOp::Rgt);
+                    Expr lhs = expr();
+                    Expr rhs = expr();
+                    return Pred::makeExprComparison(op,std::move(lhs),std::move(rhs),goalTag);
+                }
+            case Pred::PKind::True:
+                return Pred::makeTrue(goalTag);
+            case Pred::PKind::False:
+                return Pred::makeFalse(goalTag);
+        }
+        throw ReaderException("Invalid tag."); // unreachable: the tags are checked by toEnum
+    }
+
+    GPred Reader::gpred(){
+        GPred::Kind kind = toEnum(varint(),GPred::Kind::LetFreshId);
+        switch(kind){
+            case GPred::Kind::Implication:
+            case GPred::Kind::Equivalence:
+                {
+                    GPred lhs = gpred();
+                    GPred rhs = gpred();
+                    if(kind == GPred::Kind::Implication)
+                        return GPred::makeImplication(std::move(lhs),std::move(rhs));
+                    else
+                        return GPred::makeEquivalence(std::move(lhs),std::move(rhs));
+                }
+            case GPred::Kind::ExprComparison:
+                {
+                    Pred::ComparisonOp op = toEnum(varint(),Pred::ComparisonOp::Rgt);
+                    Expr lhs = expr();
+                    Expr rhs = expr();
+                    return GPred::makeExprComparison(op,std::move(lhs),std::move(rhs));
+                }
+            case GPred::Kind::Negation:
+                return GPred::makeNegationPred(gpred());
+            case GPred::Kind::Conjunction:
+            case GPred::Kind::Disjunction:
+                {
+                    size_t n = count();
+                    std::vector<GPred> vec;
+                    vec.reserve(n);
+                    for(size_t i=0;i<n;i++)
+                        vec.push_back(gpred());
+                    if(kind == GPred::Kind::Conjunction)
+                        return GPred::makeConjunction(std::move(vec));
+                    else
+                        return GPred::makeDisjunction(std::move(vec));
+                }
+            case GPred::Kind::Forall:
+            case GPred::Kind::Exists:
+                {
+                    std::vector<TypedVar> vars = this->vars();
+                    GPred body = gpred();
+                    if(kind == GPred::Kind::Forall)
+                        return GPred::makeForall(vars,std::move(body));
+                    else
+                        return GPred::makeExists(vars,std::move(body));
+                }
+            case GPred::Kind::TaggedPred:
+                {
+                    const std::string &tag = str();
+                    return GPred::makeTaggedPred(tag,gpred());
+                }
+            case GPred::Kind::Sub:
+                {
+                    bool overflow = (varint() != 0);
+                    Subst sub = subst();
+                    GPred p = gpred();
+                    return GPred::makeSub(std::move(sub),std::move(p),overflow);
+                }
+            case GPred::Kind::NotSubNot:
+                {
+                    Subst sub = subst();
+                    Pred p = pred();
+                    return GPred::makeNotSubNot(std::move(sub),std::move(p));
+                }
+            case GPred::Kind::LetFreshId:
+                {
+                    const std::string &id = str();
+                    return GPred::makeLetFreshId(id,gpred());
+                }
+        }
+        throw ReaderException("Invalid tag."); // unreachable: the tags are checked by toEnum
+    }
+
+    struct Reader::SubstFrame {
+        Subst::SKind tag;
+        size_t arity;
+        std::vector<Subst> operands;
+        Subst make();
+    };
+
+    Subst Reader::subst(){
+        return readOperators<Subst,SubstFrame>(
+                [this](SubstFrame &f, Subst &res){ return substOperator(f,res); });
+    }
+
+    bool Reader::substOperator(SubstFrame &f, Subst &res){
+        f.tag = toEnum(varint(),Subst::SKind::Witness);
+        switch(f.tag){
+            case Subst::SKind::Block:
+                f.arity = 1;
+                return true;
+            case Subst::SKind::Sequence:
+            case Subst::SKind::Parallel:
+            case Subst::SKind::Choice:
+                f.arity = count();
+                return true;
+            default:
+                res = substNode(f.tag);
+                return false;
+        }
+    }
+
+    Subst Reader::SubstFrame::make(){
+        std::vector<Subst> &ops = operands;
+        switch(tag){
+            case Subst::SKind::Block:
+                return Subst::makeBlock(std::move(ops[0]));
+            case Subst::SKind::Sequence:
+                return Subst::makeSequence(std::move(ops));
+            case Subst::SKind::Parallel:
+                return Subst::makeParallel(std::move(ops));
+            case Subst::SKind::Choice:
+                return Subst::makeChoice(std::move(ops));
+            default:
+                throw ReaderException("Invalid tag."); // unreachable: see substOperator
+        }
+    }
+
+    // The nodes that are not read by substOperator
+    Subst Reader::substNode(Subst::SKind tag){
+        switch(tag){
+            case Subst::SKind::Block:
+            case Subst::SKind::Sequence:
+            case Subst::SKind::Parallel:
+            case Subst::SKind::Choice:
+                break; // read by substOperator
+            case Subst::SKind::Skip:
+                return Subst::makeSkip();
+            case Subst::SKind::Assert:
+            case Subst::SKind::IfThen:
+                {
+                    Pred p = pred();
+                    Subst s = subst();
+                    if(tag == Subst::SKind::Assert)
+                        return Subst::makeAssert(std::move(p),std::move(s));
+                    else
+                        return Subst::makeIfThen(std::move(p),std::move(s));
+                }
+            case Subst::SKind::IfThenElse:
+                {
+                    Pred p = pred();
+                    Subst s_if = subst();
+                    Subst s_else = subst();
+                    return Subst::makeIfThenElse(std::move(p),std::move(s_if),std::move(s_else));
+                }
+            case Subst::SKind::SimpleAssignment:
+                {
+                    std::vector<TypedVar> vars = this->vars();
+                    std::vector<Expr> values;
+                    values.reserve(vars.size());
+                    for(size_t i=0;i<vars.size();i++)
+                        values.push_back(expr());
+                    return Subst::makeSimpleAssignment(vars,std::move(values));
+                }
+            case Subst::SKind::Select:
+            case Subst::SKind::SelectElse:
+                {
+                    size_t n = count();
+                    std::vector<std::pair<Pred,Subst>> clauses;
+                    clauses.reserve(n);
+                    for(size_t i=0;i<n;i++){
+                        Pred p = pred();
+                        Subst s = subst();
+                        clauses.push_back({std::move(p),std::move(s)});
+                    }
+                    if(tag == Subst::SKind::Select)
+                        return Subst::makeSelect(std::move(clauses));
+                    else
+                        return Subst::makeSelectElse(std::move(clauses),subst());
+                }
+            case Subst::SKind::Case:
+            case Subst::SKind::CaseElse:
+                {
+                    Expr e = expr();
+                    size_t n = count();
+                    std::vector<Subst::CaseChoice> cases;
+                    cases.reserve(n);
+                    for(size_t i=0;i<n;i++){
+                        size_t m = count();
+                        std::vector<Expr> values;
+                        values.reserve(m);
+                        for(size_t j=0;j<m;j++)
+                            values.push_back(expr());
+                        Subst body = subst();
+                        cases.push_back({std::move(values),std::move(body)});
+                    }
+                    if(tag == Subst::SKind::Case)
+                        return Subst::makeCase(std::move(e),std::move(cases));
+                    else
+                        return Subst::makeCaseElse(std::move(e),std::move(cases),subst());
+                }
+            case Subst::SKind::Any:
+                {
+                    std::vector<TypedVar> vars = this->vars();
+                    Pred p = pred();
+                    Subst body = subst();
+                    return Subst::makeAny(vars,std::move(p),std::move(body));
+                }
+            case Subst::SKind::OperationCall:
+                {
+                    size_t n = count();
+                    std::vector<Expr> input;
+                    input.reserve(n);
+                    for(size_t i=0;i<n;i++)
+                        input.push_back(expr());
+                    std::vector<TypedVar> output = vars();
+                    uint64_t i = varint();
+                    if(i == operations.size()){
+                        // first call to the operation: its definition follows, numbered
+                        // before the definitions of the operations called in its body
+                        operations.emplace_back();
+                        const std::string &name = str();
+                        std::vector<TypedVar> op_input = vars();
+                        std::vector<TypedVar> op_output = vars();
+                        Pred op_precondition = pred();
+                        Subst op_body = subst();
+                        operations[i] = Subst::makeOperation(name,op_input,op_output,
+                                    std::move(op_precondition),std::move(op_body));
+                    } else if(i > operations.size() || operations[i] == nullptr){
+                        throw ReaderException("Invalid operation reference " + std::to_string(i) + ".");
+                    }
+                    std::shared_ptr<const Subst::Operation> op = operations[i];
+                    if(input.size() != op->input.size() || output.size() != op->output.size())
+                        throw ReaderException("Wrong number of parameters in call to operation " + op->name + ".");
+                    return Subst::makeOpCall(std::move(input),output,op);
+                }
+            case Subst::SKind::While:
+                {
+                    Pred cond = pred();
+                    Subst body = subst();
+                    Pred inv = pred();
+                    Expr var = expr();
+                    return Subst::makeWhile(std::move(cond),std::move(body),std::move(inv),std::move(var));
+                }
+            case Subst::SKind::Witness:
+                {
+                    size_t n = count();
+                    std::map<std::string,Expr> witnesses;
+                    for(size_t i=0;i<n;i++){
+                        const std::string &id = str();
+                        witnesses[id] = expr();
+                    }
+                    return Subst::makeWitness(std::move(witnesses),subst());
+                }
+        }
+        throw ReaderException("Invalid tag."); // unreachable: the tags are checked by toEnum
+    }
+
+    Expr Reader::readExpression(){
+        root(Root::Expr);
+        return expr();
+    }
+
+    Pred Reader::readPredicate(){
+        root(Root::Pred);
+        return pred();
+    }
+
+    GPred Reader::readGPredicate(){
+        root(Root::GPred);
+        return gpred();
+    }
+
+    Subst Reader::readSubstitution(){
+        root(Root::Subst);
+        return subst();
+    }
+}
@@ -0,0 +1,88 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BINREADER_H
+#define BINREADER_H
+
+#include <cstdint>
+#include "binWriter.h"
+
+namespace Bin {
+    class ReaderException : public std::exception
+    {
+        public:
+            ReaderException(const std::string desc):description{desc}{};
+            ~ReaderException() throw() {};
+            const char *what() const throw(){ return description.c_str(); };
+        private:
+            std::string description;
+    };
+
+    /* Reads the trees serialized by a Bin::Writer, in the order they were
+     * written. The tables are decoded by the constructor. The data must
+     * outlive the reader. Nodes are allocated in the current arena, if any
+     * (see Arena::Scope). */
+    class Reader {
+        public:
+            Reader(const char *data, size_t size);
+
+            // True when every tree has been read
+            bool atEnd() const { return cur == end; };
+
+            Expr readExpression();
+            Pred readPredicate();
+            GPred readGPredicate();
+            Subst readSubstitution();
+
+        private:
+            const unsigned char *cur;
+            const unsigned char *end;
+
+            // Tables
+            std::vector<std::string> strings;
+            std::vector<BType> types;
+            std::vector<VarName> names;
+            std::vector<TagSet::List> tagLists;
+            // Definitions of the operations called in the trees read so far
+            std::vector<std::shared_ptr<const Subst::Operation>> operations;
+
+            // Operators waiting for their operands (see readOperators)
+            struct ExprFrame;
+            struct PredFrame;
+            struct SubstFrame;
+
+            // Methods
+            uint64_t varint();
+            size_t count();
+            const std::string& str();
+            const BType& type();
+            const VarName& name();
+            const TagSet::List& tags();
+            std::vector<TypedVar> vars();
+            void root(Root r);
+            Expr expr();
+            bool exprOperator(ExprFrame &f, Expr &res);
+            Expr exprNode(Expr::EKind tag, const BType &ty, const TagSet::List &bxmlTag);
+            Pred pred();
+            bool predOperator(PredFrame &f, Pred &res);
+            Pred predNode(Pred::PKind tag, const std::string &goalTag);
+            GPred gpred();
+            Subst subst();
+            bool substOperator(SubstFrame &f, Subst &res);
+            Subst substNode(Subst::SKind tag);
+    };
+}
+
+#endif // BINREADER_H
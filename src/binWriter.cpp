@@ -0,0 +1,510 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "binWriter.h"
+#include "predDesc.h"
+
+namespace Bin {
+    const char magic[4] = {'B','A','S','T'};
+    const unsigned int version = 3;
+
+    static void putVarint(std::string &out, uint64_t v){
+        while(v >= 0x80){
+            out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<char>(v));
+    }
+
+    template <typename E>
+    static void putEnum(std::string &out, E e){
+        putVarint(out,static_cast<uint64_t>(e));
+    }
+
+    unsigned int Writer::str(const std::string &s){
+        auto it = strings.find(s);
+        if(it != strings.end())
+            return it->second;
+        unsigned int i = stringTable.size();
+        strings.insert({s,i});
+        stringTable.push_back(s);
+        return i;
+    }
+
+    unsigned int Writer::type(const BType &ty){
+        auto it = types.find(ty);
+        if(it != types.end())
+            return it->second;
+        // the components are written first, so that entries only refer to previous ones
+        std::string entry;
+        putEnum(entry,ty.getKind());
+        switch(ty.getKind()){
+            case BType::Kind::INTEGER:
+            case BType::Kind::BOOLEAN:
+            case BType::Kind::FLOAT:
+            case BType::Kind::REAL:
+            case BType::Kind::STRING:
+                break;
+            case BType::Kind::ProductType:
+                {
+                    auto &p = ty.toProductType();
+                    putVarint(entry,type(p.lhs));
+                    putVarint(entry,type(p.rhs));
+                    break;
+                }
+            case BType::Kind::PowerType:
+                putVarint(entry,type(ty.toPowerType().content));
+                break;
+            case BType::Kind::Struct:
+                {
+                    auto &fields = ty.toRecordType().fields;
+                    putVarint(entry,fields.size());
+                    for(auto &f : fields){
+                        putVarint(entry,str(f.first));
+                        putVarint(entry,type(f.second));
+                    }
+                    break;
+                }
+        }
+        unsigned int i = types.size();
+        types.insert({ty,i});
+        typeTable += entry;
+        return i;
+    }
+
+    unsigned int Writer::name(const VarName &v){
+        auto it = names.find(v);
+        if(it != names.end())
+            return it->second;
+        unsigned int i = names.size();
+        names.insert({v,i});
+        putEnum(nameTable,v.kind());
+        putVarint(nameTable,str(v.prefix()));
+        if(v.kind() == VarName::Kind::WithSuffix)
+            putVarint(nameTable,v.suffix());
+        return i;
+    }
+
+    unsigned int Writer::tags(const TagSet::List &bxmlTag){
+        std::vector<unsigned int> key;
+        for(auto &t : bxmlTag)
+            key.push_back(str(t));
+        auto it = tagLists.find(key);
+        if(it != tagLists.end())
+            return it->second;
+        unsigned int i = tagLists.size();
+        tagLists.insert({key,i});
+        putVarint(tagTable,key.size());
+        for(auto s : key)
+            putVarint(tagTable,s);
+        return i;
+    }
+
+    void Writer::vars(const std::vector<TypedVar> &vec){
+        putVarint(nodes,vec.size());
+        for(auto &v : vec){
+            putVarint(nodes,name(v.name));
+            putVarint(nodes,type(v.type));
+        }
+    }
+
+    /* The visitors write the content of a node, its header is written by the
+     * caller. When the sub-trees of the same kind come last in the content of
+     * a node, the visitor pushes them on the stack of the caller instead of
+     * recursing: they are written in the same prefix order, and chains of
+     * operators such as ((a+b)+c)+... do not use the call stack. */
+
+    class Writer::ExprVisitor : public Expr::Visitor {
+        public:
+            ExprVisitor(Writer &w, std::vector<const Expr*> &todo):w{w},todo{todo}{};
+            void visitConstant(const BType &, const TagSet::List &, EConstant){}
+            void visitIdent(const BType &, const TagSet::List &, const VarName &v){
+                putVarint(w.nodes,w.name(v));
+            }
+            void visitIntegerLiteral(const BType &, const TagSet::List &, const std::string &i){
+                putVarint(w.nodes,w.str(i));
+            }
+            void visitStringLiteral(const BType &, const TagSet::List &, const std::string &s){
+                putVarint(w.nodes,w.str(s));
+            }
+            void visitRealLiteral(const BType &, const TagSet::List &, const Expr::Decimal &d){
+                putVarint(w.nodes,w.str(d.integerPart));
+                putVarint(w.nodes,w.str(d.fractionalPart));
+            }
+            void visitUnaryExpression(const BType &, const TagSet::List &, Expr::UnaryOp op, const Expr &e){
+                putEnum(w.nodes,op);
+                todo.push_back(&e);
+            }
+            void visitBinaryExpression(const BType &, const TagSet::List &, Expr::BinaryOp op, const Expr &lhs, const Expr &rhs){
+                putEnum(w.nodes,op);
+                todo.push_back(&rhs);
+                todo.push_back(&lhs);
+            }
+            void visitTernaryExpression(const BType &, const TagSet::List &, Expr::TernaryOp op, const Expr &fst, const Expr &snd, const Expr &thd){
+                putEnum(w.nodes,op);
+                todo.push_back(&thd);
+                todo.push_back(&snd);
+                todo.push_back(&fst);
+            }
+            void visitNaryExpression(const BType &, const TagSet::List &, Expr::NaryOp op, const std::vector<Expr> &vec){
+                putEnum(w.nodes,op);
+                putVarint(w.nodes,vec.size());
+                for(auto it = vec.rbegin(); it != vec.rend(); ++it)
+                    todo.push_back(&*it);
+            }
+            void visitBooleanExpression(const BType &, const TagSet::List &, const Pred &p){
+                w.pred(p);
+            }
+            void visitRecord(const BType &, const TagSet::List &, const std::vector<std::pair<std::string,Expr>> &fds){
+                fields(fds);
+            }
+            void visitStruct(const BType &, const TagSet::List &, const std::vector<std::pair<std::string,Expr>> &fds){
+                fields(fds);
+            }
+            void visitQuantifiedExpr(const BType &, const TagSet::List &, Expr::QuantifiedOp op, const std::vector<TypedVar> vars, const Pred &cond, const Expr &body){
+                putEnum(w.nodes,op);
+                w.vars(vars);
+                w.pred(cond);
+                todo.push_back(&body);
+            }
+            void visitQuantifiedSet(const BType &, const TagSet::List &, const std::vector<TypedVar> vars, const Pred &cond){
+                w.vars(vars);
+                w.pred(cond);
+            }
+            void visitRecordUpdate(const BType &, const TagSet::List &, const Expr &rec, const std::string &label, const Expr &value){
+                putVarint(w.nodes,w.str(label));
+                todo.push_back(&value);
+                todo.push_back(&rec);
+            }
+            void visitRecordAccess(const BType &, const TagSet::List &, const Expr &rec, const std::string &label){
+                putVarint(w.nodes,w.str(label));
+                todo.push_back(&rec);
+            }
+        private:
+            Writer &w;
+            std::vector<const Expr*> &todo;
+            void fields(const std::vector<std::pair<std::string,Expr>> &fds){
+                putVarint(w.nodes,fds.size());
+                for(auto &f : fds){
+                    putVarint(w.nodes,w.str(f.first));
+                    w.expr(f.second);
+                }
+            }
+    };
+
+    class Writer::PredVisitor : public Pred::Visitor {
+        public:
+            PredVisitor(Writer &w, std::vector<const Pred*> &todo):w{w},todo{todo}{};
+            void visitImplication(const Pred &lhs, const Pred &rhs){
+                todo.push_back(&rhs);
+                todo.push_back(&lhs);
+            }
+            void visitEquivalence(const Pred &lhs, const Pred &rhs){
+                todo.push_back(&rhs);
+                todo.push_back(&lhs);
+            }
+            void visitExprComparison(Pred::ComparisonOp op, const Expr &lhs, const Expr &rhs){
+                putEnum(w.nodes,op);
+                w.expr(lhs);
+                w.expr(rhs);
+            }
+            void visitNegation(const Pred &p){
+                todo.push_back(&p);
+            }
+            void visitConjunction(const std::vector<Pred> &vec){
+                list(vec);
+            }
+            void visitDisjunction(const std::vector<Pred> &vec){
+                list(vec);
+            }
+            void visitForall(const std::vector<TypedVar> &vars, const Pred &p){
+                w.vars(vars);
+                todo.push_back(&p);
+            }
+            void visitExists(const std::vector<TypedVar> &vars, const Pred &p){
+                w.vars(vars);
+                todo.push_back(&p);
+            }
+            void visitTrue(){}
+            void visitFalse(){}
+        private:
+            Writer &w;
+            std::vector<const Pred*> &todo;
+            void list(const std::vector<Pred> &vec){
+                putVarint(w.nodes,vec.size());
+                for(auto it = vec.rbegin(); it != vec.rend(); ++it)
+                    todo.push_back(&*it);
+            }
+    };
+
+    class Writer::SubstVisitor : public Subst::Visitor {
+        public:
+            SubstVisitor(Writer &w, std::vector<const Subst*> &todo):w{w},todo{todo}{};
+            void visitSkip(){}
+            void visitBlock(const Subst &s){
+                todo.push_back(&s);
+            }
+            void visitAssert(const Pred &p, const Subst &s){
+                w.pred(p);
+                todo.push_back(&s);
+            }
+            void visitIfThen(const Pred &p, const Subst &s){
+                w.pred(p);
+                todo.push_back(&s);
+            }
+            void visitIfThenElse(const Pred &p, const Subst &s_if, const Subst &s_else){
+                w.pred(p);
+                todo.push_back(&s_else);
+                todo.push_back(&s_if);
+            }
+            void visitSimpleAssignment(const std::vector<TypedVar> &variables, const std::vector<Expr> &values){
+                w.vars(variables);
+                for(auto &e : values)
+                    w.expr(e);
+            }
+            void visitSelect(const std::vector<std::pair<Pred,Subst>> &clauses){
+                select(clauses);
+            }
+            void visitSelectElse(const std::vector<std::pair<Pred,Subst>> &clauses, const Subst &els){
+                select(clauses);
+                w.subst(els);
+            }
+            void visitCase(const Expr &e, const std::vector<Subst::CaseChoice> &cases){
+                w.expr(e);
+                choices(cases);
+            }
+            void visitCaseElse(const Expr &e, const std::vector<Subst::CaseChoice> &cases, const Subst &els){
+                w.expr(e);
+                choices(cases);
+                w.subst(els);
+            }
+            void visitAny(const std::vector<TypedVar> &vars, const Pred &p, const Subst &body){
+                w.vars(vars);
+                w.pred(p);
+                todo.push_back(&body);
+            }
+            void visitOpCall(const std::vector<Expr> &input, const std::vector<TypedVar> &output,
+                    const std::shared_ptr<const Subst::Operation> &op)
+            {
+                putVarint(w.nodes,input.size());
+                for(auto &e : input)
+                    w.expr(e);
+                w.vars(output);
+                auto it = w.operations.find(op.get());
+                if(it != w.operations.end()){
+                    putVarint(w.nodes,it->second);
+                    return;
+                }
+                unsigned int i = w.operationTable.size();
+                w.operations.insert({op.get(),i});
+                w.operationTable.push_back(op);
+                putVarint(w.nodes,i);
+                putVarint(w.nodes,w.str(op->name));
+                w.vars(op->input);
+                w.vars(op->output);
+                w.pred(op->precondition);
+                w.subst(op->body);
+            }
+            void visitWhile(const Pred &cond, const Subst &body, const Pred &inv, const Expr &var){
+                w.pred(cond);
+                w.subst(body);
+                w.pred(inv);
+                w.expr(var);
+            }
+            void visitSequence(const std::vector<Subst> &vec){
+                list(vec);
+            }
+            void visitParallel(const std::vector<Subst> &vec){
+                list(vec);
+            }
+            void visitChoice(const std::vector<Subst> &vec){
+                list(vec);
+            }
+            void visitWitness(const std::map<std::string,Expr> &witnesses, const Subst &body){
+                putVarint(w.nodes,witnesses.size());
+                for(auto &p : witnesses){
+                    putVarint(w.nodes,w.str(p.first));
+                    w.expr(p.second);
+                }
+                todo.push_back(&body);
+            }
+        private:
+            Writer &w;
+            std::vector<const Subst*> &todo;
+            void select(const std::vector<std::pair<Pred,Subst>> &clauses){
+                putVarint(w.nodes,clauses.size());
+                for(auto &c : clauses){
+                    w.pred(c.first);
+                    w.subst(c.second);
+                }
+            }
+            void choices(const std::vector<Subst::CaseChoice> &cases){
+                putVarint(w.nodes,cases.size());
+                for(auto &c : cases){
+                    putVarint(w.nodes,c.values.size());
+                    for(auto &v : c.values)
+                        w.expr(v);
+                    w.subst(c.body);
+                }
+            }
+            void list(const std::vector<Subst> &vec){
+                putVarint(w.nodes,vec.size());
+                for(auto it = vec.rbegin(); it != vec.rend(); ++it)
+                    todo.push_back(&*it);
+            }
+    };
+
+    void Writer::expr(const Expr &e){
+        std::vector<const Expr*> todo {&e};
+        ExprVisitor v(*this,todo);
+        while(!todo.empty()){
+            const Expr *n = todo.back();
+            todo.pop_back();
+            putEnum(nodes,n->getTag());
+            putVarint(nodes,type(n->getType()));
+            putVarint(nodes,tags(n->getBxmlTag()));
+            n->accept(v);
+        }
+    }
+
+    void Writer::pred(const Pred &p){
+        std::vector<const Pred*> todo {&p};
+        PredVisitor v(*this,todo);
+        while(!todo.empty()){
+            const Pred *n = todo.back();
+            todo.pop_back();
+            putEnum(nodes,n->getTag());
+            putVarint(nodes,str(n->getGoalTag()));
+            if(n->getTag() == Pred::PKind::Exists) // not given to the visitor
+                putVarint(nodes,n->toExists().allowWitnessInstanciation ? 1 : 0);
+            n->accept(v);
+        }
+    }
+
+    void Writer::subst(const Subst &s){
+        std::vector<const Subst*> todo {&s};
+        SubstVisitor v(*this,todo);
+        while(!todo.empty()){
+            const Subst *n = todo.back();
+            todo.pop_back();
+            putEnum(nodes,n->getTag());
+            n->accept(v);
+        }
+    }
+
+    // Same stack as the visitors above
+    void Writer::gpred(const GPred &root){
+        std::vector<const GPred*> todo {&root};
+        while(!todo.empty()){
+            const GPred &p = *todo.back();
+            todo.pop_back();
+            putEnum(nodes,p.getKind());
+            switch(p.getKind()){
+                case GPred::Kind::Implication:
+                    todo.push_back(&p.toImplication().rhs);
+                    todo.push_back(&p.toImplication().lhs);
+                    break;
+                case GPred::Kind::Equivalence:
+                    todo.push_back(&p.toEquivalence().rhs);
+                    todo.push_back(&p.toEquivalence().lhs);
+                    break;
+                case GPred::Kind::ExprComparison:
+                    {
+                        auto &c = p.toExprComparison();
+                        putEnum(nodes,c.op);
+                        expr(c.lhs);
+                        expr(c.rhs);
+                        break;
+                    }
+                case GPred::Kind::Negation:
+                    todo.push_back(&p.toNegationPred().content);
+                    break;
+                case GPred::Kind::Conjunction:
+                case GPred::Kind::Disjunction:
+                    {
+                        const std::vector<GPred> &content = (p.getKind() == GPred::Kind::Conjunction) ?
+                            p.toConjunction().content : p.toDisjunction().content;
+                        putVarint(nodes,content.size());
+                        for(auto it = content.rbegin(); it != content.rend(); ++it)
+                            todo.push_back(&*it);
+                        break;
+                    }
+                case GPred::Kind::Forall:
+                    vars(p.toForall().vars);
+                    todo.push_back(&p.toForall().body);
+                    break;
+                case GPred::Kind::Exists:
+                    vars(p.toExists().vars);
+                    todo.push_back(&p.toExists().body);
+                    break;
+                case GPred::Kind::TaggedPred:
+                    putVarint(nodes,str(p.toTaggedPred().tag));
+                    todo.push_back(&p.toTaggedPred().content);
+                    break;
+                case GPred::Kind::Sub:
+                    putVarint(nodes,p.toSub().overflow ? 1 : 0);
+                    subst(p.toSub().sub);
+                    todo.push_back(&p.toSub().pred);
+                    break;
+                case GPred::Kind::NotSubNot:
+                    subst(p.toNotSubNot().sub);
+                    pred(p.toNotSubNot().pred);
+                    break;
+                case GPred::Kind::LetFreshId:
+                    putVarint(nodes,str(p.toLetFreshId().id));
+                    todo.push_back(&p.toLetFreshId().pred);
+                    break;
+            }
+        }
+    }
+
+    void Writer::writeExpression(const Expr &e){
+        nodes.push_back(static_cast<char>(Root::Expr));
+        expr(e);
+    }
+
+    void Writer::writePredicate(const Pred &p){
+        nodes.push_back(static_cast<char>(Root::Pred));
+        pred(p);
+    }
+
+    void Writer::writeGPredicate(const GPred &p){
+        nodes.push_back(static_cast<char>(Root::GPred));
+        gpred(p);
+    }
+
+    void Writer::writeSubstitution(const Subst &s){
+        nodes.push_back(static_cast<char>(Root::Subst));
+        subst(s);
+    }
+
+    std::string Writer::data() const {
+        std::string res(magic,sizeof(magic));
+        putVarint(res,version);
+        putVarint(res,stringTable.size());
+        for(auto &s : stringTable){
+            putVarint(res,s.size());
+            res += s;
+        }
+        putVarint(res,types.size());
+        res += typeTable;
+        putVarint(res,names.size());
+        res += nameTable;
+        putVarint(res,tagLists.size());
+        res += tagTable;
+        res += nodes;
+        return res;
+    }
+}
@@ -0,0 +1,103 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BINWRITER_H
+#define BINWRITER_H
+
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "expr.h"
+#include "pred.h"
+#include "gpred.h"
+#include "subst.h"
+
+/** \brief Compact binary format for the abstract syntax trees.
+ *
+ * Layout (all integers are unsigned LEB128 varints):
+ *   magic "BAST", version,
+ *   string table: count, then (length, bytes) for each string,
+ *   type table: count, then one entry per type, children first,
+ *   name table: count, then (kind, prefix, [suffix]) for each identifier,
+ *   tag table: count, then (count, strings) for each list of bxml tags,
+ *   the nodes of each tree, written in prefix order.
+ * A predicate node starts with its tag and goal tag; an EXISTS node then
+ * tells whether it allows the instanciation of a witness (0 or 1).
+ * Nodes refer to the tables by index, so reading does no string lookup.
+ * The definitions of the called operations are numbered in the order they
+ * are met: a call gives the number of its definition, followed by the
+ * definition itself the first time only.
+ *
+ * The writer and the reader walk the chains of operators (arithmetic,
+ * connectives, sequences of substitutions...) with an explicit stack. The
+ * call stack still grows with the nesting of expressions in predicates and
+ * of predicates in expressions, with the nesting of quantifiers, records,
+ * SELECT, CASE and WHILE, and, for the reader, with the depth of the GPred
+ * connectives.
+ */
+namespace Bin {
+    extern const char magic[4];
+    extern const unsigned int version;
+
+    // Marks the beginning of each tree in the node stream
+    enum class Root : char { Expr = 'E', Pred = 'P', GPred = 'G', Subst = 'S' };
+
+    class Writer {
+        public:
+            Writer(){};
+
+            void writeExpression(const Expr &e);
+            void writePredicate(const Pred &p);
+            void writeGPredicate(const GPred &p);
+            void writeSubstitution(const Subst &s);
+
+            // Serialized form of the trees written so far, in the same order
+            std::string data() const;
+
+        private:
+            class ExprVisitor;
+            class PredVisitor;
+            class SubstVisitor;
+
+            // Tables
+            std::unordered_map<std::string,unsigned int> strings;
+            std::vector<std::string> stringTable;
+            std::map<BType,unsigned int> types;
+            std::string typeTable;
+            std::map<VarName,unsigned int> names;
+            std::string nameTable;
+            std::map<std::vector<unsigned int>,unsigned int> tagLists;
+            std::string tagTable;
+            // Definitions of the called operations, kept alive so that the addresses are not reused
+            std::map<const Subst::Operation*,unsigned int> operations;
+            std::vector<std::shared_ptr<const Subst::Operation>> operationTable;
+            // Nodes
+            std::string nodes;
+
+            // Methods
+            unsigned int str(const std::string &s);
+            unsigned int type(const BType &ty);
+            unsigned int name(const VarName &v);
+            unsigned int tags(const TagSet::List &bxmlTag);
+            void vars(const std::vector<TypedVar> &vec);
+            void expr(const Expr &e);
+            void pred(const Pred &p);
+            void gpred(const GPred &p);
+            void subst(const Subst &s);
+    };
+}
+
+#endif // BINWRITER_H
@@ -16,8 +16,78 @@
 
 #include <cassert>
 #include <algorithm>
+#include <mutex>
+#include <unordered_map>
 #include "btype.h"
 
+/* The interned types, indexed by their kind and the ids of their
+ * components. Interned types are never freed. */
+class BType::Table {
+    public:
+        BType intern(Kind kind, const std::shared_ptr<AbstractBType> &ptr){
+            Key key = makeKey(kind,*ptr);
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = types.find(key);
+            if(it != types.end())
+                return BType(kind,it->second);
+            ptr->id = next++;
+            ptr->hash = hashUtil::hash_combine_int(static_cast<int>(kind),ptr->hash_combine(0));
+            types.emplace(std::move(key),ptr);
+            return BType(kind,ptr);
+        }
+
+    private:
+        struct Key {
+            Kind kind;
+            std::vector<unsigned int> ids;
+            std::vector<std::string> labels;
+            bool operator==(const Key &other) const {
+                return kind == other.kind && ids == other.ids && labels == other.labels;
+            }
+        };
+        struct KeyHash {
+            size_t operator()(const Key &k) const {
+                size_t seed = hashUtil::hash_combine_int(static_cast<int>(k.kind),0);
+                for(auto i : k.ids)
+                    seed = hashUtil::hash_combine_int(i,seed);
+                for(auto &l : k.labels)
+                    seed = hashUtil::hash_combine_string(l,seed);
+                return seed;
+            }
+        };
+
+        static Key makeKey(Kind kind, const AbstractBType &ty){
+            Key key {kind,{},{}};
+            switch(kind){
+                case Kind::ProductType:
+                    key.ids.push_back(static_cast<const ProductType&>(ty).lhs.getId());
+                    key.ids.push_back(static_cast<const ProductType&>(ty).rhs.getId());
+                    break;
+                case Kind::PowerType:
+                    key.ids.push_back(static_cast<const PowerType&>(ty).content.getId());
+                    break;
+                case Kind::Struct:
+                    for(auto &fd : static_cast<const RecordType&>(ty).fields){
+                        key.labels.push_back(fd.first);
+                        key.ids.push_back(fd.second.getId());
+                    }
+                    break;
+                default:
+                    assert(false); // the other kinds are not interned
+            }
+            return key;
+        }
+
+        std::mutex mutex;
+        std::unordered_map<Key,std::shared_ptr<AbstractBType>,KeyHash> types;
+        unsigned int next = static_cast<unsigned int>(Kind::Struct) + 1;
+};
+
+BType BType::intern(Kind kind, const std::shared_ptr<AbstractBType> &ptr){
+    static Table table;
+    return table.intern(kind,ptr);
+}
+
 void BType::accept(Visitor &v) const {
     switch(kind){
         case Kind::INTEGER:
@@ -70,35 +140,22 @@ const BType BType::POW_STRING = POW(STRING);
 const BType BType::POW_REAL = POW(REAL);
 
 BType BType::PROD(const BType &lhs,const BType &rhs){
-    return BType(Kind::ProductType,std::make_shared<ProductType>(ProductType(lhs,rhs)));
+    return intern(Kind::ProductType,std::make_shared<ProductType>(ProductType(lhs,rhs)));
 };
 BType BType::POW(const BType &content){
-    return BType(Kind::PowerType,std::make_shared<PowerType>(PowerType(content)));
+    return intern(Kind::PowerType,std::make_shared<PowerType>(PowerType(content)));
 };
 BType BType::STRUCT(const std::vector<std::pair<std::string,BType>> &fields){
-    return BType(Kind::Struct,std::make_shared<RecordType>(RecordType(fields)));
+    return intern(Kind::Struct,std::make_shared<RecordType>(RecordType(fields)));
 }
 
+// The fields of a RecordType are sorted, see RecordType::sort
 int compare_field_vec(const std::vector<std::pair<std::string,BType>>& lhs, const std::vector<std::pair<std::string,BType>>& rhs){
     if(lhs.size() == rhs.size()){
-
-        struct {
-            bool operator()(const std::pair<std::string,BType> &a, const std::pair<std::string,BType> &b) const
-            {
-                return a.first < b.first;
-            }
-        } lessThan;
-
-        std::vector<std::pair<std::string,BType>> sorted_lhs(lhs.size());
-        partial_sort_copy(begin(lhs), end(lhs), begin(sorted_lhs), end(sorted_lhs),lessThan);
-
-        std::vector<std::pair<std::string,BType>> sorted_rhs(rhs.size());
-        partial_sort_copy(begin(rhs), end(rhs), begin(sorted_rhs), end(sorted_rhs),lessThan);
-
         size_t i = 0;
         while(i<lhs.size()){
-            auto &p1 = sorted_lhs.at(i);
-            auto &p2 = sorted_rhs.at(i);
+            auto &p1 = lhs.at(i);
+            auto &p2 = rhs.at(i);
             int res = p1.first.compare(p2.first);
             if(res != 0) return res;
             res = BType::compare(p1.second,p2.second);
@@ -111,7 +168,11 @@ int compare_field_vec(const std::vector<std::pair<std::string,BType>>& lhs, cons
     }
 };
 
+// Equal types are the same interned type. Distinct types are still ordered
+// structurally, so that the order does not depend on the interning order.
 int BType::compare(const BType &ty1, const BType& ty2){
+    if(ty1.getId() == ty2.getId())
+        return 0;
     if(ty1.kind == ty2.kind){
         switch(ty1.kind){
             case Kind::INTEGER:
@@ -146,7 +207,7 @@ int BType::compare(const BType &ty1, const BType& ty2){
 
 size_t BType::hash_combine(size_t seed) const {
     if(ptr != nullptr)
-        seed = ptr->hash_combine(seed);
+        return hashUtil::hash_combine_hash(ptr->hash,seed);
     return hashUtil::hash_combine_int(static_cast<int>(kind),seed);
 }
 
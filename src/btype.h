@@ -21,10 +21,17 @@
 #include <vector>
 #include "hash.h"
 
+/* Types are interned: PROD, POW and STRUCT return the unique instance of
+ * each distinct type, which is kept in a global (thread-safe) table. Two
+ * types are therefore equal if and only if they have the same id, and
+ * equality and hashing are O(1). */
 class BType {
 public:
     enum class Kind { INTEGER, BOOLEAN, FLOAT, REAL, STRING, ProductType, PowerType, Struct };
     Kind getKind() const { return kind; };
+    // Identifies the type among all the types created so far (the kinds
+    // without parameters use their own value)
+    unsigned int getId() const { return ptr == nullptr ? static_cast<unsigned int>(kind) : ptr->id; };
 
     class ProductType;
     class PowerType;
@@ -68,8 +75,8 @@ public:
     // Comparisons
     static int compare(const BType &v1, const BType& v2);
     static int vec_compare(const std::vector<BType> &v1, const std::vector<BType>& v2);
-    inline bool operator==(const BType& other) const { return compare(*this,other) == 0; }
-    inline bool operator!=(const BType& other) const { return compare(*this,other) != 0; }
+    inline bool operator==(const BType& other) const { return getId() == other.getId(); }
+    inline bool operator!=(const BType& other) const { return getId() != other.getId(); }
     inline bool operator< (const BType& other) const { return compare(*this,other) <  0; }
     inline bool operator> (const BType& other) const { return compare(*this,other) >  0; }
     inline bool operator<=(const BType& other) const { return compare(*this,other) <= 0; }
@@ -82,7 +89,11 @@ private:
         public:
             virtual void accept(Visitor &v) const = 0;
             virtual size_t hash_combine(size_t seed) const = 0;
+            // Set when the type is interned
+            unsigned int id = 0;
+            size_t hash = 0;
     };
+    class Table;
     Kind kind;
     std::shared_ptr<AbstractBType> ptr;
 
@@ -90,6 +101,8 @@ private:
         kind{kind},
         ptr{ptr}
     {};
+    // Returns the interned type equal to (kind,ptr)
+    static BType intern(Kind kind, const std::shared_ptr<AbstractBType> &ptr);
 };
 
 class BType::ProductType : public AbstractBType {
@@ -16,36 +16,124 @@
 #include<cassert>
 #include<cstring> // strcmp
 #include<utility> // swap
+#include<algorithm> // reverse
 #include<map>
 
 #include "exprDesc.h"
 #include "predDesc.h"
 
 Expr Expr::copy() const {
-    if(desc == nullptr) return Expr(tag,nullptr,type,bxmlTag);
-    else return Expr(tag,desc->copy(),type,bxmlTag);
+    return Expr(tag,desc,type,bxmlTag);
+}
+
+void Expr::detach(){
+    if(desc == nullptr)
+        return;
+    if(desc.use_count() > 1){
+        desc = std::shared_ptr<ExprDesc>(desc->copy());
+    } else {
+        desc->cachedHash.reset();
+        desc->freeVars.reset();
+    }
+}
+
+Expr::~Expr(){
+    // The sub-expressions of a desc owned by this expression alone are moved to
+    // an explicit stack and destroyed one at a time
+    if(desc == nullptr || desc.use_count() != 1)
+        return;
+    std::vector<Expr> todo;
+    desc->release(todo);
+    while(!todo.empty()){
+        Expr e = std::move(todo.back());
+        todo.pop_back();
+        if(e.desc != nullptr && e.desc.use_count() == 1){
+            e.desc->release(todo);
+            e.desc.reset();
+        }
+    }
+}
+
+template<typename F> void Expr::forEachScopeLeaf(F f) const {
+    std::vector<const Expr*> todo {this};
+    while(!todo.empty()){
+        const Expr *e = todo.back();
+        todo.pop_back();
+        if(e->desc == nullptr)
+            continue;
+        size_t n = todo.size();
+        e->desc->getChildren(todo);
+        if(todo.size() == n)
+            f(*e);
+    }
+}
+
+// The leaves compute their free variables directly, without a cache
+static bool cachesFreeVars(Expr::EKind tag){
+    switch(tag){
+        case Expr::EKind::Id:
+        case Expr::EKind::IntegerLiteral:
+        case Expr::EKind::StringLiteral:
+        case Expr::EKind::RealLiteral:
+            return false;
+        default:
+            return true;
+    }
+}
+
+const std::vector<VarName>& Expr::freeVars() const {
+    return desc->freeVars.get([this](){
+            std::set<VarName> fv;
+            forEachScopeLeaf([&](const Expr &e){ e.desc->getFreeVars({},fv); });
+            return fv; });
 }
 
 void Expr::getFreeVars(const std::set<VarName> &boundVars, const std::set<VarName> &freeVars, std::set<VarName>& freeVarsThis) const {
-    if(desc != nullptr)
+    if(desc == nullptr)
+        return;
+    if(!cachesFreeVars(tag)){
         desc->getFreeVars(boundVars,freeVars,freeVarsThis);
+        return;
+    }
+    for(auto &v : this->freeVars()){
+        if(boundVars.find(v) == boundVars.end() && freeVars.find(v) == freeVars.end())
+            freeVarsThis.insert(freeVarsThis.end(),v);
+    }
 }
 void Expr::getFreeVars(const std::set<VarName> &boundVars, std::set<VarName> &accu) const {
-    if(desc != nullptr)
+    if(desc == nullptr)
+        return;
+    if(!cachesFreeVars(tag)){
         desc->getFreeVars(boundVars,accu);
+        return;
+    }
+    for(auto &v : freeVars()){
+        if(boundVars.find(v) == boundVars.end())
+            accu.insert(accu.end(),v);
+    }
+}
+void Expr::getFreeVars(VarSet &accu) const {
+    if(desc == nullptr)
+        return;
+    if(!cachesFreeVars(tag)){
+        desc->getAllVars(accu); // the variables of a leaf are free
+        return;
+    }
+    auto &fv = freeVars();
+    accu.insert(fv.begin(),fv.end());
 }
 void Expr::getFreeTVars(const std::set<VarName> &boundVars, std::set<TypedVar> &accu) const {
-    if(desc != nullptr)
-        desc->getFreeTVars(boundVars,accu,type);
+    forEachScopeLeaf([&](const Expr &e){ e.desc->getFreeTVars(boundVars,accu,e.type); });
 }
 void Expr::substFreshId(const std::string &id, const VarName &v){
-    if(desc != nullptr)
+    if(desc != nullptr){
+        detach();
         desc->substFreshId(id,v);
+    }
 }
 
-void Expr::getAllVars(std::set<VarName> &accu) const {
-    if(desc != nullptr)
-        desc->getAllVars(accu);
+void Expr::getAllVars(VarSet &accu) const {
+    forEachScopeLeaf([&](const Expr &e){ e.desc->getAllVars(accu); });
 }
 
 class Expr::IntegerLiteral : public ExprDesc {
@@ -72,12 +160,12 @@ class Expr::IntegerLiteral : public ExprDesc {
         IntegerLiteral* copy() const {
             return new IntegerLiteral(value);
         }
-        void subst(const std::map<VarName,Expr> &map) {}
+        void subst(SubstEnv &env) {}
         void alpha(const std::map<VarName,VarName> &map) {}
         void getFreeVars(const std::set<VarName> &boundVars, const std::set<VarName> &freeVars, std::set<VarName>& freeVarsThis) const {}
         void getFreeVars(const std::set<VarName> &boundVars, std::set<VarName> &accu) const {}
         void getFreeTVars(const std::set<VarName> &boundVars, std::set<TypedVar> &accu, const BType &ty) const {}
-        void getAllVars(std::set<VarName> &accu) const {}
+        void getAllVars(VarSet &accu) const {}
         void substFreshId(const std::string &id, const VarName &v){}
 };
 
@@ -92,12 +180,12 @@ class Expr::StringLiteral : public ExprDesc {
         StringLiteral* copy() const {
             return new StringLiteral(value);
         }
-        void subst(const std::map<VarName,Expr> &map) {}
+        void subst(SubstEnv &env) {}
         void alpha(const std::map<VarName,VarName> &map) {}
         void getFreeVars(const std::set<VarName> &boundVars, const std::set<VarName> &freeVars, std::set<VarName>& freeVarsThis) const {}
         void getFreeVars(const std::set<VarName> &boundVars, std::set<VarName> &accu) const {}
         void getFreeTVars(const std::set<VarName> &boundVars, std::set<TypedVar> &accu, const BType &ty) const {}
-        void getAllVars(std::set<VarName> &accu) const {}
+        void getAllVars(VarSet &accu) const {}
         void substFreshId(const std::string &id, const VarName &v){}
 };
 
@@ -113,12 +201,12 @@ class Expr::RealLiteral : public ExprDesc {
         RealLiteral* copy() const {
             return new RealLiteral(value);
         }
-        void subst(const std::map<VarName,Expr> &map) {}
+        void subst(SubstEnv &env) {}
         void alpha(const std::map<VarName,VarName> &map) {}
         void getFreeVars(const std::set<VarName> &boundVars, const std::set<VarName> &freeVars, std::set<VarName>& freeVarsThis) const {}
         void getFreeVars(const std::set<VarName> &boundVars, std::set<VarName> &accu) const {}
         void getFreeTVars(const std::set<VarName> &boundVars, std::set<TypedVar> &accu, const BType &ty) const {}
-        void getAllVars(std::set<VarName> &accu) const {}
+        void getAllVars(VarSet &accu) const {}
         void substFreshId(const std::string &id, const VarName &v){}
 };
 
@@ -133,7 +221,7 @@ class Expr::IdentExpr : public ExprDesc {
         IdentExpr* copy() const {
             return new IdentExpr(value);
         }
-        void subst(const std::map<VarName,Expr> &map) {
+        void subst(SubstEnv &env) {
             assert(false); // should not be called
         }
         void alpha(const std::map<VarName,VarName> &map) {
@@ -156,7 +244,7 @@ class Expr::IdentExpr : public ExprDesc {
             if(boundVars.find(value) == boundVars.end())
                 accu.insert({value,ty});
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             accu.insert(value);
         }
         void substFreshId(const std::string &id, const VarName &v){
@@ -176,8 +264,8 @@ class Expr::BooleanExpr : public Expr::ExprDesc {
         BooleanExpr* copy() const {
             return new BooleanExpr(pred.copy());
         }
-        void subst(const std::map<VarName,Expr> &map) {
-            pred.subst(map);
+        void subst(SubstEnv &env) {
+            pred.subst(env);
         }
         void alpha(const std::map<VarName,VarName> &map) {
             pred.alpha(map);
@@ -191,7 +279,7 @@ class Expr::BooleanExpr : public Expr::ExprDesc {
         void getFreeTVars(const std::set<VarName> &boundVars, std::set<TypedVar> &accu, const BType &ty) const {
             pred.getFreeTVars(boundVars,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             pred.getAllVars(accu);
         }
         void substFreshId(const std::string &id, const VarName &v){
@@ -211,170 +299,170 @@ void Expr::accept(Visitor &visitor) const {
     switch(tag){
         case EKind::INTEGER:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::INTEGER);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::INTEGER);
                 break;
             }
         case EKind::NATURAL:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::NATURAL);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::NATURAL);
                 break;
             }
         case EKind::NATURAL1:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::NATURAL1);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::NATURAL1);
                 break;
             }
         case EKind::INT:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::INT);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::INT);
                 break;
             }
         case EKind::MaxInt:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::MaxInt);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::MaxInt);
                 break;
             }
         case EKind::MinInt:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::MinInt);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::MinInt);
                 break;
             }
         case EKind::NAT:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::NAT);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::NAT);
                 break;
             }
         case EKind::NAT1:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::NAT1);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::NAT1);
                 break;
             }
         case EKind::TRUE:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::TRUE);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::TRUE);
                 break;
             }
         case EKind::FALSE:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::FALSE);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::FALSE);
                 break;
             }
         case EKind::BOOL:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::BOOL);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::BOOL);
                 break;
             }
         case EKind::STRING:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::STRING);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::STRING);
                 break;
             }
         case EKind::REAL:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::REAL);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::REAL);
                 break;
             }
         case EKind::FLOAT:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::FLOAT);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::FLOAT);
                 break;
             }
         case EKind::Successor:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::Successor);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::Successor);
                 break;
             }
         case EKind::Predecessor:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::Predecessor);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::Predecessor);
                 break;
             }
         case EKind::EmptySet:
             {
-                visitor.visitConstant(type,bxmlTag,Visitor::EConstant::EmptySet);
+                visitor.visitConstant(type,getBxmlTag(),Visitor::EConstant::EmptySet);
                 break;
             }
         case EKind::Id:
             {
-                visitor.visitIdent(type,bxmlTag,static_cast<IdentExpr&>(*desc).value);
+                visitor.visitIdent(type,getBxmlTag(),static_cast<IdentExpr&>(*desc).value);
                 break;
             }
         case EKind::QuantifiedSet:
             {
                 QuantifiedSet& e = static_cast<QuantifiedSet&>(*desc);
-                visitor.visitQuantifiedSet(type,bxmlTag,e.vars,e.cond);
+                visitor.visitQuantifiedSet(type,getBxmlTag(),e.vars,e.cond);
                 break;
             }
         case EKind::QuantifiedExpr:
             {
                 QuantifiedExpr& e = static_cast<QuantifiedExpr&>(*desc);
-                visitor.visitQuantifiedExpr(type,bxmlTag,e.op,e.vars,e.cond,e.body);
+                visitor.visitQuantifiedExpr(type,getBxmlTag(),e.op,e.vars,e.cond,e.body);
                 break;
             }
         case EKind::IntegerLiteral:
             {
-                visitor.visitIntegerLiteral(type,bxmlTag,static_cast<IntegerLiteral&>(*desc).value);
+                visitor.visitIntegerLiteral(type,getBxmlTag(),static_cast<IntegerLiteral&>(*desc).value);
                 break;
             }
         case EKind::StringLiteral:
             {
-                visitor.visitStringLiteral(type,bxmlTag,static_cast<StringLiteral&>(*desc).value);
+                visitor.visitStringLiteral(type,getBxmlTag(),static_cast<StringLiteral&>(*desc).value);
                 break;
             }
         case EKind::RealLiteral:
             {
-                visitor.visitRealLiteral(type,bxmlTag,static_cast<RealLiteral&>(*desc).value);
+                visitor.visitRealLiteral(type,getBxmlTag(),static_cast<RealLiteral&>(*desc).value);
                 break;
             }
         case EKind::UnaryExpr:
             {
                 UnaryExpr& e = static_cast<UnaryExpr&>(*desc);
-                visitor.visitUnaryExpression(type,bxmlTag,e.op,e.content);
+                visitor.visitUnaryExpression(type,getBxmlTag(),e.op,e.content);
                 break;
             }
         case EKind::BinaryExpr:
             {
                 BinaryExpr& e = static_cast<BinaryExpr&>(*desc);
-                visitor.visitBinaryExpression(type,bxmlTag,e.op,e.lhs,e.rhs);
+                visitor.visitBinaryExpression(type,getBxmlTag(),e.op,e.lhs,e.rhs);
                 break;
             }
         case EKind::TernaryExpr:
             {
                 TernaryExpr& e = static_cast<TernaryExpr&>(*desc);
-                visitor.visitTernaryExpression(type,bxmlTag,e.op,e.fst,e.snd,e.thd);
+                visitor.visitTernaryExpression(type,getBxmlTag(),e.op,e.fst,e.snd,e.thd);
                 break;
             }
         case EKind::NaryExpr:
             {
                 NaryExpr& e = static_cast<NaryExpr&>(*desc);
-                visitor.visitNaryExpression(type,bxmlTag,e.op,e.vec);
+                visitor.visitNaryExpression(type,getBxmlTag(),e.op,e.vec);
                 break;
             }
         case EKind::BooleanExpr:
             {
-                visitor.visitBooleanExpression(type,bxmlTag,static_cast<BooleanExpr&>(*desc).pred);
+                visitor.visitBooleanExpression(type,getBxmlTag(),static_cast<BooleanExpr&>(*desc).pred);
                 break;
             }
         case EKind::Struct:
             {
-                visitor.visitStruct(type,bxmlTag,static_cast<StructExpr&>(*desc).fields);
+                visitor.visitStruct(type,getBxmlTag(),static_cast<StructExpr&>(*desc).fields);
                 break;
             }
         case EKind::Record:
             {
-                visitor.visitRecord(type,bxmlTag,static_cast<RecordExpr&>(*desc).fields);
+                visitor.visitRecord(type,getBxmlTag(),static_cast<RecordExpr&>(*desc).fields);
                 break;
             }
         case EKind::Record_Field_Access:
             {
                 RecordAccessExpr &acc = static_cast<RecordAccessExpr&>(*desc);
-                visitor.visitRecordAccess(type,bxmlTag,acc.rec,acc.label);
+                visitor.visitRecordAccess(type,getBxmlTag(),acc.rec,acc.label);
                 break;
             }
         case EKind::Record_Field_Update:
             {
                 RecordUpdateExpr &up = static_cast<RecordUpdateExpr&>(*desc);
-                visitor.visitRecordUpdate(type,bxmlTag,up.rec,up.label,up.fvalue);
+                visitor.visitRecordUpdate(type,getBxmlTag(),up.rec,up.label,up.fvalue);
                 break;
             }
 
@@ -458,162 +546,179 @@ const Expr::RecordUpdateExpr& Expr::toRecordUpdate() const {
 
 Expr::BinaryExpr& Expr::toBinaryExpr() {
     assert(tag == EKind::BinaryExpr);
+    detach();
     return static_cast<BinaryExpr&>(*desc);
 };
 
 Expr::TernaryExpr& Expr::toTernaryExpr() {
     assert(tag == EKind::TernaryExpr);
+    detach();
     return static_cast<TernaryExpr&>(*desc);
 };
 
 Expr::UnaryExpr& Expr::toUnaryExpr() {
     assert(tag == EKind::UnaryExpr);
+    detach();
     return static_cast<UnaryExpr&>(*desc);
 };
 
 Expr::NaryExpr& Expr::toNaryExpr() {
     assert(tag == EKind::NaryExpr);
+    detach();
     return static_cast<NaryExpr&>(*desc);
 };
 
 Pred& Expr::toBooleanExpr() {
     assert(tag == EKind::BooleanExpr);
+    detach();
     return static_cast<BooleanExpr&>(*desc).pred;
 };
 
 Expr::QuantifiedSet& Expr::toQuantifiedSet() {
     assert(tag == EKind::QuantifiedSet);
+    detach();
     return static_cast<QuantifiedSet&>(*desc);
 };
 
 Expr::QuantifiedExpr& Expr::toQuantiedExpr() {
     assert(tag == EKind::QuantifiedExpr);
+    detach();
     return static_cast<QuantifiedExpr&>(*desc);
 };
 
 Expr::RecordExpr& Expr::toRecordExpr() {
     assert(tag == EKind::Record);
+    detach();
     return static_cast<RecordExpr&>(*desc);
 };
 
 Expr::StructExpr& Expr::toStructExpr() {
     assert(tag == EKind::Struct);
+    detach();
     return static_cast<StructExpr&>(*desc);
 };
 
 Expr::RecordAccessExpr& Expr::toRecordAccess() {
     assert(tag == EKind::Record_Field_Access);
+    detach();
     return static_cast<RecordAccessExpr&>(*desc);
 };
 
 Expr::RecordUpdateExpr& Expr::toRecordUpdate() {
     assert(tag == EKind::Record_Field_Update);
+    detach();
     return static_cast<RecordUpdateExpr&>(*desc);
 };
 
-Expr Expr::makeInteger(const std::string &i, const QStringList &bxmlTag){
+Expr Expr::makeInteger(const std::string &i, const TagSet::List &bxmlTag){
     return Expr(
             EKind::IntegerLiteral,
             new IntegerLiteral(i),
-            BType::INT,bxmlTag);
+            BType::INT,TagSet::intern(bxmlTag));
 };
 
-Expr Expr::makeString(const std::string &s, const QStringList &bxmlTag){
+Expr Expr::makeString(const std::string &s, const TagSet::List &bxmlTag){
     return Expr(
             EKind::StringLiteral,
             new StringLiteral(s),
-            BType::STRING,bxmlTag);
+            BType::STRING,TagSet::intern(bxmlTag));
 };
 
-Expr Expr::makeReal(const Decimal &d, const QStringList &bxmlTag){
+Expr Expr::makeReal(const Decimal &d, const TagSet::List &bxmlTag){
     return Expr(
             EKind::RealLiteral,
             new RealLiteral(d),
-            BType::REAL,bxmlTag);
+            BType::REAL,TagSet::intern(bxmlTag));
 };
 
-Expr Expr::makeIdent(const VarName &id, const BType &type, const QStringList &bxmlTag){
+Expr Expr::makeIdent(const VarName &id, const BType &type, const TagSet::List &bxmlTag){
     return Expr(
             EKind::Id,
             new IdentExpr(id),
-            type,bxmlTag);
+            type,TagSet::intern(bxmlTag));
 };
 
-Expr Expr::makePredecessor(const BType &type, const QStringList &bxmlTag){ return Expr(EKind::Predecessor,nullptr,type,bxmlTag); };
-Expr Expr::makeSuccessor(const BType &type, const QStringList &bxmlTag){ return Expr(EKind::Successor,nullptr,type,bxmlTag); };
-Expr Expr::makeEmptySet(const BType &type, const QStringList &bxmlTag){ return Expr(EKind::EmptySet,nullptr,type,bxmlTag); };
-Expr Expr::makeMaxInt(const QStringList &bxmlTag){ return Expr(EKind::MaxInt,nullptr,BType::INT,bxmlTag); };
-Expr Expr::makeMinInt(const QStringList &bxmlTag){ return Expr(EKind::MinInt,nullptr,BType::INT,bxmlTag); };
-Expr Expr::makeINTEGER(const QStringList &bxmlTag){ return Expr(EKind::INTEGER,nullptr,BType::POW_INT,bxmlTag); };
-Expr Expr::makeNATURAL(const QStringList &bxmlTag){ return Expr(EKind::NATURAL,nullptr,BType::POW_INT,bxmlTag); };
-Expr Expr::makeNATURAL1(const QStringList &bxmlTag){ return Expr(EKind::NATURAL1,nullptr,BType::POW_INT,bxmlTag); };
-Expr Expr::makeINT(const QStringList &bxmlTag){ return Expr(EKind::INT,nullptr,BType::POW_INT,bxmlTag); };
-Expr Expr::makeNAT(const QStringList &bxmlTag){ return Expr(EKind::NAT,nullptr,BType::POW_INT,bxmlTag); };
-Expr Expr::makeNAT1(const QStringList &bxmlTag){ return Expr(EKind::NAT1,nullptr,BType::POW_INT,bxmlTag); };
-Expr Expr::makeSTRING(const QStringList &bxmlTag){ return Expr(EKind::STRING,nullptr,BType::POW_STRING,bxmlTag); };
-Expr Expr::makeBOOL(const QStringList &bxmlTag){ return Expr(EKind::BOOL,nullptr,BType::POW_BOOL,bxmlTag); };
-Expr Expr::makeTRUE(const QStringList &bxmlTag){ return Expr(EKind::TRUE,nullptr,BType::BOOL,bxmlTag); };
-Expr Expr::makeFALSE(const QStringList &bxmlTag){ return Expr(EKind::FALSE,nullptr,BType::BOOL,bxmlTag); };
-Expr Expr::makeREAL(const QStringList &bxmlTag){ return Expr(EKind::REAL,nullptr,BType::POW_REAL,bxmlTag); };
-Expr Expr::makeFLOAT(const QStringList &bxmlTag){ return Expr(EKind::FLOAT,nullptr,BType::POW_FLOAT,bxmlTag); };
-
-Expr Expr::makeBinaryExpr(BinaryOp op, Expr &&lhs, Expr &&rhs, const BType &type, const QStringList &bxmlTag){
-    return Expr( EKind::BinaryExpr, new BinaryExpr(op,std::move(lhs),std::move(rhs)), type,bxmlTag);
+Expr Expr::makePredecessor(const BType &type, const TagSet::List &bxmlTag){ return Expr(EKind::Predecessor,nullptr,type,TagSet::intern(bxmlTag)); };
+Expr Expr::makeSuccessor(const BType &type, const TagSet::List &bxmlTag){ return Expr(EKind::Successor,nullptr,type,TagSet::intern(bxmlTag)); };
+Expr Expr::makeEmptySet(const BType &type, const TagSet::List &bxmlTag){ return Expr(EKind::EmptySet,nullptr,type,TagSet::intern(bxmlTag)); };
+Expr Expr::makeMaxInt(const TagSet::List &bxmlTag){ return Expr(EKind::MaxInt,nullptr,BType::INT,TagSet::intern(bxmlTag)); };
+Expr Expr::makeMinInt(const TagSet::List &bxmlTag){ return Expr(EKind::MinInt,nullptr,BType::INT,TagSet::intern(bxmlTag)); };
+Expr Expr::makeINTEGER(const TagSet::List &bxmlTag){ return Expr(EKind::INTEGER,nullptr,BType::POW_INT,TagSet::intern(bxmlTag)); };
+Expr Expr::makeNATURAL(const TagSet::List &bxmlTag){ return Expr(EKind::NATURAL,nullptr,BType::POW_INT,TagSet::intern(bxmlTag)); };
+Expr Expr::makeNATURAL1(const TagSet::List &bxmlTag){ return Expr(EKind::NATURAL1,nullptr,BType::POW_INT,TagSet::intern(bxmlTag)); };
+Expr Expr::makeINT(const TagSet::List &bxmlTag){ return Expr(EKind::INT,nullptr,BType::POW_INT,TagSet::intern(bxmlTag)); };
+Expr Expr::makeNAT(const TagSet::List &bxmlTag){ return Expr(EKind::NAT,nullptr,BType::POW_INT,TagSet::intern(bxmlTag)); };
+Expr Expr::makeNAT1(const TagSet::List &bxmlTag){ return Expr(EKind::NAT1,nullptr,BType::POW_INT,TagSet::intern(bxmlTag)); };
+Expr Expr::makeSTRING(const TagSet::List &bxmlTag){ return Expr(EKind::STRING,nullptr,BType::POW_STRING,TagSet::intern(bxmlTag)); };
+Expr Expr::makeBOOL(const TagSet::List &bxmlTag){ return Expr(EKind::BOOL,nullptr,BType::POW_BOOL,TagSet::intern(bxmlTag)); };
+Expr Expr::makeTRUE(const TagSet::List &bxmlTag){ return Expr(EKind::TRUE,nullptr,BType::BOOL,TagSet::intern(bxmlTag)); };
+Expr Expr::makeFALSE(const TagSet::List &bxmlTag){ return Expr(EKind::FALSE,nullptr,BType::BOOL,TagSet::intern(bxmlTag)); };
+Expr Expr::makeREAL(const TagSet::List &bxmlTag){ return Expr(EKind::REAL,nullptr,BType::POW_REAL,TagSet::intern(bxmlTag)); };
+Expr Expr::makeFLOAT(const TagSet::List &bxmlTag){ return Expr(EKind::FLOAT,nullptr,BType::POW_FLOAT,TagSet::intern(bxmlTag)); };
+
+Expr Expr::makeBinaryExpr(BinaryOp op, Expr &&lhs, Expr &&rhs, const BType &type, const TagSet::List &bxmlTag){
+    return Expr( EKind::BinaryExpr, new BinaryExpr(op,std::move(lhs),std::move(rhs)), type,TagSet::intern(bxmlTag));
 };
-Expr Expr::makeTernaryExpr(TernaryOp op, Expr &&fst, Expr &&snd, Expr &&thd, const BType &type, const QStringList &bxmlTag){
-    return Expr( EKind::TernaryExpr, new TernaryExpr(op,std::move(fst),std::move(snd),std::move(thd)), type,bxmlTag);
+Expr Expr::makeTernaryExpr(TernaryOp op, Expr &&fst, Expr &&snd, Expr &&thd, const BType &type, const TagSet::List &bxmlTag){
+    return Expr( EKind::TernaryExpr, new TernaryExpr(op,std::move(fst),std::move(snd),std::move(thd)), type,TagSet::intern(bxmlTag));
 };
-Expr Expr::makeUnaryExpr(UnaryOp op, Expr &&e, const BType &type, const QStringList &bxmlTag){
-    return Expr( EKind::UnaryExpr, new UnaryExpr(op,std::move(e)), type,bxmlTag);
+Expr Expr::makeUnaryExpr(UnaryOp op, Expr &&e, const BType &type, const TagSet::List &bxmlTag){
+    return Expr( EKind::UnaryExpr, new UnaryExpr(op,std::move(e)), type,TagSet::intern(bxmlTag));
 };
-Expr Expr::makeNaryExpr(NaryOp op, std::vector<Expr> &&vec, const BType &type, const QStringList &bxmlTag){
-    return Expr( EKind::NaryExpr, new NaryExpr(op,std::move(vec)), type,bxmlTag);
+Expr Expr::makeNaryExpr(NaryOp op, std::vector<Expr> &&vec, const BType &type, const TagSet::List &bxmlTag){
+    return Expr( EKind::NaryExpr, new NaryExpr(op,std::move(vec)), type,TagSet::intern(bxmlTag));
 };
-Expr Expr::makeBooleanExpr(Pred &&p, const QStringList &bxmlTag){
-    return Expr( EKind::BooleanExpr, new BooleanExpr(std::move(p)), BType::BOOL,bxmlTag);
+Expr Expr::makeBooleanExpr(Pred &&p, const TagSet::List &bxmlTag){
+    return Expr( EKind::BooleanExpr, new BooleanExpr(std::move(p)), BType::BOOL,TagSet::intern(bxmlTag));
 };
-Expr Expr::makeRecord(std::vector<std::pair<std::string,Expr>> &&fds, const BType &type, const QStringList &bxmlTag){
-    return Expr( EKind::Record, new RecordExpr(std::move(fds)),type,bxmlTag);
+Expr Expr::makeRecord(std::vector<std::pair<std::string,Expr>> &&fds, const BType &type, const TagSet::List &bxmlTag){
+    return Expr( EKind::Record, new RecordExpr(std::move(fds)),type,TagSet::intern(bxmlTag));
 };
-Expr Expr::makeStruct(std::vector<std::pair<std::string,Expr>> &&fds, const BType &type, const QStringList &bxmlTag){
-    return Expr( EKind::Struct, new StructExpr(std::move(fds)),type,bxmlTag);
+Expr Expr::makeStruct(std::vector<std::pair<std::string,Expr>> &&fds, const BType &type, const TagSet::List &bxmlTag){
+    return Expr( EKind::Struct, new StructExpr(std::move(fds)),type,TagSet::intern(bxmlTag));
 };
-Expr Expr::makeQuantifiedExpr(QuantifiedOp op,const std::vector<TypedVar> vars, Pred &&cond, Expr &&body, const BType &type, const QStringList &bxmlTag){
-    return Expr( EKind::QuantifiedExpr, new QuantifiedExpr(op,vars,std::move(cond),std::move(body)),type,bxmlTag);
+Expr Expr::makeQuantifiedExpr(QuantifiedOp op,const std::vector<TypedVar> vars, Pred &&cond, Expr &&body, const BType &type, const TagSet::List &bxmlTag){
+    return Expr( EKind::QuantifiedExpr, new QuantifiedExpr(op,vars,std::move(cond),std::move(body)),type,TagSet::intern(bxmlTag));
 };
-Expr Expr::makeQuantifiedSet(const std::vector<TypedVar> vars, Pred &&cond, const BType &type, const QStringList &bxmlTag){
-    return Expr( EKind::QuantifiedSet, new QuantifiedSet(vars,std::move(cond)),type,bxmlTag);
+Expr Expr::makeQuantifiedSet(const std::vector<TypedVar> vars, Pred &&cond, const BType &type, const TagSet::List &bxmlTag){
+    return Expr( EKind::QuantifiedSet, new QuantifiedSet(vars,std::move(cond)),type,TagSet::intern(bxmlTag));
 };
-Expr Expr::makeRecordFieldUpdate(Expr &&rec, const std::string &label, Expr &&value, const BType &type, const QStringList &bxmlTag){
-    return Expr(EKind::Record_Field_Update, new RecordUpdateExpr(std::move(rec),label,std::move(value)) ,type,bxmlTag);
+Expr Expr::makeRecordFieldUpdate(Expr &&rec, const std::string &label, Expr &&value, const BType &type, const TagSet::List &bxmlTag){
+    return Expr(EKind::Record_Field_Update, new RecordUpdateExpr(std::move(rec),label,std::move(value)) ,type,TagSet::intern(bxmlTag));
 };
-Expr Expr::makeRecordFieldAccess(Expr &&rec, const std::string &label, const BType &type, const QStringList &bxmlTag){
-    return Expr(EKind::Record_Field_Access, new RecordAccessExpr(std::move(rec),label) ,type,bxmlTag);
+Expr Expr::makeRecordFieldAccess(Expr &&rec, const std::string &label, const BType &type, const TagSet::List &bxmlTag){
+    return Expr(EKind::Record_Field_Access, new RecordAccessExpr(std::move(rec),label) ,type,TagSet::intern(bxmlTag));
 };
 
-void Expr::addBxmlTags(const QStringList &bxmlTag){
-    this->bxmlTag << bxmlTag;
+void Expr::addBxmlTags(const TagSet::List &bxmlTag){
+    this->bxmlTag = TagSet::concat(this->bxmlTag,TagSet::intern(bxmlTag));
 }
 
-int compare_field_vec(const std::vector<std::pair<std::string,Expr>>& lhs, const std::vector<std::pair<std::string,Expr>>& rhs){
-    if(lhs.size() == rhs.size()){
-        size_t i = 0;
-        while(i<lhs.size()){
-            auto &p1 = lhs.at(i);
-            auto &p2 = rhs.at(i);
-            int res = p1.first.compare(p2.first);
-            if(res != 0) return res;
-            res = Expr::compare(p1.second,p2.second);
-            if(res != 0) return res;
-            i++;
-        }
-        return 0;
-    } else {
-        return (lhs.size() - rhs.size());
+namespace {
+    // Pair of sub-expressions still to be compared by Expr::compare, with the
+    // labels to compare first when they are record fields
+    struct PendingPair {
+        const Expr *e1;
+        const Expr *e2;
+        const std::string *label1;
+        const std::string *label2;
+    };
+
+    void pushFields(std::vector<PendingPair> &todo,
+            const std::vector<std::pair<std::string,Expr>>& lhs, const std::vector<std::pair<std::string,Expr>>& rhs){
+        for(size_t i=lhs.size();i>0;i--)
+            todo.push_back({&lhs[i-1].second,&rhs[i-1].second,&lhs[i-1].first,&rhs[i-1].first});
     }
-};
 
-int Expr::compare(const Expr& e1, const Expr& e2){
+    void pushPair(std::vector<PendingPair> &todo, const Expr &e1, const Expr &e2){
+        todo.push_back({&e1,&e2,nullptr,nullptr});
+    }
+}
+
+/* Compares the root nodes of e1 and e2, and pushes the pairs of sub-expressions
+ * to compare next in reverse order. Expr::compare pops them in the order of the
+ * recursive definition: the first difference found is the same. */
+static int compareNode(const Expr& e1, const Expr& e2, std::vector<PendingPair> &todo){
     if(e1.getTag() == e2.getTag()){
         switch(e1.getTag()){
             case Expr::EKind::INTEGER:
@@ -634,7 +739,7 @@ int Expr::compare(const Expr& e1, const Expr& e2){
             case Expr::EKind::Predecessor:
                 return 0;
             case Expr::EKind::EmptySet:
-                return BType::compare(e1.type,e2.type);
+                return BType::compare(e1.getType(),e2.getType());
             case Expr::EKind::IntegerLiteral:
                 return e1.getIntegerLiteral().compare(e2.getIntegerLiteral());
             case Expr::EKind::StringLiteral:
@@ -642,13 +747,14 @@ int Expr::compare(const Expr& e1, const Expr& e2){
             case Expr::EKind::RealLiteral:
                 return e1.getRealLiteral().compare(e2.getRealLiteral());
             case Expr::EKind::Id:
-                return TypedVar::compare({e1.getId(),e1.type},{e2.getId(),e2.type});
+                return TypedVar::compare({e1.getId(),e1.getType()},{e2.getId(),e2.getType()});
             case Expr::EKind::UnaryExpr:
                 {
                     auto &u1 = e1.toUnaryExpr();
                     auto &u2 = e2.toUnaryExpr();
                     if(u1.op == u2.op){
-                        return compare(u1.content, u2.content);
+                        pushPair(todo,u1.content,u2.content);
+                        return 0;
                     } else if (u1.op < u2.op){
                         return -1;
                     } else {
@@ -660,12 +766,9 @@ int Expr::compare(const Expr& e1, const Expr& e2){
                     auto &b1 = e1.toBinaryExpr();
                     auto &b2 = e2.toBinaryExpr();
                     if(b1.op == b2.op){
-                        int res = compare(b1.lhs,b2.lhs);
-                        if (res == 0){
-                            return compare(b1.rhs,b2.rhs);
-                        } else {
-                            return res;
-                        }
+                        pushPair(todo,b1.rhs,b2.rhs);
+                        pushPair(todo,b1.lhs,b2.lhs);
+                        return 0;
                     } else if (b1.op < b2.op){
                         return -1;
                     } else {
@@ -677,17 +780,10 @@ int Expr::compare(const Expr& e1, const Expr& e2){
                     auto &t1 = e1.toTernaryExpr();
                     auto &t2 = e2.toTernaryExpr();
                     if(t1.op == t2.op){
-                        int res = compare(t1.fst,t2.fst);
-                        if (res == 0){
-                            res = compare(t1.snd,t2.snd);
-                            if (res == 0){
-                                return compare(t1.thd,t2.thd);
-                            } else {
-                                return res;
-                            }
-                        } else {
-                            return res;
-                        }
+                        pushPair(todo,t1.thd,t2.thd);
+                        pushPair(todo,t1.snd,t2.snd);
+                        pushPair(todo,t1.fst,t2.fst);
+                        return 0;
                     } else if (t1.op < t2.op){
                         return -1;
                     } else {
@@ -699,7 +795,11 @@ int Expr::compare(const Expr& e1, const Expr& e2){
                     auto &n1 = e1.toNaryExpr();
                     auto &n2 = e2.toNaryExpr();
                     if(n1.op == n2.op){
-                        return vec_compare(n1.vec,n2.vec);
+                        if(n1.vec.size() != n2.vec.size())
+                            return (n1.vec.size() - n2.vec.size());
+                        for(size_t i=n1.vec.size();i>0;i--)
+                            pushPair(todo,n1.vec[i-1],n2.vec[i-1]);
+                        return 0;
                     } else if (n1.op < n2.op){
                         return -1;
                     } else {
@@ -714,13 +814,19 @@ int Expr::compare(const Expr& e1, const Expr& e2){
                 {
                     auto &s1 = e1.toStructExpr();
                     auto &s2 = e2.toStructExpr();
-                    return compare_field_vec(s1.fields,s2.fields);
+                    if(s1.fields.size() != s2.fields.size())
+                        return (s1.fields.size() - s2.fields.size());
+                    pushFields(todo,s1.fields,s2.fields);
+                    return 0;
                 }
             case Expr::EKind::Record:
                 {
                     auto &s1 = e1.toRecordExpr();
                     auto &s2 = e2.toRecordExpr();
-                    return compare_field_vec(s1.fields,s2.fields);
+                    if(s1.fields.size() != s2.fields.size())
+                        return (s1.fields.size() - s2.fields.size());
+                    pushFields(todo,s1.fields,s2.fields);
+                    return 0;
                 }
             case Expr::EKind::QuantifiedSet:
                 {
@@ -741,11 +847,9 @@ int Expr::compare(const Expr& e1, const Expr& e2){
                         int i = TypedVar::vec_compare(s1.vars,s2.vars);
                         if(i == 0){
                             i = Pred::compare(s1.cond,s2.cond);
-                            if(i == 0){
-                                return compare(s1.body,s2.body);
-                            } else {
-                                return i;
-                            }
+                            if(i == 0)
+                                pushPair(todo,s1.body,s2.body);
+                            return i;
                         } else {
                             return i;
                         }
@@ -760,12 +864,9 @@ int Expr::compare(const Expr& e1, const Expr& e2){
                     auto &t1 = e1.toRecordUpdate();
                     auto &t2 = e2.toRecordUpdate();
                     if(t1.label == t2.label){
-                        int res = compare(t1.rec,t2.rec);
-                            if (res == 0){
-                                return compare(t1.fvalue,t2.fvalue);
-                            } else {
-                                return res;
-                            }
+                        pushPair(todo,t1.fvalue,t2.fvalue);
+                        pushPair(todo,t1.rec,t2.rec);
+                        return 0;
                     } else if (t1.label < t2.label){
                         return -1;
                     } else {
@@ -777,7 +878,8 @@ int Expr::compare(const Expr& e1, const Expr& e2){
                     auto &t1 = e1.toRecordAccess();
                     auto &t2 = e2.toRecordAccess();
                     if(t1.label == t2.label){
-                        return compare(t1.rec,t2.rec);
+                        pushPair(todo,t1.rec,t2.rec);
+                        return 0;
                     } else if (t1.label < t2.label){
                         return -1;
                     } else {
@@ -792,7 +894,24 @@ int Expr::compare(const Expr& e1, const Expr& e2){
     } else {
         return 1;
     }
-};
+}
+
+int Expr::compare(const Expr& e1, const Expr& e2){
+    // Explicit stack: the depth of the expressions is not limited by the call stack
+    std::vector<PendingPair> todo;
+    pushPair(todo,e1,e2);
+    while(!todo.empty()){
+        PendingPair p = todo.back();
+        todo.pop_back();
+        if(p.label1 != nullptr){
+            int res = p.label1->compare(*p.label2);
+            if(res != 0) return res;
+        }
+        int res = compareNode(*p.e1,*p.e2,todo);
+        if(res != 0) return res;
+    }
+    return 0;
+}
 
 int Expr::vec_compare(const std::vector<Expr>& lhs, const std::vector<Expr>& rhs){
     if(lhs.size() == rhs.size()){
@@ -809,12 +928,42 @@ int Expr::vec_compare(const std::vector<Expr>& lhs, const std::vector<Expr>& rhs
 }
 
 size_t Expr::hash_combine(size_t seed) const {
-    if(desc != nullptr)
-        seed = desc->hash_combine(seed);
-    return hashUtil::hash_combine_int(static_cast<int>(tag),seed);
+    if(desc == nullptr)
+        return hashUtil::hash_combine_int(static_cast<int>(tag),seed);
+    if(!desc->cachedHash.known())
+        computeHashes();
+    size_t h = desc->cachedHash.get([this](){ return nodeHash(); });
+    return hashUtil::hash_combine_hash(h,seed);
 }
 
-std::string Expr::to_string(UnaryOp op){
+size_t Expr::nodeHash() const {
+    return hashUtil::hash_combine_int(static_cast<int>(tag),desc->hash_combine(0));
+}
+
+void Expr::computeHashes() const {
+    // The children are hashed before their parent, so desc->hash_combine only
+    // reads cached values (binders excepted, see getChildren)
+    std::vector<std::pair<const Expr*,bool>> todo; // second: children pushed
+    todo.push_back({this,false});
+    std::vector<const Expr*> children;
+    while(!todo.empty()){
+        const Expr *e = todo.back().first;
+        if(todo.back().second || e->desc->cachedHash.known()){
+            todo.pop_back();
+            e->desc->cachedHash.get([e](){ return e->nodeHash(); });
+            continue;
+        }
+        todo.back().second = true;
+        children.clear();
+        e->desc->getChildren(children);
+        for(const Expr *c : children){
+            if(c->desc != nullptr && !c->desc->cachedHash.known())
+                todo.push_back({c,false});
+        }
+    }
+}
+
+const char* Expr::to_chars(UnaryOp op){
     switch(op){
         case UnaryOp::IMaximum: return "imax";
         case UnaryOp::IMinimum: return "imin";
@@ -868,7 +1017,11 @@ std::string Expr::to_string(UnaryOp op){
     assert(false); // unreachable
 };
 
-std::string Expr::to_string(BinaryOp op){
+std::string Expr::to_string(UnaryOp op){
+    return to_chars(op);
+};
+
+const char* Expr::to_chars(BinaryOp op){
     switch(op){
         case BinaryOp::IMultiplication: return "*i";
         case BinaryOp::RMultiplication: return "*r";
@@ -927,7 +1080,11 @@ std::string Expr::to_string(BinaryOp op){
     assert(false); // unreachable
 };
 
-std::string Expr::to_string(NaryOp op){
+std::string Expr::to_string(BinaryOp op){
+    return to_chars(op);
+};
+
+const char* Expr::to_chars(NaryOp op){
     switch(op){
         case NaryOp::Sequence: return "[";
         case NaryOp::Set: return "{";
@@ -935,7 +1092,11 @@ std::string Expr::to_string(NaryOp op){
     assert(false); // unreachable
 };
 
-std::string Expr::to_string(TernaryOp op){
+std::string Expr::to_string(NaryOp op){
+    return to_chars(op);
+};
+
+const char* Expr::to_chars(TernaryOp op){
     switch(op){
         case TernaryOp::Bin: return "bin";
         case TernaryOp::Son: return "son";
@@ -943,7 +1104,11 @@ std::string Expr::to_string(TernaryOp op){
     assert(false); // unreachable
 };
 
-std::string Expr::to_string(QuantifiedOp op){
+std::string Expr::to_string(TernaryOp op){
+    return to_chars(op);
+};
+
+const char* Expr::to_chars(QuantifiedOp op){
     switch(op){
         case QuantifiedOp::Lambda: return "%";
         case QuantifiedOp::Intersection: return "INTER";
@@ -956,6 +1121,10 @@ std::string Expr::to_string(QuantifiedOp op){
     assert(false); // unreachable
 };
 
+std::string Expr::to_string(QuantifiedOp op){
+    return to_chars(op);
+};
+
 std::string Expr::show() const {
     switch(tag){
         case EKind::INTEGER:
@@ -1086,79 +1255,135 @@ std::string Expr::show() const {
 
 void Expr::subst(const std::map<VarName,Expr> &map) {
     if(!map.empty()){
-       switch(tag){
-           case EKind::MaxInt:
-           case EKind::MinInt:
-           case EKind::INTEGER:
-           case EKind::NATURAL:
-           case EKind::NATURAL1:
-           case EKind::INT:
-           case EKind::NAT:
-           case EKind::NAT1:
-           case EKind::STRING:
-           case EKind::BOOL:
-           case EKind::REAL:
-           case EKind::FLOAT:
-           case EKind::TRUE:
-           case EKind::FALSE:
-           case EKind::EmptySet:
-           case EKind::IntegerLiteral:
-           case EKind::StringLiteral:
-           case EKind::RealLiteral:
-           case EKind::Successor:
-           case EKind::Predecessor:
-               return;
-           case EKind::Id:
-               {
-                   auto it = map.find(static_cast<IdentExpr&>(*desc).value);
-                   if(it != map.end()){
-                       tag = it->second.tag;
-                       //type = it->second.type;
-                       bxmlTag << it->second.bxmlTag;
-                       if(it->second.desc != nullptr)
-                           desc = std::unique_ptr<ExprDesc>(it->second.desc->copy());
-                       else
-                           desc = nullptr;
-                   }
-                   return;
-               }
-           case EKind::BooleanExpr:
-           case EKind::QuantifiedExpr:
-           case EKind::QuantifiedSet:
-           case EKind::UnaryExpr:
-           case EKind::BinaryExpr:
-           case EKind::NaryExpr:
-           case EKind::Struct:
-           case EKind::Record:
-           case EKind::TernaryExpr:
-           case EKind::Record_Field_Access:
-           case EKind::Record_Field_Update:
-               return desc->subst(map);
-       }
-       assert(false); // unreachable
+        SubstEnv env(map);
+        subst(env);
     }
-};
+}
 
-void Expr::alpha(const std::map<VarName,VarName> &map) {
-    if(desc != nullptr)
-        desc->alpha(map);
-};
-bool Expr::isRenamingNeeded(const std::vector<TypedVar> &vars,const std::set<VarName> freeVars){
-    for(auto &v : vars){
-        if(freeVars.find(v.name) != freeVars.end())
-            return true;
+void Expr::subst(SubstEnv &env) {
+    if(env.empty())
+        return;
+    // The operands of the non-binding operators (see getChildren) are
+    // substituted with an explicit stack, in the order of the recursion
+    std::vector<const Expr*> todo {this};
+    while(!todo.empty()){
+        // e is reached from this through detached descs, which it does not share
+        Expr *e = const_cast<Expr*>(todo.back());
+        todo.pop_back();
+        switch(e->tag){
+            case EKind::MaxInt:
+            case EKind::MinInt:
+            case EKind::INTEGER:
+            case EKind::NATURAL:
+            case EKind::NATURAL1:
+            case EKind::INT:
+            case EKind::NAT:
+            case EKind::NAT1:
+            case EKind::STRING:
+            case EKind::BOOL:
+            case EKind::REAL:
+            case EKind::FLOAT:
+            case EKind::TRUE:
+            case EKind::FALSE:
+            case EKind::EmptySet:
+            case EKind::IntegerLiteral:
+            case EKind::StringLiteral:
+            case EKind::RealLiteral:
+            case EKind::Successor:
+            case EKind::Predecessor:
+                break;
+            case EKind::Id:
+                {
+                    const Expr *v = env.find(static_cast<IdentExpr&>(*e->desc).value);
+                    if(v != nullptr){
+                        e->tag = v->tag;
+                        //e->type = v->type;
+                        e->bxmlTag = TagSet::concat(e->bxmlTag,v->bxmlTag);
+                        e->desc = v->desc;
+                    }
+                    break;
+                }
+            case EKind::BooleanExpr:
+            case EKind::QuantifiedExpr:
+            case EKind::QuantifiedSet:
+            case EKind::UnaryExpr:
+            case EKind::BinaryExpr:
+            case EKind::NaryExpr:
+            case EKind::Struct:
+            case EKind::Record:
+            case EKind::TernaryExpr:
+            case EKind::Record_Field_Access:
+            case EKind::Record_Field_Update:
+                {
+                    e->detach();
+                    size_t n = todo.size();
+                    e->desc->getChildren(todo);
+                    if(todo.size() == n)
+                        e->desc->subst(env);
+                    else
+                        std::reverse(todo.begin() + n,todo.end());
+                    break;
+                }
+        }
     }
-    return false;
 }
+
+// A substitution of a temporary variable whose substituend has the free variables names
+static std::map<VarName,Expr> capturingMap(const std::vector<VarName> &names){
+    std::vector<Expr> ids;
+    ids.reserve(names.size());
+    for(auto &v : names)
+        ids.push_back(Expr::makeIdent(v,BType::INT));
+    std::map<VarName,Expr> map;
+    map[VarName::makeTmp("freeVars")] = Expr::makeNaryExpr(Expr::NaryOp::Set,std::move(ids),BType::POW(BType::INT));
+    return map;
+}
+
+bool Expr::isRenamingNeeded(const std::vector<TypedVar> &vars,const std::set<VarName> freeVars){
+    VarSet fv;
+    fv.insert(freeVars.begin(),freeVars.end());
+    return isRenamingNeeded(vars,fv);
+}
+
+bool Expr::isRenamingNeeded(const std::vector<TypedVar> &vars,const VarSet &freeVars){
+    std::map<VarName,Expr> map = capturingMap({freeVars.begin(),freeVars.end()});
+    SubstEnv env(map);
+    return env.captures(vars);
+}
+
 void Expr::renameVars(std::vector<TypedVar> &vars, const std::set<VarName> freeVars, std::map<VarName,Expr> &map2){
-    for(size_t i=0;i<vars.size();i++){
-        VarName nv = VarName::getFreshVar(vars[i].name.prefix(),freeVars);
-        map2[vars[i].name] = Expr::makeIdent(nv,vars[i].type);
-        vars[i].name = nv;
-    }
+    VarSet fv;
+    fv.insert(freeVars.begin(),freeVars.end());
+    renameVars(vars,fv,map2);
 }
 
-bool Expr::alpha_equals(Context &ctx, const Expr& e1, const Expr& e2){
+void Expr::renameVars(std::vector<TypedVar> &vars, const VarSet &freeVars, std::map<VarName,Expr> &map2){
+    // the substituend also has the variables of vars free, so that all of them are renamed
+    std::vector<VarName> names(freeVars.begin(),freeVars.end());
+    for(auto &v : vars)
+        names.push_back(v.name);
+    std::map<VarName,Expr> map = capturingMap(names);
+    SubstEnv env(map);
+    const std::vector<TypedVar> old = vars;
+    VarSet avoid = freeVars;
+    env.push(vars);
+    env.rename(vars,avoid);
+    env.pop();
+    for(size_t i=0;i<vars.size();i++)
+        map2[old[i].name] = Expr::makeIdent(vars[i].name,vars[i].type);
+}
+
+void Expr::alpha(const std::map<VarName,VarName> &map) {
+    if(desc != nullptr){
+        detach();
+        desc->alpha(map);
+    }
+};
+/* Compares the root nodes of e1 and e2, and pushes the pairs of sub-expressions
+ * that are in the same scope. The contents of the binders extend ctx: they are
+ * compared by a nested call to Expr::alpha_equals. */
+static bool alphaEqualsNode(Context &ctx, const Expr& e1, const Expr& e2,
+        std::vector<std::pair<const Expr*,const Expr*>> &todo){
     if(e1.getType() != e2.getType())
         return false;
 
@@ -1202,25 +1427,31 @@ bool Expr::alpha_equals(Context &ctx, const Expr& e1, const Expr& e2){
                 {
                     auto &u1 = e1.toUnaryExpr();
                     auto &u2 = e2.toUnaryExpr();
-                    return u1.op == u2.op
-                        && alpha_equals(ctx,u1.content,u2.content);
+                    if(u1.op != u2.op)
+                        return false;
+                    todo.push_back({&u1.content,&u2.content});
+                    return true;
                 }
             case Expr::EKind::BinaryExpr:
                 {
                     auto &b1 = e1.toBinaryExpr();
                     auto &b2 = e2.toBinaryExpr();
-                    return b1.op == b2.op
-                        && alpha_equals(ctx,b1.lhs,b2.lhs)
-                        && alpha_equals(ctx,b1.rhs,b2.rhs);
+                    if(b1.op != b2.op)
+                        return false;
+                    todo.push_back({&b1.rhs,&b2.rhs});
+                    todo.push_back({&b1.lhs,&b2.lhs});
+                    return true;
                 }
             case Expr::EKind::TernaryExpr:
                 {
                     auto &t1 = e1.toTernaryExpr();
                     auto &t2 = e2.toTernaryExpr();
-                    return t1.op == t2.op
-                        && alpha_equals(ctx,t1.fst,t2.fst)
-                        && alpha_equals(ctx,t1.snd,t2.snd)
-                        && alpha_equals(ctx,t1.thd,t2.thd);
+                    if(t1.op != t2.op)
+                        return false;
+                    todo.push_back({&t1.thd,&t2.thd});
+                    todo.push_back({&t1.snd,&t2.snd});
+                    todo.push_back({&t1.fst,&t2.fst});
+                    return true;
                 }
             case Expr::EKind::NaryExpr:
                 {
@@ -1230,10 +1461,8 @@ bool Expr::alpha_equals(Context &ctx, const Expr& e1, const Expr& e2){
                         return false;
                     if(n1.vec.size() != n2.vec.size())
                         return false;
-                    for(size_t i=0;i<n1.vec.size();i++){
-                        if(!alpha_equals(ctx,n1.vec[i],n2.vec[i]))
-                            return false;
-                    }
+                    for(size_t i=n1.vec.size();i>0;i--)
+                        todo.push_back({&n1.vec[i-1],&n2.vec[i-1]});
                     return true;
                 }
             case Expr::EKind::BooleanExpr:
@@ -1249,9 +1478,9 @@ bool Expr::alpha_equals(Context &ctx, const Expr& e1, const Expr& e2){
                     for(size_t i=0;i<s1.fields.size();i++){
                         if(s1.fields[i].first != s2.fields[i].first)
                             return false;
-                        if(!alpha_equals(ctx,s1.fields[i].second,s2.fields[i].second))
-                            return false;
                     }
+                    for(size_t i=s1.fields.size();i>0;i--)
+                        todo.push_back({&s1.fields[i-1].second,&s2.fields[i-1].second});
                     return true;
                 }
             case Expr::EKind::Record:
@@ -1263,9 +1492,9 @@ bool Expr::alpha_equals(Context &ctx, const Expr& e1, const Expr& e2){
                     for(size_t i=0;i<s1.fields.size();i++){
                         if(s1.fields[i].first != s2.fields[i].first)
                             return false;
-                        if(!alpha_equals(ctx,s1.fields[i].second,s2.fields[i].second))
-                            return false;
                     }
+                    for(size_t i=s1.fields.size();i>0;i--)
+                        todo.push_back({&s1.fields[i-1].second,&s2.fields[i-1].second});
                     return true;
                 }
             case Expr::EKind::QuantifiedSet:
@@ -1288,7 +1517,7 @@ bool Expr::alpha_equals(Context &ctx, const Expr& e1, const Expr& e2){
                         return false;
                     bool res = s1.op == s2.op
                       &&  Pred::alpha_equals(ctx,s1.cond,s2.cond)
-                      &&  alpha_equals(ctx,s1.body,s2.body);
+                      &&  Expr::alpha_equals(ctx,s1.body,s2.body);
                     ctx.pop();
                     return res;
                 }
@@ -1296,16 +1525,20 @@ bool Expr::alpha_equals(Context &ctx, const Expr& e1, const Expr& e2){
                 {
                     auto &t1 = e1.toRecordUpdate();
                     auto &t2 = e2.toRecordUpdate();
-                    return t1.label == t2.label
-                        && alpha_equals(ctx,t1.fvalue,t2.fvalue)
-                        && alpha_equals(ctx,t1.rec,t2.rec);
+                    if(t1.label != t2.label)
+                        return false;
+                    todo.push_back({&t1.rec,&t2.rec});
+                    todo.push_back({&t1.fvalue,&t2.fvalue});
+                    return true;
                 }
             case Expr::EKind::Record_Field_Access:
                 {
                     auto &t1 = e1.toRecordAccess();
                     auto &t2 = e2.toRecordAccess();
-                    return t1.label == t2.label
-                        && alpha_equals(ctx,t1.rec,t2.rec);
+                    if(t1.label != t2.label)
+                        return false;
+                    todo.push_back({&t1.rec,&t2.rec});
+                    return true;
                 }
         }
         assert(false); // unreachable
@@ -1315,6 +1548,19 @@ bool Expr::alpha_equals(Context &ctx, const Expr& e1, const Expr& e2){
 
 }
 
+bool Expr::alpha_equals(Context &ctx, const Expr& e1, const Expr& e2){
+    // Explicit stack: the depth of the expressions is not limited by the call stack
+    std::vector<std::pair<const Expr*,const Expr*>> todo;
+    todo.push_back({&e1,&e2});
+    while(!todo.empty()){
+        auto p = todo.back();
+        todo.pop_back();
+        if(!alphaEqualsNode(ctx,*p.first,*p.second,todo))
+            return false;
+    }
+    return true;
+}
+
 bool Expr::alpha_equals(const Expr& e1, const Expr& e2){
     Context ctx;
     return alpha_equals(ctx,e1,e2);
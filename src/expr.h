@@ -22,12 +22,14 @@
 #include <vector>
 #include <cassert>
 #include <set>
-#include <QStringList>
 #include <cctype> // isdigit
 #include "btype.h"
 #include "vars.h"
+#include "arena.h"
+#include "tagSet.h"
 
 class Pred;
+class SubstEnv;
 
 class Expr {
     public:
@@ -56,16 +58,20 @@ class Expr {
             Const, Rank, Father, Subtree, Arity
         };
         static std::string to_string(BinaryOp op);
+        // Same as to_string, without allocation (static storage)
+        static const char* to_chars(BinaryOp op);
 
         enum class TernaryOp {
             Son, Bin
         };
         static std::string to_string(TernaryOp op);
+        static const char* to_chars(TernaryOp op);
 
         enum class QuantifiedOp {
             Lambda, Intersection, Union, ISum, IProduct, RSum, RProduct
         };
         static std::string to_string(QuantifiedOp op);
+        static const char* to_chars(QuantifiedOp op);
 
         enum class UnaryOp {
             Cardinality, Domain, Range, Subsets, Non_Empty_Subsets, Finite_Subsets,
@@ -77,18 +83,27 @@ class Expr {
             Sons, Prefix, Postfix, Sizet, Mirror, Left, Right, Infix, Bin
         };
         static std::string to_string(UnaryOp op);
+        static const char* to_chars(UnaryOp op);
 
         enum class NaryOp {
             Sequence, Set
         };
         static std::string to_string(NaryOp op);
+        static const char* to_chars(NaryOp op);
 
         Expr():
             tag{EKind::MaxInt}
+        ,bxmlTag{TagSet::Empty}
         ,desc{nullptr}
         ,type{BType::INT}
-        ,bxmlTag{}
         {};
+        Expr(Expr &&) = default;
+        Expr& operator=(Expr &&) = default;
+        // Iterative: the depth of the expression is not limited by the call stack
+        ~Expr();
+        // Expressions are duplicated explicitly with copy()
+        Expr(const Expr &) = delete;
+        Expr& operator=(const Expr &) = delete;
 
         struct Decimal {
             Decimal(const std::string &integerPart, const std::string &fractionalPart):
@@ -112,48 +127,52 @@ class Expr {
             int compare(const Decimal &other) const;
         };
 
-        static Expr makeInteger(const std::string &i, const QStringList &bxmlTag = {});
-        static Expr makeString(const std::string &s, const QStringList &bxmlTag = {});
-        static Expr makeReal(const Decimal &d, const QStringList &bxmlTag = {});
-        static Expr makeIdent(const VarName &s, const BType &type, const QStringList &bxmlTag = {});
-        static Expr makeEmptySet(const BType &ty, const QStringList &bxmlTag = {});
-        static Expr makePredecessor(const BType &ty, const QStringList &bxmlTag = {});
-        static Expr makeSuccessor(const BType &ty, const QStringList &bxmlTag = {});
-        static Expr makeMaxInt(const QStringList &bxmlTag = {});
-        static Expr makeMinInt(const QStringList &bxmlTag = {});
-        static Expr makeINTEGER(const QStringList &bxmlTag = {});
-        static Expr makeNATURAL(const QStringList &bxmlTag = {});
-        static Expr makeNATURAL1(const QStringList &bxmlTag = {});
-        static Expr makeINT(const QStringList &bxmlTag = {});
-        static Expr makeNAT(const QStringList &bxmlTag = {});
-        static Expr makeNAT1(const QStringList &bxmlTag = {});
-        static Expr makeSTRING(const QStringList &bxmlTag = {});
-        static Expr makeBOOL(const QStringList &bxmlTag = {});
-        static Expr makeTRUE(const QStringList &bxmlTag = {});
-        static Expr makeFALSE(const QStringList &bxmlTag = {});
-        static Expr makeREAL(const QStringList &bxmlTag = {});
-        static Expr makeFLOAT(const QStringList &bxmlTag = {});
-        static Expr makeBinaryExpr(BinaryOp op, Expr &&lhs, Expr &&rhs, const BType &type, const QStringList &bxmlTag = {});
-        static Expr makeUnaryExpr(UnaryOp op, Expr &&lhs, const BType &type, const QStringList &bxmlTag = {});
-        static Expr makeNaryExpr(NaryOp op, std::vector<Expr> &&vec, const BType &type, const QStringList &bxmlTag = {});
-        static Expr makeTernaryExpr(TernaryOp op, Expr &&fst, Expr &&snd, Expr &&thd, const BType &type, const QStringList &bxmlTag = {});
-        static Expr makeBooleanExpr(Pred &&p, const QStringList &bxmlTag = {});
-        static Expr makeRecord(std::vector<std::pair<std::string,Expr>> &&fds, const BType &type, const QStringList &bxmlTag = {}); // /!\ fields must be sorted alphabetically
-        static Expr makeStruct(std::vector<std::pair<std::string,Expr>> &&fds, const BType &type, const QStringList &bxmlTag = {}); // /!\ fields must be sorted alphabetically
+        static Expr makeInteger(const std::string &i, const TagSet::List &bxmlTag = {});
+        static Expr makeString(const std::string &s, const TagSet::List &bxmlTag = {});
+        static Expr makeReal(const Decimal &d, const TagSet::List &bxmlTag = {});
+        static Expr makeIdent(const VarName &s, const BType &type, const TagSet::List &bxmlTag = {});
+        static Expr makeEmptySet(const BType &ty, const TagSet::List &bxmlTag = {});
+        static Expr makePredecessor(const BType &ty, const TagSet::List &bxmlTag = {});
+        static Expr makeSuccessor(const BType &ty, const TagSet::List &bxmlTag = {});
+        static Expr makeMaxInt(const TagSet::List &bxmlTag = {});
+        static Expr makeMinInt(const TagSet::List &bxmlTag = {});
+        static Expr makeINTEGER(const TagSet::List &bxmlTag = {});
+        static Expr makeNATURAL(const TagSet::List &bxmlTag = {});
+        static Expr makeNATURAL1(const TagSet::List &bxmlTag = {});
+        static Expr makeINT(const TagSet::List &bxmlTag = {});
+        static Expr makeNAT(const TagSet::List &bxmlTag = {});
+        static Expr makeNAT1(const TagSet::List &bxmlTag = {});
+        static Expr makeSTRING(const TagSet::List &bxmlTag = {});
+        static Expr makeBOOL(const TagSet::List &bxmlTag = {});
+        static Expr makeTRUE(const TagSet::List &bxmlTag = {});
+        static Expr makeFALSE(const TagSet::List &bxmlTag = {});
+        static Expr makeREAL(const TagSet::List &bxmlTag = {});
+        static Expr makeFLOAT(const TagSet::List &bxmlTag = {});
+        static Expr makeBinaryExpr(BinaryOp op, Expr &&lhs, Expr &&rhs, const BType &type, const TagSet::List &bxmlTag = {});
+        static Expr makeUnaryExpr(UnaryOp op, Expr &&lhs, const BType &type, const TagSet::List &bxmlTag = {});
+        static Expr makeNaryExpr(NaryOp op, std::vector<Expr> &&vec, const BType &type, const TagSet::List &bxmlTag = {});
+        static Expr makeTernaryExpr(TernaryOp op, Expr &&fst, Expr &&snd, Expr &&thd, const BType &type, const TagSet::List &bxmlTag = {});
+        static Expr makeBooleanExpr(Pred &&p, const TagSet::List &bxmlTag = {});
+        static Expr makeRecord(std::vector<std::pair<std::string,Expr>> &&fds, const BType &type, const TagSet::List &bxmlTag = {}); // /!\ fields must be sorted alphabetically
+        static Expr makeStruct(std::vector<std::pair<std::string,Expr>> &&fds, const BType &type, const TagSet::List &bxmlTag = {}); // /!\ fields must be sorted alphabetically
         static Expr makeQuantifiedExpr(QuantifiedOp op,const std::vector<TypedVar> vars,
-                Pred &&cond, Expr &&body, const BType &type, const QStringList &bxmlTag = {});
-        static Expr makeQuantifiedSet(const std::vector<TypedVar> vars, Pred &&cond, const BType &type, const QStringList &bxmlTag = {});
-        static Expr makeRecordFieldUpdate(Expr &&rec, const std::string &label,Expr &&value, const BType &type, const QStringList &bxmlTag = {});
-        static Expr makeRecordFieldAccess(Expr &&rec, const std::string &label, const BType &type, const QStringList &bxmlTag = {});
+                Pred &&cond, Expr &&body, const BType &type, const TagSet::List &bxmlTag = {});
+        static Expr makeQuantifiedSet(const std::vector<TypedVar> vars, Pred &&cond, const BType &type, const TagSet::List &bxmlTag = {});
+        static Expr makeRecordFieldUpdate(Expr &&rec, const std::string &label,Expr &&value, const BType &type, const TagSet::List &bxmlTag = {});
+        static Expr makeRecordFieldAccess(Expr &&rec, const std::string &label, const BType &type, const TagSet::List &bxmlTag = {});
 
         EKind getTag() const { return tag; };
         const BType& getType() const { return type; };
-        const QStringList& getBxmlTag() const { return bxmlTag; };
+        const TagSet::List& getBxmlTag() const { return TagSet::get(bxmlTag); };
 
-        void addBxmlTags(const QStringList &bxmlTag);
+        void addBxmlTags(const TagSet::List &bxmlTag);
         
-        // Capture-avoiding substitution
+        // Capture-avoiding substitution. The operands of the operators are
+        // substituted with an explicit stack; the call stack grows with the
+        // nesting of binders and of predicates in expressions
         void subst(const std::map<VarName,Expr> &map);
+        // Same as above, in the current scope of env (used by the binders)
+        void subst(SubstEnv &env);
         // Alpha renaming. The new var names must not occur (free or bound) in the expression
         void alpha(const std::map<VarName,VarName> &map);
 
@@ -164,6 +183,8 @@ class Expr {
 	 */
         void getFreeVars(const std::set<VarName> &boundVars, const std::set<VarName> &freeVars, std::set<VarName>& freeVarsThis) const;
         void getFreeVars(const std::set<VarName> &boundVars, std::set<VarName> &accu) const;
+        // Adds the identifiers occuring free in the expression to accu
+        void getFreeVars(VarSet &accu) const;
         // Get identifiers occuring free in the expression
         std::set<VarName> getFreeVars() const {
             std::set<VarName> accu;
@@ -177,7 +198,12 @@ class Expr {
             return accu;
         };
 
-        void getAllVars(std::set<VarName> &accu) const;
+        void getAllVars(VarSet &accu) const;
+        void getAllVars(std::set<VarName> &accu) const {
+            VarSet vars;
+            getAllVars(vars);
+            accu.insert(vars.begin(),vars.end());
+        }
         // Get all identifiers (free or bound) occuring in the expression
         std::set<VarName> getAllVars() const {
             std::set<VarName> accu;
@@ -191,6 +217,7 @@ class Expr {
         class Visitor;
         void accept(Visitor &visitor) const;
 
+        // The descriptor is shared with the copy (copy-on-write), so this is O(1)
         Expr copy() const;
 
         const std::string& getIntegerLiteral() const;
@@ -264,39 +291,78 @@ class Expr {
         //inline bool operator>=(const Expr& other) const { return compare(*this,other) >= 0; }
 
         // Remarque: le hashage ne prend pas en compte le type
+        // The hash of each node is cached, so this is O(1) once computed
         size_t hash_combine(size_t seed) const;
+        // Invariant by renaming of the bound variables: alpha_equals(e1,e2)
+        // implies equal hashes. Not cached: O(size of the expression).
+        size_t alpha_hash_combine(size_t seed) const;
 
-        // Auxilliary functions used for avoiding variable capture
+        // Auxilliary functions used for avoiding variable capture. The binders
+        // use SubstEnv; these wrap SubstEnv::captures and SubstEnv::rename for
+        // a substitution whose substituends have the free variables freeVars.
         static bool isRenamingNeeded(const std::vector<TypedVar> &vars,const std::set<VarName> freeVars);
+        static bool isRenamingNeeded(const std::vector<TypedVar> &vars,const VarSet &freeVars);
+        // Renames all the variables of vars, avoiding freeVars, and maps the old names to the new ones in map2
         static void renameVars(std::vector<TypedVar> &vars, const std::set<VarName> freeVars, std::map<VarName,Expr> &map2);
+        static void renameVars(std::vector<TypedVar> &vars, const VarSet &freeVars, std::map<VarName,Expr> &map2);
+
     private:
-        class ExprDesc {
+        friend class NodeTable;
+        class ExprDesc : public Arena::Allocated {
             public:
                 virtual ~ExprDesc(){};
                 virtual size_t hash_combine(size_t seed) const = 0;
                 virtual ExprDesc* copy() const = 0;
-                virtual void subst(const std::map<VarName,Expr> &map) = 0;
+                virtual void subst(SubstEnv &env) = 0;
                 virtual void alpha(const std::map<VarName,VarName> &map) = 0;
                 virtual void getFreeVars(const std::set<VarName> &bv, const std::set<VarName> &freeVars, std::set<VarName>& freeVarsThis) const = 0;
                 virtual void getFreeVars(const std::set<VarName> &bv, std::set<VarName> &accu) const = 0;
                 virtual void getFreeTVars(const std::set<VarName> &bv, std::set<TypedVar> &accu, const BType &ty) const = 0;
-                virtual void getAllVars(std::set<VarName> &accu) const = 0;
+                virtual void getAllVars(VarSet &accu) const = 0;
                 virtual void substFreshId(const std::string &id, const VarName &v) = 0;
+                // Sub-expressions in the scope of this node (binders excepted),
+                // for the traversals driven by an explicit stack
+                virtual void getChildren(std::vector<const Expr*> &) const {};
+                // Moves the sub-expressions out, so that ~Expr destroys them iteratively
+                virtual void release(std::vector<Expr> &) {};
+                // Hash of the expression, reset when desc is modified (see detach)
+                hashUtil::CachedHash cachedHash;
+                // Free variables of the expression, reset when desc is modified
+                FreeVarsCache freeVars;
         };
 
         // Attributes
         EKind tag;  // the 'kind' of the expression. Determine the class of desc.
-        std::unique_ptr<ExprDesc> desc; // the content of the expression (if any)
+        TagSet::Id bxmlTag; // tracability tags (interned, see tagSet.h)
+        std::shared_ptr<ExprDesc> desc; // the content of the expression (if any). May be shared by several expressions.
         BType type; // the type of the expression
-        QStringList bxmlTag; // tracability tags
 
         // Constructor
-        Expr(EKind tag,ExprDesc *desc,const BType &ty, const QStringList &bxmlTag):
+        Expr(EKind tag,ExprDesc *desc,const BType &ty, TagSet::Id bxmlTag):
             tag{tag}
-        ,desc{desc}
+        ,bxmlTag{bxmlTag}
+        ,desc{Arena::share(desc)}
         ,type{ty}
+        {};
+        Expr(EKind tag,const std::shared_ptr<ExprDesc> &desc,const BType &ty, TagSet::Id bxmlTag):
+            tag{tag}
         ,bxmlTag{bxmlTag}
+        ,desc{desc}
+        ,type{ty}
         {};
+        // Gives this expression its own copy of desc before it is modified in place.
+        // Also drops the cached hash: every mutation (subst, alpha, substFreshId,
+        // non-const accessors) goes through detach.
+        void detach();
+        // Hash of this node, from the cached hashes of its sub-expressions
+        size_t nodeHash() const;
+        // Free variables of this expression, computed once (desc must not be a leaf)
+        const std::vector<VarName>& freeVars() const;
+        // Fills the missing hash caches of the sub-expressions, children first
+        void computeHashes() const;
+        // Calls f on every node in the scope of this expression that has no
+        // children for getChildren (leaves and binders), with an explicit stack
+        template<typename F> void forEachScopeLeaf(F f) const;
 };
 
 class Expr::Visitor {
@@ -305,22 +371,22 @@ class Expr::Visitor {
             MaxInt, MinInt, INTEGER, NATURAL, NATURAL1, INT, NAT, NAT1, STRING,
             BOOL, REAL, FLOAT, TRUE, FALSE, EmptySet, Successor, Predecessor };
 
-        virtual void visitConstant(const BType &type, const QStringList &bxmlTag, EConstant c) = 0;
-        virtual void visitIdent(const BType &type, const QStringList &bxmlTag, const VarName &b) = 0;
-        virtual void visitIntegerLiteral(const BType &type, const QStringList &bxmlTag, const std::string & i) = 0;
-        virtual void visitStringLiteral(const BType &type, const QStringList &bxmlTag, const std::string &b) = 0;
-        virtual void visitRealLiteral(const BType &type, const QStringList &bxmlTag, const Decimal &d) = 0;
-        virtual void visitUnaryExpression(const BType &type, const QStringList &bxmlTag, Expr::UnaryOp op,const Expr &e) = 0;
-        virtual void visitBinaryExpression(const BType &type, const QStringList &bxmlTag, Expr::BinaryOp op, const Expr &lhs, const Expr &rhs) = 0;
-        virtual void visitTernaryExpression(const BType &type, const QStringList &bxmlTag, Expr::TernaryOp op, const Expr &fst, const Expr &snd, const Expr &thd) = 0;
-        virtual void visitNaryExpression(const BType &type, const QStringList &bxmlTag, Expr::NaryOp op, const std::vector<Expr> &vec) = 0;
-        virtual void visitBooleanExpression(const BType &type, const QStringList &bxmlTag, const Pred &p) = 0;
-        virtual void visitRecord(const BType &type, const QStringList &bxmlTag, const std::vector<std::pair<std::string,Expr>> &fds) = 0;
-        virtual void visitStruct(const BType &type, const QStringList &bxmlTag, const std::vector<std::pair<std::string,Expr>> &fds) = 0;
-        virtual void visitQuantifiedExpr(const BType &type, const QStringList &bxmlTag, Expr::QuantifiedOp op,const std::vector<TypedVar> vars,const Pred &cond, const Expr &body) = 0;
-        virtual void visitQuantifiedSet(const BType &type, const QStringList &bxmlTag, const std::vector<TypedVar> vars, const Pred &cond) = 0;
-        virtual void visitRecordUpdate(const BType &type, const QStringList &bxmlTag, const Expr &rec, const std::string &label, const Expr &value) = 0;
-        virtual void visitRecordAccess(const BType &type, const QStringList &bxmlTag, const Expr &rec, const std::string &label) = 0;
+        virtual void visitConstant(const BType &type, const TagSet::List &bxmlTag, EConstant c) = 0;
+        virtual void visitIdent(const BType &type, const TagSet::List &bxmlTag, const VarName &b) = 0;
+        virtual void visitIntegerLiteral(const BType &type, const TagSet::List &bxmlTag, const std::string & i) = 0;
+        virtual void visitStringLiteral(const BType &type, const TagSet::List &bxmlTag, const std::string &b) = 0;
+        virtual void visitRealLiteral(const BType &type, const TagSet::List &bxmlTag, const Decimal &d) = 0;
+        virtual void visitUnaryExpression(const BType &type, const TagSet::List &bxmlTag, Expr::UnaryOp op,const Expr &e) = 0;
+        virtual void visitBinaryExpression(const BType &type, const TagSet::List &bxmlTag, Expr::BinaryOp op, const Expr &lhs, const Expr &rhs) = 0;
+        virtual void visitTernaryExpression(const BType &type, const TagSet::List &bxmlTag, Expr::TernaryOp op, const Expr &fst, const Expr &snd, const Expr &thd) = 0;
+        virtual void visitNaryExpression(const BType &type, const TagSet::List &bxmlTag, Expr::NaryOp op, const std::vector<Expr> &vec) = 0;
+        virtual void visitBooleanExpression(const BType &type, const TagSet::List &bxmlTag, const Pred &p) = 0;
+        virtual void visitRecord(const BType &type, const TagSet::List &bxmlTag, const std::vector<std::pair<std::string,Expr>> &fds) = 0;
+        virtual void visitStruct(const BType &type, const TagSet::List &bxmlTag, const std::vector<std::pair<std::string,Expr>> &fds) = 0;
+        virtual void visitQuantifiedExpr(const BType &type, const TagSet::List &bxmlTag, Expr::QuantifiedOp op,const std::vector<TypedVar> vars,const Pred &cond, const Expr &body) = 0;
+        virtual void visitQuantifiedSet(const BType &type, const TagSet::List &bxmlTag, const std::vector<TypedVar> vars, const Pred &cond) = 0;
+        virtual void visitRecordUpdate(const BType &type, const TagSet::List &bxmlTag, const Expr &rec, const std::string &label, const Expr &value) = 0;
+        virtual void visitRecordAccess(const BType &type, const TagSet::List &bxmlTag, const Expr &rec, const std::string &label) = 0;
 };
 
 namespace std {
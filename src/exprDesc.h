@@ -20,6 +20,7 @@
 #include "expr.h"
 #include "pred.h"
 #include "hash.h"
+#include "substEnv.h"
 #include <map>
 
 class Expr::UnaryExpr : public Expr::ExprDesc {
@@ -33,6 +34,12 @@ class Expr::UnaryExpr : public Expr::ExprDesc {
         const UnaryOp op;
         Expr content;
         // Methods
+        void getChildren(std::vector<const Expr*> &children) const {
+            children.push_back(&content);
+        }
+        void release(std::vector<Expr> &children) {
+            children.push_back(std::move(content));
+        }
         size_t hash_combine(size_t seed) const {
             return hashUtil::hash_combine_int(static_cast<int>(op),
                     content.hash_combine(seed));
@@ -40,13 +47,13 @@ class Expr::UnaryExpr : public Expr::ExprDesc {
         UnaryExpr* copy() const {
             return new UnaryExpr(op,content.copy());
         }
-        void subst(const std::map<VarName,Expr> &map) {
-            content.subst(map);
+        void subst(SubstEnv &env) {
+            content.subst(env);
         }
         void alpha(const std::map<VarName,VarName> &map) {
             content.alpha(map);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             content.getAllVars(accu);
         };
         void getFreeVars(const std::set<VarName> &boundVars, const std::set<VarName> &freeVars, std::set<VarName>& freeVarsThis) const {
@@ -76,6 +83,14 @@ class Expr::BinaryExpr : public Expr::ExprDesc {
         Expr lhs;
         Expr rhs;
         // Methods
+        void getChildren(std::vector<const Expr*> &children) const {
+            children.push_back(&lhs);
+            children.push_back(&rhs);
+        }
+        void release(std::vector<Expr> &children) {
+            children.push_back(std::move(lhs));
+            children.push_back(std::move(rhs));
+        }
         size_t hash_combine(size_t seed) const {
             return hashUtil::hash_combine_int(static_cast<int>(op),
                     lhs.hash_combine(
@@ -84,15 +99,15 @@ class Expr::BinaryExpr : public Expr::ExprDesc {
         BinaryExpr* copy() const {
             return new BinaryExpr(op,lhs.copy(),rhs.copy());
         }
-        void subst(const std::map<VarName,Expr> &map) {
-            lhs.subst(map);
-            rhs.subst(map);
+        void subst(SubstEnv &env) {
+            lhs.subst(env);
+            rhs.subst(env);
         }
         void alpha(const std::map<VarName,VarName> &map) {
             lhs.alpha(map);
             rhs.alpha(map);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             lhs.getAllVars(accu);
             rhs.getAllVars(accu);
         };
@@ -129,6 +144,16 @@ class Expr::TernaryExpr : public Expr::ExprDesc {
         Expr snd;
         Expr thd;
         // Methods
+        void getChildren(std::vector<const Expr*> &children) const {
+            children.push_back(&fst);
+            children.push_back(&snd);
+            children.push_back(&thd);
+        }
+        void release(std::vector<Expr> &children) {
+            children.push_back(std::move(fst));
+            children.push_back(std::move(snd));
+            children.push_back(std::move(thd));
+        }
         size_t hash_combine(size_t seed) const {
             return hashUtil::hash_combine_int(static_cast<int>(op),
                     fst.hash_combine(
@@ -138,17 +163,17 @@ class Expr::TernaryExpr : public Expr::ExprDesc {
         TernaryExpr* copy() const {
             return new TernaryExpr(op,fst.copy(),snd.copy(),thd.copy());
         }
-        void subst(const std::map<VarName,Expr> &map) {
-            fst.subst(map);
-            snd.subst(map);
-            thd.subst(map);
+        void subst(SubstEnv &env) {
+            fst.subst(env);
+            snd.subst(env);
+            thd.subst(env);
         }
         void alpha(const std::map<VarName,VarName> &map) {
             fst.alpha(map);
             snd.alpha(map);
             thd.alpha(map);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             fst.getAllVars(accu);
             snd.getAllVars(accu);
             thd.getAllVars(accu);
@@ -186,6 +211,14 @@ class Expr::NaryExpr : public Expr::ExprDesc {
         const NaryOp op;
         std::vector<Expr> vec;
         // Methods
+        void getChildren(std::vector<const Expr*> &children) const {
+            for(auto &e : vec)
+                children.push_back(&e);
+        }
+        void release(std::vector<Expr> &children) {
+            for(auto &e : vec)
+                children.push_back(std::move(e));
+        }
         size_t hash_combine(size_t seed) const {
             seed = hashUtil::hash_combine_int(static_cast<int>(op),seed);
             for(auto &e : vec)
@@ -198,15 +231,15 @@ class Expr::NaryExpr : public Expr::ExprDesc {
                 vec2.push_back(p.copy());
             return new NaryExpr(op,std::move(vec2));
         }
-        void subst(const std::map<VarName,Expr> &map) {
+        void subst(SubstEnv &env) {
             for(auto &e : vec)
-                e.subst(map);
+                e.subst(env);
         }
         void alpha(const std::map<VarName,VarName> &map) {
             for(auto &e : vec)
                 e.alpha(map);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &e: vec)
                 e.getAllVars(accu);
         };
@@ -246,6 +279,14 @@ class Expr::RecordExpr : public Expr::ExprDesc {
         // Members
         std::vector<std::pair<std::string,Expr>> fields;
         // Methods
+        void getChildren(std::vector<const Expr*> &children) const {
+            for(auto &p : fields)
+                children.push_back(&p.second);
+        }
+        void release(std::vector<Expr> &children) {
+            for(auto &p : fields)
+                children.push_back(std::move(p.second));
+        }
         size_t hash_combine(size_t seed) const {
             for(auto &p : fields)
                 seed = hashUtil::hash_combine_string(p.first,
@@ -258,15 +299,15 @@ class Expr::RecordExpr : public Expr::ExprDesc {
                 fields2.push_back({p.first,p.second.copy()});
             return new RecordExpr(std::move(fields2));
         }
-        void subst(const std::map<VarName,Expr> &map) {
+        void subst(SubstEnv &env) {
             for(auto &p : fields)
-                p.second.subst(map);
+                p.second.subst(env);
         }
         void alpha(const std::map<VarName,VarName> &map) {
             for(auto &p : fields)
                 p.second.alpha(map);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &pair: fields)
                 pair.second.getAllVars(accu);
         };
@@ -299,6 +340,14 @@ class Expr::StructExpr : public Expr::ExprDesc {
         // Members
         std::vector<std::pair<std::string,Expr>> fields;
         // Methods
+        void getChildren(std::vector<const Expr*> &children) const {
+            for(auto &p : fields)
+                children.push_back(&p.second);
+        }
+        void release(std::vector<Expr> &children) {
+            for(auto &p : fields)
+                children.push_back(std::move(p.second));
+        }
         size_t hash_combine(size_t seed) const {
             for(auto &p : fields)
                 seed = hashUtil::hash_combine_string(p.first,
@@ -311,15 +360,15 @@ class Expr::StructExpr : public Expr::ExprDesc {
                 fields2.push_back({p.first,p.second.copy()});
             return new StructExpr(std::move(fields2));
         }
-        void subst(const std::map<VarName,Expr> &map) {
+        void subst(SubstEnv &env) {
             for(auto &p : fields)
-                p.second.subst(map);
+                p.second.subst(env);
         }
         void alpha(const std::map<VarName,VarName> &map) {
             for(auto &p : fields)
                 p.second.alpha(map);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &pair: fields)
                 pair.second.getAllVars(accu);
         };
@@ -360,22 +409,17 @@ class Expr::QuantifiedSet : public Expr::ExprDesc {
         QuantifiedSet* copy() const {
             return new QuantifiedSet(vars,cond.copy());
         }
-        void subst(const std::map<VarName,Expr> &map) {
-            std::map<VarName,Expr> map2;
-            for(auto &p : map)
-                map2[p.first] = p.second.copy();
-            for(auto &v : vars)
-                map2.erase(v.name);
-            std::set<VarName> freeVars;
-            for(auto &p : map)
-                p.second.getFreeVars({},freeVars);
-            if(Expr::isRenamingNeeded(vars,freeVars)){
-                cond.getAllVars(freeVars);
-                Expr::renameVars(vars,freeVars,map2);
-                cond.subst(map2);
-            } else if(!map2.empty()){
-                cond.subst(map2);
+        void subst(SubstEnv &env) {
+            env.push(vars);
+            if(env.captures(vars)){
+                VarSet avoid;
+                cond.getAllVars(avoid);
+                env.rename(vars,avoid);
+            }
+            if(!env.empty()){
+                cond.subst(env);
             }
+            env.pop();
         }
         void alpha(const std::map<VarName,VarName> &map) {
             std::map<VarName,VarName> map2 { map };
@@ -386,7 +430,7 @@ class Expr::QuantifiedSet : public Expr::ExprDesc {
             if(!map2.empty())
                 cond.alpha(map2);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &v : vars)
                 accu.insert(v.name);
             cond.getAllVars(accu);
@@ -432,6 +476,9 @@ class Expr::QuantifiedExpr : public Expr::ExprDesc {
         Pred cond;
         Expr body;
         // Methods
+        void release(std::vector<Expr> &children) {
+            children.push_back(std::move(body));
+        }
         size_t hash_combine(size_t seed) const {
             seed = hashUtil::hash_combine_int(static_cast<int>(op),seed);
             for(auto &v : vars)
@@ -442,25 +489,19 @@ class Expr::QuantifiedExpr : public Expr::ExprDesc {
         QuantifiedExpr* copy() const {
             return new QuantifiedExpr(op,vars,cond.copy(),body.copy());
         }
-        void subst(const std::map<VarName,Expr> &map) {
-            std::map<VarName,Expr> map2;
-            for(auto &p : map)
-                map2[p.first] = p.second.copy();
-            for(auto &v : vars)
-                map2.erase(v.name);
-            std::set<VarName> freeVars;
-            for(auto &p : map)
-                p.second.getFreeVars({},freeVars);
-            if(Expr::isRenamingNeeded(vars,freeVars)){
-                cond.getAllVars(freeVars);
-                body.getAllVars(freeVars);
-                Expr::renameVars(vars,freeVars,map2);
-                cond.subst(map2);
-                body.subst(map2);
-            } else if(!map2.empty()){
-                cond.subst(map2);
-                body.subst(map2);
+        void subst(SubstEnv &env) {
+            env.push(vars);
+            if(env.captures(vars)){
+                VarSet avoid;
+                cond.getAllVars(avoid);
+                body.getAllVars(avoid);
+                env.rename(vars,avoid);
+            }
+            if(!env.empty()){
+                cond.subst(env);
+                body.subst(env);
             }
+            env.pop();
         }
         void alpha(const std::map<VarName,VarName> &map) {
             std::map<VarName,VarName> map2 { map };
@@ -473,7 +514,7 @@ class Expr::QuantifiedExpr : public Expr::ExprDesc {
                 body.alpha(map2);
             }
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &v : vars)
                 accu.insert(v.name);
             cond.getAllVars(accu);
@@ -521,19 +562,25 @@ class Expr::RecordAccessExpr : public Expr::ExprDesc {
         Expr rec;
         const std::string label;
         // Methods
+        void getChildren(std::vector<const Expr*> &children) const {
+            children.push_back(&rec);
+        }
+        void release(std::vector<Expr> &children) {
+            children.push_back(std::move(rec));
+        }
         size_t hash_combine(size_t seed) const {
             return rec.hash_combine(hashUtil::hash_combine_string(label,seed));
         }
         RecordAccessExpr* copy() const {
             return new RecordAccessExpr(rec.copy(),label);
         }
-        void subst(const std::map<VarName,Expr> &map) {
-            rec.subst(map);
+        void subst(SubstEnv &env) {
+            rec.subst(env);
         }
         void alpha(const std::map<VarName,VarName> &map) {
             rec.alpha(map);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             rec.getAllVars(accu);
         }
         void getFreeVars(const std::set<VarName> &boundVars, const std::set<VarName> &freeVars, std::set<VarName>& freeVarsThis) const {
@@ -563,6 +610,14 @@ class Expr::RecordUpdateExpr : public Expr::ExprDesc {
         const std::string label;
         Expr fvalue;
         // Methods
+        void getChildren(std::vector<const Expr*> &children) const {
+            children.push_back(&rec);
+            children.push_back(&fvalue);
+        }
+        void release(std::vector<Expr> &children) {
+            children.push_back(std::move(rec));
+            children.push_back(std::move(fvalue));
+        }
         size_t hash_combine(size_t seed) const {
             return rec.hash_combine(fvalue.hash_combine
                     (hashUtil::hash_combine_string(label,seed)));
@@ -570,15 +625,15 @@ class Expr::RecordUpdateExpr : public Expr::ExprDesc {
         RecordUpdateExpr* copy() const {
             return new RecordUpdateExpr(rec.copy(),label,fvalue.copy());
         }
-        void subst(const std::map<VarName,Expr> &map) {
-            rec.subst(map);
-            fvalue.subst(map);
+        void subst(SubstEnv &env) {
+            rec.subst(env);
+            fvalue.subst(env);
         }
         void alpha(const std::map<VarName,VarName> &map) {
             rec.alpha(map);
             fvalue.alpha(map);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             rec.getAllVars(accu);
             fvalue.getAllVars(accu);
         }
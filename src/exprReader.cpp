@@ -16,12 +16,13 @@
 #include "exprReader.h"
 #include "predReader.h"
 #include "exprDesc.h"
-#include <map>
+#include "xmlTags.h"
 #include <utility>
+#include <cstring>
 
 namespace Xml {
     TypedVar VarNameFromId(const QDomElement &id, const std::vector<BType> &typeInfos){
-        if(id.tagName() == "Id"){
+        if(id.tagName() == QLatin1String("Id")){
             QString prefix = id.attribute("value","");
             if(prefix == "")
                 throw ExprReaderException("value attribute is empty.",id.lineNumber());
@@ -45,7 +46,7 @@ namespace Xml {
                 else
                     return {VarName::makeVar(prefix.toStdString(),i),typeInfos[typref]};
             }
-        } else if(id.tagName() == "Fresh_Id"){
+        } else if(id.tagName() == QLatin1String("Fresh_Id")){
             QString prefix = id.attribute("ref","");
             if(prefix == "")
                 throw ExprReaderException("ref attribute is empty.",id.lineNumber());
@@ -63,7 +64,7 @@ namespace Xml {
         assert(false); // unreachable
     };
 
-    const std::map<std::string, Expr::EKind> etags = {
+    constexpr auto etags = makeStrTable<Expr::EKind>({
         {"Binary_Exp", Expr::EKind::BinaryExpr},
         {"Nary_Exp", Expr::EKind::NaryExpr},
         {"Boolean_Literal",Expr::EKind::TRUE},
@@ -84,8 +85,8 @@ namespace Xml {
         {"Ternary_Exp",  Expr::EKind::TernaryExpr},
         {"Record_Field_Access",Expr::EKind::Record_Field_Access},
         {"Record_Update",Expr::EKind::Record_Field_Update},
-    };
-    const std::map<std::string, Expr::UnaryOp> unaryExpOp = {
+    });
+    constexpr auto unaryExpOp = makeStrTable<Expr::UnaryOp>({
         {"card", Expr::UnaryOp::Cardinality},
         {"dom", Expr::UnaryOp::Domain},
         {"ran", Expr::UnaryOp::Range},
@@ -134,9 +135,9 @@ namespace Xml {
         {"right", Expr::UnaryOp::Right},
         {"infix", Expr::UnaryOp::Infix},
         {"bin", Expr::UnaryOp::Bin}
-    };
+    });
 
-    const std::map<std::string, Expr::BinaryOp> binaryExpOp = {
+    constexpr auto binaryExpOp = makeStrTable<Expr::BinaryOp>({
         {",",Expr::BinaryOp::Mapplet},
         {"*i", Expr::BinaryOp::IMultiplication},
         {"*f", Expr::BinaryOp::FMultiplication},
@@ -191,31 +192,29 @@ namespace Xml {
         {"father", Expr::BinaryOp::Father},
         {"subtree", Expr::BinaryOp::Subtree},
         {"arity", Expr::BinaryOp::Arity}
-    };
+    });
 
-    const std::map<std::string, Expr::TernaryOp> ternaryExpOp = {
+    constexpr auto ternaryExpOp = makeStrTable<Expr::TernaryOp>({
         {"bin",Expr::TernaryOp::Bin},
         {"son",Expr::TernaryOp::Son},
-    };
+    });
 
-    const std::map<std::string, Expr::NaryOp> naryExpOp = {
+    constexpr auto naryExpOp = makeStrTable<Expr::NaryOp>({
         {"[",Expr::NaryOp::Sequence},
         {"{",Expr::NaryOp::Set}
-    };
+    });
 
-    const std::map<std::string, Expr::QuantifiedOp> quantifiedExprOp = {
+    constexpr auto quantifiedExprOp = makeStrTable<Expr::QuantifiedOp>({
         {"%",Expr::QuantifiedOp::Lambda},
         {"rSIGMA",Expr::QuantifiedOp::RSum},
         {"iSIGMA",Expr::QuantifiedOp::ISum},
         {"rPI",Expr::QuantifiedOp::RProduct},
         {"iPI",Expr::QuantifiedOp::IProduct},
         {"INTER",Expr::QuantifiedOp::Intersection},
-        {"UNION",Expr::QuantifiedOp::Union},
-        {"rPI",Expr::QuantifiedOp::RProduct},
-        {"rSIGMA",Expr::QuantifiedOp::RSum}
-    };
+        {"UNION",Expr::QuantifiedOp::Union}
+    });
 
-    const std::map<std::string, Expr::EKind> constantExpr = {
+    constexpr auto constantExpr = makeStrTable<Expr::EKind>({
         {"MAXINT",Expr::EKind::MaxInt},
         {"MININT",Expr::EKind::MinInt},
         {"INTEGER",Expr::EKind::INTEGER},
@@ -232,7 +231,57 @@ namespace Xml {
         {"FALSE",Expr::EKind::FALSE},
         {"succ", Expr::EKind::Successor},
         {"pred", Expr::EKind::Predecessor}
-    };
+    });
+
+    /* Chains of Binary_Exp are read with an explicit stack, as machine generated
+     * models may nest them very deeply. A frame is pushed for each Binary_Exp
+     * element on the way down; its expression is built once both operands are read. */
+    static Expr readBinaryExpression(const QDomElement &dom, const std::vector<BType> &typeInfos){
+        struct Frame {
+            Expr::BinaryOp op;
+            BType type;
+            TagSet::List bxmlTag;
+            QDomElement snd;
+            Expr lhs;
+            bool hasLhs;
+        };
+        std::vector<Frame> stack;
+        QDomElement cur = dom;
+        Expr res;
+        while(true){
+            while(cur.tagName() == QLatin1String("Binary_Exp")){
+                if(!cur.hasAttribute("typref"))
+                    throw ExprReaderException("Missing typref attribute for 'Binary_Exp'.",cur.lineNumber());
+                QString op = cur.attribute("op");
+                auto it = find(binaryExpOp,op);
+                if(it == nullptr)
+                    throw ExprReaderException
+                        ("Unknown binary expression operator '" + op.toStdString() + "'.",cur.lineNumber());
+                TagSet::List bxmlTag;
+                QString _bxmlTag = cur.attribute("tag");
+                if(_bxmlTag != "")
+                    bxmlTag.push_back(_bxmlTag.toStdString());
+                QDomElement fst = cur.firstChildElement();
+                stack.push_back({it->value,typeInfos[cur.attribute("typref").toUInt()],
+                        std::move(bxmlTag),fst.nextSiblingElement(),Expr(),false});
+                cur = fst;
+            }
+            res = readExpression(cur,typeInfos);
+            while(true){
+                if(stack.empty())
+                    return res;
+                Frame &f = stack.back();
+                if(!f.hasLhs){
+                    f.lhs = std::move(res);
+                    f.hasLhs = true;
+                    cur = f.snd;
+                    break;
+                }
+                res = Expr::makeBinaryExpr(f.op,std::move(f.lhs),std::move(res),f.type,f.bxmlTag);
+                stack.pop_back();
+            }
+        }
+    }
 
     Expr readExpression(const QDomElement &dom, const std::vector<BType> &typeInfos){
         if (dom.isNull())
@@ -242,34 +291,25 @@ namespace Xml {
         if(!dom.hasAttribute("typref"))
             throw ExprReaderException("Missing typref attribute for '" + tagName.toStdString() + "'.",dom.lineNumber());
         BType type = typeInfos[dom.attribute("typref").toUInt()];
-        QStringList bxmlTag;
+        TagSet::List bxmlTag;
         QString _bxmlTag = dom.attribute("tag");
         if(_bxmlTag != "")
-            bxmlTag.push_back(_bxmlTag);
+            bxmlTag.push_back(_bxmlTag.toStdString());
 
-        auto it = etags.find(tagName.toStdString());
-        if(it == etags.end())
+        auto it = find(etags,tagName);
+        if(it == nullptr)
             throw ExprReaderException("Unexpected tag '" + tagName.toStdString() + "'.",dom.lineNumber());
 
-        switch(it->second){
+        switch(it->value){
             case Expr::EKind::BinaryExpr:
                 {
-                    QString op = dom.attribute("op");
-                    auto it = binaryExpOp.find(op.toStdString());
-                    if(it == binaryExpOp.end())
-                        throw ExprReaderException
-                            ("Unknown binary expression operator '" + op.toStdString() + "'.",dom.lineNumber());
-                    QDomElement fst = dom.firstChildElement();
-                    QDomElement snd = fst.nextSiblingElement();
-                    Expr lhs = readExpression(fst,typeInfos);
-                    Expr rhs = readExpression(snd,typeInfos);
-                    return Expr::makeBinaryExpr(it->second,std::move(lhs),std::move(rhs),type,bxmlTag);
+                    return readBinaryExpression(dom,typeInfos);
                 }
             case Expr::EKind::TernaryExpr:
                 {
                     QString op = dom.attribute("op");
-                    auto it = ternaryExpOp.find(op.toStdString());
-                    if(it == ternaryExpOp.end())
+                    auto it = find(ternaryExpOp,op);
+                    if(it == nullptr)
                         throw ExprReaderException
                             ("Unknown ternary expression operator '" + op.toStdString() + "'.",dom.lineNumber());
                     QDomElement fst = dom.firstChildElement();
@@ -278,13 +318,13 @@ namespace Xml {
                     Expr efst = readExpression(fst,typeInfos);
                     Expr esnd = readExpression(snd,typeInfos);
                     Expr ethd = readExpression(thd,typeInfos);
-                    return Expr::makeTernaryExpr(it->second,std::move(efst),std::move(esnd),std::move(ethd),type,bxmlTag);
+                    return Expr::makeTernaryExpr(it->value,std::move(efst),std::move(esnd),std::move(ethd),type,bxmlTag);
                 }
             case Expr::EKind::NaryExpr:
                 {
                     QString op = dom.attribute("op");
-                    auto it = naryExpOp.find(op.toStdString());
-                    if(it == naryExpOp.end())
+                    auto it = find(naryExpOp,op);
+                    if(it == nullptr)
                         throw ExprReaderException
                             ("Unknown n-ary expression operator '" + op.toStdString() + "'.",dom.lineNumber());
                     std::vector<Expr> lst;
@@ -293,7 +333,7 @@ namespace Xml {
                         lst.push_back(readExpression(ce,typeInfos));
                         ce = ce.nextSiblingElement();
                     }
-                    return Expr::makeNaryExpr(it->second,std::move(lst),type, bxmlTag);
+                    return Expr::makeNaryExpr(it->value,std::move(lst),type, bxmlTag);
                 }
             case Expr::EKind::BooleanExpr:
                 {
@@ -307,20 +347,19 @@ namespace Xml {
                 }
             case Expr::EKind::Id:
                 {
-                    if(tagName.toStdString() == "Fresh_Id"){
+                    if(tagName == QLatin1String("Fresh_Id")){
                         TypedVar tv = VarNameFromId(dom,typeInfos);
                         return Expr::makeIdent(tv.name, tv.type, bxmlTag);
                     }
 
-                    auto v = dom.attribute("value").toStdString();
-                    auto it = constantExpr.find(v);
+                    auto it = find(constantExpr,dom.attribute("value"));
 
-                    if(it == constantExpr.end()){
+                    if(it == nullptr){
                         TypedVar tv = VarNameFromId(dom,typeInfos);
                         return Expr::makeIdent(tv.name, tv.type, bxmlTag);
                     }
 
-                    switch (it->second){
+                    switch (it->value){
                         case Expr::EKind::MaxInt:
                             return Expr::makeMaxInt(bxmlTag);
                         case Expr::EKind::MinInt:
@@ -383,8 +422,8 @@ namespace Xml {
             case Expr::EKind::QuantifiedExpr:
                 {
                     QString op = dom.attribute("type");
-                    auto it = quantifiedExprOp.find(op.toStdString());
-                    if(it == quantifiedExprOp.end())
+                    auto it = find(quantifiedExprOp,op);
+                    if(it == nullptr)
                         throw ExprReaderException
                             ("Unknown type of quantified expression '" + op.toStdString() + "'.",dom.lineNumber());
 
@@ -401,7 +440,7 @@ namespace Xml {
                     }
                     Pred pre = readPredicate(dom.firstChildElement("Pred").firstChildElement(),typeInfos);
                     Expr body = readExpression(dom.firstChildElement("Body").firstChildElement(),typeInfos);
-                    return Expr::makeQuantifiedExpr(it->second,ids,std::move(pre),std::move(body),type,bxmlTag );
+                    return Expr::makeQuantifiedExpr(it->value,ids,std::move(pre),std::move(body),type,bxmlTag );
                 }
             case Expr::EKind::QuantifiedSet:
                 {
@@ -422,12 +461,12 @@ namespace Xml {
             case Expr::EKind::UnaryExpr:
                 {
                     QString op = dom.attribute("op");
-                    auto it = unaryExpOp.find(op.toStdString());
-                    if(it == unaryExpOp.end())
+                    auto it = find(unaryExpOp,op);
+                    if(it == nullptr)
                         throw ExprReaderException
                             ("Unknown unary expression operator '" + op.toStdString() + "'.",dom.lineNumber());
                     Expr content = readExpression(dom.firstChildElement(),typeInfos);
-                    return Expr::makeUnaryExpr(it->second,std::move(content),type,bxmlTag);
+                    return Expr::makeUnaryExpr(it->value,std::move(content),type,bxmlTag);
                 }
             case Expr::EKind::Struct:
                 {
@@ -509,4 +548,427 @@ namespace Xml {
         };
         assert(false); // unreachable
     };
+
+    Expr readExpression(const QDomElement &dom, const std::vector<BType> &typeInfos, Arena &arena){
+        Arena::Scope scope(arena);
+        return readExpression(dom,typeInfos);
+    }
+
+    // Moves to the next child element of the current element.
+    // Returns false when the end element of the current element is reached.
+    static bool nextChild(QXmlStreamReader &stream){
+        if(stream.readNextStartElement())
+            return true;
+        if(stream.hasError())
+            throw ExprReaderException(stream.errorString().toStdString(),stream.lineNumber());
+        return false;
+    }
+
+    static void expectChild(QXmlStreamReader &stream, const char *tagName){
+        if(!nextChild(stream))
+            throw ExprReaderException("Missing child element in '" + std::string(tagName) + "'.",stream.lineNumber());
+    }
+
+    TypedVar VarNameFromId(QXmlStreamReader &stream, const std::vector<BType> &typeInfos){
+        const QXmlStreamAttributes attrs = stream.attributes();
+        const int line = stream.lineNumber();
+        if(stream.name() == QLatin1String("Id")){
+            QString prefix = attrs.value("value").toString();
+            if(prefix == "")
+                throw ExprReaderException("value attribute is empty.",line);
+            QString typref_s = attrs.value("typref").toString();
+            if(typref_s == "")
+                throw ExprReaderException("value attribute is empty.",line);
+            bool ok = false;
+            unsigned int typref = typref_s.toInt(&ok);
+            if(!ok)
+                throw ExprReaderException("typref attribute is not an integer.",line);
+            stream.skipCurrentElement();
+
+            if(!attrs.hasAttribute("suffix")){
+                return {VarName::makeVarWithoutSuffix(prefix.toStdString()),typeInfos[typref]};
+            } else {
+                bool ok;
+                int i = attrs.value("suffix").toString().toInt(&ok);
+                if(!ok)
+                    throw ExprReaderException("suffix attribute must be a integer.",line);
+                else if(i == 0)
+                    return {VarName::makeVarWithoutSuffix(prefix.toStdString()),typeInfos[typref]};
+                else
+                    return {VarName::makeVar(prefix.toStdString(),i),typeInfos[typref]};
+            }
+        } else if(stream.name() == QLatin1String("Fresh_Id")){
+            QString prefix = attrs.value("ref").toString();
+            if(prefix == "")
+                throw ExprReaderException("ref attribute is empty.",line);
+            QString typref_s = attrs.value("typref").toString();
+            if(typref_s == "")
+                throw ExprReaderException("value attribute is empty.",line);
+            bool ok = false;
+            unsigned int typref = typref_s.toInt(&ok);
+            if(!ok)
+                throw ExprReaderException("typref attribute is not an integer.",line);
+            stream.skipCurrentElement();
+            return {VarName::makeFreshId(prefix.toStdString()),typeInfos[typref]};
+        } else {
+            throw ExprReaderException("Id element expected.",line);
+        }
+        assert(false); // unreachable
+    };
+
+    // Reads the sequence of Id elements of a 'Variables' element
+    static std::vector<TypedVar> readVariables(QXmlStreamReader &stream, const std::vector<BType> &typeInfos){
+        std::vector<TypedVar> ids;
+        while(nextChild(stream))
+            ids.push_back(VarNameFromId(stream,typeInfos));
+        return ids;
+    }
+
+    static std::vector<std::pair<std::string,Expr>> readRecordItems(QXmlStreamReader &stream, const std::vector<BType> &typeInfos){
+        std::vector<std::pair<std::string,Expr>> vec;
+        while(nextChild(stream)){
+            if(stream.name() != QLatin1String("Record_Item")){
+                stream.skipCurrentElement();
+                continue;
+            }
+            const QXmlStreamAttributes attrs = stream.attributes();
+            if(!attrs.hasAttribute("label"))
+                throw ExprReaderException
+                    ("The 'Record_Item' element is missing a 'label' attribute.",stream.lineNumber());
+            std::string label = attrs.value("label").toString().toStdString();
+            expectChild(stream,"Record_Item");
+            vec.push_back(std::make_pair(label,readExpression(stream,typeInfos)));
+            stream.skipCurrentElement();
+        }
+        std::sort(vec.begin(),vec.end(),RecordFieldCmp);
+        return vec;
+    }
+
+    // Streaming counterpart of readBinaryExpression(const QDomElement&,...)
+    static Expr readBinaryExpression(QXmlStreamReader &stream, const std::vector<BType> &typeInfos){
+        struct Frame {
+            Expr::BinaryOp op;
+            BType type;
+            TagSet::List bxmlTag;
+            Expr lhs;
+            bool hasLhs;
+        };
+        std::vector<Frame> stack;
+        Expr res;
+        while(true){
+            while(stream.name() == QLatin1String("Binary_Exp")){
+                const QXmlStreamAttributes attrs = stream.attributes();
+                if(!attrs.hasAttribute("typref"))
+                    throw ExprReaderException("Missing typref attribute for 'Binary_Exp'.",stream.lineNumber());
+                const QStringRef op = attrs.value("op");
+                auto it = find(binaryExpOp,op);
+                if(it == nullptr)
+                    throw ExprReaderException
+                        ("Unknown binary expression operator '" + op.toString().toStdString() + "'.",stream.lineNumber());
+                TagSet::List bxmlTag;
+                QString _bxmlTag = attrs.value("tag").toString();
+                if(_bxmlTag != "")
+                    bxmlTag.push_back(_bxmlTag.toStdString());
+                stack.push_back({it->value,typeInfos[attrs.value("typref").toString().toUInt()],
+                        std::move(bxmlTag),Expr(),false});
+                expectChild(stream,"Binary_Exp");
+            }
+            res = readExpression(stream,typeInfos);
+            while(true){
+                if(stack.empty())
+                    return res;
+                Frame &f = stack.back();
+                if(!f.hasLhs){
+                    f.lhs = std::move(res);
+                    f.hasLhs = true;
+                    expectChild(stream,"Binary_Exp");
+                    break;
+                }
+                stream.skipCurrentElement();
+                res = Expr::makeBinaryExpr(f.op,std::move(f.lhs),std::move(res),f.type,f.bxmlTag);
+                stack.pop_back();
+            }
+        }
+    }
+
+    Expr readExpression(QXmlStreamReader &stream, const std::vector<BType> &typeInfos){
+        if (!stream.isStartElement())
+            throw ExprReaderException("Start element expected.",stream.lineNumber());
+
+        const int line = stream.lineNumber();
+        auto it = find(etags,stream.name());
+        if(it == nullptr)
+            throw ExprReaderException("Unexpected tag '" + stream.name().toString().toStdString() + "'.",line);
+        const char *tagName = it->key;
+
+        const QXmlStreamAttributes attrs = stream.attributes();
+        if(!attrs.hasAttribute("typref"))
+            throw ExprReaderException("Missing typref attribute for '" + std::string(tagName) + "'.",line);
+        BType type = typeInfos[attrs.value("typref").toString().toUInt()];
+        TagSet::List bxmlTag;
+        QString _bxmlTag = attrs.value("tag").toString();
+        if(_bxmlTag != "")
+            bxmlTag.push_back(_bxmlTag.toStdString());
+
+        switch(it->value){
+            case Expr::EKind::BinaryExpr:
+                {
+                    return readBinaryExpression(stream,typeInfos);
+                }
+            case Expr::EKind::TernaryExpr:
+                {
+                    const QStringRef op = attrs.value("op");
+                    auto it = find(ternaryExpOp,op);
+                    if(it == nullptr)
+                        throw ExprReaderException
+                            ("Unknown ternary expression operator '" + op.toString().toStdString() + "'.",line);
+                    expectChild(stream,tagName);
+                    Expr efst = readExpression(stream,typeInfos);
+                    expectChild(stream,tagName);
+                    Expr esnd = readExpression(stream,typeInfos);
+                    expectChild(stream,tagName);
+                    Expr ethd = readExpression(stream,typeInfos);
+                    stream.skipCurrentElement();
+                    return Expr::makeTernaryExpr(it->value,std::move(efst),std::move(esnd),std::move(ethd),type,bxmlTag);
+                }
+            case Expr::EKind::NaryExpr:
+                {
+                    const QStringRef op = attrs.value("op");
+                    auto it = find(naryExpOp,op);
+                    if(it == nullptr)
+                        throw ExprReaderException
+                            ("Unknown n-ary expression operator '" + op.toString().toStdString() + "'.",line);
+                    std::vector<Expr> lst;
+                    while(nextChild(stream))
+                        lst.push_back(readExpression(stream,typeInfos));
+                    return Expr::makeNaryExpr(it->value,std::move(lst),type, bxmlTag);
+                }
+            case Expr::EKind::BooleanExpr:
+                {
+                    expectChild(stream,tagName);
+                    Pred p = readPredicate(stream,typeInfos);
+                    stream.skipCurrentElement();
+                    return Expr::makeBooleanExpr(std::move(p),bxmlTag);
+                }
+            case Expr::EKind::EmptySet:
+                {
+                    stream.skipCurrentElement();
+                    return Expr::makeEmptySet(type, bxmlTag);
+                }
+            case Expr::EKind::Id:
+                {
+                    if(std::strcmp(tagName,"Fresh_Id") == 0){
+                        TypedVar tv = VarNameFromId(stream,typeInfos);
+                        return Expr::makeIdent(tv.name, tv.type, bxmlTag);
+                    }
+
+                    auto it = find(constantExpr,attrs.value("value"));
+
+                    if(it == nullptr){
+                        TypedVar tv = VarNameFromId(stream,typeInfos);
+                        return Expr::makeIdent(tv.name, tv.type, bxmlTag);
+                    }
+
+                    stream.skipCurrentElement();
+                    switch (it->value){
+                        case Expr::EKind::MaxInt:
+                            return Expr::makeMaxInt(bxmlTag);
+                        case Expr::EKind::MinInt:
+                            return Expr::makeMinInt(bxmlTag);
+                        case Expr::EKind::INTEGER:
+                            return Expr::makeINTEGER(bxmlTag);
+                        case Expr::EKind::NATURAL:
+                            return Expr::makeNATURAL(bxmlTag);
+                        case Expr::EKind::NATURAL1:
+                            return Expr::makeNATURAL1(bxmlTag);
+                        case Expr::EKind::INT:
+                            return Expr::makeINT(bxmlTag);
+                        case Expr::EKind::NAT:
+                            return Expr::makeNAT(bxmlTag);
+                        case Expr::EKind::NAT1:
+                            return Expr::makeNAT1(bxmlTag);
+                        case Expr::EKind::STRING:
+                            return Expr::makeSTRING(bxmlTag);
+                        case Expr::EKind::BOOL:
+                            return Expr::makeBOOL(bxmlTag);
+                        case Expr::EKind::REAL:
+                            return Expr::makeREAL(bxmlTag);
+                        case Expr::EKind::FLOAT:
+                            return Expr::makeFLOAT(bxmlTag);
+                        case Expr::EKind::TRUE:
+                            return Expr::makeTRUE(bxmlTag);
+                        case Expr::EKind::FALSE:
+                            return Expr::makeFALSE(bxmlTag);
+                        case Expr::EKind::Successor:
+                            return Expr::makeSuccessor(type,bxmlTag);
+                        case Expr::EKind::Predecessor:
+                            return Expr::makePredecessor(type,bxmlTag);
+                        default:
+                            assert(false); // unreachable
+                    };
+                }
+            case Expr::EKind::IntegerLiteral:
+                {
+                    stream.skipCurrentElement();
+                    return Expr::makeInteger(attrs.value("value").toString().toStdString(),bxmlTag);
+                }
+            case Expr::EKind::RealLiteral:
+                {
+                    QString value = attrs.value("value").toString();
+                    QStringList lst = value.split(".");
+                    stream.skipCurrentElement();
+                    if(lst.size() == 1 || lst.size() == 2){
+                        std::string integerPart = lst[0].toStdString();
+                        if(lst.size() == 1){
+                            return Expr::makeReal(Expr::Decimal(integerPart),bxmlTag);
+                        } else /* lst.size() == 2 */ {
+                            std::string decimalPart = lst[1].toStdString();
+                            return Expr::makeReal(Expr::Decimal(integerPart,decimalPart),bxmlTag);
+                        }
+                    } else {
+                        throw ExprReaderException("Incorrect decimal value ("+ value.toStdString() + ").",line);
+                    }
+                }
+            case Expr::EKind::StringLiteral:
+                {
+                    stream.skipCurrentElement();
+                    return Expr::makeString(attrs.value("value").toString().toStdString(),bxmlTag);
+                }
+            case Expr::EKind::QuantifiedExpr:
+                {
+                    const QStringRef op = attrs.value("type");
+                    auto it = find(quantifiedExprOp,op);
+                    if(it == nullptr)
+                        throw ExprReaderException
+                            ("Unknown type of quantified expression '" + op.toString().toStdString() + "'.",line);
+
+                    std::vector<TypedVar> ids;
+                    Pred pre;
+                    Expr body;
+                    bool hasVars = false, hasPred = false, hasBody = false;
+                    while(nextChild(stream)){
+                        if(stream.name() == QLatin1String("Variables")){
+                            ids = readVariables(stream,typeInfos);
+                            hasVars = true;
+                        } else if(stream.name() == QLatin1String("Pred")){
+                            expectChild(stream,"Pred");
+                            pre = readPredicate(stream,typeInfos);
+                            stream.skipCurrentElement();
+                            hasPred = true;
+                        } else if(stream.name() == QLatin1String("Body")){
+                            expectChild(stream,"Body");
+                            body = readExpression(stream,typeInfos);
+                            stream.skipCurrentElement();
+                            hasBody = true;
+                        } else {
+                            stream.skipCurrentElement();
+                        }
+                    }
+                    if(!hasVars)
+                        throw ExprReaderException
+                            ("The 'Quantified_Exp' element is missing some 'Variables' child.",line);
+                    if(!hasPred)
+                        throw ExprReaderException
+                            ("The 'Quantified_Exp' element is missing some 'Pred' child.",line);
+                    if(!hasBody)
+                        throw ExprReaderException
+                            ("The 'Quantified_Exp' element is missing some 'Body' child.",line);
+                    return Expr::makeQuantifiedExpr(it->value,ids,std::move(pre),std::move(body),type,bxmlTag );
+                }
+            case Expr::EKind::QuantifiedSet:
+                {
+                    std::vector<TypedVar> ids;
+                    Pred body;
+                    bool hasVars = false, hasBody = false;
+                    while(nextChild(stream)){
+                        if(stream.name() == QLatin1String("Variables")){
+                            ids = readVariables(stream,typeInfos);
+                            hasVars = true;
+                        } else if(stream.name() == QLatin1String("Body")){
+                            expectChild(stream,"Body");
+                            body = readPredicate(stream,typeInfos);
+                            stream.skipCurrentElement();
+                            hasBody = true;
+                        } else {
+                            stream.skipCurrentElement();
+                        }
+                    }
+                    if(!hasVars)
+                        throw ExprReaderException
+                            ("The 'Quantified_Set' element is missing some 'Variables' child.",line);
+                    if(!hasBody)
+                        throw ExprReaderException
+                            ("The 'Quantified_Set' element is missing some 'Body' child.",line);
+                    return Expr::makeQuantifiedSet(ids,std::move(body),type,bxmlTag );
+                }
+            case Expr::EKind::UnaryExpr:
+                {
+                    const QStringRef op = attrs.value("op");
+                    auto it = find(unaryExpOp,op);
+                    if(it == nullptr)
+                        throw ExprReaderException
+                            ("Unknown unary expression operator '" + op.toString().toStdString() + "'.",line);
+                    expectChild(stream,tagName);
+                    Expr content = readExpression(stream,typeInfos);
+                    stream.skipCurrentElement();
+                    return Expr::makeUnaryExpr(it->value,std::move(content),type,bxmlTag);
+                }
+            case Expr::EKind::Struct:
+                return Expr::makeStruct(readRecordItems(stream,typeInfos),type, bxmlTag);
+            case Expr::EKind::Record:
+                return Expr::makeRecord(readRecordItems(stream,typeInfos),type, bxmlTag);
+            case Expr::EKind::TRUE: // Boolean_Literal
+                {
+                    QString lt = attrs.value("value").toString().toUpper();
+                    stream.skipCurrentElement();
+                    if(lt == "TRUE") return Expr::makeTRUE(bxmlTag);
+                    else if(lt == "FALSE") return Expr::makeFALSE(bxmlTag);
+                    else
+                        throw ExprReaderException("Unknown boolean literal '"
+                                + lt.toStdString() + "'.",line);
+                }
+            case Expr::EKind::Record_Field_Update:
+                {
+                    std::string label = attrs.value("label").toString().toStdString();
+                    expectChild(stream,tagName);
+                    Expr rec = readExpression(stream,typeInfos);
+                    expectChild(stream,tagName);
+                    Expr fval = readExpression(stream,typeInfos);
+                    stream.skipCurrentElement();
+                    return Expr::makeRecordFieldUpdate(std::move(rec),label,std::move(fval),type,bxmlTag);
+                }
+            case Expr::EKind::Record_Field_Access:
+                {
+                    std::string label = attrs.value("label").toString().toStdString();
+                    expectChild(stream,tagName);
+                    Expr rec = readExpression(stream,typeInfos);
+                    stream.skipCurrentElement();
+                    return Expr::makeRecordFieldAccess(std::move(rec),label,type,bxmlTag);
+                }
+            case Expr::EKind::MaxInt:
+            case Expr::EKind::MinInt:
+            case Expr::EKind::INTEGER:
+            case Expr::EKind::NATURAL:
+            case Expr::EKind::NATURAL1:
+            case Expr::EKind::INT:
+            case Expr::EKind::NAT:
+            case Expr::EKind::NAT1:
+            case Expr::EKind::STRING:
+            case Expr::EKind::BOOL:
+            case Expr::EKind::REAL:
+            case Expr::EKind::FLOAT:
+            case Expr::EKind::FALSE:
+            case Expr::EKind::Successor:
+            case Expr::EKind::Predecessor:
+                {
+                    assert(false); // unreachable
+                }
+        };
+        assert(false); // unreachable
+    };
+
+    Expr readExpression(QXmlStreamReader &stream, const std::vector<BType> &typeInfos, Arena &arena){
+        Arena::Scope scope(arena);
+        return readExpression(stream,typeInfos);
+    }
 }
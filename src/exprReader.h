@@ -18,9 +18,11 @@
 
 #include "expr.h"
 #include<QDomElement>
+#include<QXmlStreamReader>
 
 namespace Xml {
     TypedVar VarNameFromId(const QDomElement &id, const std::vector<BType> &typeInfos);
+    TypedVar VarNameFromId(QXmlStreamReader &stream, const std::vector<BType> &typeInfos);
 
     class ExprReaderException : public std::exception
     {
@@ -34,6 +36,13 @@ namespace Xml {
             std::string description;
     };
     Expr readExpression(const QDomElement &dom, const std::vector<BType> &typeInfos);
+    // Same as above, with every node allocated in arena. The arena must outlive the returned expression.
+    Expr readExpression(const QDomElement &dom, const std::vector<BType> &typeInfos, Arena &arena);
+
+    // Streaming variants: no DOM is built. The stream must be positioned on the
+    // start element of the expression; on return it is on the matching end element.
+    Expr readExpression(QXmlStreamReader &stream, const std::vector<BType> &typeInfos);
+    Expr readExpression(QXmlStreamReader &stream, const std::vector<BType> &typeInfos, Arena &arena);
 }
 
 #endif // EXPRREADER_H
@@ -17,6 +17,7 @@
 #include "exprWriter.h"
 #include "predWriter.h"
 #include "exprDesc.h"
+#include "xmlTags.h"
 
 namespace Xml {
     unsigned int getTypRef(std::map<BType,unsigned int> &typeInfos, const BType &ty){
@@ -32,13 +33,13 @@ namespace Xml {
 
     void writeExprAttributes(
             const BType &type,
-            const QStringList &bxmlTag,
+            const TagSet::List &bxmlTag,
             QXmlStreamWriter &stream,
             std::map<BType,unsigned int> &typeInfos)
     {
         stream.writeAttribute("typref",QString::number(getTypRef(typeInfos,type)));
         if(!bxmlTag.empty()){
-            stream.writeAttribute("tag",bxmlTag.join(","));
+            stream.writeAttribute("tag",toQStringList(bxmlTag).join(","));
         }
     }
 
@@ -64,7 +65,7 @@ namespace Xml {
 
     class ExprWriterVisitor : public Expr::Visitor {
         public:
-            void visitConstant(const BType &type, const QStringList &bxmlTag,Expr::Visitor::EConstant c){
+            void visitConstant(const BType &type, const TagSet::List &bxmlTag,Expr::Visitor::EConstant c){
                 switch (c){
                     case Expr::Visitor::EConstant::MaxInt:
                         {
@@ -203,25 +204,25 @@ namespace Xml {
                         }
                 }
             }
-            void visitIntegerLiteral(const BType &type, const QStringList &bxmlTag,const std::string &i){
+            void visitIntegerLiteral(const BType &type, const TagSet::List &bxmlTag,const std::string &i){
                 stream.writeStartElement("Integer_Literal");
                 stream.writeAttribute("value",QString::fromStdString(i));
                 writeExprAttributes(type,bxmlTag,stream,typeInfos);
                 stream.writeEndElement(); // Integer_Literal
             }
-            void visitStringLiteral(const BType &type, const QStringList &bxmlTag,const std::string &b){
+            void visitStringLiteral(const BType &type, const TagSet::List &bxmlTag,const std::string &b){
                 stream.writeStartElement("STRING_Literal");
                 stream.writeAttribute("value",QString::fromStdString(b));
                 writeExprAttributes(type,bxmlTag,stream,typeInfos);
                 stream.writeEndElement(); // STRING_Literal
             }
-            void visitRealLiteral(const BType &type, const QStringList &bxmlTag,const Expr::Decimal &d){
+            void visitRealLiteral(const BType &type, const TagSet::List &bxmlTag,const Expr::Decimal &d){
                 stream.writeStartElement("Real_Literal");
                 stream.writeAttribute("value",QString::fromStdString(d.integerPart) + "." + QString::fromStdString(d.fractionalPart));
                 writeExprAttributes(type,bxmlTag,stream,typeInfos);
                 stream.writeEndElement(); // Real_Literal
             }
-            void visitIdent(const BType &type, const QStringList &bxmlTag, const VarName &v){
+            void visitIdent(const BType &type, const TagSet::List &bxmlTag, const VarName &v){
                 stream.writeStartElement("Id");
                 stream.writeAttribute("value",QString::fromStdString(v.prefix()));
                 switch(v.kind()){
@@ -240,45 +241,55 @@ namespace Xml {
                 writeExprAttributes(type,bxmlTag,stream,typeInfos);
                 stream.writeEndElement(); // Id
             }
-            void visitUnaryExpression(const BType &type, const QStringList &bxmlTag,Expr::UnaryOp op,const Expr &e){
+            void visitUnaryExpression(const BType &type, const TagSet::List &bxmlTag,Expr::UnaryOp op,const Expr &e){
                 stream.writeStartElement("Unary_Exp");
-                stream.writeAttribute("op",QString::fromStdString(Expr::to_string(op)));
+                stream.writeAttribute("op",toQString(op,Expr::UnaryOp::Bin,Expr::to_chars));
                 writeExprAttributes(type,bxmlTag,stream,typeInfos);
                 e.accept(*this);
                 stream.writeEndElement(); // Unary_Exp
             }
-            void visitBinaryExpression(const BType &type, const QStringList &bxmlTag,Expr::BinaryOp op, const Expr &lhs, const Expr &rhs){
-                stream.writeStartElement("Binary_Exp");
-                stream.writeAttribute("op",QString::fromStdString(Expr::to_string(op)));
-                writeExprAttributes(type,bxmlTag,stream,typeInfos);
-                lhs.accept(*this);
-                rhs.accept(*this);
-                stream.writeEndElement(); // Binary_Exp
+            void visitBinaryExpression(const BType &type, const TagSet::List &bxmlTag,Expr::BinaryOp op, const Expr &lhs, const Expr &rhs){
+                // Chains of Binary_Exp are written with an explicit stack, as
+                // they may be very deep. A null entry closes a Binary_Exp.
+                std::vector<const Expr*> todo;
+                writeBinaryStart(type,bxmlTag,op,lhs,rhs,todo);
+                while(!todo.empty()){
+                    const Expr *e = todo.back();
+                    todo.pop_back();
+                    if(e == nullptr){
+                        stream.writeEndElement(); // Binary_Exp
+                    } else if(e->getTag() == Expr::EKind::BinaryExpr){
+                        auto &b = e->toBinaryExpr();
+                        writeBinaryStart(e->getType(),e->getBxmlTag(),b.op,b.lhs,b.rhs,todo);
+                    } else {
+                        e->accept(*this);
+                    }
+                }
             }
-            void visitTernaryExpression(const BType &type, const QStringList &bxmlTag,Expr::TernaryOp op, const Expr &fst, const Expr &snd, const Expr &thd){
+            void visitTernaryExpression(const BType &type, const TagSet::List &bxmlTag,Expr::TernaryOp op, const Expr &fst, const Expr &snd, const Expr &thd){
                 stream.writeStartElement("Ternary_Exp");
-                stream.writeAttribute("op",QString::fromStdString(Expr::to_string(op)));
+                stream.writeAttribute("op",toQString(op,Expr::TernaryOp::Bin,Expr::to_chars));
                 writeExprAttributes(type,bxmlTag,stream,typeInfos);
                 fst.accept(*this);
                 snd.accept(*this);
                 thd.accept(*this);
                 stream.writeEndElement(); // Ternary_Exp
             }
-            void visitNaryExpression(const BType &type, const QStringList &bxmlTag,Expr::NaryOp op, const std::vector<Expr> &vec){
+            void visitNaryExpression(const BType &type, const TagSet::List &bxmlTag,Expr::NaryOp op, const std::vector<Expr> &vec){
                 stream.writeStartElement("Nary_Exp");
-                stream.writeAttribute("op",QString::fromStdString(Expr::to_string(op)));
+                stream.writeAttribute("op",toQString(op,Expr::NaryOp::Set,Expr::to_chars));
                 writeExprAttributes(type,bxmlTag,stream,typeInfos);
                 for(auto &e : vec)
                     e.accept(*this);
                 stream.writeEndElement(); // Nary_Exp
             }
-            void visitBooleanExpression(const BType &type, const QStringList &bxmlTag,const Pred &p){
+            void visitBooleanExpression(const BType &type, const TagSet::List &bxmlTag,const Pred &p){
                 stream.writeStartElement("Boolean_Exp");
                 writeExprAttributes(type,bxmlTag,stream,typeInfos);
                 writePredicate(stream,typeInfos,p);
                 stream.writeEndElement(); // Boolean_Exp
             }
-            void visitRecord(const BType &type, const QStringList &bxmlTag,const std::vector<std::pair<std::string,Expr>> &fds){
+            void visitRecord(const BType &type, const TagSet::List &bxmlTag,const std::vector<std::pair<std::string,Expr>> &fds){
                 stream.writeStartElement("Record");
                 writeExprAttributes(type,bxmlTag,stream,typeInfos);
                 for(auto &pair : fds){
@@ -289,7 +300,7 @@ namespace Xml {
                 };
                 stream.writeEndElement(); // Record
             }
-            void visitStruct(const BType &type, const QStringList &bxmlTag,const std::vector<std::pair<std::string,Expr>> &fds){
+            void visitStruct(const BType &type, const TagSet::List &bxmlTag,const std::vector<std::pair<std::string,Expr>> &fds){
                 stream.writeStartElement("Struct");
                 writeExprAttributes(type,bxmlTag,stream,typeInfos);
                 for(auto &pair : fds){
@@ -300,9 +311,9 @@ namespace Xml {
                 };
                 stream.writeEndElement(); // Struct
             }
-            void visitQuantifiedExpr(const BType &type, const QStringList &bxmlTag,Expr::QuantifiedOp op,const std::vector<TypedVar> vars,const Pred &cond, const Expr &body){
+            void visitQuantifiedExpr(const BType &type, const TagSet::List &bxmlTag,Expr::QuantifiedOp op,const std::vector<TypedVar> vars,const Pred &cond, const Expr &body){
                 stream.writeStartElement("Quantified_Exp");
-                stream.writeAttribute("type",QString::fromStdString(Expr::to_string(op)));
+                stream.writeAttribute("type",toQString(op,Expr::QuantifiedOp::RProduct,Expr::to_chars));
                 writeExprAttributes(type,bxmlTag,stream,typeInfos);
 
                 stream.writeStartElement("Variables");
@@ -320,7 +331,7 @@ namespace Xml {
 
                 stream.writeEndElement(); // Quantified_Exp
             }
-            void visitQuantifiedSet(const BType &type, const QStringList &bxmlTag,const std::vector<TypedVar> vars, const Pred &cond){
+            void visitQuantifiedSet(const BType &type, const TagSet::List &bxmlTag,const std::vector<TypedVar> vars, const Pred &cond){
                 stream.writeStartElement("Quantified_Set");
                 writeExprAttributes(type,bxmlTag,stream,typeInfos);
 
@@ -336,7 +347,7 @@ namespace Xml {
                 stream.writeEndElement(); // Quantified_Set
             };
 
-            void visitRecordUpdate(const BType &type, const QStringList &bxmlTag, const Expr &rec, const std::string &label, const Expr &value){
+            void visitRecordUpdate(const BType &type, const TagSet::List &bxmlTag, const Expr &rec, const std::string &label, const Expr &value){
                 stream.writeStartElement("Record_Update");
                 stream.writeAttribute("label",QString::fromStdString(label));
                 writeExprAttributes(type,bxmlTag,stream,typeInfos);
@@ -345,7 +356,7 @@ namespace Xml {
                 stream.writeEndElement(); // Record_Update
             }
 
-            void visitRecordAccess(const BType &type, const QStringList &bxmlTag, const Expr &rec, const std::string &label){
+            void visitRecordAccess(const BType &type, const TagSet::List &bxmlTag, const Expr &rec, const std::string &label){
                 stream.writeStartElement("Record_Field_Access");
                 stream.writeAttribute("label",QString::fromStdString(label));
                 writeExprAttributes(type,bxmlTag,stream,typeInfos);
@@ -360,6 +371,17 @@ namespace Xml {
         private:
             QXmlStreamWriter &stream;
             std::map<BType,unsigned int> &typeInfos;
+
+            // Opens a Binary_Exp element and pushes what remains to write
+            void writeBinaryStart(const BType &type, const TagSet::List &bxmlTag,Expr::BinaryOp op, const Expr &lhs, const Expr &rhs,
+                    std::vector<const Expr*> &todo){
+                stream.writeStartElement("Binary_Exp");
+                stream.writeAttribute("op",toQString(op,Expr::BinaryOp::Arity,Expr::to_chars));
+                writeExprAttributes(type,bxmlTag,stream,typeInfos);
+                todo.push_back(nullptr);
+                todo.push_back(&rhs);
+                todo.push_back(&lhs);
+            }
     };
 
     void writeExpression(QXmlStreamWriter &stream, std::map<BType,unsigned int> &typeInfos, const Expr &p){
@@ -21,6 +21,8 @@
 #include <QXmlStreamWriter>
 
 namespace Xml {
+    // Number of ty in typeInfos, ty is added if needed
+    unsigned int getTypRef(std::map<BType,unsigned int> &typeInfos, const BType &ty);
     void writeTypedVar(QXmlStreamWriter &stream, std::map<BType,unsigned int> &typeInfos, const TypedVar &v);
     void writeExpression(QXmlStreamWriter &stream, std::map<BType,unsigned int> &typeInfos, const Expr &p);
 }
@@ -0,0 +1,664 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include "fingerprint.h"
+#include "hash.h"
+#include "predDesc.h"
+
+// Marks the beginning of each tree, as Bin::Root
+enum class Root : unsigned char { Expr = 'E', Pred = 'P', GPred = 'G', Subst = 'S', Type = 'T', String = 's' };
+
+static const uint64_t c1 = 0x87c37b91114253d5ULL;
+static const uint64_t c2 = 0x4cf5ad432745937fULL;
+
+static inline uint64_t rotl64(uint64_t x, int r){
+    return (x << r) | (x >> (64 - r));
+}
+
+// Little-endian whatever the platform
+static inline uint64_t load64(const unsigned char *p){
+    uint64_t res = 0;
+    for(int i=7;i>=0;i--)
+        res = (res << 8) | p[i];
+    return res;
+}
+
+void Fingerprinter::Stream::block(const unsigned char *p){
+    uint64_t k1 = load64(p);
+    uint64_t k2 = load64(p + 8);
+    k1 *= c1; k1 = rotl64(k1,31); k1 *= c2; h1 ^= k1;
+    h1 = rotl64(h1,27); h1 += h2; h1 = h1*5 + 0x52dce729;
+    k2 *= c2; k2 = rotl64(k2,33); k2 *= c1; h2 ^= k2;
+    h2 = rotl64(h2,31); h2 += h1; h2 = h2*5 + 0x38495ab5;
+}
+
+void Fingerprinter::Stream::bytes(const unsigned char *data, size_t len){
+    length += len;
+    if(buffered > 0){
+        size_t n = std::min(len,16 - buffered);
+        std::memcpy(buffer + buffered,data,n);
+        buffered += n;
+        data += n;
+        len -= n;
+        if(buffered < 16)
+            return;
+        block(buffer);
+        buffered = 0;
+    }
+    for(; len >= 16; data += 16, len -= 16)
+        block(data);
+    std::memcpy(buffer,data,len);
+    buffered = len;
+}
+
+Fingerprint Fingerprinter::Stream::finish() const {
+    uint64_t r1 = h1;
+    uint64_t r2 = h2;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    const unsigned char *tail = buffer;
+    switch(buffered){
+        case 15: k2 ^= uint64_t(tail[14]) << 48; // fall through
+        case 14: k2 ^= uint64_t(tail[13]) << 40; // fall through
+        case 13: k2 ^= uint64_t(tail[12]) << 32; // fall through
+        case 12: k2 ^= uint64_t(tail[11]) << 24; // fall through
+        case 11: k2 ^= uint64_t(tail[10]) << 16; // fall through
+        case 10: k2 ^= uint64_t(tail[9]) << 8; // fall through
+        case 9: k2 ^= uint64_t(tail[8]);
+                k2 *= c2; k2 = rotl64(k2,33); k2 *= c1; r2 ^= k2;
+                // fall through
+        case 8: k1 ^= uint64_t(tail[7]) << 56; // fall through
+        case 7: k1 ^= uint64_t(tail[6]) << 48; // fall through
+        case 6: k1 ^= uint64_t(tail[5]) << 40; // fall through
+        case 5: k1 ^= uint64_t(tail[4]) << 32; // fall through
+        case 4: k1 ^= uint64_t(tail[3]) << 24; // fall through
+        case 3: k1 ^= uint64_t(tail[2]) << 16; // fall through
+        case 2: k1 ^= uint64_t(tail[1]) << 8; // fall through
+        case 1: k1 ^= uint64_t(tail[0]);
+                k1 *= c1; k1 = rotl64(k1,31); k1 *= c2; r1 ^= k1;
+    };
+    r1 ^= length;
+    r2 ^= length;
+    r1 += r2;
+    r2 += r1;
+    r1 = hashUtil::mix64(r1);
+    r2 = hashUtil::mix64(r2);
+    r1 += r2;
+    r2 += r1;
+    return {r1,r2};
+}
+
+void Fingerprinter::varint(uint64_t v){
+    unsigned char buf[10];
+    size_t n = 0;
+    while(v >= 0x80){
+        buf[n++] = static_cast<unsigned char>((v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    buf[n++] = static_cast<unsigned char>(v);
+    stream.bytes(buf,n);
+}
+
+template <typename E>
+static uint64_t enumValue(E e){
+    return static_cast<uint64_t>(e);
+}
+
+void Fingerprinter::str(const std::string &s){
+    varint(s.size());
+    stream.bytes(reinterpret_cast<const unsigned char*>(s.data()),s.size());
+}
+
+void Fingerprinter::fingerprint(const Fingerprint &f){
+    unsigned char buf[16];
+    for(int i=0;i<8;i++){
+        buf[i] = static_cast<unsigned char>(f.low >> (8*i));
+        buf[8+i] = static_cast<unsigned char>(f.high >> (8*i));
+    }
+    stream.bytes(buf,16);
+}
+
+/* The fingerprint of a type is computed once, in a stream of its own, and
+ * then fed as 16 bytes: a struct type met at every node costs no more than
+ * INTEGER. */
+void Fingerprinter::type(const BType &ty){
+    auto it = types.find(ty.getId());
+    if(it != types.end()){
+        fingerprint(it->second);
+        return;
+    }
+    Stream saved = stream;
+    stream = Stream();
+    varint(enumValue(ty.getKind()));
+    switch(ty.getKind()){
+        case BType::Kind::INTEGER:
+        case BType::Kind::BOOLEAN:
+        case BType::Kind::FLOAT:
+        case BType::Kind::REAL:
+        case BType::Kind::STRING:
+            break;
+        case BType::Kind::ProductType:
+            {
+                auto &p = ty.toProductType();
+                type(p.lhs);
+                type(p.rhs);
+                break;
+            }
+        case BType::Kind::PowerType:
+            type(ty.toPowerType().content);
+            break;
+        case BType::Kind::Struct:
+            {
+                auto &fields = ty.toRecordType().fields;
+                varint(fields.size());
+                for(auto &f : fields){
+                    str(f.first);
+                    type(f.second);
+                }
+                break;
+            }
+    }
+    Fingerprint f = stream.finish();
+    stream = saved;
+    types.insert({ty.getId(),f});
+    fingerprint(f);
+}
+
+void Fingerprinter::name(const VarName &v){
+    varint(enumValue(v.kind()));
+    str(v.prefix());
+    switch(v.kind()){
+        case VarName::Kind::WithSuffix:
+            varint(v.suffix());
+            break;
+        case VarName::Kind::Tmp:
+            varint(-v.suffix());
+            break;
+        case VarName::Kind::NoSuffix:
+        case VarName::Kind::FreshId:
+            break;
+    }
+}
+
+void Fingerprinter::tags(const TagSet::List &bxmlTag){
+    varint(bxmlTag.size());
+    for(auto &t : bxmlTag)
+        str(t);
+}
+
+void Fingerprinter::vars(const std::vector<TypedVar> &vec){
+    varint(vec.size());
+    for(auto &v : vec){
+        name(v.name);
+        type(v.type);
+    }
+}
+
+// Same as the types: the definition of an operation is fingerprinted once per Fingerprinter
+void Fingerprinter::operation(const std::shared_ptr<const Subst::Operation> &op){
+    auto it = operations.find(op.get());
+    if(it != operations.end()){
+        fingerprint(it->second);
+        return;
+    }
+    Stream saved = stream;
+    stream = Stream();
+    str(op->name);
+    vars(op->input);
+    vars(op->output);
+    pred(op->precondition);
+    subst(op->body);
+    Fingerprint f = stream.finish();
+    stream = saved;
+    operations.insert({op.get(),f});
+    operationTable.push_back(op);
+    fingerprint(f);
+}
+
+/* The visitors feed the content of a node, its header is fed by the caller.
+ * When the sub-trees of the same kind come last in the content of a node, the
+ * visitor pushes them on the stack of the caller instead of recursing: they
+ * are fed in the same prefix order, and chains of operators such as
+ * ((a+b)+c)+... do not use the call stack. */
+
+class Fingerprinter::ExprVisitor : public Expr::Visitor {
+    public:
+        ExprVisitor(Fingerprinter &f, std::vector<const Expr*> &todo):f{f},todo{todo}{};
+        void visitConstant(const BType &, const TagSet::List &, EConstant){}
+        void visitIdent(const BType &, const TagSet::List &, const VarName &v){
+            f.name(v);
+        }
+        void visitIntegerLiteral(const BType &, const TagSet::List &, const std::string &i){
+            f.str(i);
+        }
+        void visitStringLiteral(const BType &, const TagSet::List &, const std::string &s){
+            f.str(s);
+        }
+        void visitRealLiteral(const BType &, const TagSet::List &, const Expr::Decimal &d){
+            f.str(d.integerPart);
+            f.str(d.fractionalPart);
+        }
+        void visitUnaryExpression(const BType &, const TagSet::List &, Expr::UnaryOp op, const Expr &e){
+            f.varint(enumValue(op));
+            todo.push_back(&e);
+        }
+        void visitBinaryExpression(const BType &, const TagSet::List &, Expr::BinaryOp op, const Expr &lhs, const Expr &rhs){
+            f.varint(enumValue(op));
+            todo.push_back(&rhs);
+            todo.push_back(&lhs);
+        }
+        void visitTernaryExpression(const BType &, const TagSet::List &, Expr::TernaryOp op, const Expr &fst, const Expr &snd, const Expr &thd){
+            f.varint(enumValue(op));
+            todo.push_back(&thd);
+            todo.push_back(&snd);
+            todo.push_back(&fst);
+        }
+        void visitNaryExpression(const BType &, const TagSet::List &, Expr::NaryOp op, const std::vector<Expr> &vec){
+            f.varint(enumValue(op));
+            f.varint(vec.size());
+            for(auto it = vec.rbegin(); it != vec.rend(); ++it)
+                todo.push_back(&*it);
+        }
+        void visitBooleanExpression(const BType &, const TagSet::List &, const Pred &p){
+            f.pred(p);
+        }
+        void visitRecord(const BType &, const TagSet::List &, const std::vector<std::pair<std::string,Expr>> &fds){
+            fields(fds);
+        }
+        void visitStruct(const BType &, const TagSet::List &, const std::vector<std::pair<std::string,Expr>> &fds){
+            fields(fds);
+        }
+        void visitQuantifiedExpr(const BType &, const TagSet::List &, Expr::QuantifiedOp op, const std::vector<TypedVar> vars, const Pred &cond, const Expr &body){
+            f.varint(enumValue(op));
+            f.vars(vars);
+            f.pred(cond);
+            todo.push_back(&body);
+        }
+        void visitQuantifiedSet(const BType &, const TagSet::List &, const std::vector<TypedVar> vars, const Pred &cond){
+            f.vars(vars);
+            f.pred(cond);
+        }
+        void visitRecordUpdate(const BType &, const TagSet::List &, const Expr &rec, const std::string &label, const Expr &value){
+            f.str(label);
+            todo.push_back(&value);
+            todo.push_back(&rec);
+        }
+        void visitRecordAccess(const BType &, const TagSet::List &, const Expr &rec, const std::string &label){
+            f.str(label);
+            todo.push_back(&rec);
+        }
+    private:
+        Fingerprinter &f;
+        std::vector<const Expr*> &todo;
+        void fields(const std::vector<std::pair<std::string,Expr>> &fds){
+            f.varint(fds.size());
+            for(auto &fd : fds){
+                f.str(fd.first);
+                f.expr(fd.second);
+            }
+        }
+};
+
+class Fingerprinter::PredVisitor : public Pred::Visitor {
+    public:
+        PredVisitor(Fingerprinter &f, std::vector<const Pred*> &todo):f{f},todo{todo}{};
+        void visitImplication(const Pred &lhs, const Pred &rhs){
+            todo.push_back(&rhs);
+            todo.push_back(&lhs);
+        }
+        void visitEquivalence(const Pred &lhs, const Pred &rhs){
+            todo.push_back(&rhs);
+            todo.push_back(&lhs);
+        }
+        void visitExprComparison(Pred::ComparisonOp op, const Expr &lhs, const Expr &rhs){
+            f.varint(enumValue(op));
+            f.expr(lhs);
+            f.expr(rhs);
+        }
+        void visitNegation(const Pred &p){
+            todo.push_back(&p);
+        }
+        void visitConjunction(const std::vector<Pred> &vec){
+            list(vec);
+        }
+        void visitDisjunction(const std::vector<Pred> &vec){
+            list(vec);
+        }
+        void visitForall(const std::vector<TypedVar> &vars, const Pred &p){
+            f.vars(vars);
+            todo.push_back(&p);
+        }
+        void visitExists(const std::vector<TypedVar> &vars, const Pred &p){
+            f.vars(vars);
+            todo.push_back(&p);
+        }
+        void visitTrue(){}
+        void visitFalse(){}
+    private:
+        Fingerprinter &f;
+        std::vector<const Pred*> &todo;
+        void list(const std::vector<Pred> &vec){
+            f.varint(vec.size());
+            for(auto it = vec.rbegin(); it != vec.rend(); ++it)
+                todo.push_back(&*it);
+        }
+};
+
+class Fingerprinter::SubstVisitor : public Subst::Visitor {
+    public:
+        SubstVisitor(Fingerprinter &f, std::vector<const Subst*> &todo):f{f},todo{todo}{};
+        void visitSkip(){}
+        void visitBlock(const Subst &s){
+            todo.push_back(&s);
+        }
+        void visitAssert(const Pred &p, const Subst &s){
+            f.pred(p);
+            todo.push_back(&s);
+        }
+        void visitIfThen(const Pred &p, const Subst &s){
+            f.pred(p);
+            todo.push_back(&s);
+        }
+        void visitIfThenElse(const Pred &p, const Subst &s_if, const Subst &s_else){
+            f.pred(p);
+            todo.push_back(&s_else);
+            todo.push_back(&s_if);
+        }
+        void visitSimpleAssignment(const std::vector<TypedVar> &variables, const std::vector<Expr> &values){
+            f.vars(variables);
+            for(auto &e : values)
+                f.expr(e);
+        }
+        void visitSelect(const std::vector<std::pair<Pred,Subst>> &clauses){
+            select(clauses);
+        }
+        void visitSelectElse(const std::vector<std::pair<Pred,Subst>> &clauses, const Subst &els){
+            select(clauses);
+            f.subst(els);
+        }
+        void visitCase(const Expr &e, const std::vector<Subst::CaseChoice> &cases){
+            f.expr(e);
+            choices(cases);
+        }
+        void visitCaseElse(const Expr &e, const std::vector<Subst::CaseChoice> &cases, const Subst &els){
+            f.expr(e);
+            choices(cases);
+            f.subst(els);
+        }
+        void visitAny(const std::vector<TypedVar> &vars, const Pred &p, const Subst &body){
+            f.vars(vars);
+            f.pred(p);
+            todo.push_back(&body);
+        }
+        void visitOpCall(const std::vector<Expr> &input, const std::vector<TypedVar> &output,
+                const std::shared_ptr<const Subst::Operation> &op)
+        {
+            f.varint(input.size());
+            for(auto &e : input)
+                f.expr(e);
+            f.vars(output);
+            f.operation(op);
+        }
+        void visitWhile(const Pred &cond, const Subst &body, const Pred &inv, const Expr &var){
+            f.pred(cond);
+            f.subst(body);
+            f.pred(inv);
+            f.expr(var);
+        }
+        void visitSequence(const std::vector<Subst> &vec){
+            list(vec);
+        }
+        void visitParallel(const std::vector<Subst> &vec){
+            list(vec);
+        }
+        void visitChoice(const std::vector<Subst> &vec){
+            list(vec);
+        }
+        void visitWitness(const std::map<std::string,Expr> &witnesses, const Subst &body){
+            f.varint(witnesses.size());
+            for(auto &p : witnesses){
+                f.str(p.first);
+                f.expr(p.second);
+            }
+            todo.push_back(&body);
+        }
+    private:
+        Fingerprinter &f;
+        std::vector<const Subst*> &todo;
+        void select(const std::vector<std::pair<Pred,Subst>> &clauses){
+            f.varint(clauses.size());
+            for(auto &c : clauses){
+                f.pred(c.first);
+                f.subst(c.second);
+            }
+        }
+        void choices(const std::vector<Subst::CaseChoice> &cases){
+            f.varint(cases.size());
+            for(auto &c : cases){
+                f.varint(c.values.size());
+                for(auto &v : c.values)
+                    f.expr(v);
+                f.subst(c.body);
+            }
+        }
+        void list(const std::vector<Subst> &vec){
+            f.varint(vec.size());
+            for(auto it = vec.rbegin(); it != vec.rend(); ++it)
+                todo.push_back(&*it);
+        }
+};
+
+void Fingerprinter::expr(const Expr &e){
+    std::vector<const Expr*> todo {&e};
+    ExprVisitor v(*this,todo);
+    while(!todo.empty()){
+        const Expr *n = todo.back();
+        todo.pop_back();
+        varint(enumValue(n->getTag()));
+        type(n->getType());
+        tags(n->getBxmlTag());
+        n->accept(v);
+    }
+}
+
+void Fingerprinter::pred(const Pred &p){
+    std::vector<const Pred*> todo {&p};
+    PredVisitor v(*this,todo);
+    while(!todo.empty()){
+        const Pred *n = todo.back();
+        todo.pop_back();
+        varint(enumValue(n->getTag()));
+        str(n->getGoalTag());
+        if(n->getTag() == Pred::PKind::Exists) // not given to the visitor
+            varint(n->toExists().allowWitnessInstanciation ? 1 : 0);
+        n->accept(v);
+    }
+}
+
+void Fingerprinter::subst(const Subst &s){
+    std::vector<const Subst*> todo {&s};
+    SubstVisitor v(*this,todo);
+    while(!todo.empty()){
+        const Subst *n = todo.back();
+        todo.pop_back();
+        varint(enumValue(n->getTag()));
+        n->accept(v);
+    }
+}
+
+// Same stack as the visitors above
+void Fingerprinter::gpred(const GPred &root){
+    std::vector<const GPred*> todo {&root};
+    while(!todo.empty()){
+        const GPred &p = *todo.back();
+        todo.pop_back();
+        varint(enumValue(p.getKind()));
+        switch(p.getKind()){
+            case GPred::Kind::Implication:
+                todo.push_back(&p.toImplication().rhs);
+                todo.push_back(&p.toImplication().lhs);
+                break;
+            case GPred::Kind::Equivalence:
+                todo.push_back(&p.toEquivalence().rhs);
+                todo.push_back(&p.toEquivalence().lhs);
+                break;
+            case GPred::Kind::ExprComparison:
+                {
+                    auto &c = p.toExprComparison();
+                    varint(enumValue(c.op));
+                    expr(c.lhs);
+                    expr(c.rhs);
+                    break;
+                }
+            case GPred::Kind::Negation:
+                todo.push_back(&p.toNegationPred().content);
+                break;
+            case GPred::Kind::Conjunction:
+            case GPred::Kind::Disjunction:
+                {
+                    const std::vector<GPred> &content = (p.getKind() == GPred::Kind::Conjunction) ?
+                        p.toConjunction().content : p.toDisjunction().content;
+                    varint(content.size());
+                    for(auto it = content.rbegin(); it != content.rend(); ++it)
+                        todo.push_back(&*it);
+                    break;
+                }
+            case GPred::Kind::Forall:
+                vars(p.toForall().vars);
+                todo.push_back(&p.toForall().body);
+                break;
+            case GPred::Kind::Exists:
+                vars(p.toExists().vars);
+                todo.push_back(&p.toExists().body);
+                break;
+            case GPred::Kind::TaggedPred:
+                str(p.toTaggedPred().tag);
+                todo.push_back(&p.toTaggedPred().content);
+                break;
+            case GPred::Kind::Sub:
+                varint(p.toSub().overflow ? 1 : 0);
+                subst(p.toSub().sub);
+                todo.push_back(&p.toSub().pred);
+                break;
+            case GPred::Kind::NotSubNot:
+                subst(p.toNotSubNot().sub);
+                pred(p.toNotSubNot().pred);
+                break;
+            case GPred::Kind::LetFreshId:
+                str(p.toLetFreshId().id);
+                todo.push_back(&p.toLetFreshId().pred);
+                break;
+        }
+    }
+}
+
+void Fingerprinter::addExpression(const Expr &e){
+    varint(enumValue(Root::Expr));
+    expr(e);
+}
+
+void Fingerprinter::addPredicate(const Pred &p){
+    varint(enumValue(Root::Pred));
+    pred(p);
+}
+
+void Fingerprinter::addGPredicate(const GPred &p){
+    varint(enumValue(Root::GPred));
+    gpred(p);
+}
+
+void Fingerprinter::addSubstitution(const Subst &s){
+    varint(enumValue(Root::Subst));
+    subst(s);
+}
+
+void Fingerprinter::addType(const BType &ty){
+    varint(enumValue(Root::Type));
+    type(ty);
+}
+
+void Fingerprinter::addString(const std::string &s){
+    varint(enumValue(Root::String));
+    str(s);
+}
+
+Fingerprint Fingerprinter::get() const {
+    return stream.finish();
+}
+
+static const char hexDigits[] = "0123456789abcdef";
+
+std::string Fingerprint::toString() const {
+    std::string res(32,'0');
+    for(int i=0;i<16;i++){
+        res[15-i] = hexDigits[(high >> (4*i)) & 0xf];
+        res[31-i] = hexDigits[(low >> (4*i)) & 0xf];
+    }
+    return res;
+}
+
+bool Fingerprint::fromString(const std::string &s, Fingerprint &res){
+    if(s.size() != 32)
+        return false;
+    uint64_t parts[2] = {0,0};
+    for(size_t i=0;i<32;i++){
+        char c = s[i];
+        uint64_t d;
+        if(c >= '0' && c <= '9')
+            d = c - '0';
+        else if(c >= 'a' && c <= 'f')
+            d = c - 'a' + 10;
+        else if(c >= 'A' && c <= 'F')
+            d = c - 'A' + 10;
+        else
+            return false;
+        parts[i/16] = (parts[i/16] << 4) | d;
+    }
+    res.high = parts[0];
+    res.low = parts[1];
+    return true;
+}
+
+Fingerprint Fingerprint::of(const Expr &e){
+    Fingerprinter f;
+    f.addExpression(e);
+    return f.get();
+}
+
+Fingerprint Fingerprint::of(const Pred &p){
+    Fingerprinter f;
+    f.addPredicate(p);
+    return f.get();
+}
+
+Fingerprint Fingerprint::of(const GPred &p){
+    Fingerprinter f;
+    f.addGPredicate(p);
+    return f.get();
+}
+
+Fingerprint Fingerprint::of(const Subst &s){
+    Fingerprinter f;
+    f.addSubstitution(s);
+    return f.get();
+}
+
+Fingerprint Fingerprint::of(const BType &ty){
+    Fingerprinter f;
+    f.addType(ty);
+    return f.get();
+}
@@ -0,0 +1,136 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "expr.h"
+#include "pred.h"
+#include "gpred.h"
+#include "subst.h"
+
+/** \brief 128-bit fingerprint of the content of abstract syntax trees.
+ *
+ * Unlike hash_combine, which ignores the types and is only meant for hash
+ * tables, the fingerprint covers everything the binary format stores: node
+ * kinds, operators, types, bxml tags, goal tags, literals, identifiers, the
+ * witness flag of EXISTS and the definitions of the called operations.
+ * Identifiers and types are fingerprinted by their content, not by their
+ * interning ids, so the value does not depend on the order in which they
+ * were created, nor on the platform: it can key a persistent cache, for
+ * instance of the proof obligations already proved.
+ *
+ * Temporary identifiers (VarName::Kind::Tmp) are numbered in creation
+ * order; trees containing them have no stable fingerprint.
+ */
+struct Fingerprint {
+    uint64_t low;
+    uint64_t high;
+
+    inline bool operator==(const Fingerprint &other) const { return low == other.low && high == other.high; }
+    inline bool operator!=(const Fingerprint &other) const { return !(*this == other); }
+    inline bool operator<(const Fingerprint &other) const {
+        return high < other.high || (high == other.high && low < other.low);
+    }
+
+    // 32 hexadecimal digits, high part first
+    std::string toString() const;
+    // Inverse of toString. Returns false if s is not made of 32 hexadecimal digits.
+    static bool fromString(const std::string &s, Fingerprint &res);
+
+    static Fingerprint of(const Expr &e);
+    static Fingerprint of(const Pred &p);
+    static Fingerprint of(const GPred &p);
+    static Fingerprint of(const Subst &s);
+    static Fingerprint of(const BType &ty);
+};
+
+/** \brief Computes the fingerprint of a sequence of trees in one pass.
+ *
+ * The trees are fed in prefix order to MurmurHash3 (x64, 128 bits); the
+ * fingerprint of the sequence is available at any time. Each tree is
+ * preceded by its root kind, so that the fingerprint of a sequence is not
+ * the one of another sequence with the same nodes.
+ *
+ * Chains of operators (arithmetic, connectives, sequences of substitutions...)
+ * are walked with an explicit stack. The call stack still grows with the
+ * nesting of expressions in predicates and of predicates in expressions, and
+ * with the nesting of records, SELECT, CASE and WHILE.
+ */
+class Fingerprinter {
+    public:
+        Fingerprinter(){};
+
+        void addExpression(const Expr &e);
+        void addPredicate(const Pred &p);
+        void addGPredicate(const GPred &p);
+        void addSubstitution(const Subst &s);
+        void addType(const BType &ty);
+        // For the context of the trees, for instance the name of a goal
+        void addString(const std::string &s);
+
+        // Fingerprint of the trees added so far
+        Fingerprint get() const;
+
+    private:
+        class ExprVisitor;
+        class PredVisitor;
+        class SubstVisitor;
+
+        // Streaming MurmurHash3_x64_128, with seed 0
+        class Stream {
+            public:
+                Stream():h1{0},h2{0},buffered{0},length{0}{};
+                void bytes(const unsigned char *data, size_t len);
+                Fingerprint finish() const;
+            private:
+                uint64_t h1;
+                uint64_t h2;
+                unsigned char buffer[16];
+                size_t buffered;
+                uint64_t length;
+                void block(const unsigned char *p);
+        };
+
+        // Members
+        Stream stream;
+        // Fingerprints of the types met so far, by id
+        std::unordered_map<unsigned int,Fingerprint> types;
+        // Fingerprints of the called operations, kept alive so that the addresses are not reused
+        std::map<const Subst::Operation*,Fingerprint> operations;
+        std::vector<std::shared_ptr<const Subst::Operation>> operationTable;
+
+        // Methods
+        void varint(uint64_t v);
+        void str(const std::string &s);
+        void fingerprint(const Fingerprint &f);
+        void type(const BType &ty);
+        void name(const VarName &v);
+        void tags(const TagSet::List &bxmlTag);
+        void vars(const std::vector<TypedVar> &vec);
+        void operation(const std::shared_ptr<const Subst::Operation> &op);
+        void expr(const Expr &e);
+        void pred(const Pred &p);
+        void gpred(const GPred &p);
+        void subst(const Subst &s);
+};
+
+#endif // FINGERPRINT_H
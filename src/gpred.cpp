@@ -68,50 +68,62 @@ const GPred::LetFreshId& GPred::toLetFreshId() const{
 }
 GPred::ImplicationPred& GPred::toImplication() {
   assert(getKind() == Kind::Implication);
+  modified();
   return static_cast<ImplicationPred&>(*ptr);
 }
 GPred::EquivalencePred& GPred::toEquivalence() {
   assert(getKind() == Kind::Equivalence);
+  modified();
   return static_cast<EquivalencePred&>(*ptr);
 }
 GPred::ExprComparison& GPred::toExprComparison() {
   assert(getKind() == Kind::ExprComparison);
+  modified();
   return static_cast<ExprComparison&>(*ptr);
 }
 GPred::NegationPred& GPred::toNegationPred() {
   assert(getKind() == Kind::Negation);
+  modified();
   return static_cast<NegationPred&>(*ptr);
 }
 GPred::ForallPred& GPred::toForall() {
   assert(getKind() == Kind::Forall);
+  modified();
   return static_cast<ForallPred&>(*ptr);
 }
 GPred::ExistsPred& GPred::toExists() {
   assert(getKind() == Kind::Exists);
+  modified();
   return static_cast<ExistsPred&>(*ptr);
 }
 GPred::ConjunctionPred& GPred::toConjunction() {
   assert(getKind() == Kind::Conjunction);
+  modified();
   return static_cast<ConjunctionPred&>(*ptr);
 }
 GPred::DisjunctionPred& GPred::toDisjunction() {
   assert(getKind() == Kind::Disjunction);
+  modified();
   return static_cast<DisjunctionPred&>(*ptr);
 }
 GPred::TaggedPred& GPred::toTaggedPred() {
   assert(getKind() == Kind::TaggedPred);
+  modified();
   return static_cast<TaggedPred&>(*ptr);
 }
 GPred::Sub& GPred::toSub() {
   assert(getKind() == Kind::Sub);
+  modified();
   return static_cast<Sub&>(*ptr);
 }
 GPred::NotSubNot& GPred::toNotSubNot() {
   assert(getKind() == Kind::NotSubNot);
+  modified();
   return static_cast<NotSubNot&>(*ptr);
 }
 GPred::LetFreshId& GPred::toLetFreshId() {
   assert(getKind() == Kind::LetFreshId);
+  modified();
   return static_cast<LetFreshId&>(*ptr);
 }
 GPred GPred::makeImplication(GPred &&lhs, GPred &&rhs){ return GPred(new ImplicationPred(std::move(lhs),std::move(rhs))); };
@@ -128,11 +140,17 @@ GPred GPred::makeNotSubNot(Subst &&subst, Pred &&pred){ return GPred(new NotSubN
 GPred GPred::makeLetFreshId(const std::string &id, GPred &&pred){ return GPred(new LetFreshId(id,std::move(pred))); };
 
 size_t GPred::hash_combine(size_t seed) const {
-    return hashUtil::hash_combine_int(static_cast<int>(getKind()),ptr->hash_combine(seed));
+    size_t h = ptr->cachedHash.get([this](){
+            return hashUtil::hash_combine_int(static_cast<int>(getKind()),ptr->hash_combine(0)); });
+    return hashUtil::hash_combine_hash(h,seed);
 }
-void GPred::getAllVars(std::set<VarName> &accu) const {
+void GPred::modified(){
+    ptr->cachedHash.reset();
+}
+void GPred::getAllVars(VarSet &accu) const {
     ptr->getAllVars(accu);
 }
 void GPred::substFreshId(const std::string &id, const VarName &v){
+    modified();
     ptr->substFreshId(id,v);
 }
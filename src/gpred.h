@@ -63,6 +63,7 @@ public:
     NotSubNot& toNotSubNot();
     LetFreshId& toLetFreshId();
 
+    // The hash of each node is cached, so this is O(1) once computed
     size_t hash_combine(size_t seed) const;
     class Visitor {
         public:
@@ -94,7 +95,12 @@ public:
     static GPred makeLetFreshId(const std::string &id, GPred &&pred);
 
     // Get all identifiers (free or bound) occuring in the expression
-    void getAllVars(std::set<VarName> &accu) const;
+    void getAllVars(VarSet &accu) const;
+    void getAllVars(std::set<VarName> &accu) const {
+        VarSet vars;
+        getAllVars(vars);
+        accu.insert(vars.begin(),vars.end());
+    }
     std::set<VarName> getAllVars() const {
         std::set<VarName> accu;
         getAllVars(accu);
@@ -104,16 +110,21 @@ public:
     void substFreshId(const std::string &id, const VarName &v);
 
 private:
-    class AbstractGPred {
+    class AbstractGPred : public Arena::Allocated {
         public:
+            virtual ~AbstractGPred(){};
             virtual Kind getKind() const = 0;
             virtual void accept(Visitor &v) const = 0;
             virtual size_t hash_combine(size_t seed) const = 0;
-            virtual void getAllVars(std::set<VarName> &accu) const = 0;
+            virtual void getAllVars(VarSet &accu) const = 0;
             virtual void substFreshId(const std::string &id, const VarName &v) = 0;
+            // Hash of the predicate, reset when it is modified (see modified)
+            hashUtil::CachedHash cachedHash;
     };
     std::unique_ptr<AbstractGPred> ptr;
     GPred(AbstractGPred *ptr):ptr{ptr}{};
+    // Drops the cached hash. Called by substFreshId and the non-const accessors.
+    void modified();
 };
 
 class GPred::ImplicationPred : public AbstractGPred {
@@ -126,9 +137,9 @@ class GPred::ImplicationPred : public AbstractGPred {
         }
         GPred lhs;
         GPred rhs;
-        void getAllVars(std::set<VarName> &accu) const {
-            lhs.getAllVars();
-            rhs.getAllVars();
+        void getAllVars(VarSet &accu) const {
+            lhs.getAllVars(accu);
+            rhs.getAllVars(accu);
         }
         void substFreshId(const std::string &id, const VarName &v){
             lhs.substFreshId(id,v);
@@ -145,9 +156,9 @@ class GPred::EquivalencePred : public AbstractGPred {
         }
         GPred lhs;
         GPred rhs;
-        void getAllVars(std::set<VarName> &accu) const {
-            lhs.getAllVars();
-            rhs.getAllVars();
+        void getAllVars(VarSet &accu) const {
+            lhs.getAllVars(accu);
+            rhs.getAllVars(accu);
         }
         void substFreshId(const std::string &id, const VarName &v){
             lhs.substFreshId(id,v);
@@ -167,9 +178,9 @@ class GPred::ExprComparison : public AbstractGPred {
         const Pred::ComparisonOp op;
         Expr lhs;
         Expr rhs;
-        void getAllVars(std::set<VarName> &accu) const {
-            lhs.getAllVars();
-            rhs.getAllVars();
+        void getAllVars(VarSet &accu) const {
+            lhs.getAllVars(accu);
+            rhs.getAllVars(accu);
         }
         void substFreshId(const std::string &id, const VarName &v){
             lhs.substFreshId(id,v);
@@ -185,8 +196,8 @@ class GPred::NegationPred : public AbstractGPred {
             return content.hash_combine(seed);
         }
         GPred content;
-        void getAllVars(std::set<VarName> &accu) const {
-            content.getAllVars();
+        void getAllVars(VarSet &accu) const {
+            content.getAllVars(accu);
         }
         void substFreshId(const std::string &id, const VarName &v){
             content.substFreshId(id,v);
@@ -203,7 +214,7 @@ class GPred::ConjunctionPred : public AbstractGPred {
             return seed;
         }
         std::vector<GPred> content;
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &p : content)
                 p.getAllVars(accu);
         }
@@ -223,7 +234,7 @@ class GPred::DisjunctionPred : public AbstractGPred {
             return seed;
         }
         std::vector<GPred> content;
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &p : content)
                 p.getAllVars(accu);
         }
@@ -244,7 +255,7 @@ class GPred::ForallPred : public AbstractGPred {
         }
         std::vector<TypedVar> vars;
         GPred body;
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &v : vars)
                 accu.insert(v.name);
             body.getAllVars(accu);
@@ -269,7 +280,7 @@ class GPred::ExistsPred : public AbstractGPred {
         }
         std::vector<TypedVar> vars;
         GPred body;
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &v : vars)
                 accu.insert(v.name);
             body.getAllVars(accu);
@@ -293,7 +304,7 @@ class GPred::TaggedPred : public AbstractGPred {
         }
         const std::string tag;
         GPred content;
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             content.getAllVars(accu);
         }
         void substFreshId(const std::string &id, const VarName &v){
@@ -312,7 +323,7 @@ class GPred::Sub : public AbstractGPred {
         Subst sub;
         GPred pred;
         const bool overflow;
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             sub.getAllVars(accu);
             pred.getAllVars(accu);
         }
@@ -332,7 +343,7 @@ class GPred::NotSubNot : public AbstractGPred {
         }
         Subst sub;
         Pred pred;
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             sub.getAllVars(accu);
             pred.getAllVars(accu);
         }
@@ -351,7 +362,7 @@ class GPred::LetFreshId : public AbstractGPred {
         }
         GPred pred;
         const std::string id;
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             pred.getAllVars(accu);
         }
         void substFreshId(const std::string &id2, const VarName &v){
@@ -18,11 +18,11 @@
 #include "substReader.h"
 #include "gpredReader.h"
 #include "gpred.h"
-#include <map>
+#include "xmlTags.h"
 
 namespace Xml {
 
-    const std::map<std::string, GPred::Kind> ptags = {
+    constexpr auto ptags = makeStrTable<GPred::Kind>({
         {"Binary_Pred", GPred::Kind::Implication},
         {"Exp_Comparison", GPred::Kind::ExprComparison},
         {"Quantified_Pred", GPred::Kind::Forall},
@@ -32,7 +32,7 @@ namespace Xml {
         {"Sub_Calculus", GPred::Kind::Sub},
         {"Not", GPred::Kind::NotSubNot},
         {"Let_Fresh_Id", GPred::Kind::LetFreshId},
-    };
+    });
 
     GPred readGPredicate(const QDomElement &dom, const std::vector<BType> &typeInfos){
         if (dom.isNull())
@@ -40,19 +40,19 @@ namespace Xml {
 
         QString tagName = dom.tagName();
 
-        auto it = ptags.find(tagName.toStdString());
-        if(it == ptags.end())
+        auto it = find(ptags,tagName);
+        if(it == nullptr)
             throw GPredReaderException("Unexpected tag '" + tagName.toStdString() + "'.");
 
-        switch(it->second){
+        switch(it->value){
             case GPred::Kind::NotSubNot:
                 {
                     QDomElement child = dom.firstChildElement();
-                    if(child.isNull() or child.tagName() != "Sub_Calculus")
+                    if(child.isNull() or child.tagName() != QLatin1String("Sub_Calculus"))
                         throw GPredReaderException("Sub_Calculus element expected.");
                     QDomElement sub = child.firstChildElement();
                     QDomElement _not = sub.nextSiblingElement();
-                    if(_not.isNull() or _not.tagName() != "Not")
+                    if(_not.isNull() or _not.tagName() != QLatin1String("Not"))
                         throw GPredReaderException("Not element expected.");
                     QDomElement prd = _not.firstChildElement();
                     return GPred::makeNotSubNot
@@ -73,9 +73,9 @@ namespace Xml {
                     QString op = dom.attribute("op");
                     QDomElement fst = dom.firstChildElement();
                     QDomElement snd = fst.nextSiblingElement();
-                    if(op == "=>"){
+                    if(op == QLatin1String("=>")){
                         return GPred::makeImplication(readGPredicate(fst,typeInfos),readGPredicate(snd,typeInfos));
-                    } else if (op == "<=>"){
+                    } else if (op == QLatin1String("<=>")){
                         return GPred::makeEquivalence(readGPredicate(fst,typeInfos),readGPredicate(snd,typeInfos));
                     } else {
                         throw GPredReaderException
@@ -85,28 +85,28 @@ namespace Xml {
             case GPred::Kind::ExprComparison:
                 {
                     QString op = dom.attribute("op");
-                    auto it = comparisonOp.find(op.toStdString());
+                    auto it = find(comparisonOp,op);
                     QDomElement fst = dom.firstChildElement();
                     QDomElement snd = fst.nextSiblingElement();
-                    if(it != comparisonOp.end())
+                    if(it != nullptr)
                         return GPred::makeExprComparison
-                            (it->second,readExpression(fst,typeInfos),readExpression(snd,typeInfos));
-                    if (op == "/:")
+                            (it->value,readExpression(fst,typeInfos),readExpression(snd,typeInfos));
+                    if (op == QLatin1String("/:"))
                         return GPred::makeNegationPred (GPred::makeExprComparison
                                 (Pred::ComparisonOp::Membership,
                                  readExpression(fst,typeInfos),
                                  readExpression(snd,typeInfos)));
-                    if (op == "/<:")
+                    if (op == QLatin1String("/<:"))
                         return GPred::makeNegationPred (GPred::makeExprComparison
                                 (Pred::ComparisonOp::Subset,
                                  readExpression(fst,typeInfos),
                                  readExpression(snd,typeInfos)));
-                    if (op == "/<<:")
+                    if (op == QLatin1String("/<<:"))
                         return GPred::makeNegationPred (GPred::makeExprComparison
                                 (Pred::ComparisonOp::Strict_Subset,
                                  readExpression(fst,typeInfos),
                                  readExpression(snd,typeInfos)));
-                    if (op == "/=")
+                    if (op == QLatin1String("/="))
                         return GPred::makeNegationPred (GPred::makeExprComparison
                                 (Pred::ComparisonOp::Equality,
                                  readExpression(fst,typeInfos),
@@ -130,10 +130,10 @@ namespace Xml {
                     {
                         vec.push_back(VarNameFromId(ce,typeInfos));
                     }
-                    if(op == "!"){
+                    if(op == QLatin1String("!")){
                         return GPred::makeForall(vec,
                                 readGPredicate(dom.firstChildElement("Body").firstChildElement(),typeInfos));
-                    } else if (op == "#"){
+                    } else if (op == QLatin1String("#")){
                         return GPred::makeExists(vec,
                                 readGPredicate(dom.firstChildElement("Body").firstChildElement(),typeInfos));
                     } else {
@@ -144,7 +144,7 @@ namespace Xml {
             case GPred::Kind::Negation:
                 {
                     QString op = dom.attribute("op");
-                    if(op != "not")
+                    if(op != QLatin1String("not"))
                         throw GPredReaderException
                             ("Unknown unary predicate operator '" + op.toStdString() + "'.");
 
@@ -161,9 +161,9 @@ namespace Xml {
                         vec.push_back(readGPredicate(ce,typeInfos));
                         ce = ce.nextSiblingElement();
                     }
-                    if(op == "&"){
+                    if(op == QLatin1String("&")){
                         return GPred::makeConjunction(std::move(vec));
-                    } else if(op == "or"){
+                    } else if(op == QLatin1String("or")){
                         return GPred::makeDisjunction(std::move(vec));
                     } else {
                         throw GPredReaderException
@@ -183,4 +183,191 @@ namespace Xml {
         };
         assert(false); // unreachable
     };
+
+    GPred readGPredicate(const QDomElement &dom, const std::vector<BType> &typeInfos, Arena &arena){
+        Arena::Scope scope(arena);
+        return readGPredicate(dom,typeInfos);
+    }
+
+    // Moves to the next child element of the current element.
+    // Returns false when the end element of the current element is reached.
+    static bool nextChild(QXmlStreamReader &stream){
+        if(stream.readNextStartElement())
+            return true;
+        if(stream.hasError())
+            throw GPredReaderException(stream.errorString().toStdString());
+        return false;
+    }
+
+    static void expectChild(QXmlStreamReader &stream, const char *tagName){
+        if(!nextChild(stream))
+            throw GPredReaderException("Missing child element in '" + std::string(tagName) + "'.");
+    }
+
+    GPred readGPredicate(QXmlStreamReader &stream, const std::vector<BType> &typeInfos){
+        if (!stream.isStartElement())
+            throw GPredReaderException("Start element expected.");
+
+        auto it = find(ptags,stream.name());
+        if(it == nullptr)
+            throw GPredReaderException("Unexpected tag '" + stream.name().toString().toStdString() + "'.");
+        const char *tagName = it->key;
+        const QXmlStreamAttributes attrs = stream.attributes();
+
+        switch(it->value){
+            case GPred::Kind::NotSubNot:
+                {
+                    if(!nextChild(stream) or stream.name() != QLatin1String("Sub_Calculus"))
+                        throw GPredReaderException("Sub_Calculus element expected.");
+                    expectChild(stream,"Sub_Calculus");
+                    Subst sub = readSubstitution(stream,typeInfos);
+                    if(!nextChild(stream) or stream.name() != QLatin1String("Not"))
+                        throw GPredReaderException("Not element expected.");
+                    expectChild(stream,"Not");
+                    Pred prd = readPredicate(stream,typeInfos);
+                    stream.skipCurrentElement(); // Not
+                    stream.skipCurrentElement(); // Sub_Calculus
+                    stream.skipCurrentElement();
+                    return GPred::makeNotSubNot(std::move(sub),std::move(prd));
+                }
+            case GPred::Kind::Sub:
+                {
+                    bool overflow = (attrs.value("overflow") == "true");
+                    expectChild(stream,tagName);
+                    Subst sub = readSubstitution(stream,typeInfos);
+                    expectChild(stream,tagName);
+                    GPred p = readGPredicate(stream,typeInfos);
+                    stream.skipCurrentElement();
+                    return GPred::makeSub(std::move(sub),std::move(p),overflow);
+                }
+            case GPred::Kind::Implication:
+            case GPred::Kind::Equivalence:
+                {
+                    const QStringRef op = attrs.value("op");
+                    if(op != QLatin1String("=>") && op != QLatin1String("<=>"))
+                        throw GPredReaderException
+                            ("Unknown binary predicate operator '" + op.toString().toStdString() + "'.");
+                    expectChild(stream,tagName);
+                    GPred lhs = readGPredicate(stream,typeInfos);
+                    expectChild(stream,tagName);
+                    GPred rhs = readGPredicate(stream,typeInfos);
+                    stream.skipCurrentElement();
+                    if(op == QLatin1String("=>"))
+                        return GPred::makeImplication(std::move(lhs),std::move(rhs));
+                    else
+                        return GPred::makeEquivalence(std::move(lhs),std::move(rhs));
+                }
+            case GPred::Kind::ExprComparison:
+                {
+                    const QStringRef op = attrs.value("op");
+                    Pred::ComparisonOp cop;
+                    bool negated = false;
+                    auto it = find(comparisonOp,op);
+                    if(it != nullptr)
+                        cop = it->value;
+                    else if (op == QLatin1String("/:"))
+                        { cop = Pred::ComparisonOp::Membership; negated = true; }
+                    else if (op == QLatin1String("/<:"))
+                        { cop = Pred::ComparisonOp::Subset; negated = true; }
+                    else if (op == QLatin1String("/<<:"))
+                        { cop = Pred::ComparisonOp::Strict_Subset; negated = true; }
+                    else if (op == QLatin1String("/="))
+                        { cop = Pred::ComparisonOp::Equality; negated = true; }
+                    else
+                        throw GPredReaderException
+                            ("Unknown comparison operator '" + op.toString().toStdString() + "'.");
+                    expectChild(stream,tagName);
+                    Expr lhs = readExpression(stream,typeInfos);
+                    expectChild(stream,tagName);
+                    Expr rhs = readExpression(stream,typeInfos);
+                    stream.skipCurrentElement();
+                    GPred res = GPred::makeExprComparison(cop,std::move(lhs),std::move(rhs));
+                    if(negated)
+                        return GPred::makeNegationPred(std::move(res));
+                    return res;
+                }
+            case GPred::Kind::Forall:
+            case GPred::Kind::Exists:
+                {
+                    const QStringRef op = attrs.value("type");
+                    if(op != QLatin1String("!") && op != QLatin1String("#"))
+                        throw GPredReaderException
+                            ("Unknown type of quantified predicate '" + op.toString().toStdString() + "'.");
+                    std::vector<TypedVar> vec;
+                    std::vector<GPred> body; // GPred has no default constructor
+                    bool hasVars = false;
+                    while(nextChild(stream)){
+                        if(stream.name() == QLatin1String("Variables")){
+                            while(nextChild(stream))
+                                vec.push_back(VarNameFromId(stream,typeInfos));
+                            hasVars = true;
+                        } else if(stream.name() == QLatin1String("Body") && body.empty()){
+                            expectChild(stream,"Body");
+                            body.push_back(readGPredicate(stream,typeInfos));
+                            stream.skipCurrentElement();
+                        } else {
+                            stream.skipCurrentElement();
+                        }
+                    }
+                    if(!hasVars)
+                        throw GPredReaderException
+                            ("The 'Quantified_Pred' element is missing some 'Variables' child.");
+                    if(body.empty())
+                        throw GPredReaderException
+                            ("The 'Quantified_Pred' element is missing some 'Body' child.");
+                    if(op == QLatin1String("!"))
+                        return GPred::makeForall(vec,std::move(body.front()));
+                    else
+                        return GPred::makeExists(vec,std::move(body.front()));
+                }
+            case GPred::Kind::Negation:
+                {
+                    const QStringRef op = attrs.value("op");
+                    if(op != QLatin1String("not"))
+                        throw GPredReaderException
+                            ("Unknown unary predicate operator '" + op.toString().toStdString() + "'.");
+                    expectChild(stream,tagName);
+                    GPred p = readGPredicate(stream,typeInfos);
+                    stream.skipCurrentElement();
+                    return GPred::makeNegationPred(std::move(p));
+                }
+            case GPred::Kind::Conjunction:
+            case GPred::Kind::Disjunction:
+                {
+                    const QStringRef op = attrs.value("op");
+                    if(op != QLatin1String("&") && op != QLatin1String("or"))
+                        throw GPredReaderException
+                            ("Unknown n-ary predicate operator '" + op.toString().toStdString() + "'.");
+                    std::vector<GPred> vec;
+                    while(nextChild(stream))
+                        vec.push_back(readGPredicate(stream,typeInfos));
+                    if(op == QLatin1String("&"))
+                        return GPred::makeConjunction(std::move(vec));
+                    else
+                        return GPred::makeDisjunction(std::move(vec));
+                }
+            case GPred::Kind::TaggedPred:
+                {
+                    std::string goalTag = attrs.value("goalTag").toString().toStdString();
+                    expectChild(stream,tagName);
+                    GPred p = readGPredicate(stream,typeInfos);
+                    stream.skipCurrentElement();
+                    return GPred::makeTaggedPred(goalTag,std::move(p));
+                }
+            case GPred::Kind::LetFreshId:
+                {
+                    std::string name = attrs.value("name").toString().toStdString();
+                    expectChild(stream,tagName);
+                    GPred p = readGPredicate(stream,typeInfos);
+                    stream.skipCurrentElement();
+                    return GPred::makeLetFreshId(name,std::move(p));
+                }
+        };
+        assert(false); // unreachable
+    };
+
+    GPred readGPredicate(QXmlStreamReader &stream, const std::vector<BType> &typeInfos, Arena &arena){
+        Arena::Scope scope(arena);
+        return readGPredicate(stream,typeInfos);
+    }
 }
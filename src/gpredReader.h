@@ -18,6 +18,7 @@
 
 #include "gpred.h"
 #include<QDomElement>
+#include<QXmlStreamReader>
 
 namespace Xml {
     class GPredReaderException : public std::exception
@@ -31,6 +32,13 @@ namespace Xml {
     };
 
     GPred readGPredicate(const QDomElement &dom, const std::vector<BType> &typeInfos);
+    // Same as above, with every node allocated in arena. The arena must outlive the returned predicate.
+    GPred readGPredicate(const QDomElement &dom, const std::vector<BType> &typeInfos, Arena &arena);
+
+    // Streaming variants: no DOM is built. The stream must be positioned on the
+    // start element of the predicate; on return it is on the matching end element.
+    GPred readGPredicate(QXmlStreamReader &stream, const std::vector<BType> &typeInfos);
+    GPred readGPredicate(QXmlStreamReader &stream, const std::vector<BType> &typeInfos, Arena &arena);
 }
 
 #endif // GPREDREADER_H
@@ -0,0 +1,129 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "exprWriter.h"
+#include "predWriter.h"
+#include "substWriter.h"
+#include "gpredWriter.h"
+#include "xmlTags.h"
+
+namespace Xml {
+
+    class GPredWriterVisitor : public GPred::Visitor {
+        public:
+            void visitImplication(const GPred::ImplicationPred &e){
+                stream.writeStartElement("Binary_Pred");
+                stream.writeAttribute("op","=>");
+                e.lhs.accept(*this);
+                e.rhs.accept(*this);
+                stream.writeEndElement(); // Binary_Pred
+            };
+            void visitEquivalence(const GPred::EquivalencePred &e){
+                stream.writeStartElement("Binary_Pred");
+                stream.writeAttribute("op","<=>");
+                e.lhs.accept(*this);
+                e.rhs.accept(*this);
+                stream.writeEndElement(); // Binary_Pred
+            };
+            void visitExprComparison(const GPred::ExprComparison &e){
+                stream.writeStartElement("Exp_Comparison");
+                stream.writeAttribute("op",toQString(e.op,Pred::ComparisonOp::Rgt,Pred::to_chars));
+                writeExpression(stream,typeInfos,e.lhs);
+                writeExpression(stream,typeInfos,e.rhs);
+                stream.writeEndElement(); // Exp_Comparison
+            };
+            void visitNegationPred(const GPred::NegationPred &e){
+                stream.writeStartElement("Unary_Pred");
+                stream.writeAttribute("op","not");
+                e.content.accept(*this);
+                stream.writeEndElement(); // Unary_Pred
+            };
+            void visitConjunction(const GPred::ConjunctionPred &e){
+                stream.writeStartElement("Nary_Pred");
+                stream.writeAttribute("op","&");
+                for(auto &p : e.content)
+                    p.accept(*this);
+                stream.writeEndElement(); // Nary_Pred
+            };
+            void visitDisjunction(const GPred::DisjunctionPred &e){
+                stream.writeStartElement("Nary_Pred");
+                stream.writeAttribute("op","or");
+                for(auto &p : e.content)
+                    p.accept(*this);
+                stream.writeEndElement(); // Nary_Pred
+            };
+            void visitForall(const GPred::ForallPred &e){
+                writeQuantified("!",e.vars,e.body);
+            };
+            void visitExists(const GPred::ExistsPred &e){
+                writeQuantified("#",e.vars,e.body);
+            };
+            void visitTaggedPred(const GPred::TaggedPred &e){
+                stream.writeStartElement("Tag");
+                stream.writeAttribute("goalTag",QString::fromStdString(e.tag));
+                e.content.accept(*this);
+                stream.writeEndElement(); // Tag
+            };
+            void visitSub(const GPred::Sub &e){
+                stream.writeStartElement("Sub_Calculus");
+                if(e.overflow)
+                    stream.writeAttribute("overflow","true");
+                writeSubstitution(stream,typeInfos,e.sub);
+                e.pred.accept(*this);
+                stream.writeEndElement(); // Sub_Calculus
+            };
+            void visitNotSubNot(const GPred::NotSubNot &e){
+                stream.writeStartElement("Not");
+                stream.writeStartElement("Sub_Calculus");
+                writeSubstitution(stream,typeInfos,e.sub);
+                stream.writeStartElement("Not");
+                writePredicate(stream,typeInfos,e.pred);
+                stream.writeEndElement(); // Not
+                stream.writeEndElement(); // Sub_Calculus
+                stream.writeEndElement(); // Not
+            };
+            void visitLetFreshId(const GPred::LetFreshId &e){
+                stream.writeStartElement("Let_Fresh_Id");
+                stream.writeAttribute("name",QString::fromStdString(e.id));
+                e.pred.accept(*this);
+                stream.writeEndElement(); // Let_Fresh_Id
+            };
+            GPredWriterVisitor(QXmlStreamWriter &s,std::map<BType,unsigned int> &typeInfos):
+                stream{s},
+                typeInfos{typeInfos}
+            {};
+        private:
+            QXmlStreamWriter &stream;
+            std::map<BType,unsigned int> &typeInfos;
+
+            void writeQuantified(const char *type, const std::vector<TypedVar> &vars, const GPred &body){
+                stream.writeStartElement("Quantified_Pred");
+                stream.writeAttribute("type",type);
+                stream.writeStartElement("Variables");
+                for(auto &v : vars)
+                    writeTypedVar(stream,typeInfos,v);
+                stream.writeEndElement(); // Variables
+                stream.writeStartElement("Body");
+                body.accept(*this);
+                stream.writeEndElement(); // Body
+                stream.writeEndElement(); // Quantified_Pred
+            }
+    };
+
+    void writeGPredicate(QXmlStreamWriter &stream, std::map<BType,unsigned int> &typeInfos, const GPred &p){
+        GPredWriterVisitor v(stream, typeInfos);
+        p.accept(v);
+    }
+}
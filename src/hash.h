@@ -17,19 +17,101 @@
 #define HASHUTIL_H
 
 #include<string>
+#include<atomic>
+#include<cstdint>
+#include<cstring>
 
 namespace hashUtil {
-    // These functions are specialisations of boost::hash_combine
+    /* MurmurHash64A, by Austin Appleby (public domain). Unlike std::hash, the
+     * result does not depend on the standard library. */
+    inline uint64_t hash_bytes(const char *data, size_t len, uint64_t seed = 0xc70f6907){
+        const uint64_t m = 0xc6a4a7935bd1e995ULL;
+        const int r = 47;
+        uint64_t h = seed ^ (len * m);
+        const unsigned char *p = reinterpret_cast<const unsigned char*>(data);
+        const unsigned char *end = p + (len & ~size_t(7));
+        for(; p != end; p += 8){
+            uint64_t k;
+            std::memcpy(&k,p,8);
+            k *= m;
+            k ^= k >> r;
+            k *= m;
+            h ^= k;
+            h *= m;
+        }
+        switch(len & 7){
+            case 7: h ^= uint64_t(p[6]) << 48; // fall through
+            case 6: h ^= uint64_t(p[5]) << 40; // fall through
+            case 5: h ^= uint64_t(p[4]) << 32; // fall through
+            case 4: h ^= uint64_t(p[3]) << 24; // fall through
+            case 3: h ^= uint64_t(p[2]) << 16; // fall through
+            case 2: h ^= uint64_t(p[1]) << 8; // fall through
+            case 1: h ^= uint64_t(p[0]);
+                    h *= m;
+        };
+        h ^= h >> r;
+        h *= m;
+        h ^= h >> r;
+        return h;
+    }
+
+    // Finalizer of MurmurHash3: each bit of x affects each bit of the result
+    inline uint64_t mix64(uint64_t x){
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    /* Combines h into seed. The product spreads h over the 64 bits before the
+     * finalizer, so that small values (operators, suffixes, kinds) combined
+     * in sequence do not cancel each other as with the 32-bit constant of
+     * boost::hash_combine. The added constant keeps 0 from being a fixed
+     * point (mix64(0) == 0): a run of children hashing to 0 still changes
+     * the seed at each step. */
+    inline size_t hash_combine_hash(size_t h, size_t seed){
+        return static_cast<size_t>(mix64(static_cast<uint64_t>(seed) + 0x9e3779b97f4a7c15ULL
+                    + static_cast<uint64_t>(h) * 0xc6a4a7935bd1e995ULL));
+    }
+
     inline size_t hash_combine_int(int i, size_t seed){
-        seed ^= i + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-        return seed;
+        return hash_combine_hash(static_cast<uint32_t>(i),seed);
     }
 
     inline size_t hash_combine_string(const std::string &s, size_t seed){
-        std::hash<std::string> h;
-        seed ^= h(s) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-        return seed;
+        return hash_combine_hash(static_cast<size_t>(hash_bytes(s.data(),s.size())),seed);
     }
+
+    /* Hash of a node, computed on first use and kept until reset().
+     *
+     * 0 stands for "not computed", so computed hashes are never 0. Copies
+     * start empty: a node is copied only to be modified. Several threads may
+     * compute the hash of a shared node at the same time; they store the
+     * same value. */
+    class CachedHash {
+        public:
+            CachedHash():value{0}{};
+            CachedHash(const CachedHash &):value{0}{};
+            CachedHash& operator=(const CachedHash &){ reset(); return *this; };
+
+            template<typename F> size_t get(F compute) const {
+                size_t h = value.load(std::memory_order_relaxed);
+                if(h == 0){
+                    h = compute();
+                    if(h == 0)
+                        h = 1;
+                    value.store(h,std::memory_order_relaxed);
+                }
+                return h;
+            }
+            void reset(){ value.store(0,std::memory_order_relaxed); };
+            bool known() const { return value.load(std::memory_order_relaxed) != 0; };
+
+        private:
+            mutable std::atomic<size_t> value;
+    };
 }
 
 #endif // HASHUTIL_H
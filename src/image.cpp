@@ -0,0 +1,929 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "image.h"
+#include "predDesc.h"
+#include <fstream>
+#include <sstream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Bin {
+    static const char imageMagic[4] = {'B','I','M','G'};
+    static const uint32_t imageVersion = 2;
+    // magic, version and the offsets of the five tables
+    static const uint32_t headerSize = 7 * 4;
+
+    template <typename E>
+    static E toEnum(uint32_t v, E last){
+        if(v > static_cast<uint32_t>(last))
+            throw ReaderException("Invalid node kind " + std::to_string(v) + ".");
+        return static_cast<E>(v);
+    }
+
+    /*
+     * Image
+     */
+
+    Image::Image(const std::string &path):
+        mapping{nullptr},
+        base{nullptr},
+        length{0}
+    {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(),O_RDONLY);
+        if(fd < 0)
+            throw ReaderException("Cannot open file '" + path + "'.");
+        struct stat st;
+        if(fstat(fd,&st) != 0){
+            ::close(fd);
+            throw ReaderException("Cannot open file '" + path + "'.");
+        }
+        length = st.st_size;
+        if(length > 0){
+            void *p = mmap(nullptr,length,PROT_READ,MAP_PRIVATE,fd,0);
+            if(p == MAP_FAILED){
+                ::close(fd);
+                throw ReaderException("Cannot map file '" + path + "'.");
+            }
+            mapping = p;
+            base = static_cast<const unsigned char*>(p);
+        }
+        ::close(fd); // the mapping stays valid
+#else
+        std::ifstream in(path,std::ios::binary);
+        if(!in)
+            throw ReaderException("Cannot open file '" + path + "'.");
+        std::ostringstream contents;
+        contents << in.rdbuf();
+        buffer = contents.str();
+        base = reinterpret_cast<const unsigned char*>(buffer.data());
+        length = buffer.size();
+#endif
+        try {
+            open();
+        } catch(...) {
+            unmap(); // the destructor is not run
+            throw;
+        }
+    }
+
+    Image::Image(const char *data, size_t size):
+        mapping{nullptr},
+        base{reinterpret_cast<const unsigned char*>(data)},
+        length{size}
+    {
+        open();
+    }
+
+    Image::~Image(){
+        unmap();
+    }
+
+    void Image::unmap(){
+#ifndef _WIN32
+        if(mapping != nullptr){
+            munmap(mapping,length);
+            mapping = nullptr;
+        }
+#endif
+    }
+
+    void Image::open(){
+        if(length < headerSize || memcmp(base,imageMagic,sizeof(imageMagic)) != 0)
+            throw ReaderException("Not a BAST image.");
+        if(word(4) != imageVersion)
+            throw ReaderException("Unsupported version " + std::to_string(word(4)) + ".");
+        strings = word(8);
+        uint32_t typeTable = word(12);
+        uint32_t nameTable = word(16);
+        tagLists = word(20);
+        roots = word(24);
+        rootCount = word(roots);
+
+        uint32_t n = word(typeTable);
+        uint32_t pos = typeTable + 4;
+        types.reserve(n);
+        for(uint32_t i=0;i<n;i++){
+            switch(toEnum(word(pos),BType::Kind::Struct)){
+                case BType::Kind::INTEGER:
+                    types.push_back(BType::INT);
+                    pos += 4;
+                    break;
+                case BType::Kind::BOOLEAN:
+                    types.push_back(BType::BOOL);
+                    pos += 4;
+                    break;
+                case BType::Kind::FLOAT:
+                    types.push_back(BType::FLOAT);
+                    pos += 4;
+                    break;
+                case BType::Kind::REAL:
+                    types.push_back(BType::REAL);
+                    pos += 4;
+                    break;
+                case BType::Kind::STRING:
+                    types.push_back(BType::STRING);
+                    pos += 4;
+                    break;
+                case BType::Kind::ProductType:
+                    types.push_back(BType::PROD(type(word(pos+4)),type(word(pos+8))));
+                    pos += 12;
+                    break;
+                case BType::Kind::PowerType:
+                    types.push_back(BType::POW(type(word(pos+4))));
+                    pos += 8;
+                    break;
+                case BType::Kind::Struct:
+                    {
+                        uint32_t m = word(pos+4);
+                        pos += 8;
+                        std::vector<std::pair<std::string,BType>> fields;
+                        for(uint32_t j=0;j<m;j++){
+                            fields.push_back({str(word(pos)),type(word(pos+4))});
+                            pos += 8;
+                        }
+                        types.push_back(BType::STRUCT(fields));
+                        break;
+                    }
+            }
+        }
+
+        n = word(nameTable);
+        pos = nameTable + 4;
+        names.reserve(n);
+        for(uint32_t i=0;i<n;i++){
+            VarName::Kind kind = toEnum(word(pos),VarName::Kind::Tmp);
+            std::string prefix = str(word(pos+4));
+            int suffix = static_cast<int>(word(pos+8));
+            pos += 12;
+            switch(kind){
+                case VarName::Kind::NoSuffix:
+                    names.push_back(VarName::makeVarWithoutSuffix(prefix));
+                    break;
+                case VarName::Kind::WithSuffix:
+                    if(suffix <= 0)
+                        throw ReaderException("Invalid suffix " + std::to_string(suffix) + ".");
+                    names.push_back(VarName::makeVar(prefix,suffix));
+                    break;
+                case VarName::Kind::FreshId:
+                    names.push_back(VarName::makeFreshId(prefix));
+                    break;
+                case VarName::Kind::Tmp:
+                    // temporary identifiers only need to be distinct from each other
+                    names.push_back(VarName::makeTmp(prefix));
+                    break;
+            }
+        }
+
+        n = word(tagLists);
+        bxmlTags.reserve(n);
+        for(uint32_t i=0;i<n;i++){
+            uint32_t offset = word(tagLists + 4 + 4*i);
+            uint32_t m = word(offset);
+            TagSet::List list;
+            for(uint32_t j=0;j<m;j++)
+                list.push_back(str(word(offset + 4 + 4*j)));
+            bxmlTags.push_back(std::move(list));
+        }
+    }
+
+    std::string Image::str(uint32_t i) const {
+        if(i >= word(strings))
+            throw ReaderException("Invalid string reference " + std::to_string(i) + ".");
+        uint32_t offset = word(strings + 4 + 4*i);
+        uint32_t len = word(offset);
+        if(len > length - offset - 4)
+            throw ReaderException("Invalid string length " + std::to_string(len) + ".");
+        return std::string(reinterpret_cast<const char*>(base + offset + 4),len);
+    }
+
+    const BType& Image::type(uint32_t i) const {
+        if(i >= types.size())
+            throw ReaderException("Invalid type reference " + std::to_string(i) + ".");
+        return types[i];
+    }
+
+    const VarName& Image::name(uint32_t i) const {
+        if(i >= names.size())
+            throw ReaderException("Invalid identifier reference " + std::to_string(i) + ".");
+        return names[i];
+    }
+
+    const TagSet::List& Image::tags(uint32_t i) const {
+        if(i >= bxmlTags.size())
+            throw ReaderException("Invalid tag reference " + std::to_string(i) + ".");
+        return bxmlTags[i];
+    }
+
+    std::vector<TypedVar> Image::vars(uint32_t offset) const {
+        uint32_t n = word(offset);
+        std::vector<TypedVar> res;
+        for(uint32_t i=0;i<n;i++){
+            uint32_t pos = offset + 4 + 8*i;
+            res.push_back(TypedVar(name(word(pos)),type(word(pos+4))));
+        }
+        return res;
+    }
+
+    uint32_t Image::root(size_t i, Root r) const {
+        if(getKind(i) != r)
+            throw ReaderException("Unexpected kind of tree.");
+        return word(roots + 8 + 8*i);
+    }
+
+    Root Image::getKind(size_t i) const {
+        if(i >= rootCount)
+            throw ReaderException("Invalid tree index " + std::to_string(i) + ".");
+        return static_cast<Root>(word(roots + 4 + 8*i));
+    }
+
+    ExprView Image::getExpression(size_t i) const {
+        return ExprView(*this,root(i,Root::Expr));
+    }
+
+    PredView Image::getPredicate(size_t i) const {
+        return PredView(*this,root(i,Root::Pred));
+    }
+
+    /*
+     * ExprView
+     * header: tag, type, tags; then the content of the node
+     */
+
+    uint32_t ExprView::word(uint32_t i) const {
+        return image->word(offset + 4*i);
+    }
+
+    void ExprView::expect(Expr::EKind tag) const {
+        if(getTag() != tag)
+            throw ReaderException("Unexpected kind of expression.");
+    }
+
+    Expr::EKind ExprView::getTag() const {
+        return toEnum(word(0),Expr::EKind::Predecessor);
+    }
+
+    const BType& ExprView::getType() const {
+        return image->type(word(1));
+    }
+
+    const TagSet::List& ExprView::getBxmlTag() const {
+        return image->tags(word(2));
+    }
+
+    std::string ExprView::getIntegerLiteral() const {
+        expect(Expr::EKind::IntegerLiteral);
+        return image->str(word(3));
+    }
+
+    std::string ExprView::getStringLiteral() const {
+        expect(Expr::EKind::StringLiteral);
+        return image->str(word(3));
+    }
+
+    Expr::Decimal ExprView::getRealLiteral() const {
+        expect(Expr::EKind::RealLiteral);
+        return Expr::Decimal(image->str(word(3)),image->str(word(4)));
+    }
+
+    VarName ExprView::getId() const {
+        expect(Expr::EKind::Id);
+        return image->name(word(3));
+    }
+
+    ExprView::UnaryExpr ExprView::toUnaryExpr() const {
+        expect(Expr::EKind::UnaryExpr);
+        return { toEnum(word(3),Expr::UnaryOp::Bin), child(4) };
+    }
+
+    ExprView::BinaryExpr ExprView::toBinaryExpr() const {
+        expect(Expr::EKind::BinaryExpr);
+        return { toEnum(word(3),Expr::BinaryOp::Arity), child(4), child(5) };
+    }
+
+    ExprView::TernaryExpr ExprView::toTernaryExpr() const {
+        expect(Expr::EKind::TernaryExpr);
+        return { toEnum(word(3),Expr::TernaryOp::Bin), child(4), child(5), child(6) };
+    }
+
+    ExprView::NaryExpr ExprView::toNaryExpr() const {
+        expect(Expr::EKind::NaryExpr);
+        NaryExpr res { toEnum(word(3),Expr::NaryOp::Set), {} };
+        uint32_t n = word(4);
+        for(uint32_t i=0;i<n;i++)
+            res.vec.push_back(child(5+i));
+        return res;
+    }
+
+    PredView ExprView::toBooleanExpr() const {
+        expect(Expr::EKind::BooleanExpr);
+        return PredView(*image,word(3));
+    }
+
+    ExprView::QuantifiedSet ExprView::toQuantifiedSet() const {
+        expect(Expr::EKind::QuantifiedSet);
+        return { image->vars(word(3)), PredView(*image,word(4)) };
+    }
+
+    ExprView::QuantifiedExpr ExprView::toQuantiedExpr() const {
+        expect(Expr::EKind::QuantifiedExpr);
+        return { toEnum(word(3),Expr::QuantifiedOp::RProduct), image->vars(word(4)),
+            PredView(*image,word(5)), child(6) };
+    }
+
+    ExprView::RecordExpr ExprView::fields() const {
+        RecordExpr res;
+        uint32_t n = word(3);
+        for(uint32_t i=0;i<n;i++)
+            res.fields.push_back({image->str(word(4+2*i)),child(5+2*i)});
+        return res;
+    }
+
+    ExprView::RecordExpr ExprView::toRecordExpr() const {
+        expect(Expr::EKind::Record);
+        return fields();
+    }
+
+    ExprView::RecordExpr ExprView::toStructExpr() const {
+        expect(Expr::EKind::Struct);
+        return fields();
+    }
+
+    ExprView::RecordAccessExpr ExprView::toRecordAccess() const {
+        expect(Expr::EKind::Record_Field_Access);
+        return { child(4), image->str(word(3)) };
+    }
+
+    ExprView::RecordUpdateExpr ExprView::toRecordUpdate() const {
+        expect(Expr::EKind::Record_Field_Update);
+        return { child(4), image->str(word(3)), child(5) };
+    }
+
+    Expr ExprView::toExpr() const {
+        const BType &ty = getType();
+        const TagSet::List &bxmlTag = getBxmlTag();
+        switch(getTag()){
+            case Expr::EKind::MaxInt:
+                return Expr::makeMaxInt(bxmlTag);
+            case Expr::EKind::MinInt:
+                return Expr::makeMinInt(bxmlTag);
+            case Expr::EKind::INTEGER:
+                return Expr::makeINTEGER(bxmlTag);
+            case Expr::EKind::NATURAL:
+                return Expr::makeNATURAL(bxmlTag);
+            case Expr::EKind::NATURAL1:
+                return Expr::makeNATURAL1(bxmlTag);
+            case Expr::EKind::INT:
+                return Expr::makeINT(bxmlTag);
+            case Expr::EKind::NAT:
+                return Expr::makeNAT(bxmlTag);
+            case Expr::EKind::NAT1:
+                return Expr::makeNAT1(bxmlTag);
+            case Expr::EKind::STRING:
+                return Expr::makeSTRING(bxmlTag);
+            case Expr::EKind::BOOL:
+                return Expr::makeBOOL(bxmlTag);
+            case Expr::EKind::REAL:
+                return Expr::makeREAL(bxmlTag);
+            case Expr::EKind::FLOAT:
+                return Expr::makeFLOAT(bxmlTag);
+            case Expr::EKind::TRUE:
+                return Expr::makeTRUE(bxmlTag);
+            case Expr::EKind::FALSE:
+                return Expr::makeFALSE(bxmlTag);
+            case Expr::EKind::EmptySet:
+                return Expr::makeEmptySet(ty,bxmlTag);
+            case Expr::EKind::Successor:
+                return Expr::makeSuccessor(ty,bxmlTag);
+            case Expr::EKind::Predecessor:
+                return Expr::makePredecessor(ty,bxmlTag);
+            case Expr::EKind::IntegerLiteral:
+                return Expr::makeInteger(getIntegerLiteral(),bxmlTag);
+            case Expr::EKind::StringLiteral:
+                return Expr::makeString(getStringLiteral(),bxmlTag);
+            case Expr::EKind::RealLiteral:
+                return Expr::makeReal(getRealLiteral(),bxmlTag);
+            case Expr::EKind::Id:
+                return Expr::makeIdent(getId(),ty,bxmlTag);
+            case Expr::EKind::BooleanExpr:
+                return Expr::makeBooleanExpr(toBooleanExpr().toPred(),bxmlTag);
+            case Expr::EKind::QuantifiedExpr:
+                {
+                    QuantifiedExpr q = toQuantiedExpr();
+                    Pred cond = q.cond.toPred();
+                    Expr body = q.body.toExpr();
+                    return Expr::makeQuantifiedExpr(q.op,q.vars,std::move(cond),std::move(body),ty,bxmlTag);
+                }
+            case Expr::EKind::QuantifiedSet:
+                {
+                    QuantifiedSet q = toQuantifiedSet();
+                    return Expr::makeQuantifiedSet(q.vars,q.cond.toPred(),ty,bxmlTag);
+                }
+            case Expr::EKind::UnaryExpr:
+                {
+                    UnaryExpr u = toUnaryExpr();
+                    return Expr::makeUnaryExpr(u.op,u.content.toExpr(),ty,bxmlTag);
+                }
+            case Expr::EKind::BinaryExpr:
+                {
+                    BinaryExpr b = toBinaryExpr();
+                    Expr lhs = b.lhs.toExpr();
+                    Expr rhs = b.rhs.toExpr();
+                    return Expr::makeBinaryExpr(b.op,std::move(lhs),std::move(rhs),ty,bxmlTag);
+                }
+            case Expr::EKind::TernaryExpr:
+                {
+                    TernaryExpr t = toTernaryExpr();
+                    Expr fst = t.fst.toExpr();
+                    Expr snd = t.snd.toExpr();
+                    Expr thd = t.thd.toExpr();
+                    return Expr::makeTernaryExpr(t.op,std::move(fst),std::move(snd),std::move(thd),ty,bxmlTag);
+                }
+            case Expr::EKind::NaryExpr:
+                {
+                    NaryExpr n = toNaryExpr();
+                    std::vector<Expr> vec;
+                    vec.reserve(n.vec.size());
+                    for(auto &e : n.vec)
+                        vec.push_back(e.toExpr());
+                    return Expr::makeNaryExpr(n.op,std::move(vec),ty,bxmlTag);
+                }
+            case Expr::EKind::Struct:
+            case Expr::EKind::Record:
+                {
+                    RecordExpr r = fields();
+                    std::vector<std::pair<std::string,Expr>> fds;
+                    fds.reserve(r.fields.size());
+                    for(auto &f : r.fields)
+                        fds.push_back({f.first,f.second.toExpr()});
+                    if(getTag() == Expr::EKind::Struct)
+                        return Expr::makeStruct(std::move(fds),ty,bxmlTag);
+                    else
+                        return Expr::makeRecord(std::move(fds),ty,bxmlTag);
+                }
+            case Expr::EKind::Record_Field_Access:
+                {
+                    RecordAccessExpr r = toRecordAccess();
+                    return Expr::makeRecordFieldAccess(r.rec.toExpr(),r.label,ty,bxmlTag);
+                }
+            case Expr::EKind::Record_Field_Update:
+                {
+                    RecordUpdateExpr r = toRecordUpdate();
+                    Expr rec = r.rec.toExpr();
+                    Expr value = r.fvalue.toExpr();
+                    return Expr::makeRecordFieldUpdate(std::move(rec),r.label,std::move(value),ty,bxmlTag);
+                }
+        }
+        assert(false); // unreachable
+        throw ReaderException("Invalid node kind."); // the kinds are checked by toEnum
+    }
+
+    /*
+     * PredView
+     * header: tag, goal tag; then the content of the node
+     */
+
+    uint32_t PredView::word(uint32_t i) const {
+        return image->word(offset + 4*i);
+    }
+
+    void PredView::expect(Pred::PKind tag) const {
+        if(getTag() != tag)
+            throw ReaderException("Unexpected kind of predicate.");
+    }
+
+    Pred::PKind PredView::getTag() const {
+        return toEnum(word(0),Pred::PKind::False);
+    }
+
+    std::string PredView::getGoalTag() const {
+        return image->str(word(1));
+    }
+
+    PredView::Implication PredView::toImplication() const {
+        expect(Pred::PKind::Implication);
+        return { child(2), child(3) };
+    }
+
+    PredView::Implication PredView::toEquivalence() const {
+        expect(Pred::PKind::Equivalence);
+        return { child(2), child(3) };
+    }
+
+    PredView::ExprComparison PredView::toExprComparison() const {
+        expect(Pred::PKind::ExprComparison);
+        return { toEnum(word(2),Pred::ComparisonOp::Rgt),
+            ExprView(*image,word(3)), ExprView(*image,word(4)) };
+    }
+
+    PredView::NegationPred PredView::toNegation() const {
+        expect(Pred::PKind::Negation);
+        return { child(2) };
+    }
+
+    std::vector<PredView> PredView::operands() const {
+        std::vector<PredView> res;
+        uint32_t n = word(2);
+        for(uint32_t i=0;i<n;i++)
+            res.push_back(child(3+i));
+        return res;
+    }
+
+    PredView::Conjunction PredView::toConjunction() const {
+        expect(Pred::PKind::Conjunction);
+        return { operands() };
+    }
+
+    PredView::Conjunction PredView::toDisjunction() const {
+        expect(Pred::PKind::Disjunction);
+        return { operands() };
+    }
+
+    PredView::Forall PredView::toForall() const {
+        expect(Pred::PKind::Forall);
+        return { image->vars(word(2)), child(3) };
+    }
+
+    PredView::Exists PredView::toExists() const {
+        expect(Pred::PKind::Exists);
+        return { image->vars(word(2)), child(3), word(4) != 0 };
+    }
+
+    Pred PredView::toPred() const {
+        std::string goalTag = getGoalTag();
+        switch(getTag()){
+            case Pred::PKind::Implication:
+            case Pred::PKind::Equivalence:
+                {
+                    Pred lhs = child(2).toPred();
+                    Pred rhs = child(3).toPred();
+                    if(getTag() == Pred::PKind::Implication)
+                        return Pred::makeImplication(std::move(lhs),std::move(rhs),goalTag);
+                    else
+                        return Pred::makeEquivalence(std::move(lhs),std::move(rhs),goalTag);
+                }
+            case Pred::PKind::Conjunction:
+            case Pred::PKind::Disjunction:
+                {
+                    std::vector<Pred> vec;
+                    for(auto &p : operands())
+                        vec.push_back(p.toPred());
+                    if(getTag() == Pred::PKind::Conjunction)
+                        return Pred::makeConjunction(std::move(vec),goalTag);
+                    else
+                        return Pred::makeDisjunction(std::move(vec),goalTag);
+                }
+            case Pred::PKind::Forall:
+                {
+                    std::vector<TypedVar> vars = image->vars(word(2));
+                    Pred body = child(3).toPred();
+                    return Pred::makeForall(vars,std::move(body),goalTag);
+                }
+            case Pred::PKind::Exists:
+                {
+                    Exists q = toExists();
+                    Pred body = q.body.toPred();
+                    if(q.allowWitnessInstanciation)
+                        return Pred::makeExistsForWitness(q.vars,std::move(body),goalTag);
+                    return Pred::makeExists(q.vars,std::move(body),goalTag);
+                }
+            case Pred::PKind::ExprComparison:
+                {
+                    ExprComparison c = toExprComparison();
+                    Expr lhs = c.lhs.toExpr();
+                    Expr rhs = c.rhs.toExpr();
+                    return Pred::makeExprComparison(c.op,std::move(lhs),std::move(rhs),goalTag);
+                }
+            case Pred::PKind::Negation:
+                return Pred::makeNegation(child(2).toPred(),goalTag);
+            case Pred::PKind::True:
+                return Pred::makeTrue(goalTag);
+            case Pred::PKind::False:
+                return Pred::makeFalse(goalTag);
+        }
+        assert(false); // unreachable
+        throw ReaderException("Invalid node kind."); // the kinds are checked by toEnum
+    }
+
+    /*
+     * ImageWriter
+     */
+
+    static void putWord(std::string &out, uint32_t w){
+        out.append(reinterpret_cast<const char*>(&w),4);
+    }
+
+    static void setWord(std::string &out, size_t pos, uint32_t w){
+        memcpy(&out[pos],&w,4);
+    }
+
+    uint32_t ImageWriter::str(const std::string &s){
+        auto it = strings.find(s);
+        if(it != strings.end())
+            return it->second;
+        uint32_t i = stringTable.size();
+        strings.insert({s,i});
+        stringTable.push_back(s);
+        return i;
+    }
+
+    uint32_t ImageWriter::type(const BType &ty){
+        auto it = types.find(ty);
+        if(it != types.end())
+            return it->second;
+        // the components are written first, so that entries only refer to previous ones
+        std::vector<uint32_t> entry { static_cast<uint32_t>(ty.getKind()) };
+        switch(ty.getKind()){
+            case BType::Kind::INTEGER:
+            case BType::Kind::BOOLEAN:
+            case BType::Kind::FLOAT:
+            case BType::Kind::REAL:
+            case BType::Kind::STRING:
+                break;
+            case BType::Kind::ProductType:
+                entry.push_back(type(ty.toProductType().lhs));
+                entry.push_back(type(ty.toProductType().rhs));
+                break;
+            case BType::Kind::PowerType:
+                entry.push_back(type(ty.toPowerType().content));
+                break;
+            case BType::Kind::Struct:
+                {
+                    auto &fields = ty.toRecordType().fields;
+                    entry.push_back(fields.size());
+                    for(auto &f : fields){
+                        entry.push_back(str(f.first));
+                        entry.push_back(type(f.second));
+                    }
+                    break;
+                }
+        }
+        uint32_t i = types.size();
+        types.insert({ty,i});
+        typeTable.insert(typeTable.end(),entry.begin(),entry.end());
+        return i;
+    }
+
+    uint32_t ImageWriter::name(const VarName &v){
+        auto it = names.find(v);
+        if(it != names.end())
+            return it->second;
+        uint32_t i = names.size();
+        names.insert({v,i});
+        nameTable.push_back(static_cast<uint32_t>(v.kind()));
+        nameTable.push_back(str(v.prefix()));
+        nameTable.push_back(static_cast<uint32_t>(v.suffix()));
+        return i;
+    }
+
+    uint32_t ImageWriter::tags(const TagSet::List &bxmlTag){
+        std::vector<uint32_t> key;
+        for(auto &t : bxmlTag)
+            key.push_back(str(t));
+        auto it = tagLists.find(key);
+        if(it != tagLists.end())
+            return it->second;
+        uint32_t i = tagLists.size();
+        tagLists.insert({key,i});
+        return i;
+    }
+
+    uint32_t ImageWriter::vars(const std::vector<TypedVar> &vec){
+        uint32_t res = headerSize + 4*nodes.size();
+        nodes.push_back(vec.size());
+        for(auto &v : vec){
+            nodes.push_back(name(v.name));
+            nodes.push_back(type(v.type));
+        }
+        return res;
+    }
+
+    // The visitors write the children and collect the content of the node
+
+    class ImageWriter::ExprVisitor : public Expr::Visitor {
+        public:
+            ExprVisitor(ImageWriter &w):w{w}{};
+            std::vector<uint32_t> content;
+
+            void visitConstant(const BType &, const TagSet::List &, EConstant){}
+            void visitIdent(const BType &, const TagSet::List &, const VarName &v){
+                content = { w.name(v) };
+            }
+            void visitIntegerLiteral(const BType &, const TagSet::List &, const std::string &i){
+                content = { w.str(i) };
+            }
+            void visitStringLiteral(const BType &, const TagSet::List &, const std::string &s){
+                content = { w.str(s) };
+            }
+            void visitRealLiteral(const BType &, const TagSet::List &, const Expr::Decimal &d){
+                content = { w.str(d.integerPart), w.str(d.fractionalPart) };
+            }
+            void visitUnaryExpression(const BType &, const TagSet::List &, Expr::UnaryOp op, const Expr &e){
+                content = { static_cast<uint32_t>(op), w.expr(e) };
+            }
+            void visitBinaryExpression(const BType &, const TagSet::List &, Expr::BinaryOp op, const Expr &lhs, const Expr &rhs){
+                uint32_t l = w.expr(lhs);
+                uint32_t r = w.expr(rhs);
+                content = { static_cast<uint32_t>(op), l, r };
+            }
+            void visitTernaryExpression(const BType &, const TagSet::List &, Expr::TernaryOp op, const Expr &fst, const Expr &snd, const Expr &thd){
+                uint32_t f = w.expr(fst);
+                uint32_t s = w.expr(snd);
+                uint32_t t = w.expr(thd);
+                content = { static_cast<uint32_t>(op), f, s, t };
+            }
+            void visitNaryExpression(const BType &, const TagSet::List &, Expr::NaryOp op, const std::vector<Expr> &vec){
+                content = { static_cast<uint32_t>(op), static_cast<uint32_t>(vec.size()) };
+                for(auto &e : vec)
+                    content.push_back(w.expr(e));
+            }
+            void visitBooleanExpression(const BType &, const TagSet::List &, const Pred &p){
+                content = { w.pred(p) };
+            }
+            void visitRecord(const BType &, const TagSet::List &, const std::vector<std::pair<std::string,Expr>> &fds){
+                fields(fds);
+            }
+            void visitStruct(const BType &, const TagSet::List &, const std::vector<std::pair<std::string,Expr>> &fds){
+                fields(fds);
+            }
+            void visitQuantifiedExpr(const BType &, const TagSet::List &, Expr::QuantifiedOp op, const std::vector<TypedVar> vars, const Pred &cond, const Expr &body){
+                uint32_t v = w.vars(vars);
+                uint32_t c = w.pred(cond);
+                uint32_t b = w.expr(body);
+                content = { static_cast<uint32_t>(op), v, c, b };
+            }
+            void visitQuantifiedSet(const BType &, const TagSet::List &, const std::vector<TypedVar> vars, const Pred &cond){
+                uint32_t v = w.vars(vars);
+                uint32_t c = w.pred(cond);
+                content = { v, c };
+            }
+            void visitRecordUpdate(const BType &, const TagSet::List &, const Expr &rec, const std::string &label, const Expr &value){
+                uint32_t r = w.expr(rec);
+                uint32_t v = w.expr(value);
+                content = { w.str(label), r, v };
+            }
+            void visitRecordAccess(const BType &, const TagSet::List &, const Expr &rec, const std::string &label){
+                content = { w.str(label), w.expr(rec) };
+            }
+        private:
+            ImageWriter &w;
+            void fields(const std::vector<std::pair<std::string,Expr>> &fds){
+                content = { static_cast<uint32_t>(fds.size()) };
+                for(auto &f : fds){
+                    content.push_back(w.str(f.first));
+                    content.push_back(w.expr(f.second));
+                }
+            }
+    };
+
+    class ImageWriter::PredVisitor : public Pred::Visitor {
+        public:
+            PredVisitor(ImageWriter &w):w{w}{};
+            std::vector<uint32_t> content;
+
+            void visitImplication(const Pred &lhs, const Pred &rhs){
+                uint32_t l = w.pred(lhs);
+                uint32_t r = w.pred(rhs);
+                content = { l, r };
+            }
+            void visitEquivalence(const Pred &lhs, const Pred &rhs){
+                uint32_t l = w.pred(lhs);
+                uint32_t r = w.pred(rhs);
+                content = { l, r };
+            }
+            void visitExprComparison(Pred::ComparisonOp op, const Expr &lhs, const Expr &rhs){
+                uint32_t l = w.expr(lhs);
+                uint32_t r = w.expr(rhs);
+                content = { static_cast<uint32_t>(op), l, r };
+            }
+            void visitNegation(const Pred &p){
+                content = { w.pred(p) };
+            }
+            void visitConjunction(const std::vector<Pred> &vec){
+                operands(vec);
+            }
+            void visitDisjunction(const std::vector<Pred> &vec){
+                operands(vec);
+            }
+            void visitForall(const std::vector<TypedVar> &vars, const Pred &p){
+                uint32_t v = w.vars(vars);
+                uint32_t b = w.pred(p);
+                content = { v, b };
+            }
+            void visitExists(const std::vector<TypedVar> &vars, const Pred &p){
+                uint32_t v = w.vars(vars);
+                uint32_t b = w.pred(p);
+                content = { v, b, 0 }; // the witness flag is set by ImageWriter::pred
+            }
+            void visitTrue(){}
+            void visitFalse(){}
+        private:
+            ImageWriter &w;
+            void operands(const std::vector<Pred> &vec){
+                content = { static_cast<uint32_t>(vec.size()) };
+                for(auto &p : vec)
+                    content.push_back(w.pred(p));
+            }
+    };
+
+    uint32_t ImageWriter::expr(const Expr &e){
+        ExprVisitor v(*this);
+        e.accept(v);
+        uint32_t res = headerSize + 4*nodes.size();
+        nodes.push_back(static_cast<uint32_t>(e.getTag()));
+        nodes.push_back(type(e.getType()));
+        nodes.push_back(tags(e.getBxmlTag()));
+        nodes.insert(nodes.end(),v.content.begin(),v.content.end());
+        return res;
+    }
+
+    uint32_t ImageWriter::pred(const Pred &p){
+        PredVisitor v(*this);
+        p.accept(v);
+        uint32_t res = headerSize + 4*nodes.size();
+        nodes.push_back(static_cast<uint32_t>(p.getTag()));
+        nodes.push_back(str(p.getGoalTag()));
+        if(p.getTag() == Pred::PKind::Exists && p.toExists().allowWitnessInstanciation)
+            v.content.back() = 1;
+        nodes.insert(nodes.end(),v.content.begin(),v.content.end());
+        return res;
+    }
+
+    void ImageWriter::writeExpression(const Expr &e){
+        roots.push_back({Root::Expr,expr(e)});
+    }
+
+    void ImageWriter::writePredicate(const Pred &p){
+        roots.push_back({Root::Pred,pred(p)});
+    }
+
+    std::string ImageWriter::data() const {
+        std::string res(imageMagic,sizeof(imageMagic));
+        putWord(res,imageVersion);
+        res.resize(headerSize); // offsets of the tables, set below
+        for(auto w : nodes)
+            putWord(res,w);
+
+        // strings
+        setWord(res,8,res.size());
+        putWord(res,stringTable.size());
+        size_t offsets = res.size();
+        res.resize(offsets + 4*stringTable.size());
+        for(size_t i=0;i<stringTable.size();i++){
+            setWord(res,offsets + 4*i,res.size());
+            putWord(res,stringTable[i].size());
+            res += stringTable[i];
+            res.resize((res.size() + 3) & ~size_t(3));
+        }
+
+        // types
+        setWord(res,12,res.size());
+        putWord(res,types.size());
+        for(auto w : typeTable)
+            putWord(res,w);
+
+        // names
+        setWord(res,16,res.size());
+        putWord(res,names.size());
+        for(auto w : nameTable)
+            putWord(res,w);
+
+        // tag lists
+        setWord(res,20,res.size());
+        putWord(res,tagLists.size());
+        offsets = res.size();
+        res.resize(offsets + 4*tagLists.size());
+        for(auto &p : tagLists){
+            setWord(res,offsets + 4*p.second,res.size());
+            putWord(res,p.first.size());
+            for(auto s : p.first)
+                putWord(res,s);
+        }
+
+        // roots
+        setWord(res,24,res.size());
+        putWord(res,roots.size());
+        for(auto &r : roots){
+            putWord(res,static_cast<uint32_t>(r.first));
+            putWord(res,r.second);
+        }
+        return res;
+    }
+}
@@ -0,0 +1,240 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <cstdint>
+#include <cstring>
+#include "binReader.h"
+
+/** \brief Memory-mappable images of expressions and predicates.
+ *
+ * Unlike the stream of Bin::Writer, an image is made of fixed-width
+ * 32-bit words, and a node refers to its children by their offset in the
+ * image. A tree can therefore be navigated in place through ExprView and
+ * PredView, whose accessors mirror those of Expr and Pred: only the nodes
+ * that are visited are read (and, for a mapped file, paged in).
+ *
+ * Layout (native byte order):
+ *   magic "BIMG", version, offsets of the five tables below,
+ *   the nodes, children first; an EXISTS node ends with its witness flag,
+ *   strings: count, offset of each string; a string is (length, bytes),
+ *   types: count, then one entry per type, children first,
+ *   names: count, then (kind, prefix, suffix) for each identifier,
+ *   tag lists: count, offset of each list; a list is (count, strings),
+ *   roots: count, then (kind, offset) for each tree.
+ * The types, names and tag lists are decoded when the image is opened,
+ * everything else is read on access. Files are mapped with mmap where it is
+ * available, and read in memory otherwise.
+ */
+namespace Bin {
+    class Image;
+    class PredView;
+
+    class ExprView {
+        public:
+            Expr::EKind getTag() const;
+            const BType& getType() const;
+            const TagSet::List& getBxmlTag() const;
+
+            std::string getIntegerLiteral() const;
+            std::string getStringLiteral() const;
+            Expr::Decimal getRealLiteral() const;
+            VarName getId() const;
+
+            struct UnaryExpr;
+            struct BinaryExpr;
+            struct TernaryExpr;
+            struct NaryExpr;
+            struct RecordExpr;
+            struct QuantifiedSet;
+            struct QuantifiedExpr;
+            struct RecordAccessExpr;
+            struct RecordUpdateExpr;
+
+            UnaryExpr toUnaryExpr() const;
+            BinaryExpr toBinaryExpr() const;
+            TernaryExpr toTernaryExpr() const;
+            NaryExpr toNaryExpr() const;
+            PredView toBooleanExpr() const;
+            QuantifiedSet toQuantifiedSet() const;
+            QuantifiedExpr toQuantiedExpr() const;
+            RecordExpr toRecordExpr() const;
+            RecordExpr toStructExpr() const;
+            RecordAccessExpr toRecordAccess() const;
+            RecordUpdateExpr toRecordUpdate() const;
+
+            // Builds the whole expression
+            Expr toExpr() const;
+
+        private:
+            friend class Image;
+            friend class PredView;
+            ExprView(const Image &image, uint32_t offset):image{&image},offset{offset}{};
+            // Members
+            const Image *image;
+            uint32_t offset;
+            // Methods
+            uint32_t word(uint32_t i) const;
+            ExprView child(uint32_t i) const { return ExprView(*image,word(i)); };
+            void expect(Expr::EKind tag) const;
+            RecordExpr fields() const;
+    };
+
+    class PredView {
+        public:
+            Pred::PKind getTag() const;
+            std::string getGoalTag() const;
+
+            struct Implication;
+            struct ExprComparison;
+            struct NegationPred;
+            struct Conjunction;
+            struct Forall;
+            struct Exists;
+
+            Implication toImplication() const;
+            Implication toEquivalence() const;
+            ExprComparison toExprComparison() const;
+            NegationPred toNegation() const;
+            Conjunction toConjunction() const;
+            Conjunction toDisjunction() const;
+            Forall toForall() const;
+            Exists toExists() const;
+
+            // Builds the whole predicate
+            Pred toPred() const;
+
+        private:
+            friend class Image;
+            friend class ExprView;
+            PredView(const Image &image, uint32_t offset):image{&image},offset{offset}{};
+            // Members
+            const Image *image;
+            uint32_t offset;
+            // Methods
+            uint32_t word(uint32_t i) const;
+            PredView child(uint32_t i) const { return PredView(*image,word(i)); };
+            void expect(Pred::PKind tag) const;
+            std::vector<PredView> operands() const;
+    };
+
+    // Contents of the nodes, as in exprDesc.h and predDesc.h
+    struct ExprView::UnaryExpr { Expr::UnaryOp op; ExprView content; };
+    struct ExprView::BinaryExpr { Expr::BinaryOp op; ExprView lhs; ExprView rhs; };
+    struct ExprView::TernaryExpr { Expr::TernaryOp op; ExprView fst; ExprView snd; ExprView thd; };
+    struct ExprView::NaryExpr { Expr::NaryOp op; std::vector<ExprView> vec; };
+    struct ExprView::RecordExpr { std::vector<std::pair<std::string,ExprView>> fields; };
+    struct ExprView::QuantifiedSet { std::vector<TypedVar> vars; PredView cond; };
+    struct ExprView::QuantifiedExpr { Expr::QuantifiedOp op; std::vector<TypedVar> vars; PredView cond; ExprView body; };
+    struct ExprView::RecordAccessExpr { ExprView rec; std::string label; };
+    struct ExprView::RecordUpdateExpr { ExprView rec; std::string label; ExprView fvalue; };
+
+    struct PredView::Implication { PredView lhs; PredView rhs; };
+    struct PredView::ExprComparison { Pred::ComparisonOp op; ExprView lhs; ExprView rhs; };
+    struct PredView::NegationPred { PredView operand; };
+    struct PredView::Conjunction { std::vector<PredView> operands; };
+    struct PredView::Forall { std::vector<TypedVar> vars; PredView body; };
+    struct PredView::Exists { std::vector<TypedVar> vars; PredView body; bool allowWitnessInstanciation; };
+
+    class Image {
+        public:
+            // Maps the file in memory. Throws ReaderException on failure.
+            explicit Image(const std::string &path);
+            // Image held in memory. The data must outlive the image.
+            Image(const char *data, size_t size);
+            Image(const Image &) = delete;
+            Image& operator=(const Image &) = delete;
+            ~Image();
+
+            // Number of trees in the image
+            size_t size() const { return rootCount; };
+            Root getKind(size_t i) const;
+            ExprView getExpression(size_t i) const;
+            PredView getPredicate(size_t i) const;
+
+        private:
+            friend class ExprView;
+            friend class PredView;
+            // Members
+            void *mapping; // the mapped file, if any
+            std::string buffer; // the file contents, where files cannot be mapped
+            const unsigned char *base;
+            size_t length;
+            uint32_t strings;
+            uint32_t tagLists;
+            uint32_t roots;
+            uint32_t rootCount;
+            std::vector<BType> types;
+            std::vector<VarName> names;
+            std::vector<TagSet::List> bxmlTags;
+            // Methods
+            void open();
+            void unmap();
+            uint32_t word(uint32_t offset) const {
+                if(offset > length - 4 || offset % 4 != 0)
+                    throw ReaderException("Invalid offset " + std::to_string(offset) + ".");
+                uint32_t w;
+                memcpy(&w,base + offset,4);
+                return w;
+            }
+            uint32_t root(size_t i, Root r) const;
+            std::string str(uint32_t i) const;
+            const BType& type(uint32_t i) const;
+            const VarName& name(uint32_t i) const;
+            const TagSet::List& tags(uint32_t i) const;
+            std::vector<TypedVar> vars(uint32_t offset) const;
+    };
+
+    // Writes expressions and predicates in the image format
+    class ImageWriter {
+        public:
+            ImageWriter(){};
+
+            void writeExpression(const Expr &e);
+            void writePredicate(const Pred &p);
+
+            // The image of the trees written so far, in the same order
+            std::string data() const;
+
+        private:
+            class ExprVisitor;
+            class PredVisitor;
+
+            // Tables
+            std::unordered_map<std::string,uint32_t> strings;
+            std::vector<std::string> stringTable;
+            std::map<BType,uint32_t> types;
+            std::vector<uint32_t> typeTable;
+            std::map<VarName,uint32_t> names;
+            std::vector<uint32_t> nameTable;
+            std::map<std::vector<uint32_t>,uint32_t> tagLists;
+            // Nodes, starting right after the header
+            std::vector<uint32_t> nodes;
+            std::vector<std::pair<Root,uint32_t>> roots;
+
+            // Methods
+            uint32_t str(const std::string &s);
+            uint32_t type(const BType &ty);
+            uint32_t name(const VarName &v);
+            uint32_t tags(const TagSet::List &bxmlTag);
+            uint32_t vars(const std::vector<TypedVar> &vec);
+            uint32_t expr(const Expr &e);
+            uint32_t pred(const Pred &p);
+    };
+}
+
+#endif // IMAGE_H
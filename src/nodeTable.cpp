@@ -0,0 +1,531 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "nodeTable.h"
+#include "exprDesc.h"
+#include "predDesc.h"
+
+namespace {
+    size_t hash_combine_ptr(const void *p, size_t seed){
+        std::hash<const void*> h;
+        seed ^= h(p) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed;
+    }
+
+    bool same_vars(const std::vector<TypedVar> &v1, const std::vector<TypedVar> &v2){
+        return TypedVar::vec_compare(v1,v2) == 0;
+    }
+
+    size_t hash_vars(const std::vector<TypedVar> &vars, size_t seed){
+        for(auto &v : vars)
+            seed = v.hash_combine(seed);
+        return seed;
+    }
+}
+
+bool NodeTable::same(const Expr &e1, const Expr &e2){
+    return e1.tag == e2.tag
+        && e1.desc == e2.desc
+        && e1.type == e2.type
+        && e1.bxmlTag == e2.bxmlTag;
+}
+
+bool NodeTable::same(const Pred &p1, const Pred &p2){
+    return p1.desc == p2.desc
+        && p1.goalTag == p2.goalTag;
+}
+
+void NodeTable::clear(){
+    exprs.clear();
+    preds.clear();
+    canonicalExprs.clear();
+    canonicalPreds.clear();
+}
+
+Expr NodeTable::intern(Expr &&e){
+    if(e.desc == nullptr || canonicalExprs.find(e.desc.get()) != canonicalExprs.end())
+        return std::move(e);
+
+    // the sub-terms are replaced by their canonical representative
+    e.detach();
+    switch(e.tag){
+        case Expr::EKind::UnaryExpr:
+            {
+                auto &u = static_cast<Expr::UnaryExpr&>(*e.desc);
+                u.content = intern(std::move(u.content));
+                break;
+            }
+        case Expr::EKind::BinaryExpr:
+            {
+                auto &b = static_cast<Expr::BinaryExpr&>(*e.desc);
+                b.lhs = intern(std::move(b.lhs));
+                b.rhs = intern(std::move(b.rhs));
+                break;
+            }
+        case Expr::EKind::TernaryExpr:
+            {
+                auto &t = static_cast<Expr::TernaryExpr&>(*e.desc);
+                t.fst = intern(std::move(t.fst));
+                t.snd = intern(std::move(t.snd));
+                t.thd = intern(std::move(t.thd));
+                break;
+            }
+        case Expr::EKind::NaryExpr:
+            {
+                for(auto &c : static_cast<Expr::NaryExpr&>(*e.desc).vec)
+                    c = intern(std::move(c));
+                break;
+            }
+        case Expr::EKind::BooleanExpr:
+            {
+                Pred &b = e.toBooleanExpr();
+                b = intern(std::move(b));
+                break;
+            }
+        case Expr::EKind::Struct:
+            {
+                for(auto &f : static_cast<Expr::StructExpr&>(*e.desc).fields)
+                    f.second = intern(std::move(f.second));
+                break;
+            }
+        case Expr::EKind::Record:
+            {
+                for(auto &f : static_cast<Expr::RecordExpr&>(*e.desc).fields)
+                    f.second = intern(std::move(f.second));
+                break;
+            }
+        case Expr::EKind::QuantifiedSet:
+            {
+                auto &q = static_cast<Expr::QuantifiedSet&>(*e.desc);
+                q.cond = intern(std::move(q.cond));
+                break;
+            }
+        case Expr::EKind::QuantifiedExpr:
+            {
+                auto &q = static_cast<Expr::QuantifiedExpr&>(*e.desc);
+                q.cond = intern(std::move(q.cond));
+                q.body = intern(std::move(q.body));
+                break;
+            }
+        case Expr::EKind::Record_Field_Access:
+            {
+                auto &a = static_cast<Expr::RecordAccessExpr&>(*e.desc);
+                a.rec = intern(std::move(a.rec));
+                break;
+            }
+        case Expr::EKind::Record_Field_Update:
+            {
+                auto &u = static_cast<Expr::RecordUpdateExpr&>(*e.desc);
+                u.rec = intern(std::move(u.rec));
+                u.fvalue = intern(std::move(u.fvalue));
+                break;
+            }
+        default:
+            break;
+    }
+
+    size_t h = shallowHash(e);
+    auto range = exprs.equal_range(h);
+    for(auto it = range.first; it != range.second; ++it){
+        if(it->second.tag == e.tag && shallowEquals(it->second,e)){
+            e.desc = it->second.desc;
+            return std::move(e);
+        }
+    }
+    canonicalExprs.insert(e.desc.get());
+    exprs.emplace(h,e.copy());
+    return std::move(e);
+}
+
+Pred NodeTable::intern(Pred &&p){
+    if(p.desc == nullptr || canonicalPreds.find(p.desc.get()) != canonicalPreds.end())
+        return std::move(p);
+
+    // the sub-terms are replaced by their canonical representative
+    p.detach();
+    switch(p.desc->tag()){
+        case Pred::PKind::Implication:
+            {
+                auto &b = static_cast<Pred::Implication&>(*p.desc);
+                b.lhs = intern(std::move(b.lhs));
+                b.rhs = intern(std::move(b.rhs));
+                break;
+            }
+        case Pred::PKind::Equivalence:
+            {
+                auto &b = static_cast<Pred::Equivalence&>(*p.desc);
+                b.lhs = intern(std::move(b.lhs));
+                b.rhs = intern(std::move(b.rhs));
+                break;
+            }
+        case Pred::PKind::ExprComparison:
+            {
+                auto &c = static_cast<Pred::ExprComparison&>(*p.desc);
+                c.lhs = intern(std::move(c.lhs));
+                c.rhs = intern(std::move(c.rhs));
+                break;
+            }
+        case Pred::PKind::Negation:
+            {
+                auto &n = static_cast<Pred::NegationPred&>(*p.desc);
+                n.operand = intern(std::move(n.operand));
+                break;
+            }
+        case Pred::PKind::Conjunction:
+            {
+                for(auto &c : static_cast<Pred::Conjunction&>(*p.desc).operands)
+                    c = intern(std::move(c));
+                break;
+            }
+        case Pred::PKind::Disjunction:
+            {
+                for(auto &c : static_cast<Pred::Disjunction&>(*p.desc).operands)
+                    c = intern(std::move(c));
+                break;
+            }
+        case Pred::PKind::Forall:
+            {
+                auto &q = static_cast<Pred::Forall&>(*p.desc);
+                q.body = intern(std::move(q.body));
+                break;
+            }
+        case Pred::PKind::Exists:
+            {
+                auto &q = static_cast<Pred::Exists&>(*p.desc);
+                q.body = intern(std::move(q.body));
+                break;
+            }
+        case Pred::PKind::True:
+        case Pred::PKind::False:
+            break;
+    }
+
+    size_t h = shallowHash(p);
+    auto range = preds.equal_range(h);
+    for(auto it = range.first; it != range.second; ++it){
+        if(shallowEquals(it->second,p)){
+            p.desc = it->second.desc;
+            return std::move(p);
+        }
+    }
+    canonicalPreds.insert(p.desc.get());
+    preds.emplace(h,p.copy());
+    return std::move(p);
+}
+
+namespace {
+    // identity of a canonical sub-term
+    size_t hash_child(const Expr &e, const void *desc, size_t seed){
+        return hashUtil::hash_combine_int(static_cast<int>(e.getTag()),
+                hash_combine_ptr(desc,
+                    e.getType().hash_combine(seed)));
+    }
+}
+
+size_t NodeTable::shallowHash(const Expr &e){
+    size_t seed = hashUtil::hash_combine_int(static_cast<int>(e.tag),0);
+    auto child = [&seed](const Expr &c){ seed = hash_child(c,c.desc.get(),seed); };
+    switch(e.tag){
+        case Expr::EKind::IntegerLiteral:
+            return hashUtil::hash_combine_string(e.getIntegerLiteral(),seed);
+        case Expr::EKind::StringLiteral:
+            return hashUtil::hash_combine_string(e.getStringLiteral(),seed);
+        case Expr::EKind::RealLiteral:
+            return hashUtil::hash_combine_string(e.getRealLiteral().integerPart,
+                    hashUtil::hash_combine_string(e.getRealLiteral().fractionalPart,seed));
+        case Expr::EKind::Id:
+            return e.getId().hash_combine(seed);
+        case Expr::EKind::UnaryExpr:
+            {
+                auto &u = e.toUnaryExpr();
+                seed = hashUtil::hash_combine_int(static_cast<int>(u.op),seed);
+                child(u.content);
+                return seed;
+            }
+        case Expr::EKind::BinaryExpr:
+            {
+                auto &b = e.toBinaryExpr();
+                seed = hashUtil::hash_combine_int(static_cast<int>(b.op),seed);
+                child(b.lhs);
+                child(b.rhs);
+                return seed;
+            }
+        case Expr::EKind::TernaryExpr:
+            {
+                auto &t = e.toTernaryExpr();
+                seed = hashUtil::hash_combine_int(static_cast<int>(t.op),seed);
+                child(t.fst);
+                child(t.snd);
+                child(t.thd);
+                return seed;
+            }
+        case Expr::EKind::NaryExpr:
+            {
+                auto &n = e.toNaryExpr();
+                seed = hashUtil::hash_combine_int(static_cast<int>(n.op),seed);
+                for(auto &c : n.vec)
+                    child(c);
+                return seed;
+            }
+        case Expr::EKind::BooleanExpr:
+            return hash_combine_ptr(e.toBooleanExpr().desc.get(),seed);
+        case Expr::EKind::Struct:
+            {
+                for(auto &f : e.toStructExpr().fields){
+                    seed = hashUtil::hash_combine_string(f.first,seed);
+                    child(f.second);
+                }
+                return seed;
+            }
+        case Expr::EKind::Record:
+            {
+                for(auto &f : e.toRecordExpr().fields){
+                    seed = hashUtil::hash_combine_string(f.first,seed);
+                    child(f.second);
+                }
+                return seed;
+            }
+        case Expr::EKind::QuantifiedSet:
+            {
+                auto &q = e.toQuantifiedSet();
+                return hash_combine_ptr(q.cond.desc.get(),hash_vars(q.vars,seed));
+            }
+        case Expr::EKind::QuantifiedExpr:
+            {
+                auto &q = e.toQuantiedExpr();
+                seed = hashUtil::hash_combine_int(static_cast<int>(q.op),seed);
+                seed = hash_combine_ptr(q.cond.desc.get(),hash_vars(q.vars,seed));
+                child(q.body);
+                return seed;
+            }
+        case Expr::EKind::Record_Field_Access:
+            {
+                auto &a = e.toRecordAccess();
+                seed = hashUtil::hash_combine_string(a.label,seed);
+                child(a.rec);
+                return seed;
+            }
+        case Expr::EKind::Record_Field_Update:
+            {
+                auto &u = e.toRecordUpdate();
+                seed = hashUtil::hash_combine_string(u.label,seed);
+                child(u.rec);
+                child(u.fvalue);
+                return seed;
+            }
+        default:
+            return seed;
+    }
+}
+
+bool NodeTable::shallowEquals(const Expr &e1, const Expr &e2){
+    assert(e1.tag == e2.tag);
+    switch(e1.tag){
+        case Expr::EKind::IntegerLiteral:
+            return e1.getIntegerLiteral() == e2.getIntegerLiteral();
+        case Expr::EKind::StringLiteral:
+            return e1.getStringLiteral() == e2.getStringLiteral();
+        case Expr::EKind::RealLiteral:
+            return e1.getRealLiteral().compare(e2.getRealLiteral()) == 0;
+        case Expr::EKind::Id:
+            return e1.getId() == e2.getId();
+        case Expr::EKind::UnaryExpr:
+            {
+                auto &u1 = e1.toUnaryExpr();
+                auto &u2 = e2.toUnaryExpr();
+                return u1.op == u2.op && same(u1.content,u2.content);
+            }
+        case Expr::EKind::BinaryExpr:
+            {
+                auto &b1 = e1.toBinaryExpr();
+                auto &b2 = e2.toBinaryExpr();
+                return b1.op == b2.op && same(b1.lhs,b2.lhs) && same(b1.rhs,b2.rhs);
+            }
+        case Expr::EKind::TernaryExpr:
+            {
+                auto &t1 = e1.toTernaryExpr();
+                auto &t2 = e2.toTernaryExpr();
+                return t1.op == t2.op && same(t1.fst,t2.fst)
+                    && same(t1.snd,t2.snd) && same(t1.thd,t2.thd);
+            }
+        case Expr::EKind::NaryExpr:
+            {
+                auto &n1 = e1.toNaryExpr();
+                auto &n2 = e2.toNaryExpr();
+                if(n1.op != n2.op || n1.vec.size() != n2.vec.size())
+                    return false;
+                for(size_t i=0;i<n1.vec.size();i++){
+                    if(!same(n1.vec[i],n2.vec[i]))
+                        return false;
+                }
+                return true;
+            }
+        case Expr::EKind::BooleanExpr:
+            return same(e1.toBooleanExpr(),e2.toBooleanExpr());
+        case Expr::EKind::Struct:
+        case Expr::EKind::Record:
+            {
+                auto &f1 = (e1.tag == Expr::EKind::Struct) ? e1.toStructExpr().fields : e1.toRecordExpr().fields;
+                auto &f2 = (e2.tag == Expr::EKind::Struct) ? e2.toStructExpr().fields : e2.toRecordExpr().fields;
+                if(f1.size() != f2.size())
+                    return false;
+                for(size_t i=0;i<f1.size();i++){
+                    if(f1[i].first != f2[i].first || !same(f1[i].second,f2[i].second))
+                        return false;
+                }
+                return true;
+            }
+        case Expr::EKind::QuantifiedSet:
+            {
+                auto &q1 = e1.toQuantifiedSet();
+                auto &q2 = e2.toQuantifiedSet();
+                return same_vars(q1.vars,q2.vars) && same(q1.cond,q2.cond);
+            }
+        case Expr::EKind::QuantifiedExpr:
+            {
+                auto &q1 = e1.toQuantiedExpr();
+                auto &q2 = e2.toQuantiedExpr();
+                return q1.op == q2.op && same_vars(q1.vars,q2.vars)
+                    && same(q1.cond,q2.cond) && same(q1.body,q2.body);
+            }
+        case Expr::EKind::Record_Field_Access:
+            {
+                auto &a1 = e1.toRecordAccess();
+                auto &a2 = e2.toRecordAccess();
+                return a1.label == a2.label && same(a1.rec,a2.rec);
+            }
+        case Expr::EKind::Record_Field_Update:
+            {
+                auto &u1 = e1.toRecordUpdate();
+                auto &u2 = e2.toRecordUpdate();
+                return u1.label == u2.label && same(u1.rec,u2.rec) && same(u1.fvalue,u2.fvalue);
+            }
+        default:
+            return true;
+    }
+}
+
+size_t NodeTable::shallowHash(const Pred &p){
+    size_t seed = hashUtil::hash_combine_int(static_cast<int>(p.getTag()),0);
+    switch(p.getTag()){
+        case Pred::PKind::Implication:
+            {
+                auto &b = p.toImplication();
+                return hash_combine_ptr(b.rhs.desc.get(),
+                        hash_combine_ptr(b.lhs.desc.get(),seed));
+            }
+        case Pred::PKind::Equivalence:
+            {
+                auto &b = p.toEquivalence();
+                return hash_combine_ptr(b.rhs.desc.get(),
+                        hash_combine_ptr(b.lhs.desc.get(),seed));
+            }
+        case Pred::PKind::ExprComparison:
+            {
+                auto &c = p.toExprComparison();
+                seed = hashUtil::hash_combine_int(static_cast<int>(c.op),seed);
+                seed = hash_child(c.lhs,c.lhs.desc.get(),seed);
+                return hash_child(c.rhs,c.rhs.desc.get(),seed);
+            }
+        case Pred::PKind::Negation:
+            return hash_combine_ptr(p.toNegation().operand.desc.get(),seed);
+        case Pred::PKind::Conjunction:
+            {
+                for(auto &c : p.toConjunction().operands)
+                    seed = hash_combine_ptr(c.desc.get(),seed);
+                return seed;
+            }
+        case Pred::PKind::Disjunction:
+            {
+                for(auto &c : p.toDisjunction().operands)
+                    seed = hash_combine_ptr(c.desc.get(),seed);
+                return seed;
+            }
+        case Pred::PKind::Forall:
+            {
+                auto &q = p.toForall();
+                return hash_combine_ptr(q.body.desc.get(),hash_vars(q.vars,seed));
+            }
+        case Pred::PKind::Exists:
+            {
+                auto &q = p.toExists();
+                seed = hashUtil::hash_combine_int(q.allowWitnessInstanciation ? 1 : 0,seed);
+                return hash_combine_ptr(q.body.desc.get(),hash_vars(q.vars,seed));
+            }
+        case Pred::PKind::True:
+        case Pred::PKind::False:
+            return seed;
+    }
+    assert(false); // unreachable
+    return seed;
+}
+
+bool NodeTable::shallowEquals(const Pred &p1, const Pred &p2){
+    if(p1.getTag() != p2.getTag())
+        return false;
+    switch(p1.getTag()){
+        case Pred::PKind::Implication:
+            {
+                auto &b1 = p1.toImplication();
+                auto &b2 = p2.toImplication();
+                return same(b1.lhs,b2.lhs) && same(b1.rhs,b2.rhs);
+            }
+        case Pred::PKind::Equivalence:
+            {
+                auto &b1 = p1.toEquivalence();
+                auto &b2 = p2.toEquivalence();
+                return same(b1.lhs,b2.lhs) && same(b1.rhs,b2.rhs);
+            }
+        case Pred::PKind::ExprComparison:
+            {
+                auto &c1 = p1.toExprComparison();
+                auto &c2 = p2.toExprComparison();
+                return c1.op == c2.op && same(c1.lhs,c2.lhs) && same(c1.rhs,c2.rhs);
+            }
+        case Pred::PKind::Negation:
+            return same(p1.toNegation().operand,p2.toNegation().operand);
+        case Pred::PKind::Conjunction:
+        case Pred::PKind::Disjunction:
+            {
+                auto &v1 = (p1.getTag() == Pred::PKind::Conjunction) ? p1.toConjunction().operands : p1.toDisjunction().operands;
+                auto &v2 = (p2.getTag() == Pred::PKind::Conjunction) ? p2.toConjunction().operands : p2.toDisjunction().operands;
+                if(v1.size() != v2.size())
+                    return false;
+                for(size_t i=0;i<v1.size();i++){
+                    if(!same(v1[i],v2[i]))
+                        return false;
+                }
+                return true;
+            }
+        case Pred::PKind::Forall:
+            {
+                auto &q1 = p1.toForall();
+                auto &q2 = p2.toForall();
+                return same_vars(q1.vars,q2.vars) && same(q1.body,q2.body);
+            }
+        case Pred::PKind::Exists:
+            {
+                auto &q1 = p1.toExists();
+                auto &q2 = p2.toExists();
+                return q1.allowWitnessInstanciation == q2.allowWitnessInstanciation
+                    && same_vars(q1.vars,q2.vars) && same(q1.body,q2.body);
+            }
+        case Pred::PKind::True:
+        case Pred::PKind::False:
+            return true;
+    }
+    assert(false); // unreachable
+    return false;
+}
@@ -0,0 +1,75 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef NODETABLE_H
+#define NODETABLE_H
+
+#include <unordered_map>
+#include <unordered_set>
+#include "expr.h"
+#include "pred.h"
+
+/** \brief Hash-consing table for expressions and predicates.
+ *
+ * intern() rebuilds a term bottom-up so that structurally identical
+ * sub-terms share a single descriptor. The table keeps a reference on every
+ * canonical descriptor; since descriptors are copy-on-write, modifying an
+ * interned term never alters the canonical node.
+ *
+ * Two interned terms are identical iff same() holds, which only compares
+ * descriptor addresses and the attributes stored outside the descriptor
+ * (tag, type, bxml tags for expressions; goal tag for predicates).
+ *
+ * Terms built from already interned sub-terms are interned in constant time:
+ * \code
+ * Expr e = table.intern(Expr::makeBinaryExpr(op, table.intern(std::move(a)), table.intern(std::move(b)), ty));
+ * \endcode
+ *
+ * A table is not thread-safe.
+ */
+class NodeTable {
+    public:
+        NodeTable(){};
+        NodeTable(const NodeTable &) = delete;
+        NodeTable& operator=(const NodeTable &) = delete;
+
+        // Returns the canonical representative of e
+        Expr intern(Expr &&e);
+        // Returns the canonical representative of p
+        Pred intern(Pred &&p);
+
+        // Identity of interned terms
+        static bool same(const Expr &e1, const Expr &e2);
+        static bool same(const Pred &p1, const Pred &p2);
+
+        // Number of canonical descriptors
+        size_t size() const { return exprs.size() + preds.size(); };
+        // Forget all canonical descriptors. Terms already interned remain valid.
+        void clear();
+
+    private:
+        std::unordered_multimap<size_t,Expr> exprs; // shallow hash -> canonical expression
+        std::unordered_multimap<size_t,Pred> preds; // shallow hash -> canonical predicate
+        std::unordered_set<const Expr::ExprDesc*> canonicalExprs;
+        std::unordered_set<const Pred::PredDesc*> canonicalPreds;
+
+        // hash and equality of a node whose sub-terms are canonical
+        static size_t shallowHash(const Expr &e);
+        static size_t shallowHash(const Pred &p);
+        static bool shallowEquals(const Expr &e1, const Expr &e2);
+        static bool shallowEquals(const Pred &p1, const Pred &p2);
+};
+
+#endif // NODETABLE_H
@@ -0,0 +1,260 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "pogReader.h"
+#include "predReader.h"
+#include "gpredReader.h"
+#include "readerCache.h"
+#include "arena.h"
+#include <QXmlStreamReader>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace Xml {
+
+    // Byte range of a Proof_Obligation element in the document
+    struct Chunk {
+        size_t begin;
+        size_t end;
+    };
+
+    static bool isNameEnd(char c){
+        return c == '>' || c == '/' || c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    /* Finds the Proof_Obligation elements without parsing the document. They do
+     * not nest, and the generator writes neither comments nor CDATA sections. */
+    static std::vector<Chunk> split(const QByteArray &document){
+        static const char startTag[] = "<Proof_Obligation";
+        static const char endTag[] = "</Proof_Obligation";
+        const int startLen = sizeof(startTag) - 1;
+        const int endLen = sizeof(endTag) - 1;
+        const char *data = document.constData();
+        const int size = document.size();
+        std::vector<Chunk> res;
+        int pos = 0;
+        while((pos = document.indexOf(startTag,pos)) >= 0){
+            if(pos + startLen >= size || !isNameEnd(data[pos + startLen])){
+                pos += startLen; // Proof_Obligations, or another name with this prefix
+                continue;
+            }
+            // end of the start tag, '>' may occur in attribute values
+            int i = pos + startLen;
+            char quote = 0;
+            for(; i < size; i++){
+                if(quote != 0){
+                    if(data[i] == quote)
+                        quote = 0;
+                } else if(data[i] == '"' || data[i] == '\''){
+                    quote = data[i];
+                } else if(data[i] == '>'){
+                    break;
+                }
+            }
+            if(i == size)
+                throw POGReaderException("Unterminated 'Proof_Obligation' start tag.");
+            int end;
+            if(data[i-1] == '/'){
+                end = i + 1;
+            } else {
+                int e = document.indexOf(endTag,i);
+                if(e < 0)
+                    throw POGReaderException("Missing end tag of 'Proof_Obligation' element.");
+                int gt = document.indexOf('>',e + endLen);
+                if(gt < 0)
+                    throw POGReaderException("Unterminated 'Proof_Obligation' end tag.");
+                end = gt + 1;
+            }
+            res.push_back({static_cast<size_t>(pos),static_cast<size_t>(end)});
+            pos = end;
+        }
+        return res;
+    }
+
+    // Moves to the next child element of the current element.
+    // Returns false when the end element of the current element is reached.
+    static bool nextChild(QXmlStreamReader &stream){
+        if(stream.readNextStartElement())
+            return true;
+        if(stream.hasError())
+            throw POGReaderException(stream.errorString().toStdString());
+        return false;
+    }
+
+    static void expectChild(QXmlStreamReader &stream, const QString &tagName){
+        if(!nextChild(stream))
+            throw POGReaderException("Missing child element in '" + tagName.toStdString() + "'.");
+    }
+
+    static Pred readWrappedPredicate(QXmlStreamReader &stream, const std::vector<BType> &typeInfos){
+        expectChild(stream,stream.name().toString());
+        Pred p = readPredicate(stream,typeInfos);
+        stream.skipCurrentElement();
+        return p;
+    }
+
+    static ProofObligation::SimpleGoal readSimpleGoal(QXmlStreamReader &stream, const std::vector<BType> &typeInfos){
+        std::vector<unsigned int> refHyps;
+        while(nextChild(stream)){
+            if(stream.name() == "Ref_Hyp"){
+                refHyps.push_back(stream.attributes().value("num").toUInt());
+                stream.skipCurrentElement();
+            } else if(stream.name() == "Goal"){
+                expectChild(stream,"Goal");
+                GPred goal = readGPredicate(stream,typeInfos);
+                stream.skipCurrentElement(); // Goal
+                stream.skipCurrentElement(); // Simple_Goal
+                return {std::move(refHyps),std::move(goal)};
+            } else {
+                stream.skipCurrentElement();
+            }
+        }
+        throw POGReaderException("Missing child 'Goal' in 'Simple_Goal' element.");
+    }
+
+    // The stream is on the start element; on return it is on the matching end element
+    static ProofObligation readProofObligation(QXmlStreamReader &stream, const std::vector<BType> &typeInfos){
+        ProofObligation res;
+        while(nextChild(stream)){
+            if(stream.name() == "Definition"){
+                res.definitions.push_back(stream.attributes().value("name").toString().toStdString());
+                stream.skipCurrentElement();
+            } else if(stream.name() == "Hypothesis"){
+                res.hypotheses.push_back(readWrappedPredicate(stream,typeInfos));
+            } else if(stream.name() == "Local_Hyp"){
+                res.localHypotheses.push_back(readWrappedPredicate(stream,typeInfos));
+            } else if(stream.name() == "Simple_Goal"){
+                res.goals.push_back(readSimpleGoal(stream,typeInfos));
+            } else {
+                stream.skipCurrentElement();
+            }
+        }
+        return res;
+    }
+
+    ProofObligation readProofObligation(const QByteArray &element, const std::vector<BType> &typeInfos){
+        QXmlStreamReader stream(element);
+        if(!stream.readNextStartElement())
+            throw POGReaderException(stream.errorString().toStdString());
+        return readProofObligation(stream,typeInfos);
+    }
+
+    /* True if the document can be split: the slices are parsed as UTF-8, and
+     * split() does not recognize the markup of comments and CDATA sections. */
+    static bool splittable(const QByteArray &document){
+        if(document.size() >= 2){
+            const unsigned char b0 = document[0];
+            const unsigned char b1 = document[1];
+            if((b0 == 0xfe && b1 == 0xff) || (b0 == 0xff && b1 == 0xfe))
+                return false; // UTF-16
+        }
+        if(document.startsWith("<?xml")){
+            const int end = document.indexOf("?>");
+            const QByteArray decl = document.left(end < 0 ? 0 : end);
+            const int enc = decl.indexOf("encoding");
+            if(enc >= 0){
+                const int q = decl.indexOf('=',enc);
+                QByteArray value = decl.mid(q + 1).trimmed();
+                if(!value.isEmpty() && (value[0] == '"' || value[0] == '\'')){
+                    const int close = value.indexOf(value[0],1);
+                    value = value.mid(1,close < 0 ? -1 : close - 1);
+                }
+                const QByteArray name = value.toLower();
+                if(name != "utf-8" && name != "utf8" && name != "us-ascii")
+                    return false;
+            }
+        }
+        return document.indexOf("<!--") < 0 && document.indexOf("<![CDATA[") < 0;
+    }
+
+    // For the documents that cannot be split: one stream over the whole document
+    static std::vector<ProofObligation> readSequentially(const QByteArray &document, const std::vector<BType> &typeInfos){
+        QXmlStreamReader stream(document);
+        if(!stream.readNextStartElement())
+            throw POGReaderException(stream.errorString().toStdString());
+        std::vector<ProofObligation> res;
+        while(nextChild(stream)){
+            if(stream.name() == QLatin1String("Proof_Obligation")){
+                try {
+                    res.push_back(readProofObligation(stream,typeInfos));
+                } catch(const std::exception &e) {
+                    throw POGReaderException("Proof obligation " + std::to_string(res.size() + 1) + ": " + e.what());
+                }
+            } else {
+                stream.skipCurrentElement();
+            }
+        }
+        return res;
+    }
+
+    std::vector<ProofObligation> readProofObligations(const QByteArray &document,
+            const std::vector<BType> &typeInfos, unsigned int workers, ReaderCache *cache)
+    {
+        // The calling thread runs a worker too: its nodes must not go to its arena
+        Arena::Suspend noArena;
+        if(!splittable(document))
+            return readSequentially(document,typeInfos);
+        const std::vector<Chunk> chunks = split(document);
+        std::vector<ProofObligation> res(chunks.size());
+        if(workers == 0)
+            workers = std::max(1u,std::thread::hardware_concurrency());
+        if(workers > chunks.size())
+            workers = chunks.size();
+
+        // The threads take the proof obligations in order. The first error
+        // (in document order) is reported once every thread has stopped.
+        std::atomic<size_t> next{0};
+        std::atomic<bool> failed{false};
+        std::mutex mutex;
+        size_t errorIndex = chunks.size();
+        std::string error;
+        auto work = [&](){
+            while(!failed.load(std::memory_order_relaxed)){
+                size_t i = next.fetch_add(1,std::memory_order_relaxed);
+                if(i >= chunks.size())
+                    return;
+                std::string what;
+                try {
+                    const QByteArray element = QByteArray::fromRawData(document.constData() + chunks[i].begin,
+                            chunks[i].end - chunks[i].begin);
+                    res[i] = (cache != nullptr) ? cache->readProofObligation(element,typeInfos)
+                        : readProofObligation(element,typeInfos);
+                    continue;
+                } catch(const std::exception &e) {
+                    what = e.what();
+                } catch(...) {
+                    what = "Unknown error.";
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                if(i < errorIndex){
+                    errorIndex = i;
+                    error = what;
+                }
+                failed.store(true,std::memory_order_relaxed);
+            }
+        };
+        std::vector<std::thread> threads;
+        for(unsigned int i=1;i<workers;i++)
+            threads.emplace_back(work);
+        work();
+        for(auto &t : threads)
+            t.join();
+
+        if(errorIndex < chunks.size())
+            throw POGReaderException("Proof obligation " + std::to_string(errorIndex + 1) + ": " + error);
+        return res;
+    }
+}
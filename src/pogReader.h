@@ -0,0 +1,66 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef POGREADER_H
+#define POGREADER_H
+
+#include "pred.h"
+#include "gpred.h"
+#include<QByteArray>
+
+namespace Xml {
+    class ReaderCache;
+
+    class POGReaderException : public std::exception
+    {
+        public:
+            POGReaderException(const std::string desc):description{desc}{};
+            ~POGReaderException() throw() {};
+            const char *what() const throw(){ return description.c_str(); };
+        private:
+            std::string description;
+    };
+
+    // Content of a Proof_Obligation element of a POG document
+    struct ProofObligation {
+        struct SimpleGoal {
+            std::vector<unsigned int> refHyps; // 'num' attributes of the Ref_Hyp elements
+            GPred goal;
+        };
+        std::vector<std::string> definitions; // 'name' attributes of the Definition elements
+        std::vector<Pred> hypotheses;
+        std::vector<Pred> localHypotheses; // in document order, Local_Hyp number i is at index i-1
+        std::vector<SimpleGoal> goals;
+    };
+
+    // Reads a single Proof_Obligation element, given as the UTF-8 bytes of the element
+    ProofObligation readProofObligation(const QByteArray &element, const std::vector<BType> &typeInfos);
+
+    /* Reads the Proof_Obligation elements of a POG document, in document order.
+     * The proof obligations are independent: the document is split at their
+     * boundaries and they are parsed by 'workers' threads (0 for one thread per
+     * core). The other top-level elements (Define, TypeInfos...) are ignored.
+     * The slices are parsed as UTF-8 and split() does not recognize comments
+     * nor CDATA sections: a document with another encoding, a comment or a
+     * CDATA section is parsed by a single stream, on the calling thread and
+     * without cache. The interned names, tags and types are shared by the
+     * threads; the nodes are never allocated in an arena, even if the caller
+     * has one installed. With a cache, the proof obligations found
+     * in it are loaded instead of parsed, and the others are added to it. */
+    std::vector<ProofObligation> readProofObligations(const QByteArray &document,
+            const std::vector<BType> &typeInfos, unsigned int workers = 0, ReaderCache *cache = nullptr);
+}
+
+#endif // POGREADER_H
@@ -0,0 +1,130 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "pogWriter.h"
+#include "predWriter.h"
+#include "gpredWriter.h"
+
+namespace Xml {
+
+    // Types are written as the expressions denoting them
+    class TypeWriterVisitor : public BType::Visitor {
+        public:
+            void visitINTEGER(){ writeId("INTEGER"); };
+            void visitBOOLEAN(){ writeId("BOOL"); };
+            void visitFLOAT(){ writeId("FLOAT"); };
+            void visitREAL(){ writeId("REAL"); };
+            void visitSTRING(){ writeId("STRING"); };
+            void visitProductType(const BType &lhs, const BType &rhs){
+                stream.writeStartElement("Binary_Exp");
+                stream.writeAttribute("op","*");
+                lhs.accept(*this);
+                rhs.accept(*this);
+                stream.writeEndElement(); // Binary_Exp
+            };
+            void visitPowerType(const BType &ty){
+                stream.writeStartElement("Unary_Exp");
+                stream.writeAttribute("op","POW");
+                ty.accept(*this);
+                stream.writeEndElement(); // Unary_Exp
+            };
+            void visitRecordType(const std::vector<std::pair<std::string,BType>> &fields){
+                stream.writeStartElement("Struct");
+                for(auto &f : fields){
+                    stream.writeStartElement("Record_Item");
+                    stream.writeAttribute("label",QString::fromStdString(f.first));
+                    f.second.accept(*this);
+                    stream.writeEndElement(); // Record_Item
+                }
+                stream.writeEndElement(); // Struct
+            };
+            TypeWriterVisitor(QXmlStreamWriter &s):stream{s}{};
+        private:
+            QXmlStreamWriter &stream;
+            void writeId(const char *value){
+                stream.writeEmptyElement("Id");
+                stream.writeAttribute("value",value);
+            }
+    };
+
+    void writeTypeInfos(QXmlStreamWriter &stream, const std::map<BType,unsigned int> &typeInfos){
+        std::vector<const BType*> types(typeInfos.size());
+        for(auto &t : typeInfos)
+            types[t.second] = &t.first;
+        TypeWriterVisitor v(stream);
+        stream.writeStartElement("TypeInfos");
+        for(size_t i=0;i<types.size();i++){
+            stream.writeStartElement("Type");
+            stream.writeAttribute("id",QString::number(i));
+            types[i]->accept(v);
+            stream.writeEndElement(); // Type
+        }
+        stream.writeEndElement(); // TypeInfos
+    }
+
+    POGWriter::POGWriter(QIODevice *device):
+        stream{device}
+    {
+        start();
+    }
+
+    POGWriter::POGWriter(QByteArray *array):
+        stream{array}
+    {
+        start();
+    }
+
+    void POGWriter::start(){
+        stream.writeStartDocument();
+        stream.writeStartElement("Proof_Obligations");
+    }
+
+    void POGWriter::writeProofObligation(const ProofObligation &po){
+        stream.writeStartElement("Proof_Obligation");
+        for(auto &d : po.definitions){
+            stream.writeEmptyElement("Definition");
+            stream.writeAttribute("name",QString::fromStdString(d));
+        }
+        for(auto &h : po.hypotheses){
+            stream.writeStartElement("Hypothesis");
+            writePredicate(stream,typeInfos,h);
+            stream.writeEndElement(); // Hypothesis
+        }
+        for(size_t i=0;i<po.localHypotheses.size();i++){
+            stream.writeStartElement("Local_Hyp");
+            stream.writeAttribute("num",QString::number(i+1));
+            writePredicate(stream,typeInfos,po.localHypotheses[i]);
+            stream.writeEndElement(); // Local_Hyp
+        }
+        for(auto &g : po.goals){
+            stream.writeStartElement("Simple_Goal");
+            for(auto num : g.refHyps){
+                stream.writeEmptyElement("Ref_Hyp");
+                stream.writeAttribute("num",QString::number(num));
+            }
+            stream.writeStartElement("Goal");
+            writeGPredicate(stream,typeInfos,g.goal);
+            stream.writeEndElement(); // Goal
+            stream.writeEndElement(); // Simple_Goal
+        }
+        stream.writeEndElement(); // Proof_Obligation
+    }
+
+    void POGWriter::finish(){
+        writeTypeInfos(stream,typeInfos);
+        stream.writeEndElement(); // Proof_Obligations
+        stream.writeEndDocument();
+    }
+}
@@ -0,0 +1,50 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef POGWRITER_H
+#define POGWRITER_H
+
+#include "pogReader.h"
+#include <QXmlStreamWriter>
+
+namespace Xml {
+    /* Writes the TypeInfos element: one Type element per entry of typeInfos,
+     * in the order of their numbers. */
+    void writeTypeInfos(QXmlStreamWriter &stream, const std::map<BType,unsigned int> &typeInfos);
+
+    /* Streaming writer of POG documents, read back by readProofObligations.
+     * Each proof obligation is written when it is given, so that the memory
+     * used does not depend on the number of proof obligations: the only state
+     * kept is the table of the types referenced so far, which is written as the
+     * TypeInfos trailer by finish(). */
+    class POGWriter {
+        public:
+            // Constructor
+            POGWriter(QIODevice *device);
+            POGWriter(QByteArray *array);
+            // Methods
+            void writeProofObligation(const ProofObligation &po);
+            // Writes the TypeInfos element and ends the document
+            void finish();
+            // The types referenced so far, with their typref numbers
+            const std::map<BType,unsigned int>& getTypeInfos() const { return typeInfos; }
+        private:
+            QXmlStreamWriter stream;
+            std::map<BType,unsigned int> typeInfos;
+            void start();
+    };
+}
+
+#endif // POGWRITER_H
@@ -13,23 +13,68 @@
    along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include "pred.h"
 #include "predDesc.h"
 
-void Pred::getAllVars(std::set<VarName> &accu) const {
-    desc->getAllVars(accu);
+Pred::~Pred(){
+    // The sub-predicates of a desc owned by this predicate alone are moved to
+    // an explicit stack and destroyed one at a time
+    if(desc == nullptr || desc.use_count() != 1)
+        return;
+    std::vector<Pred> todo;
+    desc->release(todo);
+    while(!todo.empty()){
+        Pred p = std::move(todo.back());
+        todo.pop_back();
+        if(p.desc != nullptr && p.desc.use_count() == 1){
+            p.desc->release(todo);
+            p.desc.reset();
+        }
+    }
+}
+template<typename F> void Pred::forEachScopeLeaf(F f) const {
+    std::vector<const Pred*> todo {this};
+    while(!todo.empty()){
+        const Pred *p = todo.back();
+        todo.pop_back();
+        size_t n = todo.size();
+        p->desc->getChildren(todo);
+        if(todo.size() == n)
+            f(*p);
+    }
+}
+void Pred::getAllVars(VarSet &accu) const {
+    forEachScopeLeaf([&](const Pred &p){ p.desc->getAllVars(accu); });
 }
 void Pred::substFreshId(const std::string &id, const VarName &v){
+    detach();
     desc->substFreshId(id,v);
 }
+const std::vector<VarName>& Pred::freeVars() const {
+    return desc->freeVars.get([this](){
+            std::set<VarName> fv;
+            forEachScopeLeaf([&](const Pred &p){ p.desc->getFreeVars({},fv); });
+            return fv; });
+}
 void Pred::getFreeVars(const std::set<VarName> &boundVars, const std::set<VarName> &freeVars, std::set<VarName>& freeVarsThis) const {
-    desc->getFreeVars(boundVars,freeVars,freeVarsThis);
+    for(auto &v : this->freeVars()){
+        if(boundVars.find(v) == boundVars.end() && freeVars.find(v) == freeVars.end())
+            freeVarsThis.insert(freeVarsThis.end(),v);
+    }
 }
 void Pred::getFreeVars(const std::set<VarName> &boundVars, std::set<VarName> &accu) const {
-    desc->getFreeVars(boundVars,accu);
+    for(auto &v : freeVars()){
+        if(boundVars.find(v) == boundVars.end())
+            accu.insert(accu.end(),v);
+    }
+}
+void Pred::getFreeVars(VarSet &accu) const {
+    auto &fv = freeVars();
+    accu.insert(fv.begin(),fv.end());
 }
 void Pred::getFreeTVars(const std::set<VarName> &boundVars, std::set<TypedVar> &accu) const {
-    desc->getFreeTVars(boundVars,accu);
+    forEachScopeLeaf([&](const Pred &p){ p.desc->getFreeTVars(boundVars,accu); });
 }
 Pred Pred::makeImplication(Pred &&lhs, Pred &&rhs, const std::string &goalTag){
     return Pred(new Implication(std::move(lhs),std::move(rhs)),goalTag);
@@ -71,12 +116,42 @@ void Pred::accept(Visitor &visitor) const {
     desc->accept(visitor);
 };
 void Pred::subst(const std::map<VarName,Expr> &map) {
-    if(!map.empty())
-        desc->subst(map);
+    if(!map.empty()){
+        SubstEnv env(map);
+        subst(env);
+    }
+};
+void Pred::subst(SubstEnv &env) {
+    if(env.empty())
+        return;
+    // Same as Expr::subst: the operands of the connectives are substituted
+    // with an explicit stack, in the order of the recursion
+    std::vector<const Pred*> todo {this};
+    while(!todo.empty()){
+        // p is reached from this through detached descs, which it does not share
+        Pred *p = const_cast<Pred*>(todo.back());
+        todo.pop_back();
+        p->detach();
+        size_t n = todo.size();
+        p->desc->getChildren(todo);
+        if(todo.size() == n)
+            p->desc->subst(env);
+        else
+            std::reverse(todo.begin() + n,todo.end());
+    }
 };
 void Pred::alpha(const std::map<VarName,VarName> &map) {
+    detach();
     desc->alpha(map);
 };
+void Pred::detach(){
+    if(desc.use_count() > 1){
+        desc = std::shared_ptr<PredDesc>(desc->copy());
+    } else {
+        desc->cachedHash.reset();
+        desc->freeVars.reset();
+    }
+}
 const Pred::Implication& Pred::toImplication() const {
     assert(desc->tag() == PKind::Implication);
     return static_cast<Implication&>(*desc);
@@ -111,40 +186,51 @@ const Pred::Exists& Pred::toExists() const {
 };
 Pred::Implication& Pred::toImplication() {
     assert(desc->tag() == PKind::Implication);
+    detach();
     return static_cast<Implication&>(*desc);
 };
 Pred::Equivalence& Pred::toEquivalence() {
     assert(desc->tag() == PKind::Equivalence);
+    detach();
     return static_cast<Equivalence&>(*desc);
 };
 Pred::ExprComparison& Pred::toExprComparison() {
     assert(desc->tag() == PKind::ExprComparison);
+    detach();
     return static_cast<ExprComparison&>(*desc);
 };
 Pred::NegationPred& Pred::toNegation(){
     assert(desc->tag() == PKind::Negation);
+    detach();
     return static_cast<NegationPred&>(*desc);
 };
 Pred::Conjunction& Pred::toConjunction(){
     assert(desc->tag() == PKind::Conjunction);
+    detach();
     return static_cast<Conjunction&>(*desc);
 };
 Pred::Disjunction& Pred::toDisjunction(){
     assert(desc->tag() == PKind::Disjunction);
+    detach();
     return static_cast<Disjunction&>(*desc);
 };
 Pred::Forall& Pred::toForall(){
     assert(desc->tag() == PKind::Forall);
+    detach();
     return static_cast<Forall&>(*desc);
 };
 Pred::Exists& Pred::toExists(){
     assert(desc->tag() == PKind::Exists);
+    detach();
     return static_cast<Exists&>(*desc);
 };
 
 Pred::PKind Pred::getTag() const { return desc->tag(); }
 
-int Pred::compare(const Pred &p1, const Pred& p2){
+/* Compares the root nodes of p1 and p2, and pushes the pairs of sub-predicates
+ * to compare next in reverse order. Pred::compare pops them in the order of the
+ * recursive definition: the first difference found is the same. */
+static int compareNode(const Pred &p1, const Pred& p2, std::vector<std::pair<const Pred*,const Pred*>> &todo){
     if(p1.getTag() == p2.getTag()){
         switch(p1.getTag()){
             case Pred::PKind::True:
@@ -154,27 +240,24 @@ int Pred::compare(const Pred &p1, const Pred& p2){
                 {
                     auto &u1 = p1.toNegation();
                     auto &u2 = p2.toNegation();
-                    return compare(u1.operand, u2.operand);
+                    todo.push_back({&u1.operand,&u2.operand});
+                    return 0;
                 }
             case Pred::PKind::Implication:
                 {
                     auto &b1 = p1.toImplication();
                     auto &b2 = p2.toImplication();
-                    int res = compare(b1.lhs, b2.lhs);
-                    if(res == 0)
-                        return compare(b1.rhs, b2.rhs);
-                    else
-                        return res;
+                    todo.push_back({&b1.rhs,&b2.rhs});
+                    todo.push_back({&b1.lhs,&b2.lhs});
+                    return 0;
                 }
             case Pred::PKind::Equivalence:
                 {
                     auto &b1 = p1.toEquivalence();
                     auto &b2 = p2.toEquivalence();
-                    int res = compare(b1.lhs, b2.lhs);
-                    if(res == 0)
-                        return compare(b1.rhs, b2.rhs);
-                    else
-                        return res;
+                    todo.push_back({&b1.rhs,&b2.rhs});
+                    todo.push_back({&b1.lhs,&b2.lhs});
+                    return 0;
                 }
             case Pred::PKind::ExprComparison:
                 {
@@ -197,35 +280,39 @@ int Pred::compare(const Pred &p1, const Pred& p2){
                 {
                     auto &n1 = p1.toDisjunction();
                     auto &n2 = p2.toDisjunction();
-                    return vec_compare(n1.operands,n2.operands);
+                    if(n1.operands.size() != n2.operands.size())
+                        return (n1.operands.size() - n2.operands.size());
+                    for(size_t i=n1.operands.size();i>0;i--)
+                        todo.push_back({&n1.operands[i-1],&n2.operands[i-1]});
+                    return 0;
                 }
             case Pred::PKind::Conjunction:
                 {
                     auto &n1 = p1.toConjunction();
                     auto &n2 = p2.toConjunction();
-                    return vec_compare(n1.operands,n2.operands);
+                    if(n1.operands.size() != n2.operands.size())
+                        return (n1.operands.size() - n2.operands.size());
+                    for(size_t i=n1.operands.size();i>0;i--)
+                        todo.push_back({&n1.operands[i-1],&n2.operands[i-1]});
+                    return 0;
                 }
             case Pred::PKind::Exists:
                 {
                     auto &q1 = p1.toExists();
                     auto &q2 = p2.toExists();
                     int i = TypedVar::vec_compare(q1.vars,q2.vars);
-                    if(i == 0){
-                        return Pred::compare(q1.body,q2.body);
-                    } else {
-                        return i;
-                    }
+                    if(i == 0)
+                        todo.push_back({&q1.body,&q2.body});
+                    return i;
                 }
             case Pred::PKind::Forall:
                 {
                     auto &q1 = p1.toForall();
                     auto &q2 = p2.toForall();
                     int i = TypedVar::vec_compare(q1.vars,q2.vars);
-                    if(i == 0){
-                        return Pred::compare(q1.body,q2.body);
-                    } else {
-                        return i;
-                    }
+                    if(i == 0)
+                        todo.push_back({&q1.body,&q2.body});
+                    return i;
                 }
         }
         assert(false); // unreachable
@@ -236,6 +323,19 @@ int Pred::compare(const Pred &p1, const Pred& p2){
     }
 }
 
+int Pred::compare(const Pred &p1, const Pred& p2){
+    // Explicit stack: the depth of the predicates is not limited by the call stack
+    std::vector<std::pair<const Pred*,const Pred*>> todo;
+    todo.push_back({&p1,&p2});
+    while(!todo.empty()){
+        auto p = todo.back();
+        todo.pop_back();
+        int res = compareNode(*p.first,*p.second,todo);
+        if(res != 0) return res;
+    }
+    return 0;
+}
+
 int Pred::vec_compare(const std::vector<Pred> &lhs, const std::vector<Pred>& rhs){
        if(lhs.size() == rhs.size()){
         size_t i = 0;
@@ -252,11 +352,40 @@ int Pred::vec_compare(const std::vector<Pred> &lhs, const std::vector<Pred>& rhs
 }
 
 size_t Pred::hash_combine(size_t seed) const {
-    seed = desc->hash_combine(seed);
-    return hashUtil::hash_combine_int(static_cast<int>(desc->tag()),seed);
+    if(!desc->cachedHash.known())
+        computeHashes();
+    size_t h = desc->cachedHash.get([this](){ return nodeHash(); });
+    return hashUtil::hash_combine_hash(h,seed);
 }
 
-std::string Pred::to_string(ComparisonOp op){
+size_t Pred::nodeHash() const {
+    return hashUtil::hash_combine_int(static_cast<int>(desc->tag()),desc->hash_combine(0));
+}
+
+void Pred::computeHashes() const {
+    // The children are hashed before their parent, so desc->hash_combine only
+    // reads cached values (binders excepted, see getChildren)
+    std::vector<std::pair<const Pred*,bool>> todo; // second: children pushed
+    todo.push_back({this,false});
+    std::vector<const Pred*> children;
+    while(!todo.empty()){
+        const Pred *p = todo.back().first;
+        if(todo.back().second || p->desc->cachedHash.known()){
+            todo.pop_back();
+            p->desc->cachedHash.get([p](){ return p->nodeHash(); });
+            continue;
+        }
+        todo.back().second = true;
+        children.clear();
+        p->desc->getChildren(children);
+        for(const Pred *c : children){
+            if(!c->desc->cachedHash.known())
+                todo.push_back({c,false});
+        }
+    }
+}
+
+const char* Pred::to_chars(ComparisonOp op){
     switch(op){
         case ComparisonOp::Membership: return ":";
         case ComparisonOp::Subset: return "<:";
@@ -278,6 +407,10 @@ std::string Pred::to_string(ComparisonOp op){
     assert(false); // unreachable
 };
 
+std::string Pred::to_string(ComparisonOp op){
+    return to_chars(op);
+};
+
 std::string Pred::show() const {
     switch(desc->tag()){
         case Pred::PKind::Implication:
@@ -340,58 +473,13 @@ std::string Pred::show() const {
 }
 
 Pred Pred::copy() const {
-    switch(desc->tag()){
-        case Pred::PKind::Implication:
-            {
-                auto& b = toImplication();
-                return makeImplication(b.lhs.copy(),b.rhs.copy(),goalTag);
-            }
-        case Pred::PKind::Equivalence:
-            {
-                auto& b = toEquivalence();
-                return makeEquivalence(b.lhs.copy(),b.rhs.copy(),goalTag);
-            }
-        case Pred::PKind::ExprComparison:
-            {
-                auto& c = toExprComparison();
-                return makeExprComparison(c.op,c.lhs.copy(),c.rhs.copy(),goalTag);
-            }
-        case Pred::PKind::Negation:
-            return makeNegation(toNegation().operand.copy(),goalTag);
-        case Pred::PKind::Conjunction:
-            {
-                auto& prd = toConjunction();
-                std::vector<Pred> accu;
-                for(auto &p : prd.operands)
-                    accu.push_back(p.copy());
-                return makeConjunction(std::move(accu),goalTag);
-            }
-        case Pred::PKind::Disjunction:
-            {
-                auto& prd = toDisjunction();
-                std::vector<Pred> accu;
-                for(auto &p : prd.operands)
-                    accu.push_back(p.copy());
-                return makeDisjunction(std::move(accu),goalTag);
-            }
-        case Pred::PKind::Forall:
-            {
-                auto& q = toForall();
-                return makeForall(q.vars,q.body.copy(),goalTag);
-            }
-        case Pred::PKind::Exists:
-            {
-                auto& q = toExists();
-                return makeExists(q.vars,q.body.copy(),goalTag);
-            }
-        case Pred::PKind::True:
-            return makeTrue(goalTag);
-        case Pred::PKind::False:
-            return makeFalse(goalTag);
-    };
-    assert(false); // unreachable
+    return Pred(desc,goalTag);
 }
-bool Pred::alpha_equals(Context &ctx, const Pred& p1, const Pred& p2){
+/* Compares the root nodes of p1 and p2, and pushes the pairs of sub-predicates
+ * that are in the same scope. The bodies of the quantifiers extend ctx: they are
+ * compared by a nested call to Pred::alpha_equals. */
+static bool alphaEqualsNode(Context &ctx, const Pred& p1, const Pred& p2,
+        std::vector<std::pair<const Pred*,const Pred*>> &todo){
     if(p1.getTag() != p2.getTag())
         return false;
 
@@ -400,13 +488,17 @@ bool Pred::alpha_equals(Context &ctx, const Pred& p1, const Pred& p2){
             {
                 auto& b1 = p1.toImplication();
                 auto& b2 = p2.toImplication();
-                return alpha_equals(ctx,b1.lhs,b2.lhs) && alpha_equals(ctx,b1.rhs,b2.rhs);
+                todo.push_back({&b1.rhs,&b2.rhs});
+                todo.push_back({&b1.lhs,&b2.lhs});
+                return true;
             }
         case Pred::PKind::Equivalence:
             {
                 auto& b1 = p1.toEquivalence();
                 auto& b2 = p2.toEquivalence();
-                return alpha_equals(ctx,b1.lhs,b2.lhs) && alpha_equals(ctx,b1.rhs,b2.rhs);
+                todo.push_back({&b1.rhs,&b2.rhs});
+                todo.push_back({&b1.lhs,&b2.lhs});
+                return true;
             }
         case Pred::PKind::ExprComparison:
             {
@@ -416,7 +508,8 @@ bool Pred::alpha_equals(Context &ctx, const Pred& p1, const Pred& p2){
             }
         case Pred::PKind::Negation:
             {
-                return alpha_equals(ctx,p1.toNegation().operand,p2.toNegation().operand);
+                todo.push_back({&p1.toNegation().operand,&p2.toNegation().operand});
+                return true;
             }
 
         case Pred::PKind::Conjunction:
@@ -425,10 +518,8 @@ bool Pred::alpha_equals(Context &ctx, const Pred& p1, const Pred& p2){
                 auto& prd2 = p2.toConjunction();
                 if(prd1.operands.size() != prd2.operands.size())
                     return false;
-                for(size_t i=0;i<prd1.operands.size();i++){
-                    if(!alpha_equals(ctx,prd1.operands[i],prd2.operands[i]))
-                        return false;
-                }
+                for(size_t i=prd1.operands.size();i>0;i--)
+                    todo.push_back({&prd1.operands[i-1],&prd2.operands[i-1]});
                 return true;
             }
         case Pred::PKind::Disjunction:
@@ -437,10 +528,8 @@ bool Pred::alpha_equals(Context &ctx, const Pred& p1, const Pred& p2){
                 auto& prd2 = p2.toDisjunction();
                 if(prd1.operands.size() != prd2.operands.size())
                     return false;
-                for(size_t i=0;i<prd1.operands.size();i++){
-                    if(!alpha_equals(ctx,prd1.operands[i],prd2.operands[i]))
-                        return false;
-                }
+                for(size_t i=prd1.operands.size();i>0;i--)
+                    todo.push_back({&prd1.operands[i-1],&prd2.operands[i-1]});
                 return true;
             }
         case Pred::PKind::Forall:
@@ -469,6 +558,18 @@ bool Pred::alpha_equals(Context &ctx, const Pred& p1, const Pred& p2){
     };
     assert(false); // unreachable
 }
+bool Pred::alpha_equals(Context &ctx, const Pred& p1, const Pred& p2){
+    // Explicit stack: the depth of the predicates is not limited by the call stack
+    std::vector<std::pair<const Pred*,const Pred*>> todo;
+    todo.push_back({&p1,&p2});
+    while(!todo.empty()){
+        auto p = todo.back();
+        todo.pop_back();
+        if(!alphaEqualsNode(ctx,*p.first,*p.second,todo))
+            return false;
+    }
+    return true;
+}
 bool Pred::alpha_equals(const Pred& p1, const Pred& p2){
     Context ctx;
     return alpha_equals(ctx,p1,p2);
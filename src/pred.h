@@ -37,13 +37,27 @@ class Pred {
             Rle, Rlt, Rge, Rgt // real comparison
         };
         static std::string to_string(ComparisonOp op);
+        // Same as to_string, without allocation (static storage)
+        static const char* to_chars(ComparisonOp op);
 
         Pred():desc{nullptr}{};
+        Pred(Pred &&) = default;
+        Pred& operator=(Pred &&) = default;
+        // Iterative: the depth of the predicate is not limited by the call stack
+        ~Pred();
+        // Predicates are duplicated explicitly with copy()
+        Pred(const Pred &) = delete;
+        Pred& operator=(const Pred &) = delete;
         PKind getTag() const;
+        // The descriptor is shared with the copy (copy-on-write), so this is O(1)
         Pred copy() const;
 
-        // Capture-avoiding substitution
+        // Capture-avoiding substitution. The operands of the operators are
+        // substituted with an explicit stack; the call stack grows with the
+        // nesting of binders and of expressions in predicates
         void subst(const std::map<VarName,Expr> &map);
+        // Same as above, in the current scope of env (used by the binders)
+        void subst(SubstEnv &env);
         // Alpha renaming. The new var names must not occur (free or bound) in the expression
         void alpha(const std::map<VarName,VarName> &map);
 
@@ -91,7 +105,11 @@ class Pred {
         class Visitor;
         void accept(Visitor &v) const;
 
+        // The hash of each node is cached, so this is O(1) once computed
         size_t hash_combine(size_t seed) const;
+        // Invariant by renaming of the bound variables: alpha_equals(p1,p2)
+        // implies equal hashes. Not cached: O(size of the predicate).
+        size_t alpha_hash_combine(size_t seed) const;
         const std::string& getGoalTag() const { return goalTag; };
         void setGoalTag(const std::string &s){ goalTag = s; }
 
@@ -108,6 +126,8 @@ class Pred {
 
         void getFreeVars(const std::set<VarName> &boundVars, const std::set<VarName> &freeVars, std::set<VarName>& freeVarsThis) const;
         void getFreeVars(const std::set<VarName> &boundVars, std::set<VarName> &accu) const;
+        // Adds the identifiers occuring free in the predicate to accu
+        void getFreeVars(VarSet &accu) const;
         // Get identifiers occuring free in the expression
         std::set<VarName> getFreeVars() const {
             std::set<VarName> accu;
@@ -122,7 +142,12 @@ class Pred {
         };
 
         // Get all identifiers (free or bound) occuring in the expression
-        void getAllVars(std::set<VarName> &accu) const;
+        void getAllVars(VarSet &accu) const;
+        void getAllVars(std::set<VarName> &accu) const {
+            VarSet vars;
+            getAllVars(vars);
+            accu.insert(vars.begin(),vars.end());
+        }
         std::set<VarName> getAllVars() const {
             std::set<VarName> accu;
             getAllVars(accu);
@@ -133,31 +158,65 @@ class Pred {
 
         static bool alpha_equals(Context &ctx, const Pred& p1, const Pred& p2);
         static bool alpha_equals(const Pred& p1, const Pred& p2);
+        // Alpha-equivalence classes, e.g. std::unordered_set<Pred,Pred::AlphaHash,Pred::AlphaEqual>
+        struct AlphaHash {
+            size_t operator()(const Pred &p) const { return p.alpha_hash_combine(0); };
+        };
+        struct AlphaEqual {
+            bool operator()(const Pred &p1, const Pred &p2) const { return alpha_equals(p1,p2); };
+        };
     private:
+        friend class NodeTable;
         class PredDesc;
 
         std::string goalTag; // Used to describe the source of the goal of a proof obligation
-        std::unique_ptr<PredDesc> desc; // content of the predicate. Never null (except if default constructor is used)
+        std::shared_ptr<PredDesc> desc; // content of the predicate. Never null (except if default constructor is used). May be shared by several predicates.
         // Constructor
         Pred(PredDesc *desc, const std::string &gt):
+            goalTag{gt},
+            desc{Arena::share(desc)}
+        {};
+        Pred(const std::shared_ptr<PredDesc> &desc, const std::string &gt):
             goalTag{gt},
             desc{desc}
         {};
+        // Gives this predicate its own copy of desc before it is modified in place.
+        // Also drops the cached hash.
+        void detach();
+        // Hash of this node, from the cached hashes of its sub-predicates
+        size_t nodeHash() const;
+        // Free variables of this predicate, computed once
+        const std::vector<VarName>& freeVars() const;
+        // Fills the missing hash caches of the sub-predicates, children first
+        void computeHashes() const;
+        // Calls f on every node in the scope of this predicate that has no
+        // children for getChildren (leaves and binders), with an explicit stack
+        template<typename F> void forEachScopeLeaf(F f) const;
 };
 
-class Pred::PredDesc {
+class Pred::PredDesc : public Arena::Allocated {
     public:
         virtual ~PredDesc(){};
         virtual PKind tag() const = 0;
         virtual void accept(Visitor &visitor) const = 0;
         virtual size_t hash_combine(size_t seed) const = 0;
-        virtual void subst(const std::map<VarName,Expr> &map) = 0;
+        virtual PredDesc* copy() const = 0;
+        virtual void subst(SubstEnv &env) = 0;
         virtual void alpha(const std::map<VarName,VarName> &map) = 0;
         virtual void getFreeVars(const std::set<VarName> &boundVars, const std::set<VarName> &freeVars, std::set<VarName>& freeVarsThis) const = 0;
         virtual void getFreeVars(const std::set<VarName> &boundVars, std::set<VarName> &accu) const = 0;
-        virtual void getAllVars(std::set<VarName> &accu) const = 0;
+        virtual void getAllVars(VarSet &accu) const = 0;
                 virtual void getFreeTVars(const std::set<VarName> &bv, std::set<TypedVar> &accu) const = 0;
         virtual void substFreshId(const std::string &id, const VarName &v) = 0;
+        // Sub-predicates in the scope of this node (binders excepted),
+        // for the traversals driven by an explicit stack
+        virtual void getChildren(std::vector<const Pred*> &) const {};
+        // Moves the sub-predicates out, so that ~Pred destroys them iteratively
+        virtual void release(std::vector<Pred> &) {};
+        // Hash of the predicate, reset when desc is modified (see detach)
+        hashUtil::CachedHash cachedHash;
+        // Free variables of the predicate, reset when desc is modified
+        FreeVarsCache freeVars;
 };
 
 class Pred::Visitor {
@@ -19,6 +19,7 @@
 #include "expr.h"
 #include "pred.h"
 #include "hash.h"
+#include "substEnv.h"
 
 class Pred::Implication : public PredDesc {
     public:
@@ -31,14 +32,25 @@ class Pred::Implication : public PredDesc {
         Pred lhs;
         Pred rhs;
         // Methods
+        void getChildren(std::vector<const Pred*> &children) const {
+            children.push_back(&lhs);
+            children.push_back(&rhs);
+        }
+        void release(std::vector<Pred> &children) {
+            children.push_back(std::move(lhs));
+            children.push_back(std::move(rhs));
+        }
         PKind tag() const { return PKind::Implication; }
         void accept(Visitor &v) const { v.visitImplication(lhs,rhs); };
         size_t hash_combine(size_t seed) const {
             return lhs.hash_combine(rhs.hash_combine(seed));
         }
-        void subst(const std::map<VarName,Expr> &map) {
-            lhs.subst(map);
-            rhs.subst(map);
+        Implication* copy() const {
+            return new Implication(lhs.copy(),rhs.copy());
+        }
+        void subst(SubstEnv &env) {
+            lhs.subst(env);
+            rhs.subst(env);
         };
         void alpha(const std::map<VarName,VarName> &map) {
             lhs.alpha(map);
@@ -56,7 +68,7 @@ class Pred::Implication : public PredDesc {
             lhs.getFreeTVars(boundVars,accu);
             rhs.getFreeTVars(boundVars,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             lhs.getAllVars(accu);
             rhs.getAllVars(accu);
         }
@@ -76,14 +88,25 @@ class Pred::Equivalence : public PredDesc {
         Pred lhs;
         Pred rhs;
         // Methods
+        void getChildren(std::vector<const Pred*> &children) const {
+            children.push_back(&lhs);
+            children.push_back(&rhs);
+        }
+        void release(std::vector<Pred> &children) {
+            children.push_back(std::move(lhs));
+            children.push_back(std::move(rhs));
+        }
         PKind tag() const { return PKind::Equivalence; }
         void accept(Visitor &v) const { v.visitEquivalence(lhs,rhs); };
         size_t hash_combine(size_t seed) const {
             return lhs.hash_combine(rhs.hash_combine(seed));
         }
-        void subst(const std::map<VarName,Expr> &map) {
-            lhs.subst(map);
-            rhs.subst(map);
+        Equivalence* copy() const {
+            return new Equivalence(lhs.copy(),rhs.copy());
+        }
+        void subst(SubstEnv &env) {
+            lhs.subst(env);
+            rhs.subst(env);
         };
         void alpha(const std::map<VarName,VarName> &map) {
             lhs.alpha(map);
@@ -97,7 +120,7 @@ class Pred::Equivalence : public PredDesc {
             lhs.getFreeVars(boundVars,accu);
             rhs.getFreeVars(boundVars,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             lhs.getAllVars(accu);
             rhs.getAllVars(accu);
         }
@@ -130,9 +153,12 @@ class Pred::ExprComparison : public PredDesc {
                     lhs.hash_combine(
                         rhs.hash_combine(seed)));
         }
-        void subst(const std::map<VarName,Expr> &map) {
-            lhs.subst(map);
-            rhs.subst(map);
+        ExprComparison* copy() const {
+            return new ExprComparison(op,lhs.copy(),rhs.copy());
+        }
+        void subst(SubstEnv &env) {
+            lhs.subst(env);
+            rhs.subst(env);
         };
         void alpha(const std::map<VarName,VarName> &map) {
             lhs.alpha(map);
@@ -146,7 +172,7 @@ class Pred::ExprComparison : public PredDesc {
             lhs.getFreeVars(boundVars,accu);
             rhs.getFreeVars(boundVars,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             lhs.getAllVars(accu);
             rhs.getAllVars(accu);
         }
@@ -168,13 +194,22 @@ class Pred::NegationPred : public PredDesc {
         // Members
         Pred operand;
         // Methods
+        void getChildren(std::vector<const Pred*> &children) const {
+            children.push_back(&operand);
+        }
+        void release(std::vector<Pred> &children) {
+            children.push_back(std::move(operand));
+        }
         PKind tag() const { return PKind::Negation; }
         void accept(Visitor &v) const { v.visitNegation(operand); };
         size_t hash_combine(size_t seed) const {
             return operand.hash_combine(seed);
         }
-        void subst(const std::map<VarName,Expr> &map) {
-            operand.subst(map);
+        NegationPred* copy() const {
+            return new NegationPred(operand.copy());
+        }
+        void subst(SubstEnv &env) {
+            operand.subst(env);
         };
         void alpha(const std::map<VarName,VarName> &map) {
             operand.alpha(map);
@@ -185,7 +220,7 @@ class Pred::NegationPred : public PredDesc {
         void getFreeVars(const std::set<VarName> &boundVars, std::set<VarName> &accu) const {
             operand.getFreeVars(boundVars,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             operand.getAllVars(accu);
         }
         void substFreshId(const std::string &id, const VarName &v){
@@ -204,6 +239,14 @@ class Pred::Conjunction : public PredDesc {
         // Members
         std::vector<Pred> operands;
         // Methods
+        void getChildren(std::vector<const Pred*> &children) const {
+            for(auto &p : operands)
+                children.push_back(&p);
+        }
+        void release(std::vector<Pred> &children) {
+            for(auto &p : operands)
+                children.push_back(std::move(p));
+        }
         PKind tag() const { return PKind::Conjunction; }
         void accept(Visitor &v) const { v.visitConjunction(operands); };
         size_t hash_combine(size_t seed) const {
@@ -211,9 +254,15 @@ class Pred::Conjunction : public PredDesc {
                 seed = p.hash_combine(seed);
             return seed;
         }
-        void subst(const std::map<VarName,Expr> &map) {
+        Conjunction* copy() const {
+            std::vector<Pred> vec;
+            for(auto &p : operands)
+                vec.push_back(p.copy());
+            return new Conjunction(std::move(vec));
+        }
+        void subst(SubstEnv &env) {
             for(auto &p : operands)
-                p.subst(map);
+                p.subst(env);
         };
         void alpha(const std::map<VarName,VarName> &map) {
             for(auto &p : operands)
@@ -227,7 +276,7 @@ class Pred::Conjunction : public PredDesc {
             for(auto &p: operands)
                 p.getFreeVars(boundVars,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &p: operands)
                 p.getAllVars(accu);
         }
@@ -250,6 +299,14 @@ class Pred::Disjunction : public PredDesc {
         // Members
         std::vector<Pred> operands;
         // Methods
+        void getChildren(std::vector<const Pred*> &children) const {
+            for(auto &p : operands)
+                children.push_back(&p);
+        }
+        void release(std::vector<Pred> &children) {
+            for(auto &p : operands)
+                children.push_back(std::move(p));
+        }
         PKind tag() const { return PKind::Disjunction; }
         void accept(Visitor &v) const { v.visitDisjunction(operands); };
         size_t hash_combine(size_t seed) const {
@@ -257,9 +314,15 @@ class Pred::Disjunction : public PredDesc {
                 seed = p.hash_combine(seed);
             return seed;
         }
-        void subst(const std::map<VarName,Expr> &map) {
+        Disjunction* copy() const {
+            std::vector<Pred> vec;
             for(auto &p : operands)
-                p.subst(map);
+                vec.push_back(p.copy());
+            return new Disjunction(std::move(vec));
+        }
+        void subst(SubstEnv &env) {
+            for(auto &p : operands)
+                p.subst(env);
         };
         void alpha(const std::map<VarName,VarName> &map) {
             for(auto &p : operands)
@@ -273,7 +336,7 @@ class Pred::Disjunction : public PredDesc {
             for(auto &p: operands)
                 p.getFreeVars(boundVars,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &p: operands)
                 p.getAllVars(accu);
         }
@@ -298,6 +361,9 @@ class Pred::Forall : public PredDesc {
         std::vector<TypedVar> vars;
         Pred body;
         // Methods
+        void release(std::vector<Pred> &children) {
+            children.push_back(std::move(body));
+        }
         PKind tag() const { return PKind::Forall; }
         void accept(Visitor &v) const { v.visitForall(vars,body); };
         size_t hash_combine(size_t seed) const {
@@ -305,22 +371,20 @@ class Pred::Forall : public PredDesc {
                 seed = v.hash_combine(seed);
             return body.hash_combine(seed);
         }
-        void subst(const std::map<VarName,Expr> &map) {
-            std::map<VarName,Expr> map2;
-            for(auto &p : map)
-                map2[p.first] = p.second.copy();
-            for(auto &v : vars)
-                map2.erase(v.name);
-            std::set<VarName> freeVars;
-            for(auto &p : map)
-                p.second.getFreeVars({},freeVars);
-            if(Expr::isRenamingNeeded(vars,freeVars)){
-                body.getAllVars(freeVars);
-                Expr::renameVars(vars,freeVars,map2);
-                body.subst(map2);
-            } else if(!map2.empty()){
-                body.subst(map2);
+        Forall* copy() const {
+            return new Forall(vars,body.copy());
+        }
+        void subst(SubstEnv &env) {
+            env.push(vars);
+            if(env.captures(vars)){
+                VarSet avoid;
+                body.getAllVars(avoid);
+                env.rename(vars,avoid);
+            }
+            if(!env.empty()){
+                body.subst(env);
             }
+            env.pop();
         };
         void alpha(const std::map<VarName,VarName> &map) {
             std::map<VarName,VarName> map2 { map };
@@ -343,7 +407,7 @@ class Pred::Forall : public PredDesc {
                 boundVars2.insert(v.name);
             body.getFreeVars(boundVars2,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &v : vars)
                 accu.insert(v.name);
             body.getAllVars(accu);
@@ -380,6 +444,9 @@ class Pred::Exists : public PredDesc {
         Pred body;
         const bool allowWitnessInstanciation;
         // Methods
+        void release(std::vector<Pred> &children) {
+            children.push_back(std::move(body));
+        }
         PKind tag() const { return PKind::Exists; }
         void accept(Visitor &v) const { v.visitExists(vars,body); };
         size_t hash_combine(size_t seed) const {
@@ -389,22 +456,20 @@ class Pred::Exists : public PredDesc {
                     allowWitnessInstanciation? 1 : 0,
                     body.hash_combine(seed));
         }
-        void subst(const std::map<VarName,Expr> &map) {
-            std::map<VarName,Expr> map2;
-            for(auto &p : map)
-                map2[p.first] = p.second.copy();
-            for(auto &v : vars)
-                map2.erase(v.name);
-            std::set<VarName> freeVars;
-            for(auto &p : map)
-                p.second.getFreeVars({},freeVars);
-            if(Expr::isRenamingNeeded(vars,freeVars)){
-                body.getAllVars(freeVars);
-                Expr::renameVars(vars,freeVars,map2);
-                body.subst(map2);
-            } else if(!map2.empty()){
-                body.subst(map2);
+        Exists* copy() const {
+            return new Exists(vars,body.copy(),allowWitnessInstanciation);
+        }
+        void subst(SubstEnv &env) {
+            env.push(vars);
+            if(env.captures(vars)){
+                VarSet avoid;
+                body.getAllVars(avoid);
+                env.rename(vars,avoid);
+            }
+            if(!env.empty()){
+                body.subst(env);
             }
+            env.pop();
         };
         void alpha(const std::map<VarName,VarName> &map) {
             std::map<VarName,VarName> map2 { map };
@@ -427,7 +492,7 @@ class Pred::Exists : public PredDesc {
                 boundVars2.insert(v.name);
             body.getFreeVars(boundVars2,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &v : vars)
                 accu.insert(v.name);
             body.getAllVars(accu);
@@ -457,11 +522,14 @@ class Pred::True : public PredDesc {
         size_t hash_combine(size_t seed) const {
             return seed;
         }
-        void subst(const std::map<VarName,Expr> &map) { };
+        True* copy() const {
+            return new True();
+        }
+        void subst(SubstEnv &env) { };
         void alpha(const std::map<VarName,VarName> &map) { };
         void getFreeVars(const std::set<VarName> &boundVars, const std::set<VarName> &freeVars, std::set<VarName>& freeVarsThis) const {}
         void getFreeVars(const std::set<VarName> &boundVars, std::set<VarName> &accu) const {}
-        void getAllVars(std::set<VarName> &accu) const {}
+        void getAllVars(VarSet &accu) const {}
         void substFreshId(const std::string &id, const VarName &v){}
         void getFreeTVars(const std::set<VarName> &boundVars, std::set<TypedVar> &accu) const { }
 };
@@ -476,11 +544,14 @@ class Pred::False : public PredDesc {
         size_t hash_combine(size_t seed) const {
             return seed;
         }
-        void subst(const std::map<VarName,Expr> &map) { };
+        False* copy() const {
+            return new False();
+        }
+        void subst(SubstEnv &env) { };
         void alpha(const std::map<VarName,VarName> &map) { };
         void getFreeVars(const std::set<VarName> &boundVars, const std::set<VarName> &freeVars, std::set<VarName>& freeVarsThis) const {}
         void getFreeVars(const std::set<VarName> &boundVars, std::set<VarName> &accu) const {}
-        void getAllVars(std::set<VarName> &accu) const {}
+        void getAllVars(VarSet &accu) const {}
         void substFreshId(const std::string &id, const VarName &v){}
         void getFreeTVars(const std::set<VarName> &boundVars, std::set<TypedVar> &accu) const { }
 };
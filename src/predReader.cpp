@@ -15,18 +15,18 @@
 
 #include "exprReader.h"
 #include "predReader.h"
-#include <map>
+#include "xmlTags.h"
 
 namespace Xml {
-    const std::map<std::string, Pred::PKind> ptags = {
+    constexpr auto ptags = makeStrTable<Pred::PKind>({
         {"Binary_Pred", Pred::PKind::Implication},
         {"Exp_Comparison", Pred::PKind::ExprComparison},
         {"Quantified_Pred", Pred::PKind::Forall},
         {"Unary_Pred", Pred::PKind::Negation},
         {"Nary_Pred", Pred::PKind::Conjunction},
-    };
+    });
 
-    const std::map<std::string, Pred::ComparisonOp> comparisonOp = {
+    constexpr StrTable<Pred::ComparisonOp,16> comparisonOp = makeStrTable<Pred::ComparisonOp>({
                 {":", Pred::ComparisonOp::Membership},
         {"<:",Pred::ComparisonOp::Subset},
         {"<<:",Pred::ComparisonOp::Strict_Subset},
@@ -43,7 +43,7 @@ namespace Xml {
         {">f",Pred::ComparisonOp::Fgt},
         {"<f",Pred::ComparisonOp::Flt},
         {"<=f",Pred::ComparisonOp::Fle},
-    };
+    });
 
     Pred readPredicate(const QDomElement &dom, const std::vector<BType> &typeInfos){
         if (dom.isNull())
@@ -51,23 +51,23 @@ namespace Xml {
 
         QString tagName = dom.tagName();
 
-        if(tagName == "Tag")
+        if(tagName == QLatin1String("Tag"))
             return readPredicate(dom.firstChildElement(),typeInfos);
 
-        auto it = ptags.find(tagName.toStdString());
-        if(it == ptags.end())
+        auto it = find(ptags,tagName);
+        if(it == nullptr)
             throw PredReaderException("Unexpected tag '" + tagName.toStdString() + "'.");
 
-        switch(it->second){
+        switch(it->value){
             case Pred::PKind::Implication:
             case Pred::PKind::Equivalence:
                 {
                     QString op = dom.attribute("op");
                     QDomElement fst = dom.firstChildElement();
                     QDomElement snd = fst.nextSiblingElement();
-                    if(op == "=>"){
+                    if(op == QLatin1String("=>")){
                         return Pred::makeImplication(readPredicate(fst,typeInfos),readPredicate(snd,typeInfos));
-                    } else if(op == "<=>"){
+                    } else if(op == QLatin1String("<=>")){
                         return Pred::makeEquivalence(readPredicate(fst,typeInfos),readPredicate(snd,typeInfos));
                     } else {
                         throw PredReaderException
@@ -77,28 +77,28 @@ namespace Xml {
             case Pred::PKind::ExprComparison:
                 {
                     QString op = dom.attribute("op");
-                    auto it = comparisonOp.find(op.toStdString());
+                    auto it = find(comparisonOp,op);
                     QDomElement fst = dom.firstChildElement();
                     QDomElement snd = fst.nextSiblingElement();
-                    if(it != comparisonOp.end())
+                    if(it != nullptr)
                         return Pred::makeExprComparison
-                            (it->second,readExpression(fst,typeInfos),readExpression(snd,typeInfos));
-                    if (op == "/:")
+                            (it->value,readExpression(fst,typeInfos),readExpression(snd,typeInfos));
+                    if (op == QLatin1String("/:"))
                         return Pred::makeNegation (Pred::makeExprComparison
                                 (Pred::ComparisonOp::Membership,
                                  readExpression(fst,typeInfos),
                                  readExpression(snd,typeInfos)));
-                    if (op == "/<:")
+                    if (op == QLatin1String("/<:"))
                         return Pred::makeNegation (Pred::makeExprComparison
                                 (Pred::ComparisonOp::Subset,
                                  readExpression(fst,typeInfos),
                                  readExpression(snd,typeInfos)));
-                    if (op == "/<<:")
+                    if (op == QLatin1String("/<<:"))
                         return Pred::makeNegation (Pred::makeExprComparison
                                 (Pred::ComparisonOp::Strict_Subset,
                                  readExpression(fst,typeInfos),
                                  readExpression(snd,typeInfos)));
-                    if (op == "/=")
+                    if (op == QLatin1String("/="))
                         return Pred::makeNegation (Pred::makeExprComparison
                                 (Pred::ComparisonOp::Equality,
                                  readExpression(fst,typeInfos),
@@ -122,10 +122,10 @@ namespace Xml {
                         vec.push_back(VarNameFromId(ce,typeInfos));
                     }
 
-                    if(op == "!"){
+                    if(op == QLatin1String("!")){
                         return Pred::makeForall(vec,
                                 readPredicate(dom.firstChildElement("Body").firstChildElement(),typeInfos));
-                    } else if (op == "#"){
+                    } else if (op == QLatin1String("#")){
                         return Pred::makeExists(vec,
                                 readPredicate(dom.firstChildElement("Body").firstChildElement(),typeInfos));
                     } else
@@ -135,7 +135,7 @@ namespace Xml {
             case Pred::PKind::Negation:
                 {
                     QString op = dom.attribute("op");
-                    if(op != "not")
+                    if(op != QLatin1String("not"))
                         throw PredReaderException
                             ("Unknown unary predicate operator '" + op.toStdString() + "'.");
 
@@ -153,9 +153,9 @@ namespace Xml {
                         ce = ce.nextSiblingElement();
                     }
 
-                    if(op == "&"){
+                    if(op == QLatin1String("&")){
                         return Pred::makeConjunction(std::move(vec));
-                    } else if (op == "or"){
+                    } else if (op == QLatin1String("or")){
                         return Pred::makeDisjunction(std::move(vec));
                     } else {
                         throw PredReaderException
@@ -169,4 +169,165 @@ namespace Xml {
         };
         assert(false); // unreachable
     };
+
+    Pred readPredicate(const QDomElement &dom, const std::vector<BType> &typeInfos, Arena &arena){
+        Arena::Scope scope(arena);
+        return readPredicate(dom,typeInfos);
+    }
+
+    // Moves to the next child element of the current element.
+    // Returns false when the end element of the current element is reached.
+    static bool nextChild(QXmlStreamReader &stream){
+        if(stream.readNextStartElement())
+            return true;
+        if(stream.hasError())
+            throw PredReaderException(stream.errorString().toStdString());
+        return false;
+    }
+
+    static void expectChild(QXmlStreamReader &stream, const char *tagName){
+        if(!nextChild(stream))
+            throw PredReaderException("Missing child element in '" + std::string(tagName) + "'.");
+    }
+
+    Pred readPredicate(QXmlStreamReader &stream, const std::vector<BType> &typeInfos){
+        if (!stream.isStartElement())
+            throw PredReaderException("Start element expected.");
+
+        if(stream.name() == QLatin1String("Tag")){
+            expectChild(stream,"Tag");
+            Pred p = readPredicate(stream,typeInfos);
+            stream.skipCurrentElement();
+            return p;
+        }
+
+        auto it = find(ptags,stream.name());
+        if(it == nullptr)
+            throw PredReaderException("Unexpected tag '" + stream.name().toString().toStdString() + "'.");
+        const char *tagName = it->key;
+        const QXmlStreamAttributes attrs = stream.attributes();
+
+        switch(it->value){
+            case Pred::PKind::Implication:
+            case Pred::PKind::Equivalence:
+                {
+                    const QStringRef op = attrs.value("op");
+                    if(op != QLatin1String("=>") && op != QLatin1String("<=>"))
+                        throw PredReaderException
+                            ("Unknown binary predicate operator '" + op.toString().toStdString() + "'.");
+                    expectChild(stream,tagName);
+                    Pred lhs = readPredicate(stream,typeInfos);
+                    expectChild(stream,tagName);
+                    Pred rhs = readPredicate(stream,typeInfos);
+                    stream.skipCurrentElement();
+                    if(op == QLatin1String("=>"))
+                        return Pred::makeImplication(std::move(lhs),std::move(rhs));
+                    else
+                        return Pred::makeEquivalence(std::move(lhs),std::move(rhs));
+                }
+            case Pred::PKind::ExprComparison:
+                {
+                    const QStringRef op = attrs.value("op");
+                    Pred::ComparisonOp cop;
+                    bool negated = false;
+                    auto it = find(comparisonOp,op);
+                    if(it != nullptr)
+                        cop = it->value;
+                    else if (op == QLatin1String("/:"))
+                        { cop = Pred::ComparisonOp::Membership; negated = true; }
+                    else if (op == QLatin1String("/<:"))
+                        { cop = Pred::ComparisonOp::Subset; negated = true; }
+                    else if (op == QLatin1String("/<<:"))
+                        { cop = Pred::ComparisonOp::Strict_Subset; negated = true; }
+                    else if (op == QLatin1String("/="))
+                        { cop = Pred::ComparisonOp::Equality; negated = true; }
+                    else
+                        throw PredReaderException
+                            ("Unknown comparison operator '" + op.toString().toStdString() + "'.");
+                    expectChild(stream,tagName);
+                    Expr lhs = readExpression(stream,typeInfos);
+                    expectChild(stream,tagName);
+                    Expr rhs = readExpression(stream,typeInfos);
+                    stream.skipCurrentElement();
+                    Pred res = Pred::makeExprComparison(cop,std::move(lhs),std::move(rhs));
+                    if(negated)
+                        return Pred::makeNegation(std::move(res));
+                    return res;
+                }
+            case Pred::PKind::Forall:
+            case Pred::PKind::Exists:
+                {
+                    const QStringRef op = attrs.value("type");
+                    if(op != QLatin1String("!") && op != QLatin1String("#"))
+                        throw PredReaderException
+                            ("Unknown type of quantified predicate '" + op.toString().toStdString() + "'.");
+                    std::vector<TypedVar> vec;
+                    Pred body;
+                    bool hasVars = false, hasBody = false;
+                    while(nextChild(stream)){
+                        if(stream.name() == QLatin1String("Variables")){
+                            while(nextChild(stream)){
+                                if(stream.name() == QLatin1String("Id"))
+                                    vec.push_back(VarNameFromId(stream,typeInfos));
+                                else
+                                    stream.skipCurrentElement();
+                            }
+                            hasVars = true;
+                        } else if(stream.name() == QLatin1String("Body")){
+                            expectChild(stream,"Body");
+                            body = readPredicate(stream,typeInfos);
+                            stream.skipCurrentElement();
+                            hasBody = true;
+                        } else {
+                            stream.skipCurrentElement();
+                        }
+                    }
+                    if(!hasVars)
+                        throw PredReaderException
+                            ("The 'Quantified_Pred' element is missing some 'Variables' child.");
+                    if(!hasBody)
+                        throw PredReaderException
+                            ("The 'Quantified_Pred' element is missing some 'Body' child.");
+                    if(op == QLatin1String("!"))
+                        return Pred::makeForall(vec,std::move(body));
+                    else
+                        return Pred::makeExists(vec,std::move(body));
+                }
+            case Pred::PKind::Negation:
+                {
+                    const QStringRef op = attrs.value("op");
+                    if(op != QLatin1String("not"))
+                        throw PredReaderException
+                            ("Unknown unary predicate operator '" + op.toString().toStdString() + "'.");
+                    expectChild(stream,tagName);
+                    Pred p = readPredicate(stream,typeInfos);
+                    stream.skipCurrentElement();
+                    return Pred::makeNegation(std::move(p));
+                }
+            case Pred::PKind::Conjunction:
+            case Pred::PKind::Disjunction:
+                {
+                    const QStringRef op = attrs.value("op");
+                    if(op != QLatin1String("&") && op != QLatin1String("or"))
+                        throw PredReaderException
+                            ("Unknown n-ary predicate operator '" + op.toString().toStdString() + "'.");
+                    std::vector<Pred> vec;
+                    while(nextChild(stream))
+                        vec.push_back(readPredicate(stream,typeInfos));
+                    if(op == QLatin1String("&"))
+                        return Pred::makeConjunction(std::move(vec));
+                    else
+                        return Pred::makeDisjunction(std::move(vec));
+                }
+            case Pred::PKind::True:
+            case Pred::PKind::False:
+                assert(false); // unreachable
+        };
+        assert(false); // unreachable
+    };
+
+    Pred readPredicate(QXmlStreamReader &stream, const std::vector<BType> &typeInfos, Arena &arena){
+        Arena::Scope scope(arena);
+        return readPredicate(stream,typeInfos);
+    }
 }
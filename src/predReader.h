@@ -18,7 +18,9 @@
 
 #include "pred.h"
 #include "btype.h"
+#include "strTable.h"
 #include<QDomElement>
+#include<QXmlStreamReader>
 
 namespace Xml {
     class PredReaderException : public std::exception
@@ -31,9 +33,16 @@ namespace Xml {
             std::string description;
     };
 
-    extern const std::map<std::string, Pred::ComparisonOp> comparisonOp; // declared and initialized in predReader.cpp - also used in gpredReader.cpp
+    extern const StrTable<Pred::ComparisonOp,16> comparisonOp; // declared and initialized in predReader.cpp - also used in gpredReader.cpp
 
     Pred readPredicate(const QDomElement &dom, const std::vector<BType> &typeInfos);
+    // Same as above, with every node allocated in arena. The arena must outlive the returned predicate.
+    Pred readPredicate(const QDomElement &dom, const std::vector<BType> &typeInfos, Arena &arena);
+
+    // Streaming variants: no DOM is built. The stream must be positioned on the
+    // start element of the predicate; on return it is on the matching end element.
+    Pred readPredicate(QXmlStreamReader &stream, const std::vector<BType> &typeInfos);
+    Pred readPredicate(QXmlStreamReader &stream, const std::vector<BType> &typeInfos, Arena &arena);
 }
 
 #endif // PREDREADER_H
@@ -15,6 +15,7 @@
 
 #include "exprWriter.h"
 #include "predWriter.h"
+#include "xmlTags.h"
 
 namespace Xml {
 
@@ -36,7 +37,7 @@ namespace Xml {
             };
             void visitExprComparison(Pred::ComparisonOp op, const Expr &lhs, const Expr &rhs){
                 stream.writeStartElement("Exp_Comparison");
-                stream.writeAttribute("op",QString::fromStdString(Pred::to_string(op)));
+                stream.writeAttribute("op",toQString(op,Pred::ComparisonOp::Rgt,Pred::to_chars));
                 writeExpression(stream,typeInfos,lhs);
                 writeExpression(stream,typeInfos,rhs);
                 stream.writeEndElement(); // Exp_Comparison
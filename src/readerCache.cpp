@@ -0,0 +1,249 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "readerCache.h"
+#include "predReader.h"
+#include "gpredReader.h"
+#include "binWriter.h"
+#include "binReader.h"
+#include "fingerprint.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QXmlStreamReader>
+#include <cstring>
+
+namespace Xml {
+    /* Layout of an entry: magic "BXRC", version, kind, content. The content
+     * of a predicate is the data of a Bin::Writer. The content of a proof
+     * obligation starts with its definitions, the number of hypotheses,
+     * local hypotheses and goals, and the Ref_Hyp numbers of each goal; the
+     * data of a Bin::Writer follows, with the hypotheses, the local
+     * hypotheses and the goals, in this order. */
+    static const char magic[4] = {'B','X','R','C'};
+    const unsigned int ReaderCache::version = 1;
+
+    static void putVarint(std::string &out, uint64_t v){
+        while(v >= 0x80){
+            out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<char>(v));
+    }
+
+    // A corrupted entry is reported as the corrupted data of a Bin::Reader
+    static uint64_t getVarint(const unsigned char *&cur, const unsigned char *end){
+        uint64_t res = 0;
+        for(int shift = 0; shift < 64; shift += 7){
+            if(cur == end)
+                throw Bin::ReaderException("Truncated cache entry.");
+            unsigned char b = *cur++;
+            res |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if((b & 0x80) == 0)
+                return res;
+        }
+        throw Bin::ReaderException("Invalid varint in cache entry.");
+    }
+
+    // Number of elements or bytes: at most one per remaining byte
+    static size_t getCount(const unsigned char *&cur, const unsigned char *end){
+        uint64_t n = getVarint(cur,end);
+        if(n > static_cast<uint64_t>(end - cur))
+            throw Bin::ReaderException("Invalid count in cache entry.");
+        return n;
+    }
+
+    static std::string encode(const ProofObligation &po){
+        std::string res;
+        putVarint(res,po.definitions.size());
+        for(auto &d : po.definitions){
+            putVarint(res,d.size());
+            res += d;
+        }
+        putVarint(res,po.hypotheses.size());
+        putVarint(res,po.localHypotheses.size());
+        putVarint(res,po.goals.size());
+        for(auto &g : po.goals){
+            putVarint(res,g.refHyps.size());
+            for(auto n : g.refHyps)
+                putVarint(res,n);
+        }
+        Bin::Writer writer;
+        for(auto &p : po.hypotheses)
+            writer.writePredicate(p);
+        for(auto &p : po.localHypotheses)
+            writer.writePredicate(p);
+        for(auto &g : po.goals)
+            writer.writeGPredicate(g.goal);
+        res += writer.data();
+        return res;
+    }
+
+    static ProofObligation decode(const QByteArray &content){
+        const unsigned char *cur = reinterpret_cast<const unsigned char*>(content.constData());
+        const unsigned char *end = cur + content.size();
+        ProofObligation res;
+        res.definitions.resize(getCount(cur,end));
+        for(auto &d : res.definitions){
+            size_t len = getCount(cur,end);
+            d.assign(reinterpret_cast<const char*>(cur),len);
+            cur += len;
+        }
+        size_t nbHyps = getCount(cur,end);
+        size_t nbLocalHyps = getCount(cur,end);
+        size_t nbGoals = getCount(cur,end);
+        std::vector<std::vector<unsigned int>> refHyps(nbGoals);
+        for(auto &r : refHyps){
+            r.resize(getCount(cur,end));
+            for(auto &n : r)
+                n = static_cast<unsigned int>(getVarint(cur,end));
+        }
+        Bin::Reader reader(reinterpret_cast<const char*>(cur),end - cur);
+        for(size_t i=0;i<nbHyps;i++)
+            res.hypotheses.push_back(reader.readPredicate());
+        for(size_t i=0;i<nbLocalHyps;i++)
+            res.localHypotheses.push_back(reader.readPredicate());
+        for(auto &r : refHyps)
+            res.goals.push_back({std::move(r),reader.readGPredicate()});
+        if(!reader.atEnd())
+            throw Bin::ReaderException("Trailing data in cache entry.");
+        return res;
+    }
+
+    ReaderCache::ReaderCache(const QString &directory):
+        directory{directory},
+        nbHits{0},
+        nbMisses{0}
+    {}
+
+    // <directory>/<2 first digits>/<30 last digits>, to keep the directories small
+    QString ReaderCache::path(Kind kind, const QByteArray &section, const std::vector<BType> &typeInfos) const {
+        Fingerprinter f;
+        f.addString(std::string(1,static_cast<char>(kind)));
+        f.addString(std::to_string(version) + "." + std::to_string(Bin::version));
+        for(auto &ty : typeInfos)
+            f.addType(ty);
+        f.addString(std::string(section.constData(),section.size()));
+        const QString name = QString::fromStdString(f.get().toString());
+        return QDir(directory).filePath(name.left(2) + "/" + name.mid(2));
+    }
+
+    QByteArray ReaderCache::load(const QString &file, Kind kind){
+        QFile f(file);
+        if(!f.open(QIODevice::ReadOnly))
+            return QByteArray();
+        const QByteArray data = f.readAll();
+        const unsigned char *begin = reinterpret_cast<const unsigned char*>(data.constData());
+        const unsigned char *cur = begin;
+        const unsigned char *end = begin + data.size();
+        if(static_cast<size_t>(data.size()) < sizeof(magic) || std::memcmp(cur,magic,sizeof(magic)) != 0)
+            return QByteArray();
+        cur += sizeof(magic);
+        try {
+            if(getVarint(cur,end) != version)
+                return QByteArray();
+        } catch(const Bin::ReaderException &) {
+            return QByteArray();
+        }
+        if(cur == end || *cur != static_cast<unsigned char>(kind))
+            return QByteArray();
+        cur++;
+        return data.mid(cur - begin);
+    }
+
+    // QSaveFile writes to a temporary file and renames it on commit, so readers never see a partial entry
+    void ReaderCache::store(const QString &file, Kind kind, const std::string &content){
+        if(!QDir().mkpath(QFileInfo(file).path()))
+            return;
+        std::string header(magic,sizeof(magic));
+        putVarint(header,version);
+        header.push_back(static_cast<char>(kind));
+        QSaveFile f(file);
+        if(!f.open(QIODevice::WriteOnly))
+            return;
+        f.write(header.data(),header.size());
+        f.write(content.data(),content.size());
+        f.commit();
+    }
+
+    Pred ReaderCache::readPredicate(const QByteArray &section, const std::vector<BType> &typeInfos){
+        const QString file = path(Kind::Pred,section,typeInfos);
+        const QByteArray content = load(file,Kind::Pred);
+        if(!content.isEmpty()){
+            try {
+                Bin::Reader reader(content.constData(),content.size());
+                Pred p = reader.readPredicate();
+                if(reader.atEnd()){
+                    nbHits.fetch_add(1,std::memory_order_relaxed);
+                    return p;
+                }
+            } catch(const Bin::ReaderException &) {
+                // parsed and stored again below
+            }
+        }
+        nbMisses.fetch_add(1,std::memory_order_relaxed);
+        QXmlStreamReader stream(section);
+        stream.readNextStartElement();
+        Pred p = Xml::readPredicate(stream,typeInfos);
+        Bin::Writer writer;
+        writer.writePredicate(p);
+        store(file,Kind::Pred,writer.data());
+        return p;
+    }
+
+    GPred ReaderCache::readGPredicate(const QByteArray &section, const std::vector<BType> &typeInfos){
+        const QString file = path(Kind::GPred,section,typeInfos);
+        const QByteArray content = load(file,Kind::GPred);
+        if(!content.isEmpty()){
+            try {
+                Bin::Reader reader(content.constData(),content.size());
+                GPred p = reader.readGPredicate();
+                if(reader.atEnd()){
+                    nbHits.fetch_add(1,std::memory_order_relaxed);
+                    return p;
+                }
+            } catch(const Bin::ReaderException &) {
+                // parsed and stored again below
+            }
+        }
+        nbMisses.fetch_add(1,std::memory_order_relaxed);
+        QXmlStreamReader stream(section);
+        stream.readNextStartElement();
+        GPred p = Xml::readGPredicate(stream,typeInfos);
+        Bin::Writer writer;
+        writer.writeGPredicate(p);
+        store(file,Kind::GPred,writer.data());
+        return p;
+    }
+
+    ProofObligation ReaderCache::readProofObligation(const QByteArray &section, const std::vector<BType> &typeInfos){
+        const QString file = path(Kind::ProofObligation,section,typeInfos);
+        const QByteArray content = load(file,Kind::ProofObligation);
+        if(!content.isEmpty()){
+            try {
+                ProofObligation po = decode(content);
+                nbHits.fetch_add(1,std::memory_order_relaxed);
+                return po;
+            } catch(const Bin::ReaderException &) {
+                // parsed and stored again below
+            }
+        }
+        nbMisses.fetch_add(1,std::memory_order_relaxed);
+        ProofObligation po = Xml::readProofObligation(section,typeInfos);
+        store(file,Kind::ProofObligation,encode(po));
+        return po;
+    }
+}
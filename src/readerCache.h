@@ -0,0 +1,79 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef READERCACHE_H
+#define READERCACHE_H
+
+#include <atomic>
+#include <string>
+#include <QByteArray>
+#include <QString>
+#include "pred.h"
+#include "gpred.h"
+#include "pogReader.h"
+
+namespace Xml {
+    /** \brief Persistent cache of the results of the bxml readers.
+     *
+     * The tree read from an XML section (the bytes of one element) is stored
+     * in a file of the cache directory, in the binary format of Bin::Writer.
+     * The file name is the fingerprint of the section, of the type table and
+     * of the versions of the entries and of the binary format. Reading the
+     * same section with the same type table again loads the file instead of
+     * parsing the XML, and a library upgrade that changes either version
+     * simply stops finding the old entries.
+     *
+     * Entries are written atomically, so several processes may share a
+     * directory. A cache file that cannot be read or written is not an
+     * error: the section is parsed. Errors in the XML are reported by the
+     * readers, as without cache, and nothing is stored. Old entries are
+     * never removed: delete the directory to reclaim the space.
+     */
+    class ReaderCache {
+        public:
+            // To be increased whenever the readers change the trees they build
+            static const unsigned int version;
+
+            // The directory is created when the first entry is stored
+            explicit ReaderCache(const QString &directory);
+
+            // Same as readPredicate(QXmlStreamReader&,typeInfos) on the root element of section
+            Pred readPredicate(const QByteArray &section, const std::vector<BType> &typeInfos);
+            // Same as readGPredicate(QXmlStreamReader&,typeInfos) on the root element of section
+            GPred readGPredicate(const QByteArray &section, const std::vector<BType> &typeInfos);
+            // Same as Xml::readProofObligation
+            ProofObligation readProofObligation(const QByteArray &section, const std::vector<BType> &typeInfos);
+
+            // Number of sections loaded from the cache, and parsed
+            size_t hits() const { return nbHits.load(std::memory_order_relaxed); };
+            size_t misses() const { return nbMisses.load(std::memory_order_relaxed); };
+
+        private:
+            enum class Kind : char { Pred = 'P', GPred = 'G', ProofObligation = 'O' };
+
+            // Members
+            const QString directory;
+            std::atomic<size_t> nbHits;
+            std::atomic<size_t> nbMisses;
+
+            // Methods
+            QString path(Kind kind, const QByteArray &section, const std::vector<BType> &typeInfos) const;
+            // Content of the entry without its header, empty if there is no valid entry
+            QByteArray load(const QString &file, Kind kind);
+            void store(const QString &file, Kind kind, const std::string &content);
+    };
+}
+
+#endif // READERCACHE_H
@@ -0,0 +1,129 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef STRTABLE_H
+#define STRTABLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <utility>
+
+/** \brief Constant table from short ASCII strings to values.
+ *
+ * The table is built at compile time: the seed of the hash function is
+ * searched until every key has a slot of its own (perfect hashing), so a
+ * lookup hashes the string once and compares it with a single key. Keys are
+ * looked up as sequences of code units, either UTF-8 (char) or UTF-16 (the
+ * data of a QString), without any conversion or allocation.
+ */
+template <typename V, size_t N>
+class StrTable {
+    public:
+        struct Entry {
+            const char *key;
+            size_t length;
+            V value;
+        };
+
+        // Constructor. The keys must be distinct.
+        constexpr explicit StrTable(const std::pair<const char*,V> (&init)[N]):
+            entries{},
+            slots{},
+            seed{0}
+        {
+            static_assert(N < 255, "StrTable: too many keys");
+            for(size_t i=0;i<N;i++){
+                size_t n = 0;
+                while(init[i].first[n] != 0)
+                    n++;
+                entries[i] = {init[i].first,n,init[i].second};
+            }
+            while(!tryBuild()){
+                if(++seed == MaxSeed)
+                    throw "StrTable: no perfect hash found (duplicate keys?)";
+            }
+        };
+
+        // Entry of the key s[0..n), nullptr if there is none
+        template <typename Char> const Entry* find(const Char *s, size_t n) const {
+            uint8_t i = slots[hash(seed,s,n) & (Size - 1)];
+            if(i == 0)
+                return nullptr;
+            const Entry &e = entries[i-1];
+            if(e.length != n)
+                return nullptr;
+            for(size_t j=0;j<n;j++){
+                if(code(s[j]) != code(e.key[j]))
+                    return nullptr;
+            }
+            return &e;
+        };
+        const Entry* find(const std::string &s) const { return find(s.data(),s.size()); };
+        const Entry* find(const char *s) const { return find(s,std::char_traits<char>::length(s)); };
+
+    private:
+        static constexpr size_t minSize(size_t n){
+            size_t s = 1;
+            while(s < 8 * n)
+                s *= 2;
+            return s;
+        };
+        // 8 slots per key: a seed is found after a few tries
+        static constexpr size_t Size = minSize(N);
+        static constexpr uint32_t MaxSeed = 100000;
+
+        Entry entries[N];
+        uint8_t slots[Size]; // index of the entry + 1, 0 if the slot is free
+        uint32_t seed;
+
+        static constexpr uint32_t code(char c){ return static_cast<unsigned char>(c); };
+        template <typename Char> static constexpr uint32_t code(Char c){ return static_cast<uint32_t>(c); };
+
+        // FNV-1a, followed by the finalizer of MurmurHash3 so that the low bits depend on every bit
+        template <typename Char> static constexpr uint32_t hash(uint32_t seed, const Char *s, size_t n){
+            uint32_t h = 2166136261u ^ seed;
+            for(size_t i=0;i<n;i++){
+                h ^= code(s[i]);
+                h *= 16777619u;
+            }
+            h ^= h >> 16;
+            h *= 0x85ebca6bu;
+            h ^= h >> 13;
+            h *= 0xc2b2ae35u;
+            h ^= h >> 16;
+            return h;
+        };
+
+        constexpr bool tryBuild(){
+            for(size_t i=0;i<Size;i++)
+                slots[i] = 0;
+            for(size_t i=0;i<N;i++){
+                uint8_t &slot = slots[hash(seed,entries[i].key,entries[i].length) & (Size - 1)];
+                if(slot != 0)
+                    return false;
+                slot = static_cast<uint8_t>(i + 1);
+            }
+            return true;
+        };
+};
+
+// Deduces the number of keys: makeStrTable<V>({{"key",value}, ...})
+template <typename V, size_t N>
+constexpr StrTable<V,N> makeStrTable(const std::pair<const char*,V> (&init)[N]){
+    return StrTable<V,N>(init);
+}
+
+#endif // STRTABLE_H
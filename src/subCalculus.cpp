@@ -0,0 +1,448 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "subCalculus.h"
+#include "predDesc.h"
+#include <stdexcept>
+
+namespace {
+    // Predicates that are cheap enough to be duplicated in each branch
+    bool isSmall(const Pred &p){
+        switch(p.getTag()){
+            case Pred::PKind::True:
+            case Pred::PKind::False:
+            case Pred::PKind::ExprComparison:
+                return true;
+            case Pred::PKind::Negation:
+                return isSmall(p.toNegation().operand);
+            default:
+                return false;
+        }
+    }
+
+    // Constructors simplifying away the trivial cases
+
+    Pred conj(std::vector<Pred> &&vec){
+        std::vector<Pred> res;
+        for(auto &p : vec){
+            if(p.getTag() != Pred::PKind::True)
+                res.push_back(std::move(p));
+        }
+        if(res.empty())
+            return Pred::makeTrue();
+        if(res.size() == 1)
+            return std::move(res[0]);
+        return Pred::makeConjunction(std::move(res));
+    }
+
+    Pred conj(Pred &&lhs, Pred &&rhs){
+        std::vector<Pred> vec;
+        vec.push_back(std::move(lhs));
+        vec.push_back(std::move(rhs));
+        return conj(std::move(vec));
+    }
+
+    Pred disj(std::vector<Pred> &&vec){
+        if(vec.size() == 1)
+            return std::move(vec[0]);
+        return Pred::makeDisjunction(std::move(vec));
+    }
+
+    Pred imp(Pred &&lhs, Pred &&rhs){
+        if(lhs.getTag() == Pred::PKind::True || rhs.getTag() == Pred::PKind::True)
+            return std::move(rhs);
+        return Pred::makeImplication(std::move(lhs),std::move(rhs));
+    }
+
+    Pred neg(Pred &&p){
+        switch(p.getTag()){
+            case Pred::PKind::True:
+                return Pred::makeFalse();
+            case Pred::PKind::False:
+                return Pred::makeTrue();
+            case Pred::PKind::Negation:
+                return std::move(p.toNegation().operand);
+            default:
+                return Pred::makeNegation(std::move(p));
+        }
+    }
+
+    Pred forall(const std::vector<TypedVar> &vars, Pred &&body){
+        if(vars.empty() || body.getTag() == Pred::PKind::True)
+            return std::move(body);
+        return Pred::makeForall(vars,std::move(body));
+    }
+
+    Pred equality(const TypedVar &lhs, const TypedVar &rhs){
+        return Pred::makeExprComparison(Pred::ComparisonOp::Equality,
+                Expr::makeIdent(lhs.name,lhs.type),
+                Expr::makeIdent(rhs.name,rhs.type));
+    }
+
+    // Guard of a CASE branch: e = v1 or ... or e = vn
+    Pred caseGuard(const Expr &e, const Subst::CaseChoice &ch){
+        std::vector<Pred> vec;
+        for(auto &v : ch.values)
+            vec.push_back(Pred::makeExprComparison(Pred::ComparisonOp::Equality,e.copy(),v.copy()));
+        return disj(std::move(vec));
+    }
+
+    Pred wp(const Subst &s, Pred &&post, bool mayShare);
+
+    /* Fresh copies of the variables modified by s, with
+     * - after, the fresh variables,
+     * - toAfter, the substitution replacing each modified variable by its copy,
+     * - same, the predicate stating that each copy is equal to its variable. */
+    void afterValues(const Subst &s, std::vector<TypedVar> &after, std::map<VarName,Expr> &toAfter, std::vector<Pred> &same){
+        for(auto &v : s.getModifiedVars()){
+            TypedVar a {VarName::makeTmp(v.name.prefix()), v.type};
+            same.push_back(equality(a,v));
+            toAfter[v.name] = Expr::makeIdent(a.name,a.type);
+            after.push_back(a);
+        }
+    }
+
+    // Before-after predicate of s: not([s] not(M' = M))
+    Pred prd(const Subst &s, std::vector<Pred> &&same, bool mayShare){
+        return neg(wp(s,neg(conj(std::move(same))),mayShare));
+    }
+
+    // [s]post stated with a single occurrence of post
+    Pred shared(const Subst &s, Pred &&post){
+        std::vector<TypedVar> after;
+        std::map<VarName,Expr> toAfter;
+        std::vector<Pred> same;
+        afterValues(s,after,toAfter,same);
+        Pred trm = wp(s,Pred::makeTrue(),false);
+        Pred before_after = prd(s,std::move(same),false);
+        post.subst(toAfter);
+        return conj(std::move(trm),
+                forall(after,imp(std::move(before_after),std::move(post))));
+    }
+
+    Pred parallel(const std::vector<Subst> &vec, Pred &&post){
+        if(vec.size() == 1)
+            return wp(vec[0],std::move(post),true);
+
+        bool allAssignments = true;
+        for(auto &s : vec){
+            if(s.getTag() != Subst::SKind::SimpleAssignment)
+                allAssignments = false;
+        }
+        if(allAssignments){
+            // x := e || y := f is the simultaneous substitution x,y := e,f
+            std::map<VarName,Expr> map;
+            for(auto &s : vec){
+                for(auto &p : s.toSimpleAssignment().toMap())
+                    map[p.first] = p.second.copy();
+            }
+            post.subst(map);
+            return std::move(post);
+        }
+
+        // The components modify disjoint sets of variables
+        std::vector<Pred> trm;
+        std::vector<Pred> before_after;
+        std::vector<TypedVar> after;
+        std::map<VarName,Expr> toAfter;
+        for(auto &s : vec){
+            std::vector<Pred> same;
+            afterValues(s,after,toAfter,same);
+            trm.push_back(wp(s,Pred::makeTrue(),true));
+            before_after.push_back(prd(s,std::move(same),true));
+        }
+        post.subst(toAfter);
+        return conj(conj(std::move(trm)),
+                forall(after,imp(conj(std::move(before_after)),std::move(post))));
+    }
+
+    Pred opCall(const Subst::OpCallSubst &call, Pred &&post){
+        // The formal parameters are renamed apart from the calling context
+        std::map<VarName,VarName> renaming;
+        std::vector<TypedVar> inputs;
+        for(auto &v : call.operation->input){
+            TypedVar nv {VarName::makeTmp(v.name.prefix()), v.type};
+            renaming.emplace(v.name,nv.name);
+            inputs.push_back(nv);
+        }
+        std::vector<TypedVar> outputs;
+        for(auto &v : call.operation->output){
+            TypedVar nv {VarName::makeTmp(v.name.prefix()), v.type};
+            renaming.emplace(v.name,nv.name);
+            outputs.push_back(nv);
+        }
+        Pred pre = call.operation->precondition.copy();
+        Subst body = call.operation->body.copy();
+        if(!renaming.empty()){
+            pre.alpha(renaming);
+            body.alpha(renaming);
+        }
+
+        // r <-- op(e) : [fi := e](P & [S](Q[r := fo]))
+        std::map<VarName,Expr> results;
+        for(size_t i=0;i<call.output.size();i++)
+            results[call.output[i].name] = Expr::makeIdent(outputs[i].name,outputs[i].type);
+        post.subst(results);
+        Pred res = conj(std::move(pre),wp(body,std::move(post),true));
+        std::map<VarName,Expr> parameters;
+        for(size_t i=0;i<call.input.size();i++)
+            parameters[inputs[i].name] = call.input[i].copy();
+        res.subst(parameters);
+
+        // Output parameters that the operation does not set are unconstrained
+        std::set<VarName> fv = res.getFreeVars();
+        std::vector<TypedVar> unset;
+        for(auto &v : outputs){
+            if(fv.find(v.name) != fv.end())
+                unset.push_back(v);
+        }
+        return forall(unset,std::move(res));
+    }
+
+    Pred loop(const Subst::WhileSubst &w, Pred &&post){
+        std::set<TypedVar> modified = w.body.getModifiedVars();
+        std::vector<TypedVar> m { modified.begin(), modified.end() };
+        std::vector<Pred> vec;
+        // the invariant holds initially
+        vec.push_back(w.inv.copy());
+        // the variant is a natural number
+        vec.push_back(forall(m,imp(w.inv.copy(),
+                        Pred::makeExprComparison(Pred::ComparisonOp::Membership,
+                            w.var.copy(),Expr::makeNATURAL()))));
+        // the body preserves the invariant
+        vec.push_back(forall(m,imp(conj(w.inv.copy(),w.cond.copy()),
+                        wp(w.body,w.inv.copy(),true))));
+        // the body decreases the variant: [n := V][S](V < n)
+        TypedVar n {VarName::makeTmp("variant"), w.var.getType()};
+        Pred decrease = wp(w.body,
+                Pred::makeExprComparison(Pred::ComparisonOp::Ilt,
+                    w.var.copy(),Expr::makeIdent(n.name,n.type)),true);
+        std::map<VarName,Expr> variant;
+        variant[n.name] = w.var.copy();
+        decrease.subst(variant);
+        vec.push_back(forall(m,imp(conj(w.inv.copy(),w.cond.copy()),std::move(decrease))));
+        // the postcondition holds on exit
+        vec.push_back(forall(m,imp(conj(w.inv.copy(),neg(w.cond.copy())),std::move(post))));
+        return conj(std::move(vec));
+    }
+
+    Pred wp(const Subst &s, Pred &&post, bool mayShare){
+        switch(s.getTag()){
+            case Subst::SKind::Skip:
+                return std::move(post);
+            case Subst::SKind::Block:
+                return wp(s.toBlock(),std::move(post),mayShare);
+            case Subst::SKind::Assert:
+                {
+                    auto &a = s.toAssert();
+                    return conj(a.condition.copy(),wp(a.content,std::move(post),mayShare));
+                }
+            case Subst::SKind::IfThen:
+                {
+                    if(mayShare && !isSmall(post))
+                        return shared(s,std::move(post));
+                    auto &i = s.toIfThen();
+                    Pred p_then = wp(i.s_if,post.copy(),true);
+                    return conj(imp(i.condition.copy(),std::move(p_then)),
+                            imp(neg(i.condition.copy()),std::move(post)));
+                }
+            case Subst::SKind::IfThenElse:
+                {
+                    if(mayShare && !isSmall(post))
+                        return shared(s,std::move(post));
+                    auto &i = s.toIfThenElse();
+                    Pred p_then = wp(i.s_if,post.copy(),true);
+                    Pred p_else = wp(i.s_else,std::move(post),true);
+                    return conj(imp(i.condition.copy(),std::move(p_then)),
+                            imp(neg(i.condition.copy()),std::move(p_else)));
+                }
+            case Subst::SKind::SimpleAssignment:
+                {
+                    post.subst(s.toSimpleAssignment().toMap());
+                    return std::move(post);
+                }
+            case Subst::SKind::Select:
+            case Subst::SKind::SelectElse:
+                {
+                    if(mayShare && !isSmall(post))
+                        return shared(s,std::move(post));
+                    const std::vector<std::pair<Pred,Subst>> &clauses =
+                        (s.getTag() == Subst::SKind::Select) ? s.toSelect().clauses : s.toSelectElse().clauses;
+                    std::vector<Pred> vec;
+                    std::vector<Pred> otherwise;
+                    for(auto &c : clauses){
+                        vec.push_back(imp(c.first.copy(),wp(c.second,post.copy(),true)));
+                        otherwise.push_back(neg(c.first.copy()));
+                    }
+                    if(s.getTag() == Subst::SKind::SelectElse)
+                        vec.push_back(imp(conj(std::move(otherwise)),
+                                    wp(s.toSelectElse().s_else,std::move(post),true)));
+                    return conj(std::move(vec));
+                }
+            case Subst::SKind::Case:
+            case Subst::SKind::CaseElse:
+                {
+                    if(mayShare && !isSmall(post))
+                        return shared(s,std::move(post));
+                    const Expr &e = (s.getTag() == Subst::SKind::Case) ? s.toCase().e : s.toCaseElse().e;
+                    const std::vector<Subst::CaseChoice> &cases =
+                        (s.getTag() == Subst::SKind::Case) ? s.toCase().cases : s.toCaseElse().cases;
+                    std::vector<Pred> vec;
+                    std::vector<Pred> otherwise;
+                    for(auto &ch : cases){
+                        vec.push_back(imp(caseGuard(e,ch),wp(ch.body,post.copy(),true)));
+                        otherwise.push_back(neg(caseGuard(e,ch)));
+                    }
+                    // without ELSE branch, the CASE substitution behaves as skip when no value matches
+                    Pred p_else = (s.getTag() == Subst::SKind::CaseElse) ?
+                        wp(s.toCaseElse().s_else,std::move(post),true) :
+                        std::move(post);
+                    vec.push_back(imp(conj(std::move(otherwise)),std::move(p_else)));
+                    return conj(std::move(vec));
+                }
+            case Subst::SKind::Any:
+                {
+                    auto &any = s.toAny();
+                    // the bound variables must not capture the free variables of the postcondition
+                    std::set<VarName> fv = post.getFreeVars();
+                    std::map<VarName,VarName> renaming;
+                    std::vector<TypedVar> vars;
+                    for(auto &v : any.vars){
+                        if(fv.find(v.name) == fv.end()){
+                            vars.push_back(v);
+                        } else {
+                            TypedVar nv {VarName::makeTmp(v.name.prefix()), v.type};
+                            renaming.emplace(v.name,nv.name);
+                            vars.push_back(nv);
+                        }
+                    }
+                    Pred guard = any.p.copy();
+                    Subst body = any.body.copy();
+                    if(!renaming.empty()){
+                        guard.alpha(renaming);
+                        body.alpha(renaming);
+                    }
+                    return forall(vars,imp(std::move(guard),wp(body,std::move(post),true)));
+                }
+            case Subst::SKind::OperationCall:
+                return opCall(s.toOpCall(),std::move(post));
+            case Subst::SKind::While:
+                return loop(s.toWhile(),std::move(post));
+            case Subst::SKind::Sequence:
+                {
+                    auto &vec = s.toSequence();
+                    for(auto it = vec.rbegin(); it != vec.rend(); ++it)
+                        post = wp(*it,std::move(post),true);
+                    return std::move(post);
+                }
+            case Subst::SKind::Parallel:
+                return parallel(s.toParallel(),std::move(post));
+            case Subst::SKind::Choice:
+                {
+                    auto &vec = s.toChoice();
+                    if(vec.size() > 1 && mayShare && !isSmall(post))
+                        return shared(s,std::move(post));
+                    std::vector<Pred> res;
+                    for(auto &c : vec)
+                        res.push_back(wp(c,post.copy(),true));
+                    return conj(std::move(res));
+                }
+            case Subst::SKind::Witness:
+                // witnesses are hints for the instantiation of existential quantifiers
+                return wp(s.toWitness().body,std::move(post),mayShare);
+        };
+        assert(false); // unreachable
+        throw std::logic_error("Unknown kind of substitution.");
+    }
+}
+
+Pred SubCalculus::apply(const Subst &s, Pred &&post){
+    return wp(s,std::move(post),true);
+}
+
+Pred SubCalculus::lower(const GPred &p){
+    switch(p.getKind()){
+        case GPred::Kind::Implication:
+            {
+                auto &i = p.toImplication();
+                return Pred::makeImplication(lower(i.lhs),lower(i.rhs));
+            }
+        case GPred::Kind::Equivalence:
+            {
+                auto &e = p.toEquivalence();
+                return Pred::makeEquivalence(lower(e.lhs),lower(e.rhs));
+            }
+        case GPred::Kind::ExprComparison:
+            {
+                auto &c = p.toExprComparison();
+                return Pred::makeExprComparison(c.op,c.lhs.copy(),c.rhs.copy());
+            }
+        case GPred::Kind::Negation:
+            return Pred::makeNegation(lower(p.toNegationPred().content));
+        case GPred::Kind::Conjunction:
+        case GPred::Kind::Disjunction:
+            {
+                const std::vector<GPred> &content = (p.getKind() == GPred::Kind::Conjunction) ?
+                    p.toConjunction().content : p.toDisjunction().content;
+                std::vector<Pred> vec;
+                for(auto &q : content)
+                    vec.push_back(lower(q));
+                if(p.getKind() == GPred::Kind::Conjunction)
+                    return Pred::makeConjunction(std::move(vec));
+                else
+                    return Pred::makeDisjunction(std::move(vec));
+            }
+        case GPred::Kind::Forall:
+            {
+                auto &f = p.toForall();
+                return Pred::makeForall(f.vars,lower(f.body));
+            }
+        case GPred::Kind::Exists:
+            {
+                auto &e = p.toExists();
+                return Pred::makeExists(e.vars,lower(e.body));
+            }
+        case GPred::Kind::TaggedPred:
+            {
+                auto &t = p.toTaggedPred();
+                Pred res = lower(t.content);
+                res.setGoalTag(t.tag);
+                return res;
+            }
+        case GPred::Kind::Sub:
+            {
+                auto &s = p.toSub();
+                return apply(s.sub,lower(s.pred));
+            }
+        case GPred::Kind::NotSubNot:
+            {
+                // not([S] not P)
+                auto &s = p.toNotSubNot();
+                return neg(apply(s.sub,neg(s.pred.copy())));
+            }
+        case GPred::Kind::LetFreshId:
+            {
+                auto &l = p.toLetFreshId();
+                Pred res = lower(l.pred);
+                VarSet vars;
+                res.getAllVars(vars);
+                VarName v = VarName::getFreshVar(l.id,vars);
+                res.substFreshId(l.id,v);
+                return res;
+            }
+    };
+    assert(false); // unreachable
+    throw std::logic_error("Unknown kind of generalized predicate.");
+}
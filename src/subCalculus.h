@@ -0,0 +1,51 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef SUBCALCULUS_H
+#define SUBCALCULUS_H
+
+#include "pred.h"
+#include "subst.h"
+#include "gpred.h"
+
+/** \brief Weakest precondition calculus.
+ *
+ * Turns the substitutions of the generalized predicates into ordinary
+ * predicates. When a postcondition that is not atomic would be duplicated
+ * in several branches (IF, SELECT, CASE, CHOICE), it is stated once
+ * using the before-after predicate of the substitution instead:
+ *     [S]Q <=> trm(S) & !M'.(prd(S) => Q[M:=M'])
+ * where M are the variables modified by S. The postcondition is thus never
+ * duplicated. trm(S) and prd(S) are however computed again at each
+ * enclosing branching level, so the size of the result can grow
+ * quadratically with the nesting depth of the substitution.
+ *
+ * For instance, with S = IF x < 0 THEN x := -x END:
+ *     [S](0 <= x)
+ *         = (x < 0 => 0 <= -x) & (not(x < 0) => 0 <= x)
+ *     [S](0 <= x & x <= 10)
+ *         = !x'.(not((x < 0 => x' /= -x) & (not(x < 0) => x' /= x))
+ *               => 0 <= x' & x' <= 10)
+ * where trm(S), true here, is left out, and x' is a temporary identifier.
+ */
+class SubCalculus {
+    public:
+        // Weakest precondition [s]post
+        static Pred apply(const Subst &s, Pred &&post);
+        // Predicate equivalent to p, without any substitution
+        static Pred lower(const GPred &p);
+};
+
+#endif // SUBCALCULUS_H
@@ -15,9 +15,32 @@
 
 #include "subst.h"
 
+Subst::~Subst(){
+    // The sub-substitutions are moved to an explicit stack and destroyed one at a time
+    if(desc == nullptr)
+        return;
+    std::vector<Subst> todo;
+    desc->release(todo);
+    while(!todo.empty()){
+        Subst s = std::move(todo.back());
+        todo.pop_back();
+        if(s.desc != nullptr){
+            s.desc->release(todo);
+            s.desc.reset();
+        }
+    }
+}
 void Subst::alpha(const std::map<VarName,VarName> &map){
-    if(desc != nullptr)
+    if(desc != nullptr){
+        modified();
         desc->alpha(map);
+    }
+}
+void Subst::modified(){
+    if(desc != nullptr){
+        desc->cachedHash.reset();
+        desc->freeVars.reset();
+    }
 }
 void Subst::getInnerFreeVars(std::set<VarName> &accu) const {
     if(desc != nullptr)
@@ -45,7 +68,7 @@ class Subst::BlockSubst : public SubstDesc {
         void getModifiedVars(const std::set<VarName> &boundVars, std::set<TypedVar> &accu) const {
             content.getModifiedVars(boundVars,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             content.getAllVars(accu);
         }
         void getInnerFreeVars(std::set<VarName> &accu) const {
@@ -57,6 +80,9 @@ class Subst::BlockSubst : public SubstDesc {
         SubstDesc* copy() const {
             return new BlockSubst(content.copy());
         }
+        void release(std::vector<Subst> &children) {
+            children.push_back(std::move(content));
+        }
 };
 
 class Subst::NarySubst : public SubstDesc {
@@ -76,7 +102,7 @@ class Subst::NarySubst : public SubstDesc {
             for(auto &s : content)
                 s.alpha(map);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &s : content)
                 s.getAllVars(accu);
         }
@@ -98,6 +124,10 @@ class Subst::NarySubst : public SubstDesc {
                 vec.push_back(s.copy());
             return new NarySubst(std::move(vec));
         }
+        void release(std::vector<Subst> &children) {
+            for(auto &s : content)
+                children.push_back(std::move(s));
+        }
 };
 
 Subst Subst::makeSkip(){ return Subst(SKind::Skip,nullptr); }
@@ -134,10 +164,18 @@ Subst Subst::makeAny(const std::vector<TypedVar> &vars, Pred &&p, Subst &&body){
 };
 Subst Subst::makeOpCall(const std::string &name, std::vector<Expr> &&input, const std::vector<TypedVar> &output,
         const std::vector<TypedVar> &op_input, const std::vector<TypedVar> &op_output, Pred &&op_precondition, Subst &&op_body){
-    assert(input.size() == op_input.size());
-    assert(output.size() == op_output.size());
-    return Subst(SKind::OperationCall,
-            new OpCallSubst(name,std::move(input),output,op_input,op_output,std::move(op_precondition),std::move(op_body))) ;
+    return makeOpCall(std::move(input),output,
+            makeOperation(name,op_input,op_output,std::move(op_precondition),std::move(op_body)));
+};
+Subst Subst::makeOpCall(std::vector<Expr> &&input, const std::vector<TypedVar> &output,
+        const std::shared_ptr<const Operation> &op){
+    assert(input.size() == op->input.size());
+    assert(output.size() == op->output.size());
+    return Subst(SKind::OperationCall, new OpCallSubst(std::move(input),output,op));
+};
+std::shared_ptr<const Subst::Operation> Subst::makeOperation(const std::string &name,
+        const std::vector<TypedVar> &op_input, const std::vector<TypedVar> &op_output, Pred &&op_precondition, Subst &&op_body){
+    return std::make_shared<const Operation>(name,op_input,op_output,std::move(op_precondition),std::move(op_body));
 };
 Subst Subst::makeWhile(Pred &&cond, Subst &&body, Pred &&inv, Expr &&var){
     return Subst(SKind::While, new WhileSubst(std::move(cond),std::move(body),std::move(inv),std::move(var)) );
@@ -218,7 +256,7 @@ void Subst::accept(Visitor &visitor) const {
         case Subst::SKind::OperationCall:
             {
                 OpCallSubst &e = static_cast<OpCallSubst&>(*desc);
-                visitor.visitOpCall(e.name,e.input,e.output,e.op_input,e.op_output,e.op_precondition,e.op_body);
+                visitor.visitOpCall(e.input,e.output,e.operation);
                 break;
             }
         case Subst::SKind::While:
@@ -326,74 +364,110 @@ const Subst::WitnessSubst& Subst::toWitness() const {
 
 Subst& Subst::toBlock() {
     assert(tag == SKind::Block);
+    modified();
     return static_cast<BlockSubst&>(*desc).content;
 };
 Subst::AssertSubst& Subst::toAssert() {
     assert(tag == SKind::Assert);
+    modified();
     return static_cast<AssertSubst&>(*desc);
 };
 Subst::IfThenSubst& Subst::toIfThen() {
     assert(tag == SKind::IfThen);
+    modified();
     return static_cast<IfThenSubst&>(*desc);
 };
 Subst::IfThenElseSubst& Subst::toIfThenElse() {
     assert(tag == SKind::IfThenElse);
+    modified();
     return static_cast<IfThenElseSubst&>(*desc);
 };
 Subst::SimpleAssignmentSubst& Subst::toSimpleAssignment() {
     assert(tag == SKind::SimpleAssignment);
+    modified();
     return static_cast<SimpleAssignmentSubst&>(*desc);
 };
 Subst::SelectSubst& Subst::toSelect() {
     assert(tag == SKind::Select);
+    modified();
     return static_cast<SelectSubst&>(*desc);
 };
 Subst::SelectElseSubst& Subst::toSelectElse() {
     assert(tag == SKind::SelectElse);
+    modified();
     return static_cast<SelectElseSubst&>(*desc);
 };
 Subst::CaseSubst& Subst::toCase() {
     assert(tag == SKind::Case);
+    modified();
     return static_cast<CaseSubst&>(*desc);
 };
 Subst::CaseElseSubst& Subst::toCaseElse() {
     assert(tag == SKind::CaseElse);
+    modified();
     return static_cast<CaseElseSubst&>(*desc);
 };
 Subst::AnySubst& Subst::toAny() {
     assert(tag == SKind::Any);
+    modified();
     return static_cast<AnySubst&>(*desc);
 };
 Subst::OpCallSubst& Subst::toOpCall() {
     assert(tag == SKind::OperationCall);
+    modified();
     return static_cast<OpCallSubst&>(*desc);
 };
 Subst::WhileSubst& Subst::toWhile() {
     assert(tag == SKind::While);
+    modified();
     return static_cast<WhileSubst&>(*desc);
 };
 std::vector<Subst>& Subst::toSequence() {
     assert(tag == SKind::Sequence);
+    modified();
     return static_cast<NarySubst&>(*desc).content;
 };
 std::vector<Subst>& Subst::toParallel() {
     assert(tag == SKind::Parallel);
+    modified();
     return static_cast<NarySubst&>(*desc).content;
 };
 std::vector<Subst>& Subst::toChoice() {
     assert(tag == SKind::Choice);
+    modified();
     return static_cast<NarySubst&>(*desc).content;
 };
 Subst::WitnessSubst& Subst::toWitness() {
     assert(tag == SKind::Witness);
+    modified();
     return static_cast<WitnessSubst&>(*desc);
 };
 
 void Subst::getFreeVars(const std::set<VarName> &boundVars, std::set<VarName> &accu) const {
-    if(desc != nullptr)
+    if(desc == nullptr)
+        return;
+    // The variables bound around a substitution do not simply filter its free
+    // variables (see SimpleAssignmentSubst), so only the top-level query is cached
+    if(!boundVars.empty()){
         desc->getFreeVars(boundVars,accu);
+        return;
+    }
+    auto &fv = freeVars();
+    accu.insert(fv.begin(),fv.end());
+}
+void Subst::getFreeVars(VarSet &accu) const {
+    if(desc == nullptr)
+        return;
+    auto &fv = freeVars();
+    accu.insert(fv.begin(),fv.end());
 }
-void Subst::getAllVars(std::set<VarName> &accu) const {
+const std::vector<VarName>& Subst::freeVars() const {
+    return desc->freeVars.get([this](){
+            std::set<VarName> res;
+            desc->getFreeVars({},res);
+            return res; });
+}
+void Subst::getAllVars(VarSet &accu) const {
     if(desc != nullptr)
         desc->getAllVars(accu);
 }
@@ -412,12 +486,46 @@ std::map<VarName,Expr> Subst::SimpleAssignmentSubst::toMap() const {
 };
 
 size_t Subst::hash_combine(size_t seed) const {
-    if(desc != nullptr)
-        seed = desc->hash_combine(seed);
-    return hashUtil::hash_combine_int(static_cast<int>(tag),seed);
+    if(desc == nullptr)
+        return hashUtil::hash_combine_int(static_cast<int>(tag),seed);
+    size_t h = desc->cachedHash.get([this](){
+            return hashUtil::hash_combine_int(static_cast<int>(tag),desc->hash_combine(0)); });
+    return hashUtil::hash_combine_hash(h,seed);
+}
+
+std::shared_ptr<const Subst::Operation> Subst::Operation::substFreshId(const std::shared_ptr<const Operation> &self,
+        const std::string &id, const VarName &v) const {
+    assert(self.get() == this);
+    bool found = false;
+    for(auto &n : getAllVars()){
+        if(n.kind() == VarName::Kind::FreshId && n.prefix() == id){
+            found = true;
+            break;
+        }
+    }
+    if(!found)
+        return self;
+    // The definition is shared: the other calls keep the original one
+    std::vector<TypedVar> input2 = input;
+    for(auto &tv : input2){
+        if(tv.name.kind() == VarName::Kind::FreshId && tv.name.prefix() == id)
+            tv.name = v;
+    }
+    std::vector<TypedVar> output2 = output;
+    for(auto &tv : output2){
+        if(tv.name.kind() == VarName::Kind::FreshId && tv.name.prefix() == id)
+            tv.name = v;
+    }
+    Pred precondition2 = precondition.copy();
+    precondition2.substFreshId(id,v);
+    Subst body2 = body.copy();
+    body2.substFreshId(id,v);
+    return makeOperation(name,input2,output2,std::move(precondition2),std::move(body2));
 }
 
 void Subst::substFreshId(const std::string &id, const VarName &v){
-    if(desc != nullptr)
+    if(desc != nullptr){
+        modified();
         desc->substFreshId(id,v);
+    }
 }
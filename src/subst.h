@@ -19,6 +19,7 @@
 #include "expr.h"
 #include "pred.h"
 #include "hash.h"
+#include <memory>
 
 class Subst {
     public:
@@ -28,9 +29,17 @@ class Subst {
             While, Sequence, Parallel, Choice, SimpleAssignment, Witness };
 
         Subst():tag{SKind::Skip},desc{}{}
+        Subst(Subst &&) = default;
+        Subst& operator=(Subst &&) = default;
+        // Iterative: the depth of the substitution is not limited by the call stack
+        ~Subst();
+        // Substitutions are duplicated explicitly with copy()
+        Subst(const Subst &) = delete;
+        Subst& operator=(const Subst &) = delete;
         SKind getTag() const { return tag; };
 
         struct CaseChoice;
+        class Operation;
 
         static Subst makeSkip();
         static Subst makeBlock(Subst &&s);
@@ -46,6 +55,11 @@ class Subst {
         static Subst makeWitness(std::map<std::string,Expr> &&witnesses, Subst &&body);
         static Subst makeOpCall(const std::string &name, std::vector<Expr> &&input, const std::vector<TypedVar> &output,
                 const std::vector<TypedVar> &op_input, const std::vector<TypedVar> &op_output, Pred &&op_precondition, Subst &&op_body);
+        // Call to an operation whose definition is shared with the other calls to it
+        static Subst makeOpCall(std::vector<Expr> &&input, const std::vector<TypedVar> &output,
+                const std::shared_ptr<const Operation> &op);
+        static std::shared_ptr<const Operation> makeOperation(const std::string &name,
+                const std::vector<TypedVar> &op_input, const std::vector<TypedVar> &op_output, Pred &&op_precondition, Subst &&op_body);
         static Subst makeWhile(Pred &&cond, Subst &&body, Pred &&inv, Expr &&var);
         static Subst makeSequence(std::vector<Subst> &&vec);
         static Subst makeParallel(std::vector<Subst> &&vec);
@@ -64,8 +78,8 @@ class Subst {
                 virtual void visitCase(const Expr &e, const std::vector<CaseChoice> &cases) = 0;
                 virtual void visitCaseElse(const Expr &e, const std::vector<CaseChoice> &cases, const Subst &els) = 0;
                 virtual void visitAny(const std::vector<TypedVar> &vars, const Pred &p, const Subst &body) = 0;
-                virtual void visitOpCall(const std::string &name,  const std::vector<Expr> &input, const std::vector<TypedVar> &output,
-                        const std::vector<TypedVar> &op_input, const std::vector<TypedVar> &op_output, const Pred &op_precondition, const Subst &op_body) = 0;
+                virtual void visitOpCall(const std::vector<Expr> &input, const std::vector<TypedVar> &output,
+                        const std::shared_ptr<const Operation> &op) = 0;
                 virtual void visitWhile(const Pred &cond, const Subst &body, const Pred &inv, const Expr &var) = 0;
                 virtual void visitSequence(const std::vector<Subst> &vec) = 0;
                 virtual void visitParallel(const std::vector<Subst> &vec) = 0;
@@ -74,6 +88,7 @@ class Subst {
         };
         void accept(Visitor &visitor) const;
 
+        // The hash of each node is cached, so this is O(1) once computed
         size_t hash_combine(size_t seed) const;
 
         class AssertSubst;
@@ -126,13 +141,20 @@ class Subst {
         std::vector<Subst>& toChoice();
 
         void getFreeVars(const std::set<VarName> &boundVars, std::set<VarName> &accu) const;
+        // Adds the identifiers occuring free in the substitution to accu
+        void getFreeVars(VarSet &accu) const;
         // Get identifiers occuring free in the substitution
         std::set<VarName> getFreeVars() const {
             std::set<VarName> accu;
             getFreeVars({},accu);
             return accu;
         };
-        void getAllVars(std::set<VarName> &accu) const;
+        void getAllVars(VarSet &accu) const;
+        void getAllVars(std::set<VarName> &accu) const {
+            VarSet vars;
+            getAllVars(vars);
+            accu.insert(vars.begin(),vars.end());
+        }
         // Get all identifiers (free or bound) occuring in the substitution
         std::set<VarName> getAllVars() const {
             std::set<VarName> accu;
@@ -162,6 +184,10 @@ class Subst {
         std::unique_ptr<SubstDesc> desc; // the content of the substitution (may be null if the substitution is Skip).
         // Constructor
         Subst(SKind tag,SubstDesc *desc):tag{tag},desc{desc}{};
+        // Free variables of this substitution, computed once (desc must not be null)
+        const std::vector<VarName>& freeVars() const;
+        // Drops the cached hash. Called by alpha, substFreshId and the non-const accessors.
+        void modified();
 };
 
 struct Subst::CaseChoice {
@@ -169,17 +195,23 @@ struct Subst::CaseChoice {
     Subst body;
 };
 
-class Subst::SubstDesc {
+class Subst::SubstDesc : public Arena::Allocated {
     public:
         virtual ~SubstDesc(){};
         virtual size_t hash_combine(size_t seed) const = 0;
         virtual void getFreeVars(const std::set<VarName> &boundVars, std::set<VarName> &accu) const = 0;
-        virtual void getAllVars(std::set<VarName> &accu) const = 0;
+        virtual void getAllVars(VarSet &accu) const = 0;
         virtual void getModifiedVars(const std::set<VarName> &boundVars, std::set<TypedVar> &accu) const = 0;
         virtual void alpha(const std::map<VarName,VarName> &map) = 0;
         virtual void getInnerFreeVars(std::set<VarName> &accu) const = 0;
         virtual void substFreshId(const std::string &id, const VarName &v) = 0;
         virtual SubstDesc* copy() const = 0;
+        // Moves the sub-substitutions out, so that ~Subst destroys them iteratively
+        virtual void release(std::vector<Subst> &) {};
+        // Hash of the substitution, reset when desc is modified (see modified)
+        hashUtil::CachedHash cachedHash;
+        // Free variables of the substitution, reset when desc is modified
+        FreeVarsCache freeVars;
 };
 
 class Subst::AssertSubst : public SubstDesc {
@@ -190,6 +222,9 @@ class Subst::AssertSubst : public SubstDesc {
         Pred condition;
         Subst content;
         // Methods
+        void release(std::vector<Subst> &children) {
+            children.push_back(std::move(content));
+        }
         size_t hash_combine(size_t seed) const {
             return condition.hash_combine(content.hash_combine(seed));
         }
@@ -197,7 +232,7 @@ class Subst::AssertSubst : public SubstDesc {
             condition.getFreeVars(boundVars,accu);
             content.getFreeVars(boundVars,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             condition.getAllVars(accu);
             content.getAllVars(accu);
         }
@@ -231,6 +266,9 @@ class Subst::WitnessSubst : public SubstDesc {
         std::map<std::string,Expr> witnesses;
         Subst body;
         // Methods
+        void release(std::vector<Subst> &children) {
+            children.push_back(std::move(body));
+        }
         size_t hash_combine(size_t seed) const {
             for(auto &p : witnesses)
                 seed = hashUtil::hash_combine_string(p.first,
@@ -242,7 +280,7 @@ class Subst::WitnessSubst : public SubstDesc {
                 p.second.getFreeVars(boundVars,accu);
             body.getFreeVars(boundVars,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &p : witnesses)
                 p.second.getAllVars(accu);
             body.getAllVars(accu);
@@ -280,6 +318,9 @@ class Subst::IfThenSubst : public SubstDesc {
         Pred condition;
         Subst s_if;
         // Methods
+        void release(std::vector<Subst> &children) {
+            children.push_back(std::move(s_if));
+        }
         size_t hash_combine(size_t seed) const {
             return condition.hash_combine(s_if.hash_combine(seed));
         }
@@ -290,7 +331,7 @@ class Subst::IfThenSubst : public SubstDesc {
         void getModifiedVars(const std::set<VarName> &boundVars, std::set<TypedVar> &accu) const {
             s_if.getModifiedVars(boundVars,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             condition.getAllVars(accu);
             s_if.getAllVars(accu);
         }
@@ -320,6 +361,10 @@ class Subst::IfThenElseSubst : public SubstDesc {
         Subst s_if;
         Subst s_else;
         // Methods
+        void release(std::vector<Subst> &children) {
+            children.push_back(std::move(s_if));
+            children.push_back(std::move(s_else));
+        }
         size_t hash_combine(size_t seed) const {
             return condition.hash_combine(s_if.hash_combine(s_else.hash_combine(seed)));
         }
@@ -332,7 +377,7 @@ class Subst::IfThenElseSubst : public SubstDesc {
             s_if.getModifiedVars(boundVars,accu);
             s_else.getModifiedVars(boundVars,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             condition.getAllVars(accu);
             s_if.getAllVars(accu);
             s_else.getAllVars(accu);
@@ -381,7 +426,7 @@ class Subst::SimpleAssignmentSubst : public SubstDesc {
             for(auto &e : exprs)
                 e.getFreeVars(boundVars,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &v : vars)
                 accu.insert(v.name);
             for(auto &e : exprs)
@@ -427,6 +472,10 @@ class Subst::SelectSubst : public SubstDesc {
         // Members
         std::vector<std::pair<Pred,Subst>> clauses;
         // Methods
+        void release(std::vector<Subst> &children) {
+            for(auto &c : clauses)
+                children.push_back(std::move(c.second));
+        }
         size_t hash_combine(size_t seed) const {
             for(auto &p : clauses)
                 seed = p.first.hash_combine(p.second.hash_combine(seed));
@@ -438,7 +487,7 @@ class Subst::SelectSubst : public SubstDesc {
                 p.second.getFreeVars(boundVars,accu);
             }
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &p : clauses){
                 p.first.getAllVars(accu);
                 p.second.getAllVars(accu);
@@ -481,6 +530,11 @@ class Subst::SelectElseSubst : public SubstDesc {
         std::vector<std::pair<Pred,Subst>> clauses;
         Subst s_else;
         // Methods
+        void release(std::vector<Subst> &children) {
+            for(auto &c : clauses)
+                children.push_back(std::move(c.second));
+            children.push_back(std::move(s_else));
+        }
         size_t hash_combine(size_t seed) const {
             for(auto &p : clauses)
                 seed = p.first.hash_combine(p.second.hash_combine(seed));
@@ -493,7 +547,7 @@ class Subst::SelectElseSubst : public SubstDesc {
             }
             s_else.getFreeVars(boundVars,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &p : clauses){
                 p.first.getAllVars(accu);
                 p.second.getAllVars(accu);
@@ -541,6 +595,10 @@ class Subst::CaseSubst : public SubstDesc {
         Expr e;
         std::vector<CaseChoice> cases;
         // Methods
+        void release(std::vector<Subst> &children) {
+            for(auto &c : cases)
+                children.push_back(std::move(c.body));
+        }
         size_t hash_combine(size_t seed) const {
             for(auto &ch : cases){
                 seed = ch.body.hash_combine(seed);
@@ -557,7 +615,7 @@ class Subst::CaseSubst : public SubstDesc {
                 ch.body.getFreeVars(boundVars,accu);
             }
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             e.getAllVars(accu);
             for(auto &ch: cases){
                 for(auto &e : ch.values)
@@ -613,6 +671,11 @@ class Subst::CaseElseSubst : public SubstDesc {
         std::vector<CaseChoice> cases;
         Subst s_else;
         // Methods
+        void release(std::vector<Subst> &children) {
+            for(auto &c : cases)
+                children.push_back(std::move(c.body));
+            children.push_back(std::move(s_else));
+        }
         size_t hash_combine(size_t seed) const {
             for(auto &ch : cases){
                 for(auto &e : ch.values)
@@ -630,7 +693,7 @@ class Subst::CaseElseSubst : public SubstDesc {
             }
             s_else.getFreeVars(boundVars,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             e.getAllVars(accu);
             for(auto &ch: cases){
                 for(auto &e : ch.values)
@@ -690,6 +753,9 @@ class Subst::AnySubst : public SubstDesc {
         Pred p;
         Subst body;
         // Methods
+        void release(std::vector<Subst> &children) {
+            children.push_back(std::move(body));
+        }
         size_t hash_combine(size_t seed) const {
             for(auto &v : vars)
                 seed = v.hash_combine(seed);
@@ -702,7 +768,7 @@ class Subst::AnySubst : public SubstDesc {
             p.getFreeVars(boundVars2,accu);
             body.getFreeVars(boundVars2,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &v : vars)
                 accu.insert(v.name);
             p.getAllVars(accu);
@@ -741,33 +807,109 @@ class Subst::AnySubst : public SubstDesc {
         }
 };
 
-class Subst::OpCallSubst : public SubstDesc {
+/** \brief Definition of a called operation.
+ *
+ * A definition is immutable and shared by all the calls to the operation,
+ * so what does not depend on the call site is computed once per operation.
+ */
+class Subst::Operation {
     public:
         // Constructor
-        OpCallSubst(const std::string &name,
-                std::vector<Expr> &&input,
+        Operation(const std::string &name,
+                const std::vector<TypedVar> &input,
                 const std::vector<TypedVar> &output,
-                const std::vector<TypedVar> &op_input,
-                const std::vector<TypedVar> &op_output,
-                Pred &&op_precondition,
-                Subst &&op_body):
+                Pred &&precondition,
+                Subst &&body):
             name{name},
+            input{input},
+            output{output},
+            precondition{std::move(precondition)},
+            body{std::move(body)},
+            modifiedVars{computeModifiedVars()}
+        {};
+        Operation(const Operation &) = delete;
+        Operation& operator=(const Operation &) = delete;
+        // Members
+        const std::string name;
+        const std::vector<TypedVar> input;
+        const std::vector<TypedVar> output;
+        const Pred precondition;
+        const Subst body;
+        // Variables of the calling context possibly modified by the body
+        const std::set<TypedVar> modifiedVars;
+
+        // Methods
+        size_t hash_combine(size_t seed) const {
+            size_t h = cachedHash.get([this](){
+                    size_t seed = 0;
+                    for(auto &v : input)
+                        seed = v.hash_combine(seed);
+                    for(auto &v : output)
+                        seed = v.hash_combine(seed);
+                    return hashUtil::hash_combine_string(name,
+                            precondition.hash_combine(
+                                body.hash_combine(seed))); });
+            return hashUtil::hash_combine_hash(h,seed);
+        }
+        // Identifiers occuring free in the precondition or in the body, the parameters excepted
+        const std::vector<VarName>& getInnerFreeVars() const {
+            return innerFreeVars.get([this](){
+                    std::set<VarName> accu;
+                    precondition.getFreeVars(parameters(),accu);
+                    body.getFreeVars(parameters(),accu);
+                    return accu; });
+        }
+        // Identifiers occuring (free or bound) in the definition, the parameters included
+        const std::vector<VarName>& getAllVars() const {
+            return allVars.get([this](){
+                    VarSet accu;
+                    for(auto &v : input)
+                        accu.insert(v.name);
+                    for(auto &v : output)
+                        accu.insert(v.name);
+                    precondition.getAllVars(accu);
+                    body.getAllVars(accu);
+                    return accu; });
+        }
+        // Copy of the definition where the fresh identifier id is replaced by v, or the definition itself if id does not occur
+        std::shared_ptr<const Operation> substFreshId(const std::shared_ptr<const Operation> &self,
+                const std::string &id, const VarName &v) const;
+
+    private:
+        hashUtil::CachedHash cachedHash;
+        FreeVarsCache innerFreeVars;
+        FreeVarsCache allVars;
+
+        std::set<VarName> parameters() const {
+            std::set<VarName> res;
+            for(auto &v : input)
+                res.insert(v.name);
+            for(auto &v : output)
+                res.insert(v.name);
+            return res;
+        }
+        std::set<TypedVar> computeModifiedVars() const {
+            std::set<TypedVar> accu;
+            body.getModifiedVars(parameters(),accu);
+            return accu;
+        }
+};
+
+class Subst::OpCallSubst : public SubstDesc {
+    public:
+        // Constructor
+        OpCallSubst(std::vector<Expr> &&input,
+                const std::vector<TypedVar> &output,
+                const std::shared_ptr<const Operation> &operation):
             input{std::move(input)},
             output{output},
-            op_input{op_input},
-            op_output{op_output},
-            op_precondition{std::move(op_precondition)},
-            op_body{std::move(op_body)}
+            operation{operation}
         {};
         // Members
-        std::string name;
         std::vector<Expr> input;
         std::vector<TypedVar> output;
-
-        std::vector<TypedVar> op_input;
-        std::vector<TypedVar> op_output;
-        Pred op_precondition;
-        Subst op_body;
+        // Shared with the other calls to the operation
+        std::shared_ptr<const Operation> operation;
 
         // Methods
         size_t hash_combine(size_t seed) const {
@@ -775,13 +917,7 @@ class Subst::OpCallSubst : public SubstDesc {
                 seed = e.hash_combine(seed);
             for(auto &v : output)
                 seed = v.hash_combine(seed);
-            for(auto &v : op_input)
-                seed = v.hash_combine(seed);
-            for(auto &v : op_output)
-                seed = v.hash_combine(seed);
-            return hashUtil::hash_combine_string(name,
-                    op_precondition.hash_combine(
-                        op_body.hash_combine(seed)));
+            return operation->hash_combine(seed);
         }
         void getFreeVars(const std::set<VarName> &boundVars, std::set<VarName> &accu) const {
             for(auto &v : output){
@@ -790,37 +926,23 @@ class Subst::OpCallSubst : public SubstDesc {
             }
             for(auto &e : input)
                 e.getFreeVars(boundVars,accu);
-            std::set<VarName> boundVars2;
-            for(auto &v : op_input)
-                boundVars2.insert(v.name);
-            for(auto &v : op_output)
-                boundVars2.insert(v.name);
-            op_precondition.getFreeVars(boundVars2,accu);
-            op_body.getFreeVars(boundVars2,accu);
+            auto &fv = operation->getInnerFreeVars();
+            accu.insert(fv.begin(),fv.end());
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             for(auto &v : output)
                 accu.insert(v.name);
             for(auto &e : input)
                 e.getAllVars(accu);
-            for(auto &v : op_input)
-                accu.insert(v.name);
-            for(auto &v : op_output)
-                accu.insert(v.name);
-            op_precondition.getAllVars(accu);
-            op_body.getAllVars(accu);
+            auto &av = operation->getAllVars();
+            accu.insert(av.begin(),av.end());
         }
         void getModifiedVars(const std::set<VarName> &boundVars, std::set<TypedVar> &accu) const {
             for(auto &v : output){
                 if(boundVars.find(v.name) == boundVars.end())
                     accu.insert(v);
             }
-            std::set<VarName> boundVars2;
-            for(auto &v : op_input)
-                boundVars2.insert(v.name);
-            for(auto &v : op_output)
-                boundVars2.insert(v.name);
-            op_body.getModifiedVars(boundVars2,accu);
+            accu.insert(operation->modifiedVars.begin(),operation->modifiedVars.end());
         }
         void alpha(const std::map<VarName,VarName> &map){
             for(size_t i=0;i<output.size();i++){
@@ -832,13 +954,8 @@ class Subst::OpCallSubst : public SubstDesc {
                 e.alpha(map);
         }
         void getInnerFreeVars(std::set<VarName> &accu) const {
-            std::set<VarName> boundVars;
-            for(auto &v : op_input)
-                boundVars.insert(v.name);
-            for(auto &v : op_output)
-                boundVars.insert(v.name);
-            op_precondition.getFreeVars(boundVars,accu);
-            op_body.getFreeVars(boundVars,accu);
+            auto &fv = operation->getInnerFreeVars();
+            accu.insert(fv.begin(),fv.end());
         }
         void substFreshId(const std::string &id, const VarName &v){
             for(size_t i=0;i<output.size();i++){
@@ -847,22 +964,13 @@ class Subst::OpCallSubst : public SubstDesc {
             }
             for(auto &e : input)
                 e.substFreshId(id,v);
-            for(size_t i=0;i<op_output.size();i++){
-                if(op_output[i].name.kind() == VarName::Kind::FreshId && op_output[i].name.prefix() == id)
-                    op_output[i].name = v;
-            }
-            for(size_t i=0;i<op_input.size();i++){
-                if(op_input[i].name.kind() == VarName::Kind::FreshId && op_input[i].name.prefix() == id)
-                    op_input[i].name = v;
-            }
-            op_precondition.substFreshId(id,v);
-            op_body.substFreshId(id,v);
+            operation = operation->substFreshId(operation,id,v);
         }
         SubstDesc* copy() const {
             std::vector<Expr> input2;
             for(auto &e : input)
                 input2.push_back(e.copy());
-            return new OpCallSubst(name,std::move(input2),output,op_input,op_output,op_precondition.copy(),op_body.copy());
+            return new OpCallSubst(std::move(input2),output,operation);
         }
 };
 
@@ -878,6 +986,9 @@ class Subst::WhileSubst : public SubstDesc {
         Pred inv;
         Expr var;
         // Methods
+        void release(std::vector<Subst> &children) {
+            children.push_back(std::move(body));
+        }
         size_t hash_combine(size_t seed) const {
             return cond.hash_combine(
                     body.hash_combine(
@@ -890,7 +1001,7 @@ class Subst::WhileSubst : public SubstDesc {
             inv.getFreeVars(boundVars,accu);
             var.getFreeVars(boundVars,accu);
         }
-        void getAllVars(std::set<VarName> &accu) const {
+        void getAllVars(VarSet &accu) const {
             cond.getAllVars(accu);
             body.getAllVars(accu);
             inv.getAllVars(accu);
@@ -0,0 +1,117 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "substEnv.h"
+#include "pred.h"
+
+SubstEnv::SubstEnv(const std::map<VarName,Expr> &map):
+    active{0}
+{
+    for(auto &p : map){
+        std::set<VarName> fv = p.second.getFreeVars();
+        freeVarSets.emplace_back(fv.begin(),fv.end());
+        Binding b { &p.second, &freeVarSets.back() };
+        bindings[p.first].push_back(b);
+        enable(b);
+    }
+}
+
+void SubstEnv::enable(const Binding &b){
+    if(b.value == nullptr)
+        return;
+    active++;
+    for(auto &v : *b.freeVars)
+        freeVarCount[v]++;
+}
+
+void SubstEnv::disable(const Binding &b){
+    if(b.value == nullptr)
+        return;
+    active--;
+    for(auto &v : *b.freeVars){
+        auto it = freeVarCount.find(v);
+        if(--it->second == 0)
+            freeVarCount.erase(it);
+    }
+}
+
+const Expr *SubstEnv::find(const VarName &v) const {
+    auto it = bindings.find(v);
+    if(it == bindings.end() || it->second.empty())
+        return nullptr;
+    return it->second.back().value;
+}
+
+void SubstEnv::push(const std::vector<TypedVar> &vars){
+    frames.emplace_back();
+    std::vector<VarName> &frame = frames.back();
+    for(auto &v : vars){
+        std::vector<Binding> &stack = bindings[v.name];
+        if(!stack.empty())
+            disable(stack.back());
+        stack.push_back({nullptr,nullptr});
+        frame.push_back(v.name);
+    }
+}
+
+bool SubstEnv::captures(const std::vector<TypedVar> &vars) const {
+    if(active == 0)
+        return false;
+    for(auto &v : vars){
+        if(freeVarCount.find(v.name) != freeVarCount.end())
+            return true;
+    }
+    return false;
+}
+
+void SubstEnv::rename(std::vector<TypedVar> &vars, VarSet &avoid){
+    assert(!frames.empty() && frames.back().size() == vars.size());
+    const std::vector<VarName> &frame = frames.back();
+    std::vector<VarName> names;
+    names.reserve(freeVarCount.size() + vars.size());
+    for(auto &p : freeVarCount)
+        names.push_back(p.first);
+    for(auto &v : vars)
+        names.push_back(v.name);
+    avoid.insert(names.begin(),names.end());
+    FreshNames fresh(avoid);
+    for(size_t i=0;i<vars.size();i++){
+        if(freeVarCount.find(vars[i].name) == freeVarCount.end())
+            continue;
+        VarName nv = fresh.fresh(vars[i].name);
+        renamings.push_back(Expr::makeIdent(nv,vars[i].type));
+        freeVarSets.push_back({nv});
+        Binding b { &renamings.back(), &freeVarSets.back() };
+        bindings[frame[i]].back() = b;
+        enable(b);
+        vars[i].name = nv;
+    }
+}
+
+void SubstEnv::pop(){
+    assert(!frames.empty());
+    std::vector<VarName> &frame = frames.back();
+    for(auto it = frame.rbegin(); it != frame.rend(); ++it){
+        auto bit = bindings.find(*it);
+        std::vector<Binding> &stack = bit->second;
+        disable(stack.back());
+        stack.pop_back();
+        if(stack.empty())
+            bindings.erase(bit);
+        else
+            enable(stack.back());
+    }
+    frames.pop_back();
+}
@@ -0,0 +1,74 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef SUBSTENV_H
+#define SUBSTENV_H
+
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+#include "expr.h"
+
+/** \brief Scoped environment of a simultaneous capture-avoiding substitution.
+ *
+ * The free variables of each substituend are computed once, when the
+ * environment is built. Binders push a frame that shadows the substituted
+ * variables they bind instead of copying the map, and only the bound
+ * variables that would capture a free variable of a substituend still in
+ * scope are renamed.
+ *
+ * The map given to the constructor must outlive the environment.
+ */
+class SubstEnv {
+    public:
+        explicit SubstEnv(const std::map<VarName,Expr> &map);
+        SubstEnv(const SubstEnv &) = delete;
+        SubstEnv& operator=(const SubstEnv &) = delete;
+
+        // The expression substituted for v in the current scope (nullptr if none)
+        const Expr *find(const VarName &v) const;
+        // True if no variable is substituted in the current scope
+        bool empty() const { return active == 0; };
+
+        // Enters the scope of a binder: the substitutions of vars are shadowed
+        void push(const std::vector<TypedVar> &vars);
+        // True if a variable of the innermost binder occurs free in a substituend in scope
+        bool captures(const std::vector<TypedVar> &vars) const;
+        // Renames the capturing variables of the innermost binder. The new
+        // names avoid the free variables of the substituends in scope and
+        // avoid (all the variables occurring in the scope of the binder):
+        // each one takes the suffix above the highest one in use for its prefix.
+        void rename(std::vector<TypedVar> &vars, VarSet &avoid);
+        // Leaves the innermost binder
+        void pop();
+
+    private:
+        struct Binding {
+            const Expr *value; // nullptr when shadowed
+            const std::vector<VarName> *freeVars;
+        };
+        void enable(const Binding &b);
+        void disable(const Binding &b);
+
+        std::map<VarName,std::vector<Binding>> bindings;
+        std::map<VarName,int> freeVarCount; // occurrences in the substituends in scope
+        std::vector<std::vector<VarName>> frames;
+        std::deque<std::vector<VarName>> freeVarSets;
+        std::deque<Expr> renamings;
+        int active;
+};
+
+#endif // SUBSTENV_H
@@ -16,10 +16,11 @@
 #include "substReader.h"
 #include "exprReader.h"
 #include "predReader.h"
-#include <map>
+#include "xmlTags.h"
+#include <cstring>
 
 namespace Xml {
-    const std::map<std::string, Subst::SKind> ptags = {
+    constexpr auto ptags = makeStrTable<Subst::SKind>({
         {"Bloc_Sub", Subst::SKind::Block},
         {"Skip", Subst::SKind::Skip},
         {"Assert_Sub", Subst::SKind::Assert},
@@ -32,7 +33,7 @@ namespace Xml {
         {"Operation_Call", Subst::SKind::OperationCall},
         {"While", Subst::SKind::While},
         {"Witness", Subst::SKind::Witness},
-    };
+    });
 
     Subst readSubstitution(const QDomElement &dom, const std::vector<BType> &typeInfos){
         if (dom.isNull())
@@ -40,23 +41,23 @@ namespace Xml {
 
         QString tagName = dom.tagName();
         Subst::SKind kind;
-        if(tagName == "Nary_Sub") {
+        if(tagName == QLatin1String("Nary_Sub")) {
             QString op = dom.attribute("op");
-            if(op == "||")
+            if(op == QLatin1String("||"))
                 kind = Subst::SKind::Parallel;
-            else if(op == ";")
+            else if(op == QLatin1String(";"))
                 kind = Subst::SKind::Sequence;
-            else if(op == "CHOICE")
+            else if(op == QLatin1String("CHOICE"))
                 kind = Subst::SKind::Choice;
             else
                 throw SubstReaderException("Unknown nary substitution operator '"+op.toStdString()+"'.");
         }
         else
         {
-            auto it = ptags.find(tagName.toStdString());
-            if(it == ptags.end())
+            auto it = find(ptags,tagName);
+            if(it == nullptr)
                 throw SubstReaderException("Unexpected tag '" + tagName.toStdString() + "'.");
-            kind = it->second;
+            kind = it->value;
         };
 
         switch(kind){
@@ -67,7 +68,7 @@ namespace Xml {
             case Subst::SKind::Assert:
                 {
                     QDomElement guard;
-                    if(tagName == "PRE_Sub"){
+                    if(tagName == QLatin1String("PRE_Sub")){
                         guard = dom.firstChildElement("Precondition");
                         if(guard.isNull())
                             throw SubstReaderException("Missing child 'Precondition' in PRE_Sub element.");
@@ -230,7 +231,7 @@ namespace Xml {
                     QDomElement wt_child = wt.firstChildElement();
                     if(wt_child.isNull())
                         throw SubstReaderException("Missing child in 'Witnesses' element.");
-                    if(wt_child.tagName() == "Nary_Pred"){
+                    if(wt_child.tagName() == QLatin1String("Nary_Pred")){
                         if(wt_child.attribute("op") != "&")
                             throw SubstReaderException("Expected Nary_Pred with attribute op '&'.");
                         for(    QDomElement ce = wt_child.firstChildElement("Exp_Comparison");
@@ -240,7 +241,7 @@ namespace Xml {
                             if(ce.attribute("op") != "=")
                                 throw SubstReaderException("Expected Exp_Comparison with attribute op '='.");
                             QDomElement id = ce.firstChildElement();
-                            if(id.tagName() != "Id")
+                            if(id.tagName() != QLatin1String("Id"))
                                 throw SubstReaderException("Id element expected.");
                             if(!id.hasAttribute("value"))
                                 throw SubstReaderException("value attribute expected.");
@@ -249,11 +250,11 @@ namespace Xml {
                             witnesses.insert(std::move(pair));
                         }
                     }
-                    else if(wt_child.tagName() == "Exp_Comparison"){
+                    else if(wt_child.tagName() == QLatin1String("Exp_Comparison")){
                         if(wt_child.attribute("op") != "=")
                             throw SubstReaderException("Expected Exp_Comparison with attribute op '='.");
                         QDomElement id = wt_child.firstChildElement();
-                        if(id.tagName() != "Id")
+                        if(id.tagName() != QLatin1String("Id"))
                             throw SubstReaderException("Id element expected.");
                         if(!id.hasAttribute("value"))
                             throw SubstReaderException("value attribute expected.");
@@ -418,4 +419,506 @@ namespace Xml {
         };
         assert(false); // unreachable
     };
+
+    Subst readSubstitution(const QDomElement &dom, const std::vector<BType> &typeInfos, Arena &arena){
+        Arena::Scope scope(arena);
+        return readSubstitution(dom,typeInfos);
+    }
+
+    // Moves to the next child element of the current element.
+    // Returns false when the end element of the current element is reached.
+    static bool nextChild(QXmlStreamReader &stream){
+        if(stream.readNextStartElement())
+            return true;
+        if(stream.hasError())
+            throw SubstReaderException(stream.errorString().toStdString());
+        return false;
+    }
+
+    static void expectChild(QXmlStreamReader &stream, const char *tagName){
+        if(!nextChild(stream))
+            throw SubstReaderException("Missing child element in '" + std::string(tagName) + "'.");
+    }
+
+    // Same, for the current element. On failure the stream is on its end element, which carries the same name.
+    static void expectChild(QXmlStreamReader &stream){
+        if(!nextChild(stream))
+            throw SubstReaderException("Missing child element in '" + stream.name().toString().toStdString() + "'.");
+    }
+
+    // The following read the single child of a wrapper element such as 'Body' or 'Condition'
+    static Pred readWrappedPredicate(QXmlStreamReader &stream, const std::vector<BType> &typeInfos){
+        expectChild(stream);
+        Pred res = readPredicate(stream,typeInfos);
+        stream.skipCurrentElement();
+        return res;
+    }
+
+    static Subst readWrappedSubstitution(QXmlStreamReader &stream, const std::vector<BType> &typeInfos){
+        expectChild(stream);
+        Subst res = readSubstitution(stream,typeInfos);
+        stream.skipCurrentElement();
+        return res;
+    }
+
+    static Expr readWrappedExpression(QXmlStreamReader &stream, const std::vector<BType> &typeInfos){
+        expectChild(stream);
+        Expr res = readExpression(stream,typeInfos);
+        stream.skipCurrentElement();
+        return res;
+    }
+
+    static std::vector<TypedVar> readVariables(QXmlStreamReader &stream, const std::vector<BType> &typeInfos){
+        std::vector<TypedVar> vec;
+        while(nextChild(stream))
+            vec.push_back(VarNameFromId(stream,typeInfos));
+        return vec;
+    }
+
+    // Reads a witness 'Exp_Comparison' element of the form id = expr
+    static void readWitness(QXmlStreamReader &stream, const std::vector<BType> &typeInfos, std::map<std::string,Expr> &witnesses){
+        if(stream.attributes().value("op") != "=")
+            throw SubstReaderException("Expected Exp_Comparison with attribute op '='.");
+        if(!nextChild(stream) || stream.name() != QLatin1String("Id"))
+            throw SubstReaderException("Id element expected.");
+        const QXmlStreamAttributes attrs = stream.attributes();
+        if(!attrs.hasAttribute("value"))
+            throw SubstReaderException("value attribute expected.");
+        std::string id = attrs.value("value").toString().toStdString();
+        stream.skipCurrentElement();
+        expectChild(stream,"Exp_Comparison");
+        std::pair<std::string,Expr> pair = {id, readExpression(stream,typeInfos)};
+        witnesses.insert(std::move(pair));
+        stream.skipCurrentElement();
+    }
+
+    Subst readSubstitution(QXmlStreamReader &stream, const std::vector<BType> &typeInfos){
+        if (!stream.isStartElement())
+            throw SubstReaderException("Start element expected.");
+
+        const QXmlStreamAttributes attrs = stream.attributes();
+        const char *tagName;
+        Subst::SKind kind;
+        if(stream.name() == QLatin1String("Nary_Sub")) {
+            tagName = "Nary_Sub";
+            const QStringRef op = attrs.value("op");
+            if(op == QLatin1String("||"))
+                kind = Subst::SKind::Parallel;
+            else if(op == QLatin1String(";"))
+                kind = Subst::SKind::Sequence;
+            else if(op == QLatin1String("CHOICE"))
+                kind = Subst::SKind::Choice;
+            else
+                throw SubstReaderException("Unknown nary substitution operator '"+op.toString().toStdString()+"'.");
+        }
+        else
+        {
+            auto it = find(ptags,stream.name());
+            if(it == nullptr)
+                throw SubstReaderException("Unexpected tag '" + stream.name().toString().toStdString() + "'.");
+            tagName = it->key;
+            kind = it->value;
+        };
+
+        switch(kind){
+            case Subst::SKind::Block:
+                {
+                    expectChild(stream,tagName);
+                    Subst body = readSubstitution(stream,typeInfos);
+                    stream.skipCurrentElement();
+                    return Subst::makeBlock(std::move(body));
+                }
+            case Subst::SKind::Skip:
+                stream.skipCurrentElement();
+                return Subst::makeSkip();
+            case Subst::SKind::Assert:
+                {
+                    const char *guardTag = (std::strcmp(tagName,"PRE_Sub") == 0) ? "Precondition" : "Guard";
+                    Pred guard;
+                    Subst body;
+                    bool hasGuard = false, hasBody = false;
+                    while(nextChild(stream)){
+                        if(stream.name() == QLatin1String(guardTag)){
+                            guard = readWrappedPredicate(stream,typeInfos);
+                            hasGuard = true;
+                        } else if(stream.name() == QLatin1String("Body")){
+                            body = readWrappedSubstitution(stream,typeInfos);
+                            hasBody = true;
+                        } else {
+                            stream.skipCurrentElement();
+                        }
+                    }
+                    if(!hasGuard){
+                        if(std::strcmp(tagName,"PRE_Sub") == 0)
+                            throw SubstReaderException("Missing child 'Precondition' in PRE_Sub element.");
+                        else
+                            throw SubstReaderException("Missing child 'Guard' in Assert_Sub element.");
+                    }
+                    if(!hasBody)
+                        throw SubstReaderException("Missing child 'Body' in Assert_Sub or PRE_Sub element.");
+                    return Subst::makeAssert(std::move(guard),std::move(body));
+                }
+            case Subst::SKind::IfThen:
+            case Subst::SKind::IfThenElse:
+                {
+                    Pred condition;
+                    Subst then, els;
+                    bool hasCondition = false, hasThen = false, hasElse = false;
+                    while(nextChild(stream)){
+                        if(stream.name() == QLatin1String("Condition")){
+                            condition = readWrappedPredicate(stream,typeInfos);
+                            hasCondition = true;
+                        } else if(stream.name() == QLatin1String("Then")){
+                            then = readWrappedSubstitution(stream,typeInfos);
+                            hasThen = true;
+                        } else if(stream.name() == QLatin1String("Else")){
+                            els = readWrappedSubstitution(stream,typeInfos);
+                            hasElse = true;
+                        } else {
+                            stream.skipCurrentElement();
+                        }
+                    }
+                    if(!hasCondition)
+                        throw SubstReaderException("Missing child 'Condition' in 'If_Sub' element.");
+                    if(!hasThen)
+                        throw SubstReaderException("Missing child 'Then' in 'If_Sub' element.");
+                    if(!hasElse)
+                        return Subst::makeIfThen(std::move(condition),std::move(then));
+                    else
+                        return Subst::makeIfThenElse(std::move(condition),std::move(then),std::move(els));
+                }
+            case Subst::SKind::SimpleAssignment:
+                {
+                    std::vector<TypedVar> vec;
+                    std::vector<Expr> vec2;
+                    bool hasVars = false, hasValues = false;
+                    while(nextChild(stream)){
+                        if(stream.name() == QLatin1String("Variables")){
+                            vec = readVariables(stream,typeInfos);
+                            hasVars = true;
+                        } else if(stream.name() == QLatin1String("Values")){
+                            while(nextChild(stream))
+                                vec2.push_back(readExpression(stream,typeInfos));
+                            hasValues = true;
+                        } else {
+                            stream.skipCurrentElement();
+                        }
+                    }
+                    if(!hasVars)
+                        throw SubstReaderException("Missing child 'Variables' in 'Simple_Assignement_Sub' element.");
+                    if(!hasValues)
+                        throw SubstReaderException("Missing child 'Values' in 'Simple_Assignement_Sub' element.");
+                    return Subst::makeSimpleAssignment(vec,std::move(vec2));
+                }
+            case Subst::SKind::Select:
+            case Subst::SKind::SelectElse:
+                {
+                    std::vector<std::pair<Pred,Subst>> vec;
+                    Subst els;
+                    bool hasClauses = false, hasElse = false;
+                    while(nextChild(stream)){
+                        if(stream.name() == QLatin1String("When_Clauses")){
+                            while(nextChild(stream)){
+                                if(stream.name() != QLatin1String("When")){
+                                    stream.skipCurrentElement();
+                                    continue;
+                                }
+                                Pred cond;
+                                Subst then;
+                                bool hasCond = false, hasThen = false;
+                                while(nextChild(stream)){
+                                    if(stream.name() == QLatin1String("Condition")){
+                                        cond = readWrappedPredicate(stream,typeInfos);
+                                        hasCond = true;
+                                    } else if(stream.name() == QLatin1String("Then")){
+                                        then = readWrappedSubstitution(stream,typeInfos);
+                                        hasThen = true;
+                                    } else {
+                                        stream.skipCurrentElement();
+                                    }
+                                }
+                                if(!hasCond)
+                                    throw SubstReaderException("Missing child 'Condition' in 'When' element.");
+                                if(!hasThen)
+                                    throw SubstReaderException("Missing child 'Then' in 'When' element.");
+                                vec.push_back( { std::move(cond), std::move(then) } );
+                            }
+                            hasClauses = true;
+                        } else if(stream.name() == QLatin1String("Else")){
+                            els = readWrappedSubstitution(stream,typeInfos);
+                            hasElse = true;
+                        } else {
+                            stream.skipCurrentElement();
+                        }
+                    }
+                    if(!hasClauses)
+                        throw SubstReaderException("Missing child 'When_Clauses' in 'Select' element.");
+                    if(!hasElse)
+                        return Subst::makeSelect(std::move(vec));
+                    else
+                        return Subst::makeSelectElse(std::move(vec),std::move(els));
+                }
+            case Subst::SKind::Case:
+            case Subst::SKind::CaseElse:
+                {
+                    Expr value;
+                    std::vector<Subst::CaseChoice> vec;
+                    Subst els;
+                    bool hasValue = false, hasChoices = false, hasElse = false;
+                    while(nextChild(stream)){
+                        if(stream.name() == QLatin1String("Value")){
+                            value = readWrappedExpression(stream,typeInfos);
+                            hasValue = true;
+                        } else if(stream.name() == QLatin1String("Choices")){
+                            while(nextChild(stream)){
+                                if(stream.name() != QLatin1String("Choice")){
+                                    stream.skipCurrentElement();
+                                    continue;
+                                }
+                                Subst::CaseChoice ch;
+                                bool hasThen = false;
+                                while(nextChild(stream)){
+                                    if(stream.name() == QLatin1String("Value")){
+                                        ch.values.push_back(readWrappedExpression(stream,typeInfos));
+                                    } else if(stream.name() == QLatin1String("Then")){
+                                        ch.body = readWrappedSubstitution(stream,typeInfos);
+                                        hasThen = true;
+                                    } else {
+                                        stream.skipCurrentElement();
+                                    }
+                                }
+                                if(ch.values.empty())
+                                    throw SubstReaderException("Missing child 'Value' in 'Choice' element.");
+                                if(!hasThen)
+                                    throw SubstReaderException("Missing child 'Then' in 'Choice' element.");
+                                vec.push_back(std::move(ch));
+                            }
+                            hasChoices = true;
+                        } else if(stream.name() == QLatin1String("Else")){
+                            els = readWrappedSubstitution(stream,typeInfos);
+                            hasElse = true;
+                        } else {
+                            stream.skipCurrentElement();
+                        }
+                    }
+                    if(!hasValue)
+                        throw SubstReaderException("Missing child 'Value' in 'Case_Sub' element.");
+                    if(!hasChoices)
+                        throw SubstReaderException("Missing child 'Choices' in 'Case_Sub' element.");
+                    if(!hasElse)
+                        return Subst::makeCase(std::move(value),std::move(vec));
+                    else
+                        return Subst::makeCaseElse(std::move(value),std::move(vec),std::move(els));
+                }
+            case Subst::SKind::Any:
+                {
+                    std::vector<TypedVar> vec;
+                    Pred pred;
+                    Subst then;
+                    bool hasVars = false, hasPred = false, hasThen = false;
+                    while(nextChild(stream)){
+                        if(stream.name() == QLatin1String("Variables")){
+                            vec = readVariables(stream,typeInfos);
+                            hasVars = true;
+                        } else if(stream.name() == QLatin1String("Pred")){
+                            pred = readWrappedPredicate(stream,typeInfos);
+                            hasPred = true;
+                        } else if(stream.name() == QLatin1String("Then")){
+                            then = readWrappedSubstitution(stream,typeInfos);
+                            hasThen = true;
+                        } else {
+                            stream.skipCurrentElement();
+                        }
+                    }
+                    if(!hasVars)
+                        throw SubstReaderException("Missing child 'Variables' in 'ANY_Sub' element.");
+                    if(!hasPred)
+                        throw SubstReaderException("Missing child 'Pred' in 'ANY_Sub' element.");
+                    if(!hasThen)
+                        throw SubstReaderException("Missing child 'Then' in 'ANY_Sub' element.");
+                    return Subst::makeAny(vec,std::move(pred),std::move(then));
+                }
+            case Subst::SKind::Witness:
+                {
+                    std::map<std::string,Expr> witnesses;
+                    Subst body;
+                    bool hasWitnesses = false, hasBody = false;
+                    while(nextChild(stream)){
+                        if(stream.name() == QLatin1String("Witnesses")){
+                            if(!nextChild(stream))
+                                throw SubstReaderException("Missing child in 'Witnesses' element.");
+                            if(stream.name() == QLatin1String("Nary_Pred")){
+                                if(stream.attributes().value("op") != "&")
+                                    throw SubstReaderException("Expected Nary_Pred with attribute op '&'.");
+                                while(nextChild(stream)){
+                                    if(stream.name() == QLatin1String("Exp_Comparison"))
+                                        readWitness(stream,typeInfos,witnesses);
+                                    else
+                                        stream.skipCurrentElement();
+                                }
+                            } else if(stream.name() == QLatin1String("Exp_Comparison")){
+                                readWitness(stream,typeInfos,witnesses);
+                            } else {
+                                throw SubstReaderException("Nary_Pred or Exp_Comparison element expected.");
+                            }
+                            stream.skipCurrentElement();
+                            hasWitnesses = true;
+                        } else if(stream.name() == QLatin1String("Body")){
+                            body = readWrappedSubstitution(stream,typeInfos);
+                            hasBody = true;
+                        } else {
+                            stream.skipCurrentElement();
+                        }
+                    }
+                    if(!hasWitnesses)
+                        throw SubstReaderException("Missing child 'Witnesses' in 'Witness' element.");
+                    if(!hasBody)
+                        throw SubstReaderException("Missing child 'Body' in 'Witness' element.");
+                    return Subst::makeWitness(std::move(witnesses),std::move(body));
+                }
+            case Subst::SKind::OperationCall:
+                {
+                    std::string name;
+                    std::vector<Expr> v_input;
+                    std::vector<TypedVar> v_output;
+                    std::vector<TypedVar> op_inputs;
+                    std::vector<TypedVar> op_outputs;
+                    Pred pre = Pred::makeTrue();
+                    Subst body;
+                    bool hasName = false, hasOperation = false, hasBody = false;
+                    while(nextChild(stream)){
+                        if(stream.name() == QLatin1String("Name")){
+                            if(!nextChild(stream) || stream.name() != QLatin1String("Id"))
+                                throw SubstReaderException("Missing child 'Id' in 'Name' element.");
+                            if(!stream.attributes().hasAttribute("value"))
+                                throw SubstReaderException("Missing attribute 'value' in 'Id' element.");
+                            name = stream.attributes().value("value").toString().toStdString();
+                            stream.skipCurrentElement(); // Id
+                            stream.skipCurrentElement(); // Name
+                            hasName = true;
+                        } else if(stream.name() == QLatin1String("Input_Parameters")){
+                            // Inputs (Effective)
+                            while(nextChild(stream))
+                                v_input.push_back(readExpression(stream,typeInfos));
+                        } else if(stream.name() == QLatin1String("Output_Parameters")){
+                            // Outputs (Effective)
+                            v_output = readVariables(stream,typeInfos);
+                        } else if(stream.name() == QLatin1String("Operation")){
+                            if(!stream.attributes().hasAttribute("name"))
+                                throw SubstReaderException("Missing attribute 'name' in 'Operation' element.");
+                            while(nextChild(stream)){
+                                if(stream.name() == QLatin1String("Output_Parameters")){
+                                    // Outputs (Formal)
+                                    while(nextChild(stream)){
+                                        if(stream.name() == QLatin1String("Id"))
+                                            op_outputs.push_back(VarNameFromId(stream,typeInfos));
+                                        else
+                                            stream.skipCurrentElement();
+                                    }
+                                } else if(stream.name() == QLatin1String("Input_Parameters")){
+                                    // Inputs (Formal)
+                                    while(nextChild(stream)){
+                                        if(stream.name() == QLatin1String("Id"))
+                                            op_inputs.push_back(VarNameFromId(stream,typeInfos));
+                                        else
+                                            stream.skipCurrentElement();
+                                    }
+                                } else if(stream.name() == QLatin1String("Precondition")){
+                                    pre = readWrappedPredicate(stream,typeInfos);
+                                } else if(stream.name() == QLatin1String("Body")){
+                                    body = readWrappedSubstitution(stream,typeInfos);
+                                    hasBody = true;
+                                } else {
+                                    stream.skipCurrentElement();
+                                }
+                            }
+                            hasOperation = true;
+                        } else {
+                            stream.skipCurrentElement();
+                        }
+                    }
+                    if(!hasName)
+                        throw SubstReaderException("Missing child 'Name' in 'Operation_Call' element.");
+                    if(!hasOperation)
+                        throw SubstReaderException("Missing child 'Operation' in 'Operation_Call' element.");
+
+                    if(v_input.size() != op_inputs.size())
+                        throw SubstReaderException("Wrong number of input parameters in call to operation "
+                                + name
+                                + " (Formal: " + std::to_string(op_inputs.size()) + ", "
+                                + "Effective: " +std::to_string(v_input.size()) + ")");
+
+                    if(v_output.size() != op_outputs.size())
+                        throw SubstReaderException("Wrong number of output parameters in call to operation "
+                                + name
+                                + " (Formal: " + std::to_string(op_outputs.size()) + ", "
+                                + "Effective: " +std::to_string(v_output.size()) + ")");
+
+                    if(!hasBody)
+                        throw SubstReaderException("Missing body in call to operation " + name);
+
+                    return Subst::makeOpCall(
+                            name,
+                            std::move(v_input),
+                            v_output,
+                            op_inputs,
+                            op_outputs,
+                            std::move(pre),
+                            std::move(body));
+                }
+            case Subst::SKind::While:
+                {
+                    Pred cond, inv;
+                    Subst body;
+                    Expr var;
+                    bool hasCond = false, hasBody = false, hasInv = false, hasVar = false;
+                    while(nextChild(stream)){
+                        if(stream.name() == QLatin1String("Condition")){
+                            cond = readWrappedPredicate(stream,typeInfos);
+                            hasCond = true;
+                        } else if(stream.name() == QLatin1String("Body")){
+                            body = readWrappedSubstitution(stream,typeInfos);
+                            hasBody = true;
+                        } else if(stream.name() == QLatin1String("Invariant")){
+                            inv = readWrappedPredicate(stream,typeInfos);
+                            hasInv = true;
+                        } else if(stream.name() == QLatin1String("Variant")){
+                            var = readWrappedExpression(stream,typeInfos);
+                            hasVar = true;
+                        } else {
+                            stream.skipCurrentElement();
+                        }
+                    }
+                    if(!hasCond)
+                        throw SubstReaderException("Missing child 'Condition' in 'While' element.");
+                    if(!hasBody)
+                        throw SubstReaderException("Missing child 'Body' in 'While' element.");
+                    if(!hasInv)
+                        throw SubstReaderException("Missing child 'Invariant' in 'While' element.");
+                    if(!hasVar)
+                        throw SubstReaderException("Missing child 'Variant' in 'While' element.");
+                    return Subst::makeWhile(std::move(cond),std::move(body),std::move(inv),std::move(var));
+                }
+            case Subst::SKind::Sequence:
+            case Subst::SKind::Parallel:
+            case Subst::SKind::Choice:
+                {
+                    std::vector<Subst> vec;
+                    while(nextChild(stream))
+                        vec.push_back(readSubstitution(stream,typeInfos));
+                    if(kind == Subst::SKind::Sequence)
+                        return Subst::makeSequence(std::move(vec));
+                    else if(kind == Subst::SKind::Parallel)
+                        return Subst::makeParallel(std::move(vec));
+                    else
+                        return Subst::makeChoice(std::move(vec));
+                }
+        };
+        assert(false); // unreachable
+    };
+
+    Subst readSubstitution(QXmlStreamReader &stream, const std::vector<BType> &typeInfos, Arena &arena){
+        Arena::Scope scope(arena);
+        return readSubstitution(stream,typeInfos);
+    }
 }
@@ -18,6 +18,7 @@
 
 #include "subst.h"
 #include<QDomElement>
+#include<QXmlStreamReader>
 
 namespace Xml {
     class SubstReaderException : public std::exception
@@ -31,6 +32,13 @@ namespace Xml {
     };
 
     Subst readSubstitution(const QDomElement &dom, const std::vector<BType> &typeInfos);
+    // Same as above, with every node allocated in arena. The arena must outlive the returned substitution.
+    Subst readSubstitution(const QDomElement &dom, const std::vector<BType> &typeInfos, Arena &arena);
+
+    // Streaming variants: no DOM is built. The stream must be positioned on the
+    // start element of the substitution; on return it is on the matching end element.
+    Subst readSubstitution(QXmlStreamReader &stream, const std::vector<BType> &typeInfos);
+    Subst readSubstitution(QXmlStreamReader &stream, const std::vector<BType> &typeInfos, Arena &arena);
 }
 
 #endif // SUBSTREADER_H
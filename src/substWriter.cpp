@@ -0,0 +1,218 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "exprWriter.h"
+#include "predWriter.h"
+#include "substWriter.h"
+
+namespace Xml {
+
+    class SubstWriterVisitor : public Subst::Visitor {
+        public:
+            void visitSkip(){
+                stream.writeEmptyElement("Skip");
+            };
+            void visitBlock(const Subst &s){
+                stream.writeStartElement("Bloc_Sub");
+                s.accept(*this);
+                stream.writeEndElement(); // Bloc_Sub
+            };
+            void visitAssert(const Pred &p, const Subst &s){
+                stream.writeStartElement("Assert_Sub");
+                writeWrapped("Guard",p);
+                writeWrapped("Body",s);
+                stream.writeEndElement(); // Assert_Sub
+            };
+            void visitIfThen(const Pred &p, const Subst &s){
+                stream.writeStartElement("If_Sub");
+                writeWrapped("Condition",p);
+                writeWrapped("Then",s);
+                stream.writeEndElement(); // If_Sub
+            };
+            void visitIfThenElse(const Pred &p, const Subst &s_if, const Subst &s_else){
+                stream.writeStartElement("If_Sub");
+                writeWrapped("Condition",p);
+                writeWrapped("Then",s_if);
+                writeWrapped("Else",s_else);
+                stream.writeEndElement(); // If_Sub
+            };
+            void visitSimpleAssignment(const std::vector<TypedVar> &variables, const std::vector<Expr> &values){
+                stream.writeStartElement("Simple_Assignement_Sub");
+                writeVariables("Variables",variables);
+                stream.writeStartElement("Values");
+                for(auto &e : values)
+                    writeExpression(stream,typeInfos,e);
+                stream.writeEndElement(); // Values
+                stream.writeEndElement(); // Simple_Assignement_Sub
+            };
+            void visitSelect(const std::vector<std::pair<Pred,Subst>> &clauses){
+                stream.writeStartElement("Select");
+                writeWhenClauses(clauses);
+                stream.writeEndElement(); // Select
+            };
+            void visitSelectElse(const std::vector<std::pair<Pred,Subst>> &clauses, const Subst &els){
+                stream.writeStartElement("Select");
+                writeWhenClauses(clauses);
+                writeWrapped("Else",els);
+                stream.writeEndElement(); // Select
+            };
+            void visitCase(const Expr &e, const std::vector<Subst::CaseChoice> &cases){
+                stream.writeStartElement("Case_Sub");
+                writeChoices(e,cases);
+                stream.writeEndElement(); // Case_Sub
+            };
+            void visitCaseElse(const Expr &e, const std::vector<Subst::CaseChoice> &cases, const Subst &els){
+                stream.writeStartElement("Case_Sub");
+                writeChoices(e,cases);
+                writeWrapped("Else",els);
+                stream.writeEndElement(); // Case_Sub
+            };
+            void visitAny(const std::vector<TypedVar> &vars, const Pred &p, const Subst &body){
+                stream.writeStartElement("ANY_Sub");
+                writeVariables("Variables",vars);
+                writeWrapped("Pred",p);
+                writeWrapped("Then",body);
+                stream.writeEndElement(); // ANY_Sub
+            };
+            void visitOpCall(const std::vector<Expr> &input, const std::vector<TypedVar> &output,
+                    const std::shared_ptr<const Subst::Operation> &op){
+                stream.writeStartElement("Operation_Call");
+                stream.writeStartElement("Name");
+                stream.writeEmptyElement("Id");
+                stream.writeAttribute("value",QString::fromStdString(op->name));
+                stream.writeEndElement(); // Name
+                stream.writeStartElement("Input_Parameters");
+                for(auto &e : input)
+                    writeExpression(stream,typeInfos,e);
+                stream.writeEndElement(); // Input_Parameters
+                writeVariables("Output_Parameters",output);
+                // The definition is repeated at each call, as in the files produced by the proof obligation generator
+                stream.writeStartElement("Operation");
+                stream.writeAttribute("name",QString::fromStdString(op->name));
+                writeVariables("Output_Parameters",op->output);
+                writeVariables("Input_Parameters",op->input);
+                writeWrapped("Precondition",op->precondition);
+                writeWrapped("Body",op->body);
+                stream.writeEndElement(); // Operation
+                stream.writeEndElement(); // Operation_Call
+            };
+            void visitWhile(const Pred &cond, const Subst &body, const Pred &inv, const Expr &var){
+                stream.writeStartElement("While");
+                writeWrapped("Condition",cond);
+                writeWrapped("Body",body);
+                writeWrapped("Invariant",inv);
+                stream.writeStartElement("Variant");
+                writeExpression(stream,typeInfos,var);
+                stream.writeEndElement(); // Variant
+                stream.writeEndElement(); // While
+            };
+            void visitSequence(const std::vector<Subst> &vec){
+                writeNary(";",vec);
+            };
+            void visitParallel(const std::vector<Subst> &vec){
+                writeNary("||",vec);
+            };
+            void visitChoice(const std::vector<Subst> &vec){
+                writeNary("CHOICE",vec);
+            };
+            void visitWitness(const std::map<std::string,Expr> &witnesses,const Subst &body){
+                stream.writeStartElement("Witness");
+                stream.writeStartElement("Witnesses");
+                // A single witness is written without the conjunction
+                if(witnesses.size() != 1){
+                    stream.writeStartElement("Nary_Pred");
+                    stream.writeAttribute("op","&");
+                }
+                for(auto &w : witnesses){
+                    stream.writeStartElement("Exp_Comparison");
+                    stream.writeAttribute("op","=");
+                    stream.writeEmptyElement("Id");
+                    stream.writeAttribute("value",QString::fromStdString(w.first));
+                    stream.writeAttribute("typref",QString::number(getTypRef(typeInfos,w.second.getType())));
+                    writeExpression(stream,typeInfos,w.second);
+                    stream.writeEndElement(); // Exp_Comparison
+                }
+                if(witnesses.size() != 1)
+                    stream.writeEndElement(); // Nary_Pred
+                stream.writeEndElement(); // Witnesses
+                writeWrapped("Body",body);
+                stream.writeEndElement(); // Witness
+            };
+            SubstWriterVisitor(QXmlStreamWriter &s,std::map<BType,unsigned int> &typeInfos):
+                stream{s},
+                typeInfos{typeInfos}
+            {};
+        private:
+            QXmlStreamWriter &stream;
+            std::map<BType,unsigned int> &typeInfos;
+
+            // The following write the single child of a wrapper element such as 'Body' or 'Condition'
+            void writeWrapped(const char *tag, const Pred &p){
+                stream.writeStartElement(tag);
+                writePredicate(stream,typeInfos,p);
+                stream.writeEndElement();
+            }
+            void writeWrapped(const char *tag, const Subst &s){
+                stream.writeStartElement(tag);
+                s.accept(*this);
+                stream.writeEndElement();
+            }
+            void writeVariables(const char *tag, const std::vector<TypedVar> &vars){
+                stream.writeStartElement(tag);
+                for(auto &v : vars)
+                    writeTypedVar(stream,typeInfos,v);
+                stream.writeEndElement();
+            }
+            void writeWhenClauses(const std::vector<std::pair<Pred,Subst>> &clauses){
+                stream.writeStartElement("When_Clauses");
+                for(auto &c : clauses){
+                    stream.writeStartElement("When");
+                    writeWrapped("Condition",c.first);
+                    writeWrapped("Then",c.second);
+                    stream.writeEndElement(); // When
+                }
+                stream.writeEndElement(); // When_Clauses
+            }
+            void writeChoices(const Expr &e, const std::vector<Subst::CaseChoice> &cases){
+                stream.writeStartElement("Value");
+                writeExpression(stream,typeInfos,e);
+                stream.writeEndElement(); // Value
+                stream.writeStartElement("Choices");
+                for(auto &c : cases){
+                    stream.writeStartElement("Choice");
+                    for(auto &v : c.values){
+                        stream.writeStartElement("Value");
+                        writeExpression(stream,typeInfos,v);
+                        stream.writeEndElement(); // Value
+                    }
+                    writeWrapped("Then",c.body);
+                    stream.writeEndElement(); // Choice
+                }
+                stream.writeEndElement(); // Choices
+            }
+            void writeNary(const char *op, const std::vector<Subst> &vec){
+                stream.writeStartElement("Nary_Sub");
+                stream.writeAttribute("op",op);
+                for(auto &s : vec)
+                    s.accept(*this);
+                stream.writeEndElement(); // Nary_Sub
+            }
+    };
+
+    void writeSubstitution(QXmlStreamWriter &stream, std::map<BType,unsigned int> &typeInfos, const Subst &s){
+        SubstWriterVisitor v(stream, typeInfos);
+        s.accept(v);
+    }
+}
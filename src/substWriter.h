@@ -0,0 +1,28 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef SUBSTWRITER_H
+#define SUBSTWRITER_H
+
+#include "subst.h"
+#include "btype.h"
+#include <QXmlStreamWriter>
+
+namespace Xml {
+    // Writes s in the format read by readSubstitution. The types are numbered in typeInfos, as by writeExpression.
+    void writeSubstitution(QXmlStreamWriter &stream, std::map<BType,unsigned int> &typeInfos, const Subst &s);
+}
+
+#endif // SUBSTWRITER_H
@@ -0,0 +1,138 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "tagSet.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace {
+    /* As for the identifier interner (see vars.cpp), the lists are stored in
+     * fixed-size chunks that are never moved, so get() does not take the
+     * lock. */
+    class Table {
+        public:
+            static const size_t ChunkSize = 1024;
+            static const size_t MaxChunks = 4096;
+
+            Table():next{1}{
+                for(auto &c : chunks)
+                    c.store(nullptr,std::memory_order_relaxed);
+            }
+            ~Table(){
+                for(auto &c : chunks)
+                    delete[] c.load(std::memory_order_relaxed);
+            }
+
+            TagSet::Id intern(const TagSet::List &tags){
+                std::string k = key(tags);
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = ids.find(k);
+                if(it != ids.end())
+                    return it->second;
+                if(next >= ChunkSize * MaxChunks)
+                    throw std::length_error("Too many distinct lists of bxml tags.");
+                TagSet::Id res = next++;
+                slot(res) = tags;
+                ids.emplace(std::move(k),res);
+                return res;
+            }
+
+            const TagSet::List &get(TagSet::Id id) const {
+                return chunks[id / ChunkSize].load(std::memory_order_acquire)[id % ChunkSize];
+            }
+
+            TagSet::Id concat(TagSet::Id a, TagSet::Id b){
+                uint64_t k = (static_cast<uint64_t>(a) << 32) | b;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    auto it = concats.find(k);
+                    if(it != concats.end())
+                        return it->second;
+                }
+                // the tags already in a are not repeated: substituting again and
+                // again (x := x) gives back a instead of ever longer lists
+                const TagSet::List &prefix = get(a);
+                TagSet::List tags = prefix;
+                for(auto &t : get(b)){
+                    if(std::find(tags.begin(),tags.end(),t) == tags.end())
+                        tags.push_back(t);
+                }
+                TagSet::Id res = (tags.size() == prefix.size()) ? a : intern(tags);
+                std::lock_guard<std::mutex> lock(mutex);
+                concats.emplace(k,res);
+                return res;
+            }
+
+        private:
+            // Each tag is preceded by its length, so that distinct lists have distinct keys
+            static std::string key(const TagSet::List &tags){
+                std::string res;
+                for(auto &t : tags){
+                    res += std::to_string(t.size());
+                    res += ':';
+                    res += t;
+                }
+                return res;
+            }
+
+            // Only called with the lock held
+            TagSet::List &slot(TagSet::Id id){
+                std::atomic<TagSet::List*> &chunk = chunks[id / ChunkSize];
+                TagSet::List *c = chunk.load(std::memory_order_relaxed);
+                if(c == nullptr){
+                    c = new TagSet::List[ChunkSize];
+                    chunk.store(c,std::memory_order_release);
+                }
+                return c[id % ChunkSize];
+            }
+
+            std::mutex mutex;
+            std::unordered_map<std::string,TagSet::Id> ids;
+            std::unordered_map<uint64_t,TagSet::Id> concats;
+            std::atomic<TagSet::List*> chunks[MaxChunks];
+            TagSet::Id next;
+    };
+
+    Table &table(){
+        static Table t;
+        return t;
+    }
+
+    const TagSet::List emptyList;
+}
+
+TagSet::Id TagSet::intern(const TagSet::List &tags){
+    if(tags.empty())
+        return Empty;
+    return table().intern(tags);
+}
+
+const TagSet::List& TagSet::get(Id id){
+    if(id == Empty)
+        return emptyList;
+    return table().get(id);
+}
+
+TagSet::Id TagSet::concat(Id a, Id b){
+    if(b == Empty)
+        return a;
+    if(a == Empty)
+        return b;
+    return table().concat(a,b);
+}
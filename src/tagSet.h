@@ -0,0 +1,50 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TAGSET_H
+#define TAGSET_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** \brief Interned lists of bxml traceability tags.
+ *
+ * Most expressions carry no tag, or one of a small number of tag lists.
+ * Each distinct list is stored once in a global table, and an expression
+ * only keeps its 32-bit id. The lists are never freed, so the references
+ * returned by get() stay valid. Safe to call from several threads.
+ *
+ * The table thus grows with the number of distinct lists met during the
+ * run: each one costs its strings twice (the list and its lookup key), plus
+ * the memoized concatenations that produced it. It holds at most 4194304
+ * lists (4096 chunks of 1024); beyond, intern and concat throw
+ * std::length_error.
+ */
+namespace TagSet {
+    typedef std::vector<std::string> List;
+    typedef uint32_t Id;
+    // Id of the empty list
+    const Id Empty = 0;
+
+    Id intern(const List &tags);
+    const List& get(Id id);
+    // Id of the tags of a followed by the tags of b that are not in a. The
+    // result has at most one copy of each tag of b, so concatenating the same
+    // tags again (as repeated substitutions do) creates no new list.
+    Id concat(Id a, Id b);
+}
+
+#endif // TAGSET_H
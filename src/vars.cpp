@@ -14,30 +14,108 @@
 */
 
 #include "vars.h"
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
 #include <unordered_map>
 
-std::unordered_map<std::string,int> stringToPrefix;
-std::vector<std::string> prefixToString;
+namespace {
+    /* Identifier interner shared by all threads.
+     *
+     * Lookups are spread over shards, each protected by its own mutex.
+     * The strings themselves are stored in fixed-size chunks that are never
+     * moved, so prefix() reads them without taking any lock while other
+     * threads keep inserting. The 64-bit hash of each string is stored next
+     * to it, so that VarName::hash_combine does not hash the string again. */
+    class PrefixTable {
+        public:
+            static const size_t ShardCount = 16;
+            static const size_t ChunkSize = 4096;
+            static const size_t MaxChunks = 4096;
 
-int mkPrefix(const std::string &s){
-    auto it = stringToPrefix.find(s);
-    if(it == stringToPrefix.end()){
-        int res = prefixToString.size();
-        prefixToString.push_back(s);
-        stringToPrefix[s] = res;
-        return res;
-    } else {
-        return it->second;
+            PrefixTable():next{0}{
+                for(auto &c : chunks)
+                    c.store(nullptr,std::memory_order_relaxed);
+            }
+            ~PrefixTable(){
+                for(auto &c : chunks)
+                    delete[] c.load(std::memory_order_relaxed);
+            }
+
+            int intern(const std::string &s){
+                uint64_t h = hashUtil::hash_bytes(s.data(),s.size());
+                Shard &shard = shards[h % ShardCount];
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                auto it = shard.map.find(s);
+                if(it != shard.map.end())
+                    return it->second;
+                int res = next.fetch_add(1,std::memory_order_relaxed);
+                if(static_cast<size_t>(res) >= ChunkSize * MaxChunks)
+                    throw std::length_error("Too many distinct identifier prefixes.");
+                slot(res) = {s,h};
+                shard.map.emplace(s,res);
+                return res;
+            }
+
+            // The string is written before the identifier leaves intern(),
+            // and a chunk is published before any of its slots is used.
+            const std::string &get(int id) const {
+                return entry(id).str;
+            }
+            uint64_t hash(int id) const {
+                return entry(id).hash;
+            }
+
+        private:
+            struct Entry {
+                std::string str;
+                uint64_t hash;
+            };
+
+            struct Shard {
+                std::mutex mutex;
+                std::unordered_map<std::string,int> map;
+            };
+
+            const Entry &entry(int id) const {
+                return chunks[id / ChunkSize].load(std::memory_order_acquire)[id % ChunkSize];
+            }
+
+            Entry &slot(int id){
+                std::atomic<Entry*> &chunk = chunks[id / ChunkSize];
+                Entry *c = chunk.load(std::memory_order_acquire);
+                if(c == nullptr){
+                    Entry *fresh = new Entry[ChunkSize];
+                    if(chunk.compare_exchange_strong(c,fresh,std::memory_order_acq_rel))
+                        c = fresh;
+                    else
+                        delete[] fresh; // another shard installed it first
+                }
+                return c[id % ChunkSize];
+            }
+
+            Shard shards[ShardCount];
+            std::atomic<Entry*> chunks[MaxChunks];
+            std::atomic<int> next;
+    };
+
+    PrefixTable &prefixTable(){
+        static PrefixTable table;
+        return table;
     }
 }
 
-const std::string &VarName::prefix() const { return prefixToString[_prefix]; };
+int mkPrefix(const std::string &s){
+    return prefixTable().intern(s);
+}
 
-static int varname_cpt = -2;
-VarName VarName::makeTmp(const std::string &p){ varname_cpt--; return VarName(p,varname_cpt); };
+const std::string &VarName::prefix() const { return prefixTable().get(_prefix); };
+
+static std::atomic<int> varname_cpt{-2};
+VarName VarName::makeTmp(const std::string &p){ return VarName(p,--varname_cpt); };
 
 size_t VarName::hash_combine(size_t seed) const {
-    return hashUtil::hash_combine_int(_suffix,hashUtil::hash_combine_string(prefix(),seed));
+    return hashUtil::hash_combine_int(_suffix,hashUtil::hash_combine_hash(static_cast<size_t>(prefixTable().hash(_prefix)),seed));
 };
 
 size_t TypedVar::hash_combine(size_t seed) const {
@@ -102,6 +180,94 @@ VarName VarName::getFreshVar(const VarName &v, const std::set<VarName> &set){
     assert(false); // unreachable
 }
 
+// The same, in O(log n): the highest suffix in use is the last name with the prefix
+VarName VarName::getFreshVar(const std::string &prefix, const VarSet &set){
+    return FreshNames(set).fresh(prefix);
+}
+
+VarName VarName::getFreshVar(const VarName &v, const VarSet &set){
+    if(!set.contains(v))
+        return v;
+    switch(v.kind()){
+        case Kind::NoSuffix:
+        case Kind::WithSuffix:
+            return FreshNames(set).fresh(v);
+        case Kind::FreshId:
+            assert(false);
+        case Kind::Tmp:
+            return makeTmp(v.prefix());
+    };
+    assert(false); // unreachable
+    throw std::logic_error("Unknown kind of variable name.");
+}
+
+bool VarSet::insert(const VarName &v){
+    if(vars.empty() || vars.back() < v){
+        vars.push_back(v);
+    } else {
+        auto it = std::lower_bound(vars.begin(),vars.end(),v);
+        if(*it == v)
+            return false;
+        vars.insert(it,v);
+    }
+    if(!prefixes.empty())
+        addPrefix(v._prefix);
+    else if(vars.size() > SmallSize)
+        updatePrefixes(0);
+    return true;
+}
+
+bool VarSet::contains(const VarName &v) const {
+    if(!prefixes.empty() && !hasPrefix(v._prefix))
+        return false;
+    return std::binary_search(vars.begin(),vars.end(),v);
+}
+
+const VarName *VarSet::lastWithPrefix(const VarName &v) const {
+    if(!prefixes.empty() && !hasPrefix(v._prefix))
+        return nullptr;
+    auto it = std::upper_bound(vars.begin(),vars.end(),v,
+            [](const VarName &v1, const VarName &v2){ return v1._prefix < v2._prefix; });
+    if(it == vars.begin() || (it-1)->_prefix != v._prefix)
+        return nullptr;
+    return &*(it-1);
+}
+
+void VarSet::updatePrefixes(size_t first){
+    if(vars.size() <= SmallSize)
+        return;
+    if(prefixes.empty())
+        first = 0;
+    for(size_t i=first;i<vars.size();i++)
+        addPrefix(vars[i]._prefix);
+}
+
+int &FreshNames::watermark(const VarName &v){
+    auto it = watermarks.find(v._prefix);
+    if(it != watermarks.end())
+        return it->second;
+    int w = Unused;
+    const VarName *last = (vars == nullptr) ? nullptr : vars->lastWithPrefix(v);
+    if(last != nullptr && last->_suffix > Unused) // the temporary and fresh ids sort first
+        w = last->_suffix;
+    return watermarks.emplace(v._prefix,w).first->second;
+}
+
+void FreshNames::use(const VarName &v){
+    if(v._suffix == -1 || v._suffix > 0){
+        int &w = watermark(v);
+        w = std::max(w,v._suffix);
+    }
+}
+
+VarName FreshNames::fresh(const VarName &v){
+    int &w = watermark(v);
+    VarName res = v;
+    res._suffix = (w == Unused) ? -1 : std::max(w,0) + 1;
+    w = res._suffix;
+    return res;
+}
+
 int TypedVar::compare(const TypedVar &v1, const TypedVar& v2){
     int i = VarName::compare(v1.name,v2.name);
     if(i != 0) return i;
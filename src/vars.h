@@ -18,11 +18,19 @@
 
 #include <string>
 #include <set>
+#include <vector>
+#include <atomic>
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <unordered_map>
 #include "btype.h"
 
+// Interns an identifier. Safe to call from several threads.
 int mkPrefix(const std::string &s);
 
+class VarSet;
+
 struct VarName {
     enum class Kind { 
         NoSuffix, // Ident without suffix (ex: toto)
@@ -69,7 +77,11 @@ struct VarName {
     // Misc
     static VarName getFreshVar(const std::string &prefix, const std::set<VarName> &set);
     static VarName getFreshVar(const VarName &v, const std::set<VarName> &set);
+    static VarName getFreshVar(const std::string &prefix, const VarSet &set);
+    static VarName getFreshVar(const VarName &v, const VarSet &set);
   private:
+    friend class VarSet;
+    friend class FreshNames;
     // Members
     int _prefix;
     int _suffix; // -1 means no suffix
@@ -102,6 +114,159 @@ struct TypedVar {
     size_t hash_combine(size_t seed) const ;
 };
 
+/** \brief Set of variable names, as a sorted vector.
+ *
+ * Used instead of std::set<VarName> to collect variables: no node is
+ * allocated per variable, and the names are iterated in the same order.
+ * Inserting names in increasing order appends them. Beyond SmallSize names,
+ * a bitset over the interned prefixes is kept, so that most of the negative
+ * membership tests do not search the vector.
+ */
+class VarSet {
+    public:
+        typedef std::vector<VarName>::const_iterator const_iterator;
+        static const size_t SmallSize = 16;
+
+        // Returns false if v was already in the set
+        bool insert(const VarName &v);
+        // Inserts the names of the range, in any order
+        template<typename It> void insert(It first, It last){
+            size_t n = vars.size();
+            vars.insert(vars.end(),first,last);
+            if(vars.size() == n)
+                return;
+            if(!std::is_sorted(vars.begin() + n,vars.end()))
+                std::sort(vars.begin() + n,vars.end());
+            updatePrefixes(n);
+            if(n > 0 && vars[n-1] >= vars[n])
+                std::inplace_merge(vars.begin(),vars.begin() + n,vars.end());
+            vars.erase(std::unique(vars.begin(),vars.end()),vars.end());
+        }
+        void insert(const VarSet &other){ insert(other.begin(),other.end()); };
+
+        bool contains(const VarName &v) const;
+        // The greatest name with the prefix of v, or nullptr if there is none
+        const VarName *lastWithPrefix(const VarName &v) const;
+        // Same as contains, for the code written against std::set
+        size_t count(const VarName &v) const { return contains(v) ? 1 : 0; };
+
+        size_t size() const { return vars.size(); };
+        bool empty() const { return vars.empty(); };
+        const_iterator begin() const { return vars.begin(); };
+        const_iterator end() const { return vars.end(); };
+        void clear(){ vars.clear(); prefixes.clear(); };
+
+    private:
+        std::vector<VarName> vars; // sorted, without duplicates
+        std::vector<uint64_t> prefixes; // empty while size() <= SmallSize
+
+        bool hasPrefix(int p) const {
+            size_t i = static_cast<size_t>(p) / 64;
+            return i < prefixes.size() && (prefixes[i] >> (p % 64) & 1) != 0;
+        };
+        void addPrefix(int p){
+            size_t i = static_cast<size_t>(p) / 64;
+            if(i >= prefixes.size())
+                prefixes.resize(i + 1,0);
+            prefixes[i] |= uint64_t(1) << (p % 64);
+        };
+        // Records the prefixes of the names appended from index first
+        void updatePrefixes(size_t first);
+};
+
+/** \brief Fresh names within a scope or a document.
+ *
+ * Keeps, for each prefix, the highest suffix in use, so that a fresh name is
+ * found in constant time instead of probing the suffixes one by one. The
+ * names in use are those of the VarSet given to the constructor, if any, and
+ * the ones given to use or returned by fresh. The first fresh name for an
+ * unused prefix has no suffix; the following ones are prefix$(n+1), where n
+ * is the highest suffix in use, so the result only depends on the names in use.
+ */
+class FreshNames {
+    public:
+        FreshNames():vars{nullptr}{};
+        // vars must outlive this object and must not be modified meanwhile
+        explicit FreshNames(const VarSet &vars):vars{&vars}{};
+
+        void use(const VarName &v);
+        // A name with the prefix of v that is not in use. It is then in use.
+        VarName fresh(const VarName &v);
+        VarName fresh(const std::string &prefix){ return fresh(VarName::makeVarWithoutSuffix(prefix)); };
+
+    private:
+        static const int Unused = -2; // neither the name without suffix nor a suffix is in use
+        const VarSet *vars;
+        // By prefix: highest suffix in use, -1 if only the name without suffix is
+        std::unordered_map<int,int> watermarks;
+        int &watermark(const VarName &v);
+};
+
+/** \brief Lazily computed free variables of a node, as a sorted vector.
+ *
+ * Empty until the first call to get. Several threads may call get
+ * concurrently; reset must only be called by the owner of the node, before
+ * modifying it. A copy starts empty.
+ */
+class FreeVarsCache {
+    public:
+        FreeVarsCache():value{nullptr}{};
+        FreeVarsCache(const FreeVarsCache &):value{nullptr}{};
+        FreeVarsCache& operator=(const FreeVarsCache &){ reset(); return *this; };
+        ~FreeVarsCache(){ reset(); };
+
+        template<typename F> const std::vector<VarName>& get(F compute) const {
+            const std::vector<VarName> *v = value.load(std::memory_order_acquire);
+            if(v == nullptr){
+                const auto fv = compute(); // std::set<VarName> or VarSet
+                const std::vector<VarName> *fresh = new std::vector<VarName>(fv.begin(),fv.end());
+                if(value.compare_exchange_strong(v,fresh,std::memory_order_acq_rel))
+                    v = fresh;
+                else
+                    delete fresh; // computed by another thread, now in v
+            }
+            return *v;
+        }
+        void reset(){ delete value.exchange(nullptr); };
+
+    private:
+        mutable std::atomic<const std::vector<VarName>*> value;
+};
+
+/** \brief Variables bound in the current scope, numbered by de Bruijn level.
+ *
+ * The level of a bound variable is its position among all the variables
+ * bound from the root down to the current scope.
+ */
+class Binders {
+    public:
+        void push(const std::vector<TypedVar> &vars){
+            for(auto &v : vars)
+                names.push_back(v.name);
+            sizes.push_back(vars.size());
+        };
+        void pop(){
+            names.erase(names.end() - sizes.back(),names.end());
+            sizes.pop_back();
+        };
+        // Level of the innermost binder of v, or -1 if v is free
+        int level(const VarName &v) const {
+            for(size_t i=names.size();i>0;i--){
+                if(names[i-1] == v)
+                    return i-1;
+            }
+            return -1;
+        };
+    private:
+        std::vector<VarName> names;
+        std::vector<size_t> sizes;
+};
+
+/** \brief Pair of scopes of alpha_equals.
+ *
+ * Two identifiers are equal if they are bound at the same level, or if both
+ * are free and have the same name.
+ */
 class Context {
     public:
         bool push(const std::vector<TypedVar> &vars1, const std::vector<TypedVar> &vars2){
@@ -112,48 +277,27 @@ class Context {
                     if(vars1[i].type != vars2[i].type)
                         return false;
                 }
-                vec1.push_back(vars1);
-                vec2.push_back(vars2);
+                binders1.push(vars1);
+                binders2.push(vars2);
                 return true;
             } else {
                 return false;
             }
         };
-        static void get_pair(
-                const std::vector<std::vector<TypedVar>> vec, const VarName &v,
-                bool &found, std::pair<size_t,size_t> &pos)
-        {
-            for(size_t i=0;i<vec.size();i++){
-                for(size_t j=0;j<vec[i].size();j++){
-                    if(v == vec[i][j].name){
-                        found = true;
-                        pos = {i,j};
-                        return;
-                    }
-                }
-            }
-            found = false;
-        }
-        bool equals(const VarName &v1, const VarName &v2){
-            bool v1_found, v2_found;
-            std::pair<size_t,size_t> p1, p2;
-            get_pair(vec1,v1,v1_found,p1);
-            get_pair(vec2,v2,v2_found,p2);
-            if(v1_found && v2_found){
-                return p1 == p2;
-            } else if (!v1_found && !v2_found){
+        bool equals(const VarName &v1, const VarName &v2) const {
+            int l1 = binders1.level(v1);
+            int l2 = binders2.level(v2);
+            if(l1 < 0 && l2 < 0)
                 return v1 == v2;
-            } else {
-                return false;
-            }
+            return l1 == l2;
         }
         void pop(){
-            vec1.pop_back();
-            vec2.pop_back();
+            binders1.pop();
+            binders2.pop();
         };
     private:
-        std::vector<std::vector<TypedVar>> vec1;
-        std::vector<std::vector<TypedVar>> vec2;
+        Binders binders1;
+        Binders binders2;
 };
 
 #endif // VARS_H
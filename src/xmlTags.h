@@ -0,0 +1,66 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef XMLTAGS_H
+#define XMLTAGS_H
+
+#include <QStringList>
+#include <vector>
+#include "tagSet.h"
+#include "strTable.h"
+
+/* The core stores the bxml tags as standard strings, so that it does not
+ * depend on Qt. These conversions are used at the boundary with the Qt
+ * based readers and writers. */
+namespace Xml {
+    inline TagSet::List toBxmlTag(const QStringList &tags){
+        TagSet::List res;
+        res.reserve(tags.size());
+        for(auto &t : tags)
+            res.push_back(t.toStdString());
+        return res;
+    }
+
+    inline QStringList toQStringList(const TagSet::List &tags){
+        QStringList res;
+        for(auto &t : tags)
+            res << QString::fromStdString(t);
+        return res;
+    }
+
+    // Lookup of an element or attribute name, on its UTF-16 code units
+    template <typename V, size_t N>
+    inline const typename StrTable<V,N>::Entry* find(const StrTable<V,N> &table, const QString &s){
+        return table.find(s.utf16(),s.size());
+    }
+    template <typename V, size_t N>
+    inline const typename StrTable<V,N>::Entry* find(const StrTable<V,N> &table, const QStringRef &s){
+        return table.find(reinterpret_cast<const ushort*>(s.unicode()),s.size());
+    }
+
+    /* Name of an operator as a QString. The names of the operators of type Op
+     * (up to last) are converted once, so that writing them does not allocate. */
+    template <typename Op>
+    const QString& toQString(Op op, Op last, const char *(*name)(Op)){
+        static const std::vector<QString> names = [last,name](){
+            std::vector<QString> res;
+            for(size_t i=0;i<=static_cast<size_t>(last);i++)
+                res.push_back(QString::fromLatin1(name(static_cast<Op>(i))));
+            return res; }();
+        return names[static_cast<size_t>(op)];
+    }
+}
+
+#endif // XMLTAGS_H
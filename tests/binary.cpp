@@ -0,0 +1,88 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "check.h"
+#include "binReader.h"
+#include "fingerprint.h"
+
+// Deeper than the call stack allows
+static const int chainLength = 1000000;
+
+static Expr additionChain(){
+    Expr e = Expr::makeIdent(VarName::makeVarWithoutSuffix("x"),BType::INT);
+    for(int i=0;i<chainLength;i++)
+        e = Expr::makeBinaryExpr(Expr::BinaryOp::IAddition,std::move(e),Expr::makeInteger("1"),BType::INT);
+    return e;
+}
+
+// (... ((x+1)+1 = 0) & btrue) & btrue ...
+static Pred conjunctionChain(){
+    Pred p = Pred::makeExprComparison(Pred::ComparisonOp::Equality,additionChain(),Expr::makeInteger("0"));
+    for(int i=0;i<chainLength;i++){
+        std::vector<Pred> vec;
+        vec.push_back(std::move(p));
+        vec.push_back(Pred::makeTrue());
+        p = Pred::makeConjunction(std::move(vec));
+    }
+    return p;
+}
+
+// skip ; (skip ; (skip ; ...))
+static Subst sequenceChain(){
+    Subst s = Subst::makeSkip();
+    for(int i=0;i<chainLength;i++){
+        std::vector<Subst> vec;
+        vec.push_back(Subst::makeSkip());
+        vec.push_back(std::move(s));
+        s = Subst::makeSequence(std::move(vec));
+    }
+    return s;
+}
+
+static bool deepChains(){
+    const Pred p = conjunctionChain();
+    const Subst s = sequenceChain();
+    Bin::Writer writer;
+    writer.writePredicate(p);
+    writer.writeSubstitution(s);
+    const std::string data = writer.data();
+    Bin::Reader reader(data.data(),data.size());
+    CHECK(Fingerprint::of(reader.readPredicate()) == Fingerprint::of(p));
+    CHECK(Fingerprint::of(reader.readSubstitution()) == Fingerprint::of(s));
+    CHECK(reader.atEnd());
+    return true;
+}
+
+static bool truncatedData(){
+    Bin::Writer writer;
+    writer.writeExpression(additionChain());
+    const std::string data = writer.data();
+    bool thrown = false;
+    try {
+        Bin::Reader reader(data.data(),data.size() - 1);
+        reader.readExpression();
+    } catch(const Bin::ReaderException &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    return true;
+}
+
+int main(){
+    bool ok = true;
+    ok = deepChains() && ok;
+    ok = truncatedData() && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,33 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <iostream>
+
+/**
+ * Fails the enclosing test function if cond does not hold. Unlike assert,
+ * stays active when NDEBUG is defined.
+ */
+#define CHECK(cond) \
+    do { \
+        if(!(cond)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond << std::endl; \
+            return false; \
+        } \
+    } while(0)
+
+#endif // CHECK_H
@@ -0,0 +1,67 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "check.h"
+#include "fingerprint.h"
+#include "pred.h"
+
+static Pred xIsZero(){
+    const VarName x = VarName::makeVarWithoutSuffix("x");
+    return Pred::makeExprComparison(Pred::ComparisonOp::Equality,
+                                    Expr::makeIdent(x,BType::INT),
+                                    Expr::makeInteger("0"));
+}
+
+static std::vector<TypedVar> xVars(){
+    return {TypedVar(VarName::makeVarWithoutSuffix("x"),BType::INT)};
+}
+
+// Same construction, same fingerprint
+static bool equalPredicates(){
+    CHECK(Fingerprint::of(Pred::makeExists(xVars(),xIsZero()))
+          == Fingerprint::of(Pred::makeExists(xVars(),xIsZero())));
+    return true;
+}
+
+// The binary format stores the witness flag of EXISTS, so must the fingerprint
+static bool existsWitnessFlag(){
+    CHECK(Fingerprint::of(Pred::makeExists(xVars(),xIsZero()))
+          != Fingerprint::of(Pred::makeExistsForWitness(xVars(),xIsZero())));
+    return true;
+}
+
+// Deeper than the call stack allows: ((x+1)+1)+... and not not ... x = 0
+static const int chainLength = 1000000;
+
+static bool deepChains(){
+    const VarName x = VarName::makeVarWithoutSuffix("x");
+    Expr e = Expr::makeIdent(x,BType::INT);
+    for(int i=0;i<chainLength;i++)
+        e = Expr::makeBinaryExpr(Expr::BinaryOp::IAddition,std::move(e),Expr::makeInteger("1"),BType::INT);
+    CHECK(Fingerprint::of(e) == Fingerprint::of(e.copy()));
+    Pred p = xIsZero();
+    for(int i=0;i<chainLength;i++)
+        p = Pred::makeNegation(std::move(p));
+    CHECK(Fingerprint::of(p) != Fingerprint::of(Pred::makeNegation(p.copy())));
+    return true;
+}
+
+int main(){
+    bool ok = true;
+    ok = equalPredicates() && ok;
+    ok = existsWitnessFlag() && ok;
+    ok = deepChains() && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "check.h"
+#include "fingerprint.h"
+#include "pred.h"
+
+// Deeper than the call stack allows
+static const int chainLength = 1000000;
+
+// ((v+1)+1)+... = 0
+static Pred additionChain(const VarName &v){
+    Expr e = Expr::makeIdent(v,BType::INT);
+    for(int i=0;i<chainLength;i++)
+        e = Expr::makeBinaryExpr(Expr::BinaryOp::IAddition,std::move(e),Expr::makeInteger("1"),BType::INT);
+    return Pred::makeExprComparison(Pred::ComparisonOp::Equality,std::move(e),Expr::makeInteger("0"));
+}
+
+// not not ... p
+static Pred negationChain(Pred &&p){
+    for(int i=0;i<chainLength;i++)
+        p = Pred::makeNegation(std::move(p));
+    return std::move(p);
+}
+
+static bool deepChains(){
+    const VarName x = VarName::makeVarWithoutSuffix("x");
+    const VarName y = VarName::makeVarWithoutSuffix("y");
+    const Pred p = negationChain(additionChain(x));
+    Pred q = p.copy();
+    std::map<VarName,Expr> map;
+    map[x] = Expr::makeIdent(y,BType::INT);
+    q.subst(map);
+    CHECK(Fingerprint::of(q) == Fingerprint::of(negationChain(additionChain(y))));
+    // the copy shared its descriptors with p, which is unchanged
+    CHECK(Fingerprint::of(p) == Fingerprint::of(negationChain(additionChain(x))));
+    return true;
+}
+
+// !x.(x = 0) & x = 1, with x := y + x: the bound x is not substituted
+static bool boundVariables(){
+    const VarName x = VarName::makeVarWithoutSuffix("x");
+    const VarName y = VarName::makeVarWithoutSuffix("y");
+    auto ident = [](const VarName &v){ return Expr::makeIdent(v,BType::INT); };
+    Pred p = Pred::makeExprComparison(Pred::ComparisonOp::Equality,ident(x),Expr::makeInteger("1"));
+    std::vector<Pred> vec;
+    vec.push_back(Pred::makeForall({TypedVar(x,BType::INT)},
+                Pred::makeExprComparison(Pred::ComparisonOp::Equality,ident(x),Expr::makeInteger("0"))));
+    vec.push_back(std::move(p));
+    Pred q = Pred::makeConjunction(std::move(vec));
+    std::map<VarName,Expr> map;
+    map[x] = Expr::makeBinaryExpr(Expr::BinaryOp::IAddition,ident(y),ident(x),BType::INT);
+    q.subst(map);
+    CHECK(q.show() == "(and (forall (x) (= x 0)) (= (+i y x) 1))");
+    return true;
+}
+
+// The helpers of the binders kept in the API of Expr
+static bool renamingHelpers(){
+    const VarName x = VarName::makeVarWithoutSuffix("x");
+    const VarName y = VarName::makeVarWithoutSuffix("y");
+    const VarName z = VarName::makeVarWithoutSuffix("z");
+    const std::set<VarName> freeVars {x,z};
+    VarSet freeVarSet;
+    freeVarSet.insert(freeVars.begin(),freeVars.end());
+    CHECK(Expr::isRenamingNeeded({TypedVar(x,BType::INT)},freeVars));
+    CHECK(Expr::isRenamingNeeded({TypedVar(x,BType::INT)},freeVarSet));
+    CHECK(!Expr::isRenamingNeeded({TypedVar(y,BType::INT)},freeVars));
+    CHECK(!Expr::isRenamingNeeded({TypedVar(y,BType::INT)},freeVarSet));
+
+    std::vector<TypedVar> vars {TypedVar(x,BType::INT),TypedVar(y,BType::BOOL)};
+    std::map<VarName,Expr> map;
+    Expr::renameVars(vars,freeVarSet,map);
+    CHECK(vars[0].name.show() == "x$1" && vars[1].name.show() == "y$1");
+    CHECK(map.size() == 2);
+    CHECK(map[x].show() == "x$1" && map[x].getType() == BType::INT);
+    CHECK(map[y].show() == "y$1" && map[y].getType() == BType::BOOL);
+
+    std::vector<TypedVar> vars2 {TypedVar(z,BType::INT)};
+    std::map<VarName,Expr> map2;
+    Expr::renameVars(vars2,freeVars,map2);
+    CHECK(vars2[0].name.show() == "z$1" && map2[z].show() == "z$1");
+    return true;
+}
+
+int main(){
+    bool ok = true;
+    ok = deepChains() && ok;
+    ok = boundVariables() && ok;
+    ok = renamingHelpers() && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+/*
+   This file is part of BAST.
+   Copyright © CLEARSY 2023
+   BAST is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "check.h"
+#include "expr.h"
+
+static bool concatenation(){
+    const TagSet::Id ab = TagSet::intern({"a","b"});
+    const TagSet::Id bc = TagSet::intern({"b","c"});
+    CHECK(TagSet::get(TagSet::concat(ab,bc)) == TagSet::List({"a","b","c"}));
+    CHECK(TagSet::concat(ab,ab) == ab);
+    CHECK(TagSet::concat(ab,TagSet::intern({"a"})) == ab);
+    CHECK(TagSet::concat(TagSet::Empty,bc) == bc);
+    return true;
+}
+
+// x := x, again and again: the tags of x are not repeated
+static bool repeatedSubstitution(){
+    const VarName x = VarName::makeVarWithoutSuffix("x");
+    Expr e = Expr::makeIdent(x,BType::INT,{"t"});
+    std::map<VarName,Expr> map;
+    map[x] = Expr::makeIdent(x,BType::INT,{"t"});
+    for(int i=0;i<1000;i++)
+        e.subst(map);
+    CHECK(e.getBxmlTag() == TagSet::List({"t"}));
+    return true;
+}
+
+int main(){
+    bool ok = true;
+    ok = concatenation() && ok;
+    ok = repeatedSubstitution() && ok;
+    return ok ? 0 : 1;
+}